@@ -0,0 +1,155 @@
+// Lookup microbenchmark for the B+ trees.
+//
+// Builds in-memory trees of the same random keys with different fanouts (4
+// is the old ORDER) and times point lookups of keys known to be present,
+// with std::map as a reference. Then loads the same keys, encoded as index
+// keys, into a DiskBPlusTree in a scratch directory and times the same
+// lookups there; the pool holds the whole tree, so that measures the
+// search inside the nodes rather than I/O. Each line ends with the sum of
+// the values found, which keeps the lookups from being optimized away.
+// Usage: btree_bench [key count] [lookup count]
+#include "../include/btree.h"
+#include "../include/buffer_pool_manager.h"
+#include "../include/disk_btree.h"
+#include "../include/index_key.h"
+#include "../include/log_manager.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <streambuf>
+#include <string>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+    // Swallows the debug output of the disk tree and its buffer pool.
+    class NullBuffer : public streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        streamsize xsputn(const char*, streamsize count) override { return count; }
+    };
+
+    struct Timing {
+        double ns = 0; // per lookup
+        long long checksum = 0;
+    };
+}
+
+template<typename Key, int Fanout>
+static Timing time_tree(const vector<Key>& keys, const vector<Key>& probes, int& height) {
+    BPlusTree<Key, int, Fanout> tree;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(keys[i], (int)i);
+    }
+    height = tree.height();
+
+    long long checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (const Key& probe : probes) {
+        const int* value = tree.find(probe);
+        if (value) checksum += *value;
+    }
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    return {elapsed / probes.size(), checksum};
+}
+
+template<typename Key>
+static Timing time_map(const vector<Key>& keys, const vector<Key>& probes) {
+    map<Key, int> tree;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.emplace(keys[i], (int)i);
+    }
+
+    long long checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (const Key& probe : probes) {
+        auto it = tree.find(probe);
+        if (it != tree.end()) checksum += it->second;
+    }
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    return {elapsed / probes.size(), checksum};
+}
+
+// Keys are already encoded; the tree maps them to their position in keys.
+static Timing time_disk_tree(const vector<string>& keys, const vector<string>& probes) {
+    fs::path dir = fs::temp_directory_path() / ("btree_bench_" + to_string(random_device()()));
+    fs::create_directories(dir);
+    Timing timing;
+    NullBuffer null_buffer;
+    streambuf* console = cout.rdbuf(&null_buffer);
+    {
+        LogManager log((dir / "wal.log").string());
+        size_t pool_pages = keys.size() / 16 + 1024; // a page takes a few dozen entries at least
+        BufferPoolManager buffer_pool(pool_pages, &log);
+        DiskBPlusTree tree((dir / "bench.bpt").string(), INDEX_FILE_ID_BASE, 1, buffer_pool, log);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            tree.insert(keys[i], (int)i);
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (const string& probe : probes) {
+            tree.search(probe).for_each([&](int record_id) { timing.checksum += record_id; });
+        }
+        auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        timing.ns = elapsed / probes.size();
+        tree.mark_dropped();
+    }
+    cout.rdbuf(console);
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    return timing;
+}
+
+template<typename Key, typename Encode>
+static void run(const string& label, const vector<Key>& keys, const vector<Key>& probes, Encode encode) {
+    cout << label << ": " << keys.size() << " keys, " << probes.size() << " lookups" << endl;
+
+    int height = 0;
+    Timing baseline = time_tree<Key, 4>(keys, probes, height);
+    auto report = [&](const string& name, const Timing& timing, int levels) {
+        cout << "  " << name << ": " << timing.ns << " ns/lookup";
+        if (levels > 0) cout << ", height " << levels;
+        cout << ", " << baseline.ns / timing.ns << "x vs fanout 4, checksum " << timing.checksum << endl;
+    };
+    report("fanout   4", baseline, height);
+    report("fanout  16", time_tree<Key, 16>(keys, probes, height), height);
+    report("fanout  64", time_tree<Key, 64>(keys, probes, height), height);
+    report("fanout 128", time_tree<Key, 128>(keys, probes, height), height);
+    report("fanout 256", time_tree<Key, 256>(keys, probes, height), height);
+    report("std::map  ", time_map(keys, probes), 0);
+
+    vector<string> encoded_keys, encoded_probes;
+    encoded_keys.reserve(keys.size());
+    for (const Key& key : keys) encoded_keys.push_back(encode(key));
+    encoded_probes.reserve(probes.size());
+    for (const Key& probe : probes) encoded_probes.push_back(encode(probe));
+    report("disk tree ", time_disk_tree(encoded_keys, encoded_probes), 0);
+}
+
+int main(int argc, char* argv[]) {
+    size_t key_count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t lookup_count = argc > 2 ? strtoull(argv[2], nullptr, 10) : 2000000;
+    if (key_count == 0 || lookup_count == 0) {
+        cerr << "usage: " << argv[0] << " [key count] [lookup count]" << endl;
+        return 1;
+    }
+
+    mt19937_64 rng(42);
+    vector<int64_t> int_keys(key_count);
+    for (auto& key : int_keys) key = (int64_t)rng();
+    vector<int64_t> int_probes(lookup_count);
+    for (auto& probe : int_probes) probe = int_keys[rng() % key_count];
+    run("INT keys", int_keys, int_probes, index_key_int);
+
+    vector<string> string_keys(key_count);
+    for (auto& key : string_keys) key = "user_" + to_string(rng() % (key_count * 10));
+    vector<string> string_probes(lookup_count);
+    for (auto& probe : string_probes) probe = string_keys[rng() % key_count];
+    run("VARCHAR keys", string_keys, string_probes, [](const string& key) { return index_key_varchar(key); });
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Read scaling benchmark for the shared storage stack.
+//
+// Loads a table into a scratch database, then runs the same queries from
+// 1, 2, 4, ... threads, each with a session of its own on the shared
+// Database, and reports queries per second:
+//   point  SELECT by primary key (index search + row fetch)
+//   range  COUNT(*) of 100 consecutive keys through the index
+//   scan   COUNT(*) with a filter on an unindexed column (whole heap)
+//   mixed  point lookups while one more thread keeps updating rows
+// The runs are made twice: with a pool that holds the whole table, which
+// measures CPU, and with one an eighth of its size, where most lookups
+// read their page from the file and updates write pages back.
+// Usage: concurrency_bench [rows] [seconds per run] [max threads]
+#include "../include/database.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+    // Swallows the engine's debug output, which would otherwise serialize
+    // every thread on the terminal.
+    class NullBuffer : public streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        streamsize xsputn(const char*, streamsize count) override { return count; }
+    };
+
+    Literal integer(int64_t value) {
+        Literal literal;
+        literal.kind = Literal::Kind::INTEGER;
+        literal.int_value = value;
+        literal.text = to_string(value);
+        return literal;
+    }
+
+    const char* LOOKUP_SQL = "SELECT name FROM bench WHERE id = ?;";
+
+    using Body = function<bool(QueryParser& session, PreparedStatement& lookup, mt19937_64& rng)>;
+    using Writer = function<void(QueryParser& session, mt19937_64& rng, atomic<bool>& stop)>;
+
+    // Runs body in a loop on each of threads threads for the given time and
+    // returns the calls per second over all of them. Each thread has its
+    // own session, with LOOKUP_SQL prepared in it, and ends each statement
+    // the way the server does. A writer, if given, runs alongside on a
+    // thread of its own.
+    double run(Database& database, int threads, double seconds, const Body& body, const Writer& writer) {
+        atomic<bool> stop{false};
+        atomic<uint64_t> total{0};
+        atomic<bool> failed{false};
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                unique_ptr<QueryParser> session = database.open_session();
+                shared_ptr<PreparedStatement> lookup = session->prepare(LOOKUP_SQL);
+                mt19937_64 rng(t + 1);
+                uint64_t done = 0;
+                while (lookup && !stop.load(memory_order_relaxed)) {
+                    if (!body(*session, *lookup, rng)) failed = true;
+                    database.end_statement(*session);
+                    done++;
+                }
+                total += done;
+            });
+        }
+        thread writer_thread;
+        if (writer) {
+            writer_thread = thread([&] {
+                unique_ptr<QueryParser> session = database.open_session();
+                mt19937_64 rng(1000);
+                writer(*session, rng, stop);
+            });
+        }
+
+        this_thread::sleep_for(chrono::duration<double>(seconds));
+        stop = true;
+        for (thread& worker : workers) worker.join();
+        if (writer_thread.joinable()) writer_thread.join();
+        if (failed) cerr << "[ERROR] Some queries failed." << endl;
+        return total / seconds;
+    }
+
+    // Runs every workload from 1, 2, 4, ... max_threads threads.
+    void run_workloads(Database& database, int rows, double seconds, int max_threads, ostream& out) {
+        Body point = [rows](QueryParser& session, PreparedStatement& lookup, mt19937_64& rng) {
+            return session.execute(lookup, {integer(rng() % rows)});
+        };
+        Body range = [rows](QueryParser& session, PreparedStatement&, mt19937_64& rng) {
+            int64_t start = rng() % rows;
+            return session.execute_query("SELECT COUNT(*) FROM bench WHERE id >= " + to_string(start) + " AND id < " + to_string(start + 100) + ";");
+        };
+        Body scan = [](QueryParser& session, PreparedStatement&, mt19937_64&) {
+            return session.execute_query("SELECT COUNT(*) FROM bench WHERE score = 7;");
+        };
+        Writer updater = [&database, rows](QueryParser& session, mt19937_64& rng, atomic<bool>& stop) {
+            while (!stop.load(memory_order_relaxed)) {
+                int64_t id = rng() % rows;
+                session.execute_query("UPDATE bench SET score = " + to_string(rng() % 1000) + " WHERE id = " + to_string(id) + ";");
+                database.end_statement(session);
+            }
+        };
+
+        struct Workload {
+            string name;
+            Body body;
+            Writer writer;
+        };
+        vector<Workload> workloads = {
+            {"point", point, nullptr},
+            {"range", range, nullptr},
+            {"scan ", scan, nullptr},
+            {"mixed", point, updater},
+        };
+        vector<int> thread_counts;
+        for (int threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+        thread_counts.push_back(max_threads);
+
+        for (const Workload& workload : workloads) {
+            double single = 0;
+            for (int threads : thread_counts) {
+                double rate = run(database, threads, seconds, workload.body, workload.writer);
+                if (threads == 1) single = rate;
+                out << "  " << workload.name << " " << threads << " thread(s): " << static_cast<uint64_t>(rate)
+                    << " queries/s, " << (single > 0 ? rate / single : 0) << "x" << endl;
+            }
+        }
+    }
+
+    // Bytes of the database's files, the log aside
+    uintmax_t data_bytes(const string& name) {
+        uintmax_t total = 0;
+        for (const auto& entry : fs::recursive_directory_iterator(Database::path(name))) {
+            if (entry.is_regular_file() && entry.path().filename() != "wal.log") total += entry.file_size();
+        }
+        return total;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int rows = argc > 1 ? atoi(argv[1]) : 100000;
+    double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+    int max_threads = argc > 3 ? atoi(argv[3]) : static_cast<int>(thread::hardware_concurrency());
+    if (rows <= 0 || seconds <= 0 || max_threads <= 0) {
+        cerr << "usage: " << argv[0] << " [rows] [seconds per run] [max threads]" << endl;
+        return 1;
+    }
+
+    // The engine finds its files under data/<database> in the working directory
+    fs::path scratch = fs::temp_directory_path() / ("limbodb_bench_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(scratch);
+    fs::current_path(scratch);
+    Database::create("bench");
+
+    ostream out(cout.rdbuf());
+    NullBuffer null_buffer;
+    cout.rdbuf(&null_buffer);
+
+    DBConfig config;
+    {
+        config.buffer_pool_bytes = 256 * 1024 * 1024; // keeps the table resident
+        Database database("bench", config);
+        unique_ptr<QueryParser> loader = database.open_session();
+        loader->execute_query("CREATE TABLE bench (id INT, name VARCHAR, score INT, PRIMARY KEY(id));");
+        database.end_statement(*loader);
+        const int rows_per_insert = 500;
+        for (int first = 0; first < rows; first += rows_per_insert) {
+            string insert = "INSERT INTO bench VALUES ";
+            for (int id = first; id < min(rows, first + rows_per_insert); ++id) {
+                if (id > first) insert += ", ";
+                insert += "(" + to_string(id) + ", 'name_" + to_string(id) + "', " + to_string(id % 1000) + ")";
+            }
+            loader->execute_query(insert + ";");
+            database.end_statement(*loader);
+        }
+        loader.reset();
+        out << "Loaded " << rows << " rows; " << seconds << " s per run, up to " << max_threads << " threads." << endl;
+        out << "Pool holding the whole table:" << endl;
+        run_workloads(database, rows, seconds, max_threads, out);
+    }
+    {
+        config.buffer_pool_bytes = max<size_t>(data_bytes("bench") / 8, 64 * PAGE_SIZE);
+        Database database("bench", config);
+        out << "Pool of " << config.buffer_pool_bytes / 1024 << " KB, an eighth of the table:" << endl;
+        run_workloads(database, rows, seconds, max_threads, out);
+    }
+
+    cout.rdbuf(out.rdbuf());
+    fs::current_path(fs::temp_directory_path());
+    std::error_code ec;
+    fs::remove_all(scratch, ec);
+    return 0;
+}
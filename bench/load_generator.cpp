@@ -0,0 +1,140 @@
+// Load generator for limbodb-server.
+//
+// Loads a kv table into the database "loadgen" on a running server, then
+// runs [clients] connections for the given time. Each client keeps one
+// session: it prepares a point lookup once and then sends EXECUTEs, with
+// the given percentage of requests being single-row UPDATEs instead. It
+// reports requests per second and latency percentiles over all clients.
+// Usage: limbodb-loadgen <socket path | port> [clients] [seconds] [rows] [write %]
+#include "../include/server/client.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    // A port number means TCP on localhost, anything else a socket path
+    bool connect(LimboClient& client, const string& target) {
+        bool is_port = !target.empty() && all_of(target.begin(), target.end(), ::isdigit);
+        return is_port ? client.connect_tcp("127.0.0.1", static_cast<uint16_t>(stoi(target)))
+                       : client.connect_unix(target);
+    }
+
+    // Runs a statement that has to succeed; reports why it did not
+    bool run(LimboClient& client, const string& sql) {
+        QueryResult result;
+        if (!client.query(sql, result)) {
+            cerr << "[ERROR] " << client.last_error() << endl;
+            return false;
+        }
+        if (!result.ok) {
+            cerr << "[ERROR] " << sql << "\n" << result.message;
+            return false;
+        }
+        return true;
+    }
+
+    double percentile(const vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        size_t at = min(sorted.size() - 1, static_cast<size_t>(p / 100.0 * sorted.size()));
+        return sorted[at];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " <socket path | port> [clients] [seconds] [rows] [write %]" << endl;
+        return 1;
+    }
+    string target = argv[1];
+    int clients = argc > 2 ? atoi(argv[2]) : 4;
+    double seconds = argc > 3 ? atof(argv[3]) : 5.0;
+    int rows = argc > 4 ? atoi(argv[4]) : 10000;
+    int write_percent = argc > 5 ? atoi(argv[5]) : 10;
+    if (clients <= 0 || seconds <= 0 || rows <= 0 || write_percent < 0 || write_percent > 100) {
+        cerr << "usage: " << argv[0] << " <socket path | port> [clients] [seconds] [rows] [write %]" << endl;
+        return 1;
+    }
+
+    {
+        LimboClient loader;
+        if (!connect(loader, target)) {
+            cerr << "[ERROR] " << loader.last_error() << endl;
+            return 1;
+        }
+        QueryResult ignored;
+        loader.query("CREATE DATABASE loadgen;", ignored); // fails if it exists already
+        loader.query("USE loadgen;", ignored);
+        loader.query("DROP TABLE kv;", ignored);
+        if (!run(loader, "CREATE TABLE kv (id INT, value INT, PRIMARY KEY(id));")) return 1;
+
+        // One transaction, so one log flush, for the whole load
+        if (!run(loader, "BEGIN;")) return 1;
+        const int rows_per_insert = 500;
+        for (int first = 0; first < rows; first += rows_per_insert) {
+            string insert = "INSERT INTO kv VALUES ";
+            for (int id = first; id < min(rows, first + rows_per_insert); ++id) {
+                if (id > first) insert += ", ";
+                insert += "(" + to_string(id) + ", " + to_string(id) + ")";
+            }
+            if (!run(loader, insert + ";")) return 1;
+        }
+        if (!run(loader, "COMMIT;")) return 1;
+    }
+    cout << "Loaded " << rows << " rows; " << clients << " client(s) for " << seconds << " s, "
+         << write_percent << "% writes." << endl;
+
+    atomic<bool> stop{false};
+    atomic<uint64_t> failures{0};
+    mutex latencies_latch;
+    vector<double> latencies; // microseconds
+    vector<thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            LimboClient client;
+            if (!connect(client, target) || !run(client, "USE loadgen;") ||
+                !run(client, "PREPARE get AS SELECT value FROM kv WHERE id = ?;")) {
+                failures++;
+                return;
+            }
+            mt19937_64 rng(c + 1);
+            vector<double> mine;
+            QueryResult result;
+            while (!stop.load(memory_order_relaxed)) {
+                int64_t id = rng() % rows;
+                string sql = static_cast<int>(rng() % 100) < write_percent
+                    ? "UPDATE kv SET value = " + to_string(rng() % 1000000) + " WHERE id = " + to_string(id) + ";"
+                    : "EXECUTE get (" + to_string(id) + ");";
+                auto start = chrono::steady_clock::now();
+                if (!client.query(sql, result)) {
+                    cerr << "[ERROR] " << client.last_error() << endl;
+                    failures++;
+                    return;
+                }
+                mine.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+                if (!result.ok) failures++;
+            }
+            lock_guard<mutex> lock(latencies_latch);
+            latencies.insert(latencies.end(), mine.begin(), mine.end());
+        });
+    }
+
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    stop = true;
+    for (thread& t : threads) t.join();
+
+    sort(latencies.begin(), latencies.end());
+    cout << "requests:   " << latencies.size() << " (" << static_cast<uint64_t>(latencies.size() / seconds) << "/s)\n";
+    cout << "latency us: p50 " << percentile(latencies, 50) << ", p90 " << percentile(latencies, 90)
+         << ", p99 " << percentile(latencies, 99) << ", max " << (latencies.empty() ? 0 : latencies.back()) << "\n";
+    if (failures) cout << "failures:   " << failures << "\n";
+    return failures ? 1 : 0;
+}
@@ -6,48 +6,59 @@
 
 using namespace std;
 
-const int ORDER = 4; // Define ORDER constant
-
-template<typename Key, typename Value>
+// Keys per node unless the instantiation asks otherwise. With 8-byte keys a
+// node's keys fill 8 cache lines, and a million keys fit in 4 levels.
+const int DEFAULT_BTREE_FANOUT = 64;
+
+// In-memory B+ tree with a compile-time fanout.
+//
+// Nodes keep their keys (and values or children) inline in fixed arrays, so
+// searching a node touches one contiguous run of memory instead of chasing
+// a vector's heap buffer, and there is no vtable: the is_leaf flag in the
+// common header decides which node type a pointer is. The search within a
+// node is a binary search. A node holds at most Fanout - 1 keys; it splits
+// when an insert fills it and is merged or refilled from a sibling when a
+// remove takes it under half.
+template<typename Key, typename Value, int Fanout = DEFAULT_BTREE_FANOUT>
 class BPlusTree {
+    static_assert(Fanout >= 4, "a B+ tree node needs room for at least 4 keys");
+
 public:
+    struct InternalNode;
+
     struct Node {
-        vector<Key> keys;
         bool is_leaf;
-        Node* parent;
-        
-        Node(bool leaf = false) : is_leaf(leaf), parent(nullptr) {}
-        virtual ~Node() {}
+        int count; // keys in use
+        InternalNode* parent;
+
+        explicit Node(bool leaf) : is_leaf(leaf), count(0), parent(nullptr) {}
     };
-    
+
     struct LeafNode : public Node {
-        vector<Value> values;
+        Key keys[Fanout];
+        Value values[Fanout];
         LeafNode* next;
         LeafNode* prev;
-        
+
         LeafNode() : Node(true), next(nullptr), prev(nullptr) {}
     };
-    
+
     struct InternalNode : public Node {
-        vector<Node*> children;
-        
+        Key keys[Fanout];
+        Node* children[Fanout + 1];
+
         InternalNode() : Node(false) {}
-        
-        ~InternalNode() {
-            for (auto child : children) {
-                delete child;
-            }
-        }
     };
 
 private:
     Node* root;
     LeafNode* leftmost_leaf;
-    
-    LeafNode* find_leaf(const Key& key);
+
+    static void destroy(Node* node);
+    LeafNode* find_leaf(const Key& key) const;
     void insert_in_leaf(LeafNode* leaf, const Key& key, const Value& value);
-    Node* split_leaf(LeafNode* leaf);
-    Node* split_internal(InternalNode* node);
+    LeafNode* split_leaf(LeafNode* leaf);
+    InternalNode* split_internal(InternalNode* node, Key& promoted);
     void insert_in_parent(Node* left, const Key& key, Node* right);
     void remove_from_leaf(LeafNode* leaf, const Key& key, const Value& value);
     void merge_or_redistribute(Node* node);
@@ -61,13 +72,19 @@ public:
     BPlusTree();
     ~BPlusTree();
 
-    
-    
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
     void insert(const Key& key, const Value& value);
-    vector<Value> search(const Key& key);
-    vector<Value> range_search(const Key& start_key, const Key& end_key);
+    vector<Value> search(const Key& key) const;
+    // Like search, without building a vector: nullptr if key is absent.
+    const Value* find(const Key& key) const;
+    vector<Value> range_search(const Key& start_key, const Key& end_key) const;
     void remove(const Key& key, const Value& value);
 
+    // Levels from the root to the leaves; 0 for an empty tree.
+    int height() const;
+
     LeafNode* get_leftmost_leaf() const {
         return leftmost_leaf;
     }
@@ -75,163 +92,180 @@ public:
 
 // Implementation
 
-template<typename Key, typename Value>
-BPlusTree<Key, Value>::BPlusTree() : root(nullptr), leftmost_leaf(nullptr) {}
+template<typename Key, typename Value, int Fanout>
+BPlusTree<Key, Value, Fanout>::BPlusTree() : root(nullptr), leftmost_leaf(nullptr) {}
+
+template<typename Key, typename Value, int Fanout>
+BPlusTree<Key, Value, Fanout>::~BPlusTree() {
+    destroy(root);
+}
+
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::destroy(Node* node) {
+    if (!node) return;
+    if (node->is_leaf) {
+        delete static_cast<LeafNode*>(node);
+        return;
+    }
+    InternalNode* internal = static_cast<InternalNode*>(node);
+    for (int i = 0; i <= internal->count; ++i) {
+        destroy(internal->children[i]);
+    }
+    delete internal;
+}
 
-template<typename Key, typename Value>
-BPlusTree<Key, Value>::~BPlusTree() {
-    delete root;
+template<typename Key, typename Value, int Fanout>
+int BPlusTree<Key, Value, Fanout>::height() const {
+    int levels = 0;
+    for (Node* current = root; current; ++levels) {
+        current = current->is_leaf ? nullptr : static_cast<InternalNode*>(current)->children[0];
+    }
+    return levels;
 }
 
-template<typename Key, typename Value>
-typename BPlusTree<Key, Value>::LeafNode* BPlusTree<Key, Value>::find_leaf(const Key& key){
+template<typename Key, typename Value, int Fanout>
+typename BPlusTree<Key, Value, Fanout>::LeafNode* BPlusTree<Key, Value, Fanout>::find_leaf(const Key& key) const {
     if(!root) return nullptr;
 
     Node* current = root;
     while(!current->is_leaf){
         InternalNode* internal = static_cast<InternalNode*>(current);
-        int i = 0;
-        while(i < current->keys.size() && key >= current->keys[i]) {
-            i++;
-        }
+        // Child i holds the keys in [keys[i-1], keys[i])
+        int i = upper_bound(internal->keys, internal->keys + internal->count, key) - internal->keys;
         current = internal->children[i];
     }
     return static_cast<LeafNode*>(current);
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::insert(const Key& key, const Value& value) {
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::insert(const Key& key, const Value& value) {
     if(!root) {
         root = new LeafNode();
         leftmost_leaf = static_cast<LeafNode*>(root);
     }
 
-    LeafNode* leaf = find_leaf(key);
-    if(!leaf) {
-        leaf = static_cast<LeafNode*>(root);
-    }
-
-    insert_in_leaf(leaf, key, value);
+    insert_in_leaf(find_leaf(key), key, value);
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::insert_in_leaf(LeafNode* leaf, const Key& key, const Value& value){
-    auto it = lower_bound(leaf->keys.begin(), leaf->keys.end(), key);
-    int pos = it - leaf->keys.begin();
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::insert_in_leaf(LeafNode* leaf, const Key& key, const Value& value){
+    int pos = lower_bound(leaf->keys, leaf->keys + leaf->count, key) - leaf->keys;
 
     // Check if key already exists
-    if(it != leaf->keys.end() && *it == key) {
+    if(pos < leaf->count && leaf->keys[pos] == key) {
         leaf->values[pos] = value; //update value if key exists
         return;
     }
 
     //Insert the key and value
-    leaf->keys.insert(it, key);
-    leaf->values.insert(leaf->values.begin() + pos, value);
-
-    // Check if leaf needs to be split
-    if(leaf->keys.size() >= ORDER) {
-        Node* new_node = split_leaf(leaf);
-        Key split_key = new_node->keys[0];
-        // Insert the new key into the parent
-        insert_in_parent(leaf, split_key, new_node);
+    move_backward(leaf->keys + pos, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+    move_backward(leaf->values + pos, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+    leaf->keys[pos] = key;
+    leaf->values[pos] = value;
+    leaf->count++;
+
+    // Split once the leaf is full
+    if(leaf->count == Fanout) {
+        LeafNode* new_leaf = split_leaf(leaf);
+        insert_in_parent(leaf, new_leaf->keys[0], new_leaf);
     }
 }
 
-template<typename Key, typename Value>
-typename BPlusTree<Key,Value>::Node* BPlusTree<Key, Value>::split_leaf(LeafNode* leaf){
+template<typename Key, typename Value, int Fanout>
+typename BPlusTree<Key, Value, Fanout>::LeafNode* BPlusTree<Key, Value, Fanout>::split_leaf(LeafNode* leaf){
     LeafNode* new_leaf = new LeafNode();
-    int mid = ORDER / 2;
-
-    //Move half of the keys and values to the new leaf
-    new_leaf->keys.assign(leaf->keys.begin() + mid, leaf->keys.end());
-    new_leaf->values.assign(leaf->values.begin() + mid, leaf->values.end());
+    int mid = leaf->count / 2;
 
-    // Update the original leaf
-    leaf->keys.resize(mid);
-    leaf->values.resize(mid);
+    //Move the upper half of the keys and values to the new leaf
+    move(leaf->keys + mid, leaf->keys + leaf->count, new_leaf->keys);
+    move(leaf->values + mid, leaf->values + leaf->count, new_leaf->values);
+    new_leaf->count = leaf->count - mid;
+    leaf->count = mid;
 
-    // Update next pointers
+    // Update sibling pointers
     new_leaf->next = leaf->next;
+    new_leaf->prev = leaf;
+    if (leaf->next) leaf->next->prev = new_leaf;
     leaf->next = new_leaf;
 
     return new_leaf;
 }
 
-template<typename Key, typename Value>
-typename BPlusTree<Key, Value>::Node* BPlusTree<Key, Value>::split_internal(InternalNode* node) {
+template<typename Key, typename Value, int Fanout>
+typename BPlusTree<Key, Value, Fanout>::InternalNode* BPlusTree<Key, Value, Fanout>::split_internal(InternalNode* node, Key& promoted) {
     InternalNode* new_internal = new InternalNode();
-    int mid = ORDER / 2;
+    int mid = node->count / 2;
+    promoted = node->keys[mid];
 
-    // Move keys and children
-    new_internal->keys.assign(node->keys.begin() + mid, node->keys.end());
-    new_internal->children.assign(node->children.begin() + mid, node->children.end());
+    // keys[mid] moves up to the parent; everything right of it goes to the new node
+    move(node->keys + mid + 1, node->keys + node->count, new_internal->keys);
+    copy(node->children + mid + 1, node->children + node->count + 1, new_internal->children);
+    new_internal->count = node->count - mid - 1;
+    node->count = mid;
 
-    // Update the parent pointers
-    for(auto child : new_internal->children) {
-        child->parent = new_internal;
+    for (int i = 0; i <= new_internal->count; ++i) {
+        new_internal->children[i]->parent = new_internal;
     }
 
-    // Get the middle key to promote
-    Key split_key = node->keys[mid];
-
-    // Update the original internal node
-    node->keys.resize(mid);
-    node->children.resize(mid + 1); // +1 because internal nodes have one more
-
     return new_internal;
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::insert_in_parent(Node* left, const Key& key, Node* right) {
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::insert_in_parent(Node* left, const Key& key, Node* right) {
     if(left == root){
         // Create a new root
         InternalNode* new_root = new InternalNode();
-        new_root->keys.push_back(key);
-        new_root->children.push_back(left);
-        new_root->children.push_back(right);
+        new_root->keys[0] = key;
+        new_root->children[0] = left;
+        new_root->children[1] = right;
+        new_root->count = 1;
         left->parent = new_root;
         right->parent = new_root;
         root = new_root;
         return;
     }
 
-    InternalNode* parent = static_cast<InternalNode*>(left->parent);
+    InternalNode* parent = left->parent;
     right->parent = parent;
 
     // Find the position to insert the new key
-    auto it = lower_bound(parent->keys.begin(), parent->keys.end(), key);
-    int pos = it - parent->keys.begin();
-
-    parent->keys.insert(it, key);
-    parent->children.insert(parent->children.begin() + pos + 1, right);
+    int pos = lower_bound(parent->keys, parent->keys + parent->count, key) - parent->keys;
+    move_backward(parent->keys + pos, parent->keys + parent->count, parent->keys + parent->count + 1);
+    move_backward(parent->children + pos + 1, parent->children + parent->count + 1, parent->children + parent->count + 2);
+    parent->keys[pos] = key;
+    parent->children[pos + 1] = right;
+    parent->count++;
 
     // Check if the parent needs to be split
-    if(parent->keys.size() >= ORDER){
-        Node* new_internal = split_internal(parent);
-        Key promote_key = parent->keys.back();
-        parent->keys.pop_back(); // Remove the promoted key from the parent
+    if(parent->count == Fanout){
+        Key promote_key;
+        InternalNode* new_internal = split_internal(parent, promote_key);
         insert_in_parent(parent, promote_key, new_internal);
     }
 }
 
-template<typename Key, typename Value>
-vector<Value> BPlusTree<Key, Value>::search(const Key& key){
+template<typename Key, typename Value, int Fanout>
+vector<Value> BPlusTree<Key, Value, Fanout>::search(const Key& key) const {
     vector<Value> result;
+    const Value* value = find(key);
+    if (value) result.push_back(*value);
+    return result;
+}
+
+template<typename Key, typename Value, int Fanout>
+const Value* BPlusTree<Key, Value, Fanout>::find(const Key& key) const {
     LeafNode* leaf = find_leaf(key);
-    if (!leaf) return result;
+    if (!leaf) return nullptr;
 
-    auto it = lower_bound(leaf->keys.begin(), leaf->keys.end(), key);
-    if (it != leaf->keys.end() && *it == key) {
-        int pos = it - leaf->keys.begin();
-        result.push_back(leaf->values[pos]);
+    int pos = lower_bound(leaf->keys, leaf->keys + leaf->count, key) - leaf->keys;
+    if (pos < leaf->count && leaf->keys[pos] == key) {
+        return &leaf->values[pos];
     }
-
-    return result;
+    return nullptr;
 }
 
-template<typename Key, typename Value>
-vector<Value> BPlusTree<Key, Value>::range_search(const Key& start_key, const Key& end_key){
+template<typename Key, typename Value, int Fanout>
+vector<Value> BPlusTree<Key, Value, Fanout>::range_search(const Key& start_key, const Key& end_key) const {
     vector<Value> result;
 
     if (start_key > end_key) return result;
@@ -239,11 +273,10 @@ vector<Value> BPlusTree<Key, Value>::range_search(const Key& start_key, const Ke
     LeafNode* current = find_leaf(start_key);
     if (!current) return result;
 
-    auto start_it = lower_bound(current->keys.begin(), current->keys.end(), start_key);
-    int start_pos = start_it - current->keys.begin();
+    int start_pos = lower_bound(current->keys, current->keys + current->count, start_key) - current->keys;
 
     while (current) {
-        for (int i = start_pos; i < current->keys.size(); ++i) {
+        for (int i = start_pos; i < current->count; ++i) {
             if (current->keys[i] > end_key) {
                 return result;
             }
@@ -256,72 +289,54 @@ vector<Value> BPlusTree<Key, Value>::range_search(const Key& start_key, const Ke
     return result;
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::remove(const Key& key, const Value& value) {
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::remove(const Key& key, const Value& value) {
     LeafNode* leaf = find_leaf(key);
     if (!leaf) return;
 
     remove_from_leaf(leaf, key, value);
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::remove_from_leaf(LeafNode* leaf, const Key& key, const Value& value) {
-    auto it = std::lower_bound(leaf->keys.begin(), leaf->keys.end(), key);
-    if (it != leaf->keys.end() && *it == key) {
-        int pos = it - leaf->keys.begin();
-        if (leaf->values[pos] == value) {
-            leaf->keys.erase(leaf->keys.begin() + pos);
-            leaf->values.erase(leaf->values.begin() + pos);
-
-            if (leaf == root) {
-                if (leaf->keys.empty()) {
-                    delete root;
-                    root = nullptr;
-                    leftmost_leaf = nullptr;
-                }
-                return;
-            }
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::remove_from_leaf(LeafNode* leaf, const Key& key, const Value& value) {
+    int pos = lower_bound(leaf->keys, leaf->keys + leaf->count, key) - leaf->keys;
+    if (pos >= leaf->count || !(leaf->keys[pos] == key) || !(leaf->values[pos] == value)) return;
 
-            if (leaf->keys.size() < min_keys()) {
-                merge_or_redistribute(leaf);
-            }
-        }
-    }
-}
+    move(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+    move(leaf->values + pos + 1, leaf->values + leaf->count, leaf->values + pos);
+    leaf->count--;
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::merge_or_redistribute(Node* node) {
-    if (node == root && node->keys.empty()) {
-        if (!node->is_leaf) {
-            InternalNode* internal = static_cast<InternalNode*>(node);
-            if (!internal->children.empty()) {
-                root = internal->children[0];
-                root->parent = nullptr;
-                internal->children.clear();
-            }
-        } else {
+    if (leaf == root) {
+        if (leaf->count == 0) {
+            delete leaf;
             root = nullptr;
             leftmost_leaf = nullptr;
         }
-        delete node;
         return;
     }
 
-    InternalNode* parent = static_cast<InternalNode*>(node->parent);
+    if (leaf->count < min_keys()) {
+        merge_or_redistribute(leaf);
+    }
+}
+
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::merge_or_redistribute(Node* node) {
+    InternalNode* parent = node->parent;
     int node_idx = find_child_index(parent, node);
 
     // Try left sibling
     Node* left_sibling = (node_idx > 0) ? parent->children[node_idx - 1] : nullptr;
 
-    if (left_sibling && left_sibling->keys.size() > min_keys()) {
+    if (left_sibling && left_sibling->count > min_keys()) {
         redistribute_from_left(node, left_sibling, parent, node_idx);
         return;
     }
 
     // Try right sibling
-    Node* right_sibling = (node_idx < parent->children.size() - 1) ? parent->children[node_idx + 1] : nullptr;
+    Node* right_sibling = (node_idx < parent->count) ? parent->children[node_idx + 1] : nullptr;
 
-    if (right_sibling && right_sibling->keys.size() > min_keys()) {
+    if (right_sibling && right_sibling->count > min_keys()) {
         redistribute_from_right(node, right_sibling, parent, node_idx);
         return;
     }
@@ -334,92 +349,106 @@ void BPlusTree<Key, Value>::merge_or_redistribute(Node* node) {
     }
 }
 
-template<typename Key, typename Value>
-int BPlusTree<Key, Value>::min_keys() const {
-    return (ORDER + 1) / 2 - 1;  // min number of keys
+template<typename Key, typename Value, int Fanout>
+int BPlusTree<Key, Value, Fanout>::min_keys() const {
+    return (Fanout + 1) / 2 - 1;  // min number of keys
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::merge_nodes(Node* node_left, Node* node_right, InternalNode* parent, int sep_idx) {
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::merge_nodes(Node* node_left, Node* node_right, InternalNode* parent, int sep_idx) {
     if (node_left->is_leaf) {
         LeafNode* left = static_cast<LeafNode*>(node_left);
         LeafNode* right = static_cast<LeafNode*>(node_right);
-        left->keys.insert(left->keys.end(), right->keys.begin(), right->keys.end());
-        left->values.insert(left->values.end(), right->values.begin(), right->values.end());
+        move(right->keys, right->keys + right->count, left->keys + left->count);
+        move(right->values, right->values + right->count, left->values + left->count);
+        left->count += right->count;
         left->next = right->next;
         if (right->next) right->next->prev = left;
+        delete right;
     } else {
         InternalNode* left = static_cast<InternalNode*>(node_left);
         InternalNode* right = static_cast<InternalNode*>(node_right);
-        left->keys.push_back(parent->keys[sep_idx]);
-        left->keys.insert(left->keys.end(), right->keys.begin(), right->keys.end());
-        left->children.insert(left->children.end(), right->children.begin(), right->children.end());
-        for (auto child : right->children) {
-            child->parent = left;
+        left->keys[left->count] = parent->keys[sep_idx];
+        move(right->keys, right->keys + right->count, left->keys + left->count + 1);
+        copy(right->children, right->children + right->count + 1, left->children + left->count + 1);
+        for (int i = 0; i <= right->count; ++i) {
+            right->children[i]->parent = left;
         }
+        left->count += right->count + 1;
+        delete right; // children now owned by left
     }
 
-    parent->keys.erase(parent->keys.begin() + sep_idx);
-    parent->children.erase(parent->children.begin() + sep_idx + 1);
-    delete node_right;
+    move(parent->keys + sep_idx + 1, parent->keys + parent->count, parent->keys + sep_idx);
+    move(parent->children + sep_idx + 2, parent->children + parent->count + 1, parent->children + sep_idx + 1);
+    parent->count--;
 
-    if (parent == root && parent->keys.empty()) {
-        root = parent->children[0];
-        root->parent = nullptr;
-        delete parent;
-    } else if (parent->keys.size() < min_keys()) {
+    if (parent == root) {
+        if (parent->count == 0) {
+            root = parent->children[0];
+            root->parent = nullptr;
+            delete parent;
+        }
+    } else if (parent->count < min_keys()) {
         merge_or_redistribute(parent);
     }
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::redistribute_from_left(Node* node, Node* left_sibling, InternalNode* parent, int node_idx) {
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::redistribute_from_left(Node* node, Node* left_sibling, InternalNode* parent, int node_idx) {
     if (node->is_leaf) {
         LeafNode* leaf = static_cast<LeafNode*>(node);
         LeafNode* left = static_cast<LeafNode*>(left_sibling);
-        leaf->keys.insert(leaf->keys.begin(), left->keys.back());
-        leaf->values.insert(leaf->values.begin(), left->values.back());
-        left->keys.pop_back();
-        left->values.pop_back();
+        move_backward(leaf->keys, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+        move_backward(leaf->values, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+        leaf->keys[0] = left->keys[left->count - 1];
+        leaf->values[0] = left->values[left->count - 1];
+        leaf->count++;
+        left->count--;
         parent->keys[node_idx - 1] = leaf->keys[0];
     } else {
         InternalNode* internal = static_cast<InternalNode*>(node);
         InternalNode* left = static_cast<InternalNode*>(left_sibling);
-        internal->keys.insert(internal->keys.begin(), parent->keys[node_idx - 1]);
-        parent->keys[node_idx - 1] = left->keys.back();
-        internal->children.insert(internal->children.begin(), left->children.back());
-        left->children.back()->parent = internal;
-        left->keys.pop_back();
-        left->children.pop_back();
+        move_backward(internal->keys, internal->keys + internal->count, internal->keys + internal->count + 1);
+        move_backward(internal->children, internal->children + internal->count + 1, internal->children + internal->count + 2);
+        internal->keys[0] = parent->keys[node_idx - 1];
+        internal->children[0] = left->children[left->count];
+        internal->children[0]->parent = internal;
+        internal->count++;
+        parent->keys[node_idx - 1] = left->keys[left->count - 1];
+        left->count--;
     }
 }
 
-template<typename Key, typename Value>
-void BPlusTree<Key, Value>::redistribute_from_right(Node* node, Node* right_sibling, InternalNode* parent, int node_idx) {
+template<typename Key, typename Value, int Fanout>
+void BPlusTree<Key, Value, Fanout>::redistribute_from_right(Node* node, Node* right_sibling, InternalNode* parent, int node_idx) {
     if (node->is_leaf) {
         LeafNode* leaf = static_cast<LeafNode*>(node);
         LeafNode* right = static_cast<LeafNode*>(right_sibling);
-        leaf->keys.push_back(right->keys.front());
-        leaf->values.push_back(right->values.front());
-        right->keys.erase(right->keys.begin());
-        right->values.erase(right->values.begin());
+        leaf->keys[leaf->count] = right->keys[0];
+        leaf->values[leaf->count] = right->values[0];
+        leaf->count++;
+        move(right->keys + 1, right->keys + right->count, right->keys);
+        move(right->values + 1, right->values + right->count, right->values);
+        right->count--;
         parent->keys[node_idx] = right->keys[0];
     } else {
         InternalNode* internal = static_cast<InternalNode*>(node);
         InternalNode* right = static_cast<InternalNode*>(right_sibling);
-        internal->keys.push_back(parent->keys[node_idx]);
-        parent->keys[node_idx] = right->keys.front();
-        internal->children.push_back(right->children.front());
-        right->children.front()->parent = internal;
-        right->keys.erase(right->keys.begin());
-        right->children.erase(right->children.begin());
+        internal->keys[internal->count] = parent->keys[node_idx];
+        internal->children[internal->count + 1] = right->children[0];
+        right->children[0]->parent = internal;
+        internal->count++;
+        parent->keys[node_idx] = right->keys[0];
+        move(right->keys + 1, right->keys + right->count, right->keys);
+        move(right->children + 1, right->children + right->count + 1, right->children);
+        right->count--;
     }
 }
 
-template<typename Key, typename Value>
-int BPlusTree<Key, Value>::find_child_index(InternalNode* parent, Node* node) {
-    for (int i = 0; i < parent->children.size(); ++i) {
+template<typename Key, typename Value, int Fanout>
+int BPlusTree<Key, Value, Fanout>::find_child_index(InternalNode* parent, Node* node) {
+    for (int i = 0; i <= parent->count; ++i) {
         if (parent->children[i] == node) return i;
     }
     return -1; // should not happen if tree is correct
-}
\ No newline at end of file
+}
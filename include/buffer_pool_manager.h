@@ -0,0 +1,146 @@
+#pragma once
+#include "./disk_manager.h"
+#include "./log_manager.h"
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+const size_t DEFAULT_BUFFER_POOL_PAGES = 1024; // 4 MB with 4 KB pages
+
+// Every file the pool serves is registered under a small integer id. The
+// catalog heap (pages.db) is file 0; table heaps use their table id.
+const int CATALOG_FILE_ID = 0;
+
+// A single buffer frame. page_id is -1 while the frame is free.
+//
+// The header fields belong to the pool and change under its latch. The
+// bytes are guarded by the frame's own latch: whoever pins a page takes
+// it shared to read them and exclusively to change them, and lets go of
+// it before unpinning.
+struct Page {
+    int file_id = -1;
+    int page_id = -1;
+    int pin_count = 0;
+    bool is_dirty = false;
+    bool ref_bit = false; // CLOCK second-chance bit
+    bool io_busy = false; // being read in or written out without the pool latch
+    shared_mutex latch;
+    char data[PAGE_SIZE];
+
+    char* get_data() { return data; }
+};
+
+// Read-only handle to a page's bytes. Either a pinned frame or, for pages
+// that are not resident, a view straight into the mmap'ed file.
+// A mapped view has no latch: the pool does not write the page back to
+// the file while the view is held.
+struct PageView {
+    int file_id = -1;
+    int page_id = -1;
+    const char* data = nullptr;
+    bool pinned = false;
+    shared_mutex* latch = nullptr; // the frame's, for a pinned view
+
+    // Hold while reading data; views stay valid across calls, the bytes
+    // of a pinned one may change whenever it is not held.
+    shared_lock<shared_mutex> read_latch() const {
+        return latch ? shared_lock<shared_mutex>(*latch) : shared_lock<shared_mutex>();
+    }
+};
+
+struct BufferPoolStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+    uint64_t mapped_reads = 0;
+};
+
+// Fixed-size page cache between the storage layer and the DiskManagers of
+// all open heap files, so every table competes for the same frames.
+// Every fetch_page/new_page pins the frame; callers must unpin_page when done
+// and report whether they modified it. Dirty frames are written back lazily
+// on eviction or flush. Replacement uses the CLOCK algorithm.
+//
+// With a LogManager attached, a dirty frame is only written after the log is
+// durable up to the frame's page LSN (the WAL rule).
+//
+// Safe to use from several threads. One latch guards the page table, the
+// free list and the clock. It is never held while waiting for a frame
+// latch, so threads that hold frame latches can always pin more pages, nor
+// during disk reads, write-backs and log flushes: the frame is marked
+// io_busy meanwhile, and threads that want its page wait for io_done.
+// Frames are latched in a fixed order by callers (parent before child,
+// left before right) to stay clear of deadlocks.
+class BufferPoolManager {
+private:
+    LogManager* log;
+    size_t pool_size;
+    vector<Page> frames;
+    unordered_map<int, DiskManager*> files;
+    unordered_map<uint64_t, size_t> page_table; // (file_id, page_id) -> frame index
+    unordered_map<uint64_t, int> mapped_views;  // pages read through the mapping right now
+    vector<size_t> free_frames;
+    size_t clock_hand;
+    BufferPoolStats stats;
+    mutex latch;
+    condition_variable views_released;
+    condition_variable io_done;
+
+    static uint64_t page_key(int file_id, int page_id) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(file_id)) << 32) | static_cast<uint32_t>(page_id);
+    }
+    // The members below expect the latch to be held. Those given the lock
+    // let go of it around disk and log I/O.
+    DiskManager* disk_for(int file_id);
+    bool acquire_frame(size_t& frame_id, unique_lock<mutex>& pool);
+    bool write_back(Page& frame);
+    Page* pin_page(int file_id, int page_id, unique_lock<mutex>& pool);
+    // Writes a page that may be pinned by others, holding its latch shared
+    // rather than the pool latch during the write.
+    bool flush_frame(size_t frame_id, unique_lock<mutex>& pool);
+    // Flushes the log up to the frame's LSN and writes the frame to disk.
+    // Needs no latch; the caller keeps the bytes from changing.
+    bool write_out(DiskManager* disk, const Page& frame);
+
+public:
+    BufferPoolManager(size_t num_frames = DEFAULT_BUFFER_POOL_PAGES, LogManager* log_manager = nullptr);
+    ~BufferPoolManager();
+
+    // The disk manager must outlive the registration.
+    void attach_file(int file_id, DiskManager& disk);
+    // Removes every frame of the file, writing dirty ones back first unless
+    // the file is being deleted. Fails if a page of the file is pinned.
+    bool detach_file(int file_id, bool write_back_dirty);
+
+    // Returns nullptr if the page does not exist or every frame is pinned.
+    Page* fetch_page(int file_id, int page_id);
+    // Extends the file by one page and returns it pinned and zeroed.
+    Page* new_page(int file_id, int& page_id);
+    bool unpin_page(int file_id, int page_id, bool is_dirty);
+
+    // For scans that only read. A resident page is pinned and served from its
+    // frame (it may be newer than the file). Otherwise, when the disk manager
+    // maps the file, the page is served from the mapping without taking a
+    // frame, so a large scan neither copies pages nor evicts the working set.
+    // Falls back to fetch_page when the file is not mapped.
+    PageView fetch_page_view(int file_id, int page_id);
+    void release_page_view(PageView& view);
+
+    bool flush_page(int file_id, int page_id);
+    // Returns false if any dirty page could not be written.
+    bool flush_all_pages();
+    // Writes every dirty page, then empties the log: nothing before this
+    // point needs to be redone after a crash. No other thread may change
+    // pages meanwhile, or their log records would go with the rest.
+    void checkpoint();
+
+    int get_num_pages(int file_id);
+    size_t get_pool_size() const { return pool_size; }
+    BufferPoolStats get_stats();
+};
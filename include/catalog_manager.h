@@ -1,38 +1,99 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include "./heap_file.h"
 #include "./record_manager.h"
 #include "./index_manager.h"
 #include "./data_type.h"
+#include "./row_format.h"
+#include "./table_stats.h"
 
 struct TableSchema {
     std::string table_name;
     std::vector<std::string> columns;
     std::vector<DataType> column_types;
     int primary_key_idx = -1;
+    uint32_t table_id = CATALOG_FILE_ID; // assigned by create_table; also names the heap file
 
     std::string serialize() const;
     static TableSchema deserialize(const std::string& record_str);
 };
 
+// Schemas live as text records in the database's catalog heap (pages.db).
+// Every table's rows live in a heap file of their own, table_<id>.db, which
+// the catalog opens on load and attaches to the buffer pool under the
+// table id.
+//
+// Sessions on other threads share the catalog through table_latch(): the
+// lookups below take no latch of their own, so many statements can read
+// the schema cache at once, and anything that changes it waits until none
+// is running.
 class CatalogManager {
 private:
     RecordManager& record_manager;
     IndexManager& index_manager;
+    LogManager& log_manager;
+    std::string db_dir;
+    IoMode io_mode;
     std::unordered_map<std::string, TableSchema> schema_cache;
+    std::unordered_map<uint32_t, std::unique_ptr<HeapFile>> heaps;
+    std::unordered_map<std::string, TableStats> stats_cache; // tables that have been analyzed
+    uint32_t next_table_id = CATALOG_FILE_ID + 1;
+    std::shared_mutex tables;
+    std::atomic<uint64_t> schema_version{0};
 
     void load_catalog();
+    std::string heap_path(uint32_t table_id) const;
+    std::string stats_path(uint32_t table_id) const;
+    void open_heap(uint32_t table_id);
+    // Deletes table files left behind by a drop that did not finish.
+    void remove_orphan_heaps();
 
 public:
-    CatalogManager(RecordManager& rm, IndexManager& im);
+    CatalogManager(RecordManager& catalog_heap, IndexManager& im, LogManager& lm,
+                   const std::string& db_dir, IoMode io_mode = IoMode::PREAD);
+    ~CatalogManager();
 
     bool create_table(const std::string& table_name, const std::vector<std::string>& columns, const std::vector<DataType>& types, int primary_key_idx);
     bool drop_table(const std::string& table_name);
 
     TableSchema get_schema(const std::string& table_name);
+    // The cached schema itself, without a copy; nullptr if the table does
+    // not exist. Valid until the table is dropped.
+    const TableSchema* find_schema(const std::string& table_name) const;
     std::vector<std::string> list_tables();
+    // Heap holding the table's rows, or nullptr if the table does not exist.
+    RecordManager* get_heap(const std::string& table_name);
+
+    // Statistics from the table's last ANALYZE, or nullptr if it has none.
+    const TableStats* find_stats(const std::string& table_name) const;
+    // Keeps stats as the table's statistics, in memory and on disk.
+    bool set_stats(const std::string& table_name, TableStats stats);
+
+    // Held shared by a statement from planning to its last row, and
+    // exclusively to create or drop tables or indexes or to ANALYZE, so
+    // the schemas, heaps, indexes and statistics a statement found stay
+    // as they were until it is done.
+    std::shared_mutex& table_latch() { return tables; }
+    // Serializes the statements that change the table's rows, so a
+    // PRIMARY KEY check and the insert after it, or a row's heap and index
+    // entries, cannot interleave with another writer's. nullptr if the
+    // table does not exist.
+    std::mutex* get_write_latch(const std::string& table_name);
+    // Bumped after every change to tables or indexes; plans made before
+    // have to be made again.
+    uint64_t get_schema_version() const { return schema_version.load(); }
+    void bump_schema_version() { schema_version++; }
+
+    // Directory for the spill files of queries, data/<db>/tmp. Emptied
+    // when the database is opened.
+    std::string temp_dir() const { return db_dir + "/tmp"; }
 
     // New helper
     bool column_exists(const std::string& table_name, const std::string& column_name);
@@ -0,0 +1,68 @@
+#pragma once
+#include "./buffer_pool_manager.h"
+#include "./catalog_manager.h"
+#include "./db_config.h"
+#include "./disk_manager.h"
+#include "./free_space_map.h"
+#include "./index_manager.h"
+#include "./log_manager.h"
+#include "./record_manager.h"
+#include "./table_manager.h"
+#include "./transaction_manager.h"
+#include "./query/query_parser.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The storage stack of one database, data/<name>, booted the way every
+// front end needs it: the log replayed into the files, indexes rebuilt and
+// half-committed versions undone after a crash, and the garbage collector
+// running. Sessions (QueryParser) on any number of threads share it; all
+// of them must be destroyed before it is.
+class Database {
+private:
+    string name;
+    DBConfig config;
+
+    // Declared in boot order; the destructor closes them in reverse
+    unique_ptr<DiskManager> disk_manager;
+    unique_ptr<LogManager> log_manager;
+    unique_ptr<BufferPoolManager> buffer_pool;
+    unique_ptr<FreeSpaceMap> free_space_map;
+    unique_ptr<RecordManager> catalog_heap;
+    unique_ptr<IndexManager> index_manager;
+    unique_ptr<CatalogManager> catalog_manager;
+    unique_ptr<TableManager> table_manager;
+    unique_ptr<TransactionManager> transaction_manager;
+
+public:
+    static string path(const string& name) { return "data/" + name; }
+    static bool exists(const string& name);
+    // Creates data/<name> with an empty catalog file. False if it exists.
+    static bool create(const string& name);
+    // Names of the databases under data/, sorted.
+    static vector<string> list();
+
+    // Opens an existing database. Sets CURRENT_DATABASE, which the index
+    // manager reads while it boots, so databases are opened one at a time.
+    Database(const string& name, const DBConfig& config);
+    ~Database();
+
+    Database(const Database&) = delete;
+    Database& operator=(const Database&) = delete;
+
+    unique_ptr<QueryParser> open_session();
+    // Called after each statement a session runs. Outside BEGIN ... COMMIT
+    // the statement commits on its own; inside, COMMIT makes the whole
+    // transaction durable. Either way one log flush, no page writes. Once
+    // the log outgrows wal_checkpoint_bytes, or a DROP asked for it, the
+    // pages are written and it is emptied, as soon as no transaction is
+    // open.
+    void end_statement(const QueryParser& session);
+
+    const string& get_name() const { return name; }
+    BufferPoolManager& get_buffer_pool() { return *buffer_pool; }
+    DiskManager& get_disk_manager() { return *disk_manager; }
+};
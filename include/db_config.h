@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+// Engine tunables. Every field has a compiled-in default and can be
+// overridden with the LIMBODB_* environment variable named next to it.
+struct DBConfig {
+    size_t buffer_pool_bytes = 4 * 1024 * 1024;     // LIMBODB_BUFFER_POOL_KB
+    bool use_mmap = false;                          // LIMBODB_MMAP=1
+    size_t group_commit_us = 0;                     // LIMBODB_GROUP_COMMIT_US: extra wait to batch commits
+    size_t wal_checkpoint_bytes = 16 * 1024 * 1024; // LIMBODB_WAL_CHECKPOINT_KB
+    size_t plan_cache_entries = 256;                // LIMBODB_PLAN_CACHE: statements whose plans are kept
+    size_t work_mem_bytes = 16 * 1024 * 1024;       // LIMBODB_WORK_MEM_KB: memory a sort, hash aggregate or hash join may use before spilling to disk
+    size_t gc_interval_ms = 1000;                   // LIMBODB_GC_INTERVAL_MS: how often dead row versions are collected; 0 = never
+    bool log_plans = false;                         // LIMBODB_LOG_PLANS=1: print the planner's cost estimates for each query
+
+    static DBConfig from_env();
+};
+
+namespace db_config_detail {
+    inline bool read_flag(const char* name, bool& out) {
+        const char* value = std::getenv(name);
+        if (!value || !*value) return false;
+        std::string v(value);
+        out = !(v == "0" || v == "false" || v == "off" || v == "no");
+        return true;
+    }
+
+    inline bool read_size(const char* name, size_t& out) {
+        const char* value = std::getenv(name);
+        if (!value || !*value) return false;
+        try {
+            out = static_cast<size_t>(std::stoull(value));
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+}
+
+inline DBConfig DBConfig::from_env() {
+    DBConfig config;
+    size_t kb;
+    if (db_config_detail::read_size("LIMBODB_BUFFER_POOL_KB", kb)) {
+        config.buffer_pool_bytes = kb * 1024;
+    }
+    db_config_detail::read_flag("LIMBODB_MMAP", config.use_mmap);
+    db_config_detail::read_size("LIMBODB_GROUP_COMMIT_US", config.group_commit_us);
+    if (db_config_detail::read_size("LIMBODB_WAL_CHECKPOINT_KB", kb)) {
+        config.wal_checkpoint_bytes = kb * 1024;
+    }
+    db_config_detail::read_size("LIMBODB_PLAN_CACHE", config.plan_cache_entries);
+    if (db_config_detail::read_size("LIMBODB_WORK_MEM_KB", kb)) {
+        config.work_mem_bytes = kb * 1024;
+    }
+    db_config_detail::read_size("LIMBODB_GC_INTERVAL_MS", config.gc_interval_ms);
+    db_config_detail::read_flag("LIMBODB_LOG_PLANS", config.log_plans);
+    return config;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "./buffer_pool_manager.h"
+#include "./disk_manager.h"
+#include "./log_manager.h"
+#include "./posting_list.h"
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Index files are registered in the buffer pool (and named in log records)
+// above every table id.
+const int INDEX_FILE_ID_BASE = 1 << 20;
+
+// Longest key an index accepts. Keeps room for several entries per node, so
+// a split always leaves both halves with space for the entry being added.
+const int MAX_INDEX_KEY_SIZE = 900;
+
+// Where an ordered walk over an index (DiskBPlusTree::scan_ordered) has got
+// to: the last entry it handed out. A default-constructed cursor starts at
+// the first entry in walk order.
+struct IndexCursor {
+    string key;
+    int record_id = 0;
+    bool started = false;
+    bool finished = false;
+};
+
+// B+ tree whose nodes are 4 KB pages of their own file, read and written
+// through the shared buffer pool.
+//
+// Page 0 is a meta page holding the file id and the root page number. Every
+// other page is a node: a small header, a sorted array of slots growing
+// from the front and the entries themselves growing from the back, so the
+// fanout is whatever fits in a page (hundreds of entries for short keys).
+// A slot is the entry's offset plus a 4-byte hint: the first key bytes
+// past the prefix all keys in the node share. A search inside a node
+// binary searches the hints and reads an entry only where the hints tie,
+// so it stays within the few cache lines of the slot array. Entries are (key, record id) pairs, which makes every
+// entry unique even when many rows share a key; internal entries add the
+// child that holds keys >= the entry, the header the leftmost child. Leaves
+// are chained left to right for range scans.
+//
+// Keys are compared as unsigned bytes, like std::string.
+//
+// Every node change is logged as a PAGE_WRITE of the bytes it touched before
+// the page is unpinned, so the tree is updated in place, survives a crash
+// through the same redo pass as the heap, and never has to be rewritten as a
+// whole. Deletes only remove entries; nodes are not merged, and pages
+// emptied by deletes stay in the tree until the index is rebuilt.
+//
+// Threads share a tree through latch crabbing on the node frames. Readers
+// hold a node's latch shared until they hold its child's (or, along the
+// leaves, its right sibling's). Inserts latch their way down exclusively
+// and let go of everything above a node that has room for one more entry
+// of the largest size, since a split below it stops there; the ancestors
+// still held are the ones a split has to change. Deletes never split, so
+// they hold at most a node and its child.
+class DiskBPlusTree {
+private:
+    // A pinned node and the latch held on it.
+    struct LatchedNode {
+        int page_id = -1;
+        Page* frame = nullptr;
+        bool exclusive = false;
+
+        char* data() const { return frame->get_data(); }
+    };
+
+    BufferPoolManager& buffer_pool;
+    LogManager& log_manager;
+    DiskManager disk;
+    int file_id;
+    uint32_t key_format;
+    int root_page;
+    shared_mutex root_latch; // held while reading root_page into a node latch, and exclusively to change it
+    bool dropped;
+    bool old_layout;
+
+    LatchedNode latch_node(int page_id, bool exclusive);
+    // Unlatches and unpins the node.
+    void release(LatchedNode& node, bool dirty = false);
+    void release_all(vector<LatchedNode>& nodes);
+    LatchedNode new_node(bool leaf, vector<char>& before);
+    // Logs what changed in the exclusively latched node since before was
+    // taken, and releases it.
+    void finish_edit(LatchedNode& node, const vector<char>& before);
+    // The caller holds root_latch exclusively.
+    void set_root(int page_id);
+    void redo(const LogRecord& record);
+
+    // Leaf covering (key, record_id), latched shared; page_id is -1 if the
+    // tree is empty.
+    LatchedNode find_leaf(string_view key, int record_id);
+    LatchedNode find_leaf_before(const IndexCursor& cursor, IndexCursor& fence);
+    // path holds the latched ancestors of the node that split, root first.
+    void insert_into_parent(vector<LatchedNode>& path, int left_page, const string& key, int record_id, int right_page);
+
+public:
+    // Opens the index file at path, creating it with new_file_id and
+    // new_key_format if it does not exist yet (an existing file keeps the
+    // values it was created with), and attaches it to the buffer pool.
+    // Throws runtime_error if the file is not an index file.
+    DiskBPlusTree(const string& path, int new_file_id, uint32_t new_key_format, BufferPoolManager& bpm, LogManager& lm);
+    // Detaches the file, writing its dirty pages back unless it was dropped.
+    ~DiskBPlusTree();
+
+    DiskBPlusTree(const DiskBPlusTree&) = delete;
+    DiskBPlusTree& operator=(const DiskBPlusTree&) = delete;
+
+    int get_file_id() const { return file_id; }
+    // Tag the owner stored with the file to say how its keys are encoded;
+    // the tree itself only compares bytes. 0 in files created before the
+    // tag existed.
+    uint32_t get_key_format() const { return key_format; }
+    // Whether the file was written with slots that have no key hints. Such
+    // a tree cannot be searched; it has to be rebuilt.
+    bool has_old_layout() const { return old_layout; }
+    // Dirty pages are discarded on destruction; the caller removes the file.
+    void mark_dropped() { dropped = true; }
+
+    bool insert(string_view key, int record_id);
+    bool remove(string_view key, int record_id);
+    // Record ids stored under key.
+    PostingList search(string_view key);
+    // Record ids of all keys in [start_key, end_key], or [start_key, end_key)
+    // when end_inclusive is false.
+    PostingList range_search(string_view start_key, string_view end_key, bool end_inclusive = true);
+    // Appends the record ids of up to max_entries entries after cursor, in
+    // key order or, if descending, in reverse key order, and advances the
+    // cursor past them. Leaves are only linked left to right, so a
+    // descending walk finds each leaf again from the root.
+    void scan_ordered(IndexCursor& cursor, bool descending, size_t max_entries, vector<int>& record_ids);
+};
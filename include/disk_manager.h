@@ -1,25 +1,69 @@
 #pragma once
 #include<string>
-#include<fstream>
 #include<vector>
+#include<atomic>
+#include<mutex>
 
 using namespace std;
 
 const int PAGE_SIZE = 4096;
 
+enum class IoMode {
+    PREAD, // positioned reads into caller buffers
+    MMAP   // file is mapped read-only; pages can be served as views
+};
+
+// Page-granular access to a single database file. The file stays open for
+// the lifetime of the manager and every transfer is a positioned
+// pread/pwrite, so there is no shared seek pointer and concurrent callers
+// never interfere with each other.
+//
+// In IoMode::MMAP the file is additionally mapped read-only. The mapping is
+// sized ahead of the file and replaced by a larger one when allocate_page
+// outgrows it; superseded mappings stay alive until the manager is destroyed
+// so views handed out earlier never dangle. Writes always go through pwrite,
+// which the shared mapping observes.
 class DiskManager{
 private:
-    fstream db_file;
+    struct Mapping {
+        char* base;
+        int capacity; // in pages
+    };
+
+    int fd;
     string file_name;
+    atomic<int> num_pages;
+    IoMode io_mode;
+    atomic<Mapping*> mapping;
+    vector<Mapping*> mappings; // current one last; older ones are kept for live views
+    mutex alloc_mutex;
+#ifdef _WIN32
+    mutex io_mutex; // no pread/pwrite on Windows; serialize seek + transfer
+#endif
+
+    bool read_at(char* buf, size_t count, long long offset);
+    bool write_at(const char* buf, size_t count, long long offset);
+    bool grow_mapping(int min_pages);
+    void unmap_all();
 
 public:
-    DiskManager(const std::string& filename);
+    DiskManager(const std::string& filename, IoMode mode = IoMode::PREAD);
     ~DiskManager();
 
+    DiskManager(const DiskManager&) = delete;
+    DiskManager& operator=(const DiskManager&) = delete;
+
     bool write_page(int page_id, const vector<char>& data);
+    bool write_page(int page_id, const char* data);
     vector<char> read_page(int page_id);
+    bool read_page(int page_id, char* out);
     void flush();
 
+    // Pointer to the page inside the mapping, valid for the lifetime of the
+    // manager. nullptr if the page does not exist or the file is not mapped.
+    const char* page_view(int page_id);
+    IoMode get_io_mode() const { return io_mode; }
+
     int get_num_pages();
     int allocate_page();
-};
\ No newline at end of file
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include "./disk_manager.h"
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const int FSM_CATEGORY_STEP = PAGE_SIZE / 256; // one category step = 16 free bytes
+
+// Persistent free-space map for a heap file, kept in a separate fork file
+// (<heap file>.fsm). Each heap page is summarized by one byte holding its
+// free space rounded down to FSM_CATEGORY_STEP. Fork page 0 is a header;
+// every following fork page covers PAGE_SIZE heap pages.
+//
+// The map is a hint: RecordManager re-checks the page it is given and
+// reports the real value back if the hint was stale. Lookups use a list of
+// candidate pages per category, so finding a page costs O(categories)
+// independent of the number of heap pages. A page is listed under its
+// current category only, so the lists never hold more than the heap's
+// pages. Every call holds the map's latch, so inserts from several threads
+// can share it.
+class FreeSpaceMap {
+private:
+    DiskManager fork;
+    vector<uint8_t> categories;          // one byte per heap page
+    vector<vector<int>> candidates;      // category -> its pages; category 0 is not listed
+    vector<int> candidate_slots;         // page -> index in its category's list, or -1
+    set<int> dirty_fork_pages;
+    mutex latch;
+
+    void load();
+    void write_header();
+    void add_candidate(int page_id);
+    void remove_candidate(int page_id);
+
+public:
+    FreeSpaceMap(const string& fork_file);
+    ~FreeSpaceMap();
+
+    static uint8_t category_for(int free_bytes);
+
+    // Number of heap pages the map has an entry for.
+    int get_num_pages();
+
+    // A page that had at least needed_bytes free when last updated, or -1.
+    int find_page(int needed_bytes);
+    void update(int page_id, int free_bytes);
+    void flush();
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include "./disk_manager.h"
+#include "./free_space_map.h"
+#include "./record_manager.h"
+#include <memory>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+// One table's storage: <base>.db holding its slotted pages and <base>.fsm
+// holding their free-space map. The file is attached to the shared buffer
+// pool under file_id for as long as the HeapFile lives.
+class HeapFile {
+private:
+    BufferPoolManager& buffer_pool;
+    int file_id;
+    DiskManager disk;
+    FreeSpaceMap free_space_map;
+    unique_ptr<RecordManager> record_manager;
+    mutex writers;
+    bool dropped;
+
+public:
+    HeapFile(const string& base_path, int file_id, BufferPoolManager& bpm, LogManager& lm, IoMode io_mode);
+    // Detaches the file from the buffer pool, writing its dirty pages back
+    // unless the table was dropped.
+    ~HeapFile();
+
+    HeapFile(const HeapFile&) = delete;
+    HeapFile& operator=(const HeapFile&) = delete;
+
+    RecordManager& records() { return *record_manager; }
+    // Held by a statement for as long as it changes the table's rows.
+    mutex& write_latch() { return writers; }
+    int get_file_id() const { return file_id; }
+
+    // Dirty pages are discarded on destruction; the caller removes the files.
+    void mark_dropped() { dropped = true; }
+    static void remove_files(const string& base_path);
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Index keys are byte strings built so that comparing two keys byte by byte,
+// the only comparison the B+ tree knows, orders them like the values they
+// encode:
+//
+//   NULL      [0x00]
+//   INT       [0x01][int64 with the sign bit flipped, big-endian]
+//   FLOAT     [0x01][double bits, big-endian; all bits flipped if negative,
+//                    else only the sign bit]
+//   VARCHAR   [0x01][the string's bytes]
+//
+// So 9 < 10 for INT and FLOAT columns, numeric keys are a fixed 9 bytes, and
+// NULL sorts below every value.
+const char INDEX_KEY_NULL = 0x00;
+const char INDEX_KEY_VALUE = 0x01;
+
+inline string index_key_null() {
+    return string(1, INDEX_KEY_NULL);
+}
+
+// Lowest key of a non-NULL value.
+inline string index_key_min_value() {
+    return string(1, INDEX_KEY_VALUE);
+}
+
+// Above every value's key; use it as an exclusive upper bound.
+inline string index_key_past_values() {
+    return string(1, INDEX_KEY_VALUE + 1);
+}
+
+inline string index_key_from_bits(uint64_t bits) {
+    string key(1 + sizeof(bits), INDEX_KEY_VALUE);
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+        key[1 + i] = static_cast<char>(bits >> (8 * (sizeof(bits) - 1 - i)));
+    }
+    return key;
+}
+
+inline string index_key_int(int64_t value) {
+    return index_key_from_bits(static_cast<uint64_t>(value) ^ (1ULL << 63));
+}
+
+inline string index_key_float(double value) {
+    if (value == 0) value = 0.0; // -0.0 and 0.0 are the same key
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = (bits >> 63) ? ~bits : bits | (1ULL << 63);
+    return index_key_from_bits(bits);
+}
+
+inline string index_key_varchar(string_view value) {
+    string key(1, INDEX_KEY_VALUE);
+    key.append(value);
+    return key;
+}
+
+// Smallest key greater than key, for turning "> key" into ">= successor".
+inline string index_key_successor(const string& key) {
+    return key + '\0';
+}
@@ -3,35 +3,60 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
-#include <set>
-#include "btree.h"
-#include <fstream>
 #include <filesystem>
+#include "./data_type.h"
+#include "./disk_btree.h"
 
 namespace fs = std::filesystem;
 
 using namespace std;
 
+// Each index is a DiskBPlusTree in data/<db>/indexes/<table>_<column>.bpt,
+// opened when the database is selected and kept up to date in place.
+//
+// Keys are index keys (index_key.h) of the column's type, so numeric columns
+// are ordered by value; the column type is stored in the index file.
+//
+// Trees are created and dropped only under the catalog's table latch held
+// exclusively, so lookups need no latch of their own; each tree keeps
+// concurrent searches and updates apart itself.
 class IndexManager {
 private:
-    // table -> column -> BPlusTree<string, set<int>>
-    unordered_map<string, unordered_map<string, BPlusTree<string, set<int>>*>> indexes;
+    BufferPoolManager& buffer_pool;
+    LogManager& log_manager;
+    string index_dir;
+    // table -> column -> tree
+    unordered_map<string, unordered_map<string, DiskBPlusTree*>> indexes;
+    int next_file_id = INDEX_FILE_ID_BASE;
+    bool rebuild_needed = false;
+
+    string index_path(const string& table_name, const string& column_name) const;
+    DiskBPlusTree* find_index(const string& table_name, const string& column_name);
+    void load_indexes();
 
 public:
     bool column_exists(const string& table_name, const string& column_name);
+    vector<string> indexed_columns(const string& table_name);
 
-    IndexManager();
+    IndexManager(BufferPoolManager& bpm, LogManager& lm);
     ~IndexManager();
-    
-    void save_indexes();
-    void load_indexes();
-    
-    bool create_index(const string& table_name, const string& column_name);
+
+    // True if some index could not be opened (or was written in an older
+    // format) and the indexes have to be rebuilt from the tables.
+    bool needs_rebuild() const { return rebuild_needed; }
+
+    // Creates an empty index; the caller adds the existing rows.
+    bool create_index(const string& table_name, const string& column_name, DataType key_type);
     bool drop_index(const string& table_name, const string& column_name);
 
     bool insert_entry(const string& table_name, const string& column_name, const string& key, int record_id);
     bool delete_entry(const string& table_name, const string& column_name, const string& key, int record_id);
 
-    vector<int> search(const string& table_name, const string& column_name, const string& key);
-    vector<int> range_search(const string& table_name, const string& column_name, const string& start_key, const string& end_key);
+    PostingList search(const string& table_name, const string& column_name, const string& key);
+    // Record ids with start_key <= key <= end_key (key < end_key if
+    // end_inclusive is false).
+    PostingList range_search(const string& table_name, const string& column_name, const string& start_key, const string& end_key, bool end_inclusive = true);
+    // Next record ids of an ordered walk over the index, see
+    // DiskBPlusTree::scan_ordered. Returns false if there is no such index.
+    bool scan_ordered(const string& table_name, const string& column_name, IndexCursor& cursor, bool descending, size_t max_entries, vector<int>& record_ids);
 };
\ No newline at end of file
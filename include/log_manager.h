@@ -0,0 +1,122 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef uint64_t lsn_t;
+const lsn_t INVALID_LSN = 0;
+
+// Every page that goes through the buffer pool carries the LSN of the last
+// log record applied to it at this offset (right after the 4-byte slotted
+// page header). The buffer pool uses it to enforce the WAL rule, recovery
+// uses it to decide whether a record still has to be redone.
+const int PAGE_LSN_OFFSET = 4;
+
+lsn_t get_page_lsn(const char* page);
+void set_page_lsn(char* page, lsn_t lsn);
+
+// Payload of a PAGE_WRITE record: the byte ranges in which two images of a
+// page differ, as runs of [uint16 offset][uint16 length][bytes].
+void diff_page(const char* before, const char* after, vector<char>& out);
+void apply_page_diff(char* page, const vector<char>& diff);
+
+enum class LogRecordType : uint8_t {
+    INSERT = 1, // after = record bytes placed in (page, slot)
+    DELETE = 2, // before = record bytes removed from (page, slot)
+    UPDATE = 3, // before/after images of the record in (page, slot)
+    COMMIT = 4, // end of a statement; no page
+    PAGE_WRITE = 5, // after = diff_page runs; for pages without slots (index nodes)
+    VERSION = 6, // before/after = VersionHeader (mvcc.h) at the start of the record in (page, slot)
+};
+
+// Physiological log record: names a page (file + page number) physically and the change inside
+// it logically (slot + record bytes), so redo does not depend on where the
+// record happened to land within the page.
+struct LogRecord {
+    lsn_t lsn = INVALID_LSN;
+    LogRecordType type = LogRecordType::COMMIT;
+    int file_id = -1;
+    int page_id = -1;
+    int slot_id = -1;
+    vector<char> before;
+    vector<char> after;
+};
+
+// Write-ahead log kept in a single append-only file next to the heap file.
+//
+// LSNs are byte positions in the log stream, so a record's LSN also tells
+// how far the file must be synced for it to be durable. append() only copies
+// the record into an in-memory buffer; a background flusher thread writes
+// whatever has accumulated with a single write + fdatasync and wakes every
+// waiter covered by it. Commits that arrive while a sync is in progress are
+// picked up together by the next one (group commit).
+//
+// The file starts with a small header holding the LSN of its first record.
+// checkpoint() empties the file once every page is on disk; the header keeps
+// LSNs growing across checkpoints so page LSNs stay comparable.
+class LogManager {
+private:
+    int fd;
+    string file_name;
+    unsigned group_commit_us;
+
+    mutex latch;
+    condition_variable flush_cv;   // wakes the flusher
+    condition_variable durable_cv; // wakes threads waiting in flush_to
+    vector<char> log_buffer;       // appended, not yet handed to the flusher
+    lsn_t base_lsn;                // LSN of the first record in the file
+    lsn_t next_lsn;                // LSN the next appended record gets
+    lsn_t durable_lsn;             // everything below this is synced
+    lsn_t last_commit_lsn;
+    bool flush_requested;
+    bool flushing;                 // flusher is writing a batch outside the latch
+    bool stop;
+    bool recovery_needed;
+    atomic<bool> checkpoint_requested{false};
+    thread flusher;
+
+    void flusher_loop();
+    void open_log();
+    bool write_header(lsn_t base);
+    long long file_offset(lsn_t lsn) const;
+
+public:
+    LogManager(const string& log_file, unsigned group_commit_us = 0);
+    ~LogManager();
+
+    LogManager(const LogManager&) = delete;
+    LogManager& operator=(const LogManager&) = delete;
+
+    // Buffers the record, fills in record.lsn and returns it.
+    lsn_t append(LogRecord& record);
+    // Blocks until every record with an LSN <= lsn is on disk.
+    void flush_to(lsn_t lsn);
+    // Appends a COMMIT record and waits for it to become durable. A no-op
+    // when nothing was logged since the previous commit.
+    void commit();
+
+    // Calls apply for every intact record in the file, in LSN order.
+    void replay(const function<void(const LogRecord&)>& apply);
+    // True if the file held records when it was opened, i.e. the previous
+    // run did not end with a checkpoint.
+    bool needs_recovery() const { return recovery_needed; }
+
+    // Only valid when every page dirtied by the logged records is on disk.
+    void checkpoint();
+    // For changes that want the log emptied, but not while a transaction
+    // is open: the owner checkpoints at its next safe point.
+    void request_checkpoint() { checkpoint_requested = true; }
+    bool checkpoint_due() const { return checkpoint_requested; }
+    // Bytes of log written since the last checkpoint.
+    lsn_t size();
+    // LSN the next appended record gets. LSNs keep growing across
+    // checkpoints and restarts.
+    lsn_t current_lsn();
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Multi-version rows. Every record of a table heap is one version of a row:
+//
+//   [begin: uint64][end: uint64][next: int32][row bytes (row_format.h)]
+//
+// begin and end bound the version's life in commit timestamps: it was
+// created by the transaction that committed at begin and deleted or
+// replaced by the one that committed at end (TS_INFINITY while it is the
+// row's newest). Until its transaction commits, a field holds that
+// transaction's id instead, told apart by TXN_ID_FLAG. next is the record
+// id of the version an UPDATE replaced this one with, or -1.
+//
+// Readers never change a version, so they never wait for writers: each one
+// reads as of a Snapshot and skips the versions it does not see.
+typedef uint64_t timestamp_t;
+
+const timestamp_t TXN_ID_FLAG = 1ULL << 63;
+const timestamp_t TS_INFINITY = TXN_ID_FLAG - 1;
+
+inline bool is_txn_id(timestamp_t value) {
+    return (value & TXN_ID_FLAG) != 0;
+}
+
+struct VersionHeader {
+    timestamp_t begin = TS_INFINITY;
+    timestamp_t end = TS_INFINITY;
+    int32_t next = -1;
+};
+
+const int VERSION_HEADER_SIZE = 20;
+
+inline VersionHeader read_version_header(const char* record) {
+    VersionHeader header;
+    memcpy(&header.begin, record, 8);
+    memcpy(&header.end, record + 8, 8);
+    memcpy(&header.next, record + 16, 4);
+    return header;
+}
+
+inline void write_version_header(char* record, const VersionHeader& header) {
+    memcpy(record, &header.begin, 8);
+    memcpy(record + 8, &header.end, 8);
+    memcpy(record + 16, &header.next, 4);
+}
+
+// Whether the version is still its row's newest, counting changes that have
+// not committed yet except txn_id's own: a row can only be changed through
+// such a version.
+inline bool is_live(const VersionHeader& version, timestamp_t txn_id) {
+    return version.end == TS_INFINITY || (is_txn_id(version.end) && version.end != txn_id);
+}
+
+// What a transaction reads: the versions committed at or before read_ts,
+// plus its own changes.
+struct Snapshot {
+    timestamp_t read_ts = 0;
+    timestamp_t txn_id = 0; // 0 for a snapshot that makes no changes
+
+    bool sees(const VersionHeader& version) const {
+        bool created = is_txn_id(version.begin) ? version.begin == txn_id : version.begin <= read_ts;
+        if (!created) return false;
+        bool ended = is_txn_id(version.end) ? version.end == txn_id : version.end <= read_ts;
+        return !ended;
+    }
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Sorted set of record ids, compressed roaring-style.
+//
+// Ids are grouped by their high 16 bits, which for an encoded RecordID is
+// the page, and each group keeps the low 16 bits (the slot) in a container:
+// a sorted array of uint16 while it holds at most ARRAY_LIMIT ids, a
+// 65536-bit bitmap once it is denser than that. Ids from the same page thus
+// cost 2 bytes each at most, adding or removing one touches only its own
+// container, and intersection and union work container by container
+// (merging arrays, ANDing/ORing bitmap words) without decoding the sets.
+class PostingList {
+private:
+    static constexpr uint32_t ARRAY_LIMIT = 4096;        // 4096 * 2 bytes = one bitmap
+    static constexpr uint32_t BITMAP_WORDS = 65536 / 64;
+
+    struct Container {
+        uint16_t key;
+        uint32_t cardinality = 0;
+        vector<uint16_t> array;   // sorted; used while bitmap is empty
+        vector<uint64_t> bitmap;  // BITMAP_WORDS words once the array is too big
+
+        explicit Container(uint16_t key) : key(key) {}
+        bool is_bitmap() const { return !bitmap.empty(); }
+        bool contains(uint16_t low) const;
+        bool add(uint16_t low);
+        bool remove(uint16_t low);
+        void to_bitmap();
+        void to_array();
+        // Switches to whichever form is smaller for the current cardinality.
+        void normalize();
+    };
+
+    vector<Container> containers; // sorted by key, none empty
+    size_t count = 0;
+
+    Container* find_container(uint16_t key);
+    const Container* find_container(uint16_t key) const;
+
+    static Container intersect(const Container& a, const Container& b);
+    static Container unite(const Container& a, const Container& b);
+
+public:
+    PostingList() = default;
+    // From ids in any order; duplicates are dropped.
+    explicit PostingList(const vector<int>& ids);
+
+    // Returns false if id was already present / not present.
+    bool add(int id);
+    bool remove(int id);
+    bool contains(int id) const;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear();
+
+    // Walks the ids in ascending order, one at a time. The list must not
+    // change while a cursor is in use.
+    class Cursor {
+    private:
+        const PostingList* list;
+        size_t container = 0;
+        uint32_t position = 0; // array index, or next bit to look at
+
+    public:
+        explicit Cursor(const PostingList& list) : list(&list) {}
+        // Sets id to the next id; false when there are no more.
+        bool next(int& id);
+    };
+
+    // Ids in ascending order.
+    vector<int> to_vector() const;
+    template <typename F>
+    void for_each(F visit) const;
+
+    // Keeps only the ids also in other (AND).
+    void intersect_with(const PostingList& other);
+    // Adds the ids of other (OR).
+    void union_with(const PostingList& other);
+};
+
+template <typename F>
+void PostingList::for_each(F visit) const {
+    for (const Container& container : containers) {
+        uint32_t high = static_cast<uint32_t>(container.key) << 16;
+        if (!container.is_bitmap()) {
+            for (uint16_t low : container.array) {
+                visit(static_cast<int>(high | low));
+            }
+            continue;
+        }
+        for (uint32_t word = 0; word < BITMAP_WORDS; ++word) {
+            uint64_t bits = container.bitmap[word];
+            while (bits) {
+                uint32_t bit = countr_zero(bits);
+                visit(static_cast<int>(high | (word * 64 + bit)));
+                bits &= bits - 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include "../data_type.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+using namespace std;
+
+// A constant as written in the statement. Its kind comes from the way it
+// was written: 42 is INTEGER, 4.2 FLOAT, 'x' STRING. A '?' is a PARAMETER
+// whose value is bound when a prepared statement is executed.
+struct Literal {
+    enum class Kind { NULL_VALUE, INTEGER, FLOAT, STRING, PARAMETER };
+
+    Kind kind = Kind::NULL_VALUE;
+    int64_t int_value = 0;
+    double float_value = 0;
+    string text;         // digits as written, or the string's contents
+    int parameter = -1;  // PARAMETER: position of its '?' in the statement, from 0
+
+    // The value as SQL literal text, the form RowFormat::encode and
+    // RowFormat::literal_index_key take: 42, 4.2, 'x', NULL.
+    string sql() const;
+};
+
+enum class CompareOp { EQ, NE, LT, LE, GT, GE };
+
+string to_string(CompareOp op);
+
+// Condition of a WHERE clause. Leaves compare a column with a constant;
+// inner nodes combine two conditions with AND or OR.
+struct Expr {
+    enum class Kind { COMPARE, AND, OR };
+
+    Kind kind = Kind::COMPARE;
+
+    // COMPARE
+    string column;
+    CompareOp op = CompareOp::EQ;
+    Literal value;
+
+    // AND / OR
+    unique_ptr<Expr> left;
+    unique_ptr<Expr> right;
+};
+
+struct CreateTableStatement {
+    string table;
+    vector<string> columns;
+    vector<DataType> types;
+    string primary_key;
+};
+
+struct DropTableStatement {
+    string table;
+};
+
+struct CreateIndexStatement {
+    string table;
+    string column;
+};
+
+struct InsertStatement {
+    string table;
+    vector<string> columns;       // empty: values are in schema order
+    vector<vector<Literal>> rows; // one or more VALUES tuples
+};
+
+struct DeleteStatement {
+    string table;
+    unique_ptr<Expr> where;
+};
+
+struct UpdateStatement {
+    string table;
+    vector<pair<string, Literal>> assignments;
+    unique_ptr<Expr> where;
+};
+
+enum class AggregateFunction { NONE, COUNT, SUM, AVG, MIN, MAX };
+
+string to_string(AggregateFunction function);
+
+// One entry of the SELECT list: a column, or an aggregate of a column.
+// COUNT(*) has an empty column.
+struct SelectItem {
+    AggregateFunction function = AggregateFunction::NONE;
+    string column;
+
+    // Heading of the output column: the column name, or e.g. "count(*)".
+    string name() const;
+};
+
+// ORDER BY entry. column is a column name, or the name() of an aggregate
+// item such as "count(*)".
+struct OrderItem {
+    string column;
+    bool descending = false;
+};
+
+// [INNER] JOIN table [alias] ON left_column = right_column. The ON
+// columns are as written and may name either table first.
+struct JoinClause {
+    string table;
+    string alias;
+    string left_column;
+    string right_column;
+};
+
+struct SelectStatement {
+    vector<SelectItem> items; // empty for *
+    string table;
+    string alias;             // empty without one
+    optional<JoinClause> join;
+    unique_ptr<Expr> where;   // null without WHERE
+    vector<string> group_by;
+    vector<OrderItem> order_by;
+    int64_t limit = -1;       // -1 without LIMIT
+};
+
+// PREPARE name AS statement. The statement is kept as text; QueryParser
+// parses and plans it.
+struct PrepareStatement {
+    string name;
+    string body;
+};
+
+// EXECUTE name [(value, ...)]
+struct ExecuteStatement {
+    string name;
+    vector<Literal> parameters;
+};
+
+// DEALLOCATE [PREPARE] name
+struct DeallocateStatement {
+    string name;
+};
+
+// ANALYZE [table]; every table without one.
+struct AnalyzeStatement {
+    string table;
+};
+
+// BEGIN [TRANSACTION], COMMIT or ROLLBACK
+struct TransactionStatement {
+    enum class Kind { BEGIN, COMMIT, ROLLBACK };
+    Kind kind;
+};
+
+using Statement = variant<CreateTableStatement, DropTableStatement, CreateIndexStatement,
+                          InsertStatement, DeleteStatement, UpdateStatement, SelectStatement,
+                          PrepareStatement, ExecuteStatement, DeallocateStatement, AnalyzeStatement,
+                          TransactionStatement>;
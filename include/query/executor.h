@@ -0,0 +1,482 @@
+#pragma once
+#include "./plan.h"
+#include "../index_manager.h"
+#include "../mvcc.h"
+#include "../posting_list.h"
+#include "../record_iterator.h"
+#include "../record_manager.h"
+#include "../row_format.h"
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// A row passed between operators, encoded in the producing operator's
+// RowFormat. record_id is the heap row it came from, or -1 for a row an
+// operator computed.
+struct Row {
+    int record_id = -1;
+    vector<char> data;
+};
+
+// Rows per Batch: enough to spread the per-call cost over many rows,
+// few enough for a batch's column vectors to stay in cache.
+constexpr size_t BATCH_ROWS = 2048;
+
+// One column of a Batch as a typed array indexed by row position. Only the
+// array of the column's type is filled; NULL fields hold 0 there.
+struct ColumnVector {
+    bool decoded = false;
+    vector<uint8_t> nulls;
+    vector<int64_t> ints;
+    vector<double> floats;
+    vector<string_view> strings; // point into the batch's rows
+};
+
+// Up to BATCH_ROWS rows of an operator's output. selection lists the
+// positions of the rows still in the batch, in order; filters narrow it
+// instead of moving rows. Columns are decoded the first time they are used.
+class Batch {
+private:
+    vector<ColumnVector> columns;
+
+public:
+    vector<Row> rows;
+    vector<uint16_t> selection;
+
+    void clear();
+    // Selects every row, after the producer has filled rows.
+    void select_all();
+    size_t size() const { return selection.size(); }
+    const ColumnVector& column(const RowFormat& format, int col);
+};
+
+// Pull-based query operator. open() gets it ready, each next() hands out
+// one row until it returns false, close() releases what it holds. Parents
+// drive their children the same way, so rows stream from the scan to the
+// output one at a time; only Sort, the aggregates and the right side of a
+// HashJoin are read in full first.
+//
+// next_batch() is the same stream a batch at a time. Scans and filters
+// work on whole batches, with one call per batch rather than per row;
+// Project, Sort and the aggregates read their children that way. An operator
+// is read with next() or with next_batch() between open and close, not both.
+class Operator {
+protected:
+    vector<string> column_names;
+    vector<DataType> column_types;
+    RowFormat row_format;
+
+public:
+    Operator(vector<string> names, vector<DataType> types);
+    virtual ~Operator() = default;
+
+    virtual void open() = 0;
+    virtual bool next(Row& row) = 0;
+    virtual void close() = 0;
+    // Fills batch with the next rows; false once there are none. The
+    // default gathers them from next().
+    virtual bool next_batch(Batch& batch);
+
+    const vector<string>& names() const { return column_names; }
+    const vector<DataType>& types() const { return column_types; }
+    const RowFormat& format() const { return row_format; }
+};
+
+// Every row of a table's heap the snapshot sees, in page order.
+class SeqScan : public Operator {
+private:
+    RecordManager& heap;
+    Snapshot snapshot;
+    unique_ptr<RecordIterator> iterator;
+    vector<Record> records; // next_batch's read buffer
+
+public:
+    SeqScan(RecordManager& heap, const TableSchema& schema, const Snapshot& snapshot);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+    bool next_batch(Batch& batch) override;
+};
+
+// The rows with the given ids, in id order; ids without a row the snapshot
+// sees are skipped.
+class IndexScan : public Operator {
+private:
+    RecordManager& heap;
+    Snapshot snapshot;
+    PostingList record_ids;
+    unique_ptr<PostingList::Cursor> cursor;
+
+public:
+    IndexScan(RecordManager& heap, const TableSchema& schema, const Snapshot& snapshot, PostingList record_ids);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// Every row of a table in the order of the index on one of its columns.
+// Ids are taken from the index a few at a time, so a parent that stops
+// early (LIMIT) only costs the rows it used.
+class IndexOrderScan : public Operator {
+private:
+    RecordManager& heap;
+    Snapshot snapshot;
+    IndexManager& indexes;
+    string table_name;
+    string column_name;
+    bool descending;
+    IndexCursor cursor;
+    vector<int> record_ids;
+    size_t position = 0;
+    size_t chunk = 0; // ids to read next time, growing to BATCH_ROWS
+
+public:
+    IndexOrderScan(RecordManager& heap, IndexManager& indexes, const TableSchema& schema, const Snapshot& snapshot, const SortKey& order);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// Rows of its child for which a bound WHERE condition holds.
+class Filter : public Operator {
+private:
+    unique_ptr<Operator> child;
+    unique_ptr<Predicate> predicate;
+    vector<uint8_t> hits; // per row of the batch being filtered
+
+    bool matches(const Predicate& condition, const Row& row) const;
+    // Narrows batch.selection to the rows where condition holds.
+    void select(const Predicate& condition, Batch& batch);
+    void select_comparison(const Predicate& comparison, Batch& batch);
+
+public:
+    Filter(unique_ptr<Operator> child, unique_ptr<Predicate> predicate);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+    bool next_batch(Batch& batch) override;
+};
+
+// The given columns of each child row, in the given order.
+class Project : public Operator {
+private:
+    unique_ptr<Operator> child;
+    vector<int> columns;
+    Batch input;
+    size_t position = 0; // next entry of input.selection
+
+public:
+    Project(unique_ptr<Operator> child, vector<int> columns);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// The first count rows of its child.
+class Limit : public Operator {
+private:
+    unique_ptr<Operator> child;
+    int64_t count;
+    int64_t produced = 0;
+
+public:
+    Limit(unique_ptr<Operator> child, int64_t count);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// All rows of its child, ordered by the sort keys. Ties keep their input
+// order; NULL sorts before every value.
+//
+// Rows are sorted in memory until they take more than memory_budget bytes.
+// Past that, each full load is sorted and written to a run file in
+// temp_dir, and next() merges the runs; more than MERGE_FAN_IN runs are
+// first merged in groups into longer runs. Throws runtime_error if a run
+// file cannot be written or read.
+class Sort : public Operator {
+private:
+    static constexpr size_t MERGE_FAN_IN = 64;
+
+    // A run file being merged, positioned on its next row.
+    struct RunReader {
+        ifstream in;
+        Row row;
+        vector<string> key;
+        size_t run; // position among the runs merged, to keep ties stable
+    };
+
+    unique_ptr<Operator> child;
+    vector<SortKey> keys;
+    size_t memory_budget;
+    string temp_dir;
+
+    vector<Row> rows;
+    size_t position = 0;
+
+    vector<string> runs;                 // run files, in input order
+    vector<unique_ptr<RunReader>> readers;
+    vector<RunReader*> merge_heap;       // readers with a row left, smallest first
+
+    void sort_rows(vector<pair<vector<string>, size_t>>& sort_keys);
+    string run_path() const;
+    void write_run(const vector<Row>& run_rows);
+    bool read_row(RunReader& reader) const;
+    bool comes_after(const RunReader* a, const RunReader* b) const;
+    void start_merge(size_t first, size_t last);
+    bool merge_next(Row& row);
+    void remove_runs();
+
+public:
+    Sort(unique_ptr<Operator> child, vector<SortKey> keys, size_t memory_budget, string temp_dir);
+    ~Sort() override;
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// The first count rows Sort would give, found with a heap of count rows
+// rather than by sorting the whole input.
+class TopN : public Operator {
+private:
+    unique_ptr<Operator> child;
+    vector<SortKey> keys;
+    int64_t count;
+    vector<Row> rows;
+    size_t position = 0;
+
+public:
+    TopN(unique_ptr<Operator> child, vector<SortKey> keys, int64_t count);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// One aggregate over a column of the child, or COUNT(*) for column -1.
+// In a HashAggregate, function NONE outputs the group's value of column.
+struct AggregateSpec {
+    AggregateFunction function;
+    int column;
+};
+
+// Running value of one aggregate.
+struct AggregateState {
+    int64_t count = 0;
+    int64_t int_sum = 0;
+    double float_sum = 0;
+    string best_key;   // MIN / MAX: index key of the best value so far
+    Row best_row;      // the child row holding it
+};
+
+// A single row holding the aggregates of all child rows. COUNT of no rows
+// is 0; the other functions are NULL then, and skip NULL inputs.
+class Aggregate : public Operator {
+private:
+    unique_ptr<Operator> child;
+    vector<AggregateSpec> specs;
+    bool done = false;
+
+    // Folds the selected rows of batch into state.
+    void accumulate(const AggregateSpec& spec, AggregateState& state, Batch& batch);
+
+public:
+    Aggregate(unique_ptr<Operator> child, vector<AggregateSpec> specs, vector<string> names);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// One row per group of child rows that agree on the group columns, with
+// the outputs the specs ask for. Groups are found through an
+// open-addressing hash table keyed on the group columns' index keys, so
+// values group by their typed value and all NULLs form one group.
+//
+// Once the groups take more than memory_budget bytes, rows of groups not
+// in the table yet are written by hash to PARTITIONS files in temp_dir.
+// Each file is aggregated the same way after the table has been output,
+// and split again with another hash if it still does not fit. Output order
+// follows the hash table. Throws runtime_error if a partition file cannot
+// be written or read.
+class HashAggregate : public Operator {
+private:
+    static constexpr size_t PARTITIONS = 16;
+    static constexpr int MAX_DEPTH = 8; // below this, a partition stays in memory whatever its size
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t group = EMPTY;
+    };
+
+    struct Partition {
+        string path;
+        int depth;
+    };
+
+    unique_ptr<Operator> child;
+    vector<int> group_columns;
+    vector<AggregateSpec> specs;
+    size_t memory_budget;
+    string temp_dir;
+
+    vector<Slot> slots;              // size is a power of two, at most 70% full
+    vector<string> group_keys;
+    vector<Row> group_rows;          // a row of each group, for its column values
+    vector<AggregateState> states;   // specs.size() per group
+    size_t memory_used = 0;
+    size_t position = 0;             // next group to output
+    int depth = 0;                   // how often the rows in the table were partitioned
+
+    vector<ofstream> spill;          // open partition files, while over budget
+    vector<string> spill_paths;
+    vector<size_t> spill_rows;
+    deque<Partition> pending;        // partition files still to aggregate
+
+    void reset_table();
+    void add_row(const Row& row);
+    void grow_table();
+    void start_spill();
+    void finish_spill();
+    void remove_files();
+
+public:
+    HashAggregate(unique_ptr<Operator> child, vector<int> group_columns, vector<AggregateSpec> specs, vector<string> names,
+                  size_t memory_budget, string temp_dir);
+    ~HashAggregate() override;
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// COUNT(*) of a whole table as one row, counted from the heap pages' slot
+// directories and version headers without decoding any row.
+class SlotCount : public Operator {
+private:
+    RecordManager& heap;
+    Snapshot snapshot;
+    bool done = false;
+
+public:
+    SlotCount(RecordManager& heap, const Snapshot& snapshot, string name);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// Rows of outer joined with the rows an index on the inner table finds for
+// each outer row's key: one index lookup per outer row and one heap read
+// per match. Output rows hold the joined schema's columns, the left
+// table's first, whichever side is the outer one.
+class IndexNestedLoopJoin : public Operator {
+private:
+    unique_ptr<Operator> outer;
+    int outer_key;
+    RecordManager& inner_heap;
+    Snapshot snapshot;       // the inner table's
+    IndexManager& indexes;
+    string inner_table;
+    string inner_column;
+    DataType key_type;       // the inner key column's
+    RowFormat inner_format;
+    bool outer_is_left;
+
+    Batch batch;
+    size_t position = 0;     // next entry of batch.selection
+    const Row* current = nullptr;
+    vector<int> matches;     // inner record ids for current
+    size_t match = 0;
+    Row inner_row;
+
+public:
+    IndexNestedLoopJoin(unique_ptr<Operator> outer, int outer_key, RecordManager& inner_heap, const Snapshot& snapshot, IndexManager& indexes,
+                        const TableSchema& inner, int inner_key, bool outer_is_left, const TableSchema& joined);
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
+
+// Rows of left and right whose key columns are equal, found by hashing the
+// right rows on their key and probing with each left row. NULL keys join
+// nothing. Output rows hold the left columns, then the right.
+//
+// If the right rows take more than memory_budget bytes, both sides are
+// written by key hash to PARTITIONS pairs of files in temp_dir and each
+// pair is joined on its own (a grace hash join); a pair whose right side
+// still does not fit is split again with another hash. Throws
+// runtime_error if a partition file cannot be written or read.
+class HashJoin : public Operator {
+private:
+    static constexpr size_t PARTITIONS = 16;
+    static constexpr int MAX_DEPTH = 8; // below this, a partition stays in memory whatever its size
+    static constexpr uint32_t END = UINT32_MAX;
+
+    struct Entry {
+        uint64_t hash;
+        string key;
+        Row row;
+        uint32_t next; // next entry in the same bucket
+    };
+
+    struct Partition {
+        string build_path; // right rows
+        string probe_path; // left rows
+        int depth;
+    };
+
+    unique_ptr<Operator> left;
+    unique_ptr<Operator> right;
+    int left_key;
+    int right_key;
+    DataType key_type;
+    size_t memory_budget;
+    string temp_dir;
+
+    vector<Entry> entries;           // right rows in memory
+    vector<uint32_t> buckets;        // first entry of each chain; size is a power of two
+    size_t memory_used = 0;
+    int depth = 0;                   // how often the rows in memory were partitioned
+
+    vector<ofstream> build_spill;    // open partition files, while over budget
+    vector<ofstream> probe_spill;
+    vector<string> build_paths;
+    vector<string> probe_paths;
+    vector<size_t> build_rows;
+    vector<size_t> probe_rows;
+    deque<Partition> pending;        // partition pairs still to join
+
+    bool probe_from_child = false;
+    Batch batch;
+    size_t position = 0;             // next entry of batch.selection
+    ifstream probe_file;             // left rows of the partition being joined
+    string probe_path;
+    Row probe_row;
+    const Row* probe = nullptr;      // left row being joined
+    string key;                      // and its key
+    uint64_t hash = 0;
+    uint32_t match = END;            // next entry to join it with
+
+    void reset_table();
+    void add_build_row(Row&& row);
+    void add_probe_row(const Row& row);
+    void build_table();
+    void start_spill();
+    void finish_spill();
+    uint32_t next_match(uint32_t entry) const;
+    bool next_probe();
+    bool open_partition();
+    void remove_files();
+
+public:
+    HashJoin(unique_ptr<Operator> left, int left_key, unique_ptr<Operator> right, int right_key, const TableSchema& joined,
+             size_t memory_budget, string temp_dir);
+    ~HashJoin() override;
+    void open() override;
+    bool next(Row& row) override;
+    void close() override;
+};
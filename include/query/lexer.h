@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+enum class TokenType {
+    IDENTIFIER, // names and keywords; keywords are matched case-insensitively by the parser
+    INTEGER,
+    FLOAT,
+    STRING,     // text is the unescaped contents, without the quotes
+    SYMBOL,     // ( ) , ; * = != <> < <= > >= - ?
+    END
+};
+
+struct Token {
+    TokenType type;
+    string text;
+    size_t position; // byte offset in the statement, for error messages
+};
+
+// Splits a statement into tokens in one pass over the text.
+//
+// Strings are quoted with ' or " and a doubled quote inside stands for
+// itself ('it''s'). A number with a '.' or an exponent is a FLOAT, otherwise
+// an INTEGER; a leading '-' is a separate SYMBOL token. "--" starts a
+// comment that runs to the end of the line.
+class Lexer {
+private:
+    string_view text;
+    size_t pos = 0;
+
+    bool read_token(Token& token, string& error);
+
+public:
+    explicit Lexer(string_view sql) : text(sql) {}
+
+    // Returns false with a message in error on an unterminated string or a
+    // character that cannot start a token. The last token is always END.
+    bool tokenize(vector<Token>& tokens, string& error);
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include "./ast.h"
+#include "../catalog_manager.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Column position of the record_id pseudo-column in a Predicate.
+constexpr int RECORD_ID_COLUMN = -1;
+
+// A WHERE condition resolved against the table: leaves know their column's
+// position and type and whether an index can answer them.
+struct Predicate {
+    Expr::Kind kind = Expr::Kind::COMPARE;
+
+    // COMPARE
+    int column = RECORD_ID_COLUMN;
+    DataType type = DataType::UNKNOWN;
+    CompareOp op = CompareOp::EQ;
+    Literal value;        // a PARAMETER is bound on each execution
+    string key;           // index key of value, unless it is a parameter
+    bool indexed = false;
+
+    // AND / OR
+    unique_ptr<Predicate> left;
+    unique_ptr<Predicate> right;
+};
+
+// ORDER BY entry resolved to a column position.
+struct SortKey {
+    int column;
+    bool descending;
+    bool indexed = false; // an index on the column can hand out rows in order
+};
+
+// The two tables of SELECT ... JOIN. The plan's schema describes the
+// joined row: the left table's columns, then the right's, each named
+// qualifier.column. Conditions on one table alone are split off the WHERE
+// and applied while reading that table, with positions in its own schema.
+struct JoinPlan {
+    TableSchema left;
+    TableSchema right;
+    int left_key;                      // ON column in left
+    int right_key;                     // ON column in right
+    unique_ptr<Predicate> left_where;  // null if none
+    unique_ptr<Predicate> right_where;
+};
+
+// A parsed statement together with everything that can be worked out
+// before its parameters are known. Plans are tied to the schema version
+// they were made under and are made again when DDL has run since.
+struct PreparedStatement {
+    string sql;
+    Statement statement;
+    int parameter_count = 0;
+    uint64_t schema_version = 0;
+
+    // INSERT, UPDATE, DELETE and SELECT only
+    TableSchema schema;
+    vector<int> columns;         // schema position of each INSERT value, SELECT item or UPDATE assignment; -1 for COUNT(*)
+    unique_ptr<Predicate> where; // null without WHERE
+    unique_ptr<JoinPlan> join;   // SELECT ... JOIN only
+    vector<int> group_by;        // SELECT only: schema positions
+    vector<SortKey> order_by;    // SELECT only; with GROUP BY or aggregates, positions among the items
+};
+
+// Least recently used plans, keyed by statement text.
+class PlanCache {
+private:
+    using Entry = pair<string, shared_ptr<PreparedStatement>>;
+
+    size_t capacity;
+    list<Entry> entries; // most recently used first
+    unordered_map<string, list<Entry>::iterator> by_sql;
+
+public:
+    explicit PlanCache(size_t capacity) : capacity(capacity) {}
+
+    shared_ptr<PreparedStatement> get(const string& sql) {
+        auto it = by_sql.find(sql);
+        if (it == by_sql.end()) return nullptr;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    void put(const string& sql, shared_ptr<PreparedStatement> plan) {
+        if (capacity == 0) return;
+        auto it = by_sql.find(sql);
+        if (it != by_sql.end()) {
+            it->second->second = std::move(plan);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        if (entries.size() >= capacity) {
+            by_sql.erase(entries.back().first);
+            entries.pop_back();
+        }
+        entries.emplace_front(sql, std::move(plan));
+        by_sql[sql] = entries.begin();
+    }
+
+    size_t size() const { return entries.size(); }
+};
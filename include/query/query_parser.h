@@ -1,54 +1,117 @@
 #ifndef QUERY_PARSER_H
 #define QUERY_PARSER_H
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "../catalog_manager.h"
 #include "../table_manager.h"
 #include "../index_manager.h"
 #include "../record_manager.h"
+#include "../transaction_manager.h"
+#include "./ast.h"
+#include "./executor.h"
+#include "./plan.h"
+#include "./result_printer.h"
+#include "./sql_parser.h"
+#include "../db_config.h"
 
 class QueryParser {
 public:
-    QueryParser(CatalogManager& cm, TableManager& tm, IndexManager& im);
+    QueryParser(CatalogManager& cm, TableManager& tm, IndexManager& im, TransactionManager& txm,
+                const DBConfig& config = DBConfig());
+    // Rolls back a transaction still open, as if the session had sent ROLLBACK.
+    ~QueryParser();
 
     // Main entry point: execute a SQL query string
     // Returns true if successful, false otherwise.
-    
+
     bool execute_query(const std::string& query);
     void run_interactive();
-    
+
+    // Parses and plans a statement, or returns the cached plan for the same
+    // text. Returns nullptr after printing the error if it is not valid.
+    //
+    // Each QueryParser is one session: sessions on different threads can
+    // share the managers below but not a QueryParser.
+    shared_ptr<PreparedStatement> prepare(const string& sql);
+    // Runs a prepared statement with one value per '?', in order. Outside
+    // BEGIN ... COMMIT it is a transaction of its own: it reads one
+    // snapshot and its changes become visible together when it ends.
+    bool execute(PreparedStatement& statement, const vector<Literal>& parameters);
+    // Whether BEGIN has opened a transaction that is not over yet. Its
+    // changes only need to reach the disk at COMMIT.
+    bool in_transaction() const { return session_transaction != nullptr; }
+    // With a ResultSet, SELECT results are stored in it instead of printed;
+    // nullptr prints them again. Each SELECT replaces what it holds.
+    void set_result_set(ResultSet* result) { result_set = result; }
+
     private:
     CatalogManager& catalog_manager;
     TableManager& table_manager;
     IndexManager& index_manager;
-    
-    // Parse and execute different types of queries
-    bool parse_create_table(const std::string& query);
-    bool parse_drop_table(const std::string& query);
-    bool parse_insert(const std::string& query);
-    bool parse_delete(const std::string& query);
-    bool parse_update(const std::string& query);
-    bool parse_select(const std::string& query);
-    bool parse_print_table(const std::string& query);
-    bool parse_create_index(const std::string& query);
-    
-    
-    // Utility parsing helpers
-    static void trim(std::string& s);
-    static std::vector<std::string> split(const std::string& s, char delimiter);
-private:
-    vector<Record> where_clause_handler(const std::string& where_clause, const TableSchema& schema, const string& table_name);
+    TransactionManager& transactions;
+    DBConfig config;
+    SqlParser sql_parser;
 
-    vector<Record> intersect_records(const vector<Record>& a, const vector<Record>& b);
-    vector<Record> union_records(const vector<Record>& a, const vector<Record>& b);
+    PlanCache plan_cache;
+    unordered_map<string, shared_ptr<PreparedStatement>> named_statements;
+    unique_ptr<Transaction> session_transaction; // from BEGIN; nullptr outside one
+    ResultSet* result_set = nullptr;
+
+    // Planning reads the catalog; the caller holds its table latch.
+    shared_ptr<PreparedStatement> plan_statement(const string& sql);
+    bool plan_table(PreparedStatement& plan, const string& table_name);
+    unique_ptr<Predicate> plan_where(const Expr& where, const TableSchema& schema, const string& table_name);
+    // Sets up plan.join and the joined schema for SELECT ... JOIN.
+    bool plan_join(PreparedStatement& plan, const SelectStatement& select);
+    // Splits the WHERE of a join between the two tables and the joined rows.
+    bool plan_join_where(PreparedStatement& plan, const Expr& where);
+    void mark_indexed(Predicate& where, const TableSchema& schema);
+
+    // Execute the different kinds of parsed statements
+    bool execute_create_table(const CreateTableStatement& statement);
+    bool execute_drop_table(const DropTableStatement& statement);
+    bool execute_create_index(const CreateIndexStatement& statement);
+    bool execute_insert(const PreparedStatement& plan, const vector<Literal>& parameters, Transaction& transaction);
+    bool execute_delete(const PreparedStatement& plan, const vector<Literal>& parameters, Transaction& transaction);
+    bool execute_update(const PreparedStatement& plan, const vector<Literal>& parameters, Transaction& transaction);
+    bool execute_select(const PreparedStatement& plan, const vector<Literal>& parameters, const Snapshot& snapshot);
+    bool execute_analyze(const AnalyzeStatement& statement, const Snapshot& snapshot);
+    bool execute_transaction(const TransactionStatement& statement);
+
+private:
+    // Copy of a WHERE condition with its parameters replaced by values.
+    // Returns nullptr after printing the error if a value does not fit.
+    unique_ptr<Predicate> bind_predicate(const Predicate& where, const TableSchema& schema, const vector<Literal>& parameters);
+    // Operator tree yielding the table rows snapshot sees that satisfy
+    // where (all rows for nullptr): an IndexScan when indexes narrow the rows down (and,
+    // on an analyzed table, are estimated to be cheaper), a SeqScan
+    // otherwise, and a Filter for what the indexes cannot decide.
+    // Given order, an indexed sort key, whole-table reads walk that index
+    // instead of the heap; ordered tells whether the rows come out sorted.
+    unique_ptr<Operator> scan_rows(const TableSchema& schema, const Snapshot& snapshot, unique_ptr<Predicate> where, const SortKey* order, bool& ordered);
+    // The joined rows of a SELECT ... JOIN that satisfy where: an index
+    // nested-loop join if an index covers one table's ON column, a hash
+    // join otherwise. Returns nullptr after printing the error if a
+    // parameter does not fit.
+    unique_ptr<Operator> join_tables(const PreparedStatement& plan, const vector<Literal>& parameters, const Snapshot& snapshot, unique_ptr<Predicate> where);
+    // With statistics from ANALYZE, picks the cheapest of a sequential scan,
+    // an index scan (one index) and a bitmap scan (several, their ids
+    // combined) by estimated cost, and clears the indexed flag of the
+    // conditions that are left to the Filter.
+    void choose_access_path(Predicate& where, const TableSchema& schema, RecordManager& heap);
+    // Record ids of the rows UPDATE or DELETE should change.
+    bool matching_ids(const PreparedStatement& plan, const vector<Literal>& parameters, const Snapshot& snapshot, vector<int>& ids);
 
-    vector<Record> handle_not_equal(const std::string& where_clause, const TableSchema& schema, const string& table_name);
-    vector<Record> handle_equal(const std::string& where_clause, const TableSchema& schema, const string& table_name);
-    vector<Record> handle_greater(const std::string& where_clause, const TableSchema& schema, const string& table_name);
-    vector<Record> handle_lesser(const std::string& where_clause, const TableSchema& schema, const string& table_name);
-    vector<Record> handle_greater_equal(const std::string& where_clause, const TableSchema& schema, const string& table_name);
-    vector<Record> handle_lesser_equal(const std::string& where_clause, const TableSchema& schema, const string& table_name);
+    // Ids of a superset of the rows matching where, from the indexes alone:
+    // AND intersects the sides that have indexes and OR unites its sides
+    // if both do. Returns false if the indexes cannot bound the rows;
+    // exact tells whether every condition was answered.
+    bool index_ids(const Predicate& where, const TableSchema& schema, PostingList& ids, bool& exact);
+    // Rows whose indexed column compares to the constant as the leaf says.
+    PostingList handle_comparison(const Predicate& comparison, const TableSchema& schema);
 };
 
-#endif // QUERY_PARSER_H
\ No newline at end of file
+#endif // QUERY_PARSER_H
@@ -0,0 +1,63 @@
+#pragma once
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// A result kept in memory, for callers that pass it on instead of printing
+// it (the server). Values are in their SQL text, as printed.
+//
+// With on_batch set, the rows are handed to it whenever those held reach
+// batch_bytes of values, and dropped; rows then holds what was left when
+// the statement ended.
+struct ResultSet {
+    vector<string> columns;
+    vector<vector<string>> rows;
+    function<void(ResultSet&)> on_batch;
+    size_t batch_bytes = 0;
+    size_t held_bytes = 0;
+
+    void clear() {
+        rows.clear();
+        held_bytes = 0;
+    }
+
+    void add_row(vector<string> row) {
+        for (const string& value : row) held_bytes += value.size();
+        rows.push_back(std::move(row));
+        if (on_batch && held_bytes >= batch_bytes) {
+            on_batch(*this);
+            clear();
+        }
+    }
+};
+
+// Prints a result in the framed layout of pretty::Printer while the rows
+// are still arriving. Column widths are taken from the header and the
+// first PREVIEW_ROWS rows; after that each row is printed as soon as it
+// is added, and a longer value only widens its own line.
+class ResultPrinter {
+private:
+    ostream& out;
+    vector<string> header;
+    vector<vector<string>> preview;
+    vector<size_t> widths;
+    bool streaming = false;
+    size_t rows = 0;
+
+    void start_streaming();
+    void print_border(char fill);
+    void print_row(const vector<string>& row, bool centered);
+
+public:
+    static constexpr size_t PREVIEW_ROWS = 64;
+
+    ResultPrinter(ostream& out, vector<string> header);
+
+    void add_row(vector<string> row);
+    // Prints what is still held and the bottom border; a result without
+    // rows shows "No matching records".
+    void finish();
+};
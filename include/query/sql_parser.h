@@ -0,0 +1,84 @@
+#pragma once
+#include "./ast.h"
+#include "./lexer.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Recursive-descent parser from statement text to a Statement.
+//
+// Grammar (keywords and names are case-insensitive, a trailing ';' is
+// optional):
+//
+//   CREATE TABLE t (col TYPE [PRIMARY KEY], ..., [PRIMARY KEY (col)])
+//   DROP TABLE t
+//   CREATE INDEX ON t (col)
+//   INSERT INTO t [(col, ...)] VALUES (value, ...) [, (value, ...)]...
+//   DELETE FROM t WHERE condition
+//   UPDATE t SET col = value [, col = value]... WHERE condition
+//   SELECT * | item [, item]... FROM t [[AS] alias] [[INNER] JOIN t [[AS] alias] ON col = col]
+//          [WHERE condition] [GROUP BY col [, col]...]
+//          [ORDER BY item [ASC | DESC] [, ...]] [LIMIT n]
+//   PREPARE name AS statement
+//   EXECUTE name [(value, ...)]
+//   DEALLOCATE [PREPARE] name
+//   ANALYZE [t]
+//   BEGIN [TRANSACTION] | COMMIT | ROLLBACK
+//
+//   condition  := and_expr [OR and_expr]...
+//   and_expr   := primary [AND primary]...
+//   primary    := '(' condition ')' | col op value | value op col
+//   op         := = | != | <> | < | <= | > | >=
+//   value      := [-]integer | [-]float | 'string' | NULL | ?
+//   item       := col | COUNT(*) | COUNT(col) | SUM(col) | AVG(col) | MIN(col) | MAX(col)
+//   col        := name | table.name (table or its alias)
+//
+// Names are returned in lower case, the way the catalog stores them.
+class SqlParser {
+private:
+    const string* source = nullptr;
+    vector<Token> tokens;
+    size_t pos = 0;
+    string error;
+    int parameters = 0;
+
+    const Token& peek() const { return tokens[pos]; }
+    bool fail(const string& expected);
+
+    bool accept_keyword(const char* keyword);
+    bool expect_keyword(const char* keyword);
+    bool accept_symbol(const char* symbol);
+    bool expect_symbol(const char* symbol);
+    bool expect_identifier(string& name, const char* what);
+    // col or table.col, returned as written.
+    bool expect_column(string& name);
+    // [AS] alias after a table name in FROM; none is left empty.
+    bool parse_alias(string& alias);
+    bool parse_literal(Literal& literal);
+    bool parse_compare_op(CompareOp& op);
+    bool parse_select_item(SelectItem& item);
+
+    unique_ptr<Expr> parse_condition();
+    unique_ptr<Expr> parse_and();
+    unique_ptr<Expr> parse_primary();
+
+    bool parse_create(Statement& statement);
+    bool parse_drop(Statement& statement);
+    bool parse_insert(Statement& statement);
+    bool parse_delete(Statement& statement);
+    bool parse_update(Statement& statement);
+    bool parse_select(Statement& statement);
+    bool parse_prepare(Statement& statement);
+    bool parse_execute(Statement& statement);
+    bool parse_deallocate(Statement& statement);
+    bool parse_analyze(Statement& statement);
+    bool parse_transaction(TransactionStatement::Kind kind, Statement& statement);
+
+public:
+    // Parses a single statement. Returns false with a message in error_out
+    // if the text is not a valid statement.
+    bool parse(const string& sql, Statement& statement, string& error_out);
+    // Number of '?' parameters in the statement parse() last accepted.
+    int parameter_count() const { return parameters; }
+};
@@ -1,24 +1,49 @@
+#pragma once
 #include<iostream>
-#include"disk_manager.h"
+#include"buffer_pool_manager.h"
 #include"record_manager.h"
+#include"mvcc.h"
 #include <tuple>
 
 using namespace std;
 
 class RecordIterator {
 private:
-    DiskManager& disk;
+    BufferPoolManager& buffer_pool;
+    int file_id;
     int current_page_id;
     int current_slot_id;
-    std::vector<char> page;
+    PageView page; // held while the iterator sits on it
+    Snapshot snapshot;
+    bool versioned;
 
+    // Whether the record at offset/size is one to hand out.
+    bool is_visible(uint16_t offset, uint16_t size) const;
+
+    bool load_page(int page_id);
+    void release_page();
     void load_next_valid_record();
 
 public:
-    RecordIterator(DiskManager& disk_manager);
+    // Iterates over the live records of the heap file managed by heap.
+    RecordIterator(RecordManager& heap);
+    // Iterates over the row versions (mvcc.h) snapshot sees; records hold
+    // the rows without their version headers.
+    RecordIterator(RecordManager& heap, const Snapshot& snapshot);
+    ~RecordIterator();
+
+    RecordIterator(const RecordIterator&) = delete;
+    RecordIterator& operator=(const RecordIterator&) = delete;
 
     bool has_next() const;
 
     Record next();
     tuple<Record, int, int> next_with_location();
-};
\ No newline at end of file
+    // Appends up to max_records of the next records to out, with their
+    // RecordIDs, reading page by page; returns how many were appended.
+    // Logs once per call rather than once per slot.
+    size_t next_batch(vector<Record>& out, size_t max_records);
+    // Counts the records not read yet from the pages' slot directories
+    // (and version headers), without copying any, and moves to the end.
+    size_t count_remaining();
+};
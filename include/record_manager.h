@@ -1,17 +1,23 @@
 #pragma once
-#include "./disk_manager.h"
+#include "./buffer_pool_manager.h"
+#include "./free_space_map.h"
+#include "./log_manager.h"
+#include "./mvcc.h"
 #include<unordered_map>
 #include <cstdint>
 #include <vector>
 #include <string>
 #include<cstring>
+#include <functional>
 #include "record_id.h"
 
 using namespace std;
 
-const int HEADER_SIZE = 4; // Size of the header in each page (2 bytes for slot count, 2 bytes for free offset)
+// Page header: 2 bytes slot count, 2 bytes free offset, 8 bytes page LSN (at PAGE_LSN_OFFSET)
+const int HEADER_SIZE = PAGE_LSN_OFFSET + sizeof(lsn_t);
 const int SLOT_SIZE = 4; // Size of each slot in the header
 const uint16_t INVALID_SLOT = 0xFFFF; // Invalid slot value
+const int MAX_RECORD_SIZE = PAGE_SIZE - HEADER_SIZE - SLOT_SIZE; // largest record a page can hold
 
 struct Record{
     vector<char> data;
@@ -30,6 +36,8 @@ struct Record{
         rid = id;
     }
 
+    Record(vector<char>&& raw, const RecordID& id) : data(std::move(raw)), rid(id) {}
+
     string to_string() const {
         return string(data.begin(), data.end());
     }
@@ -39,24 +47,62 @@ struct Record{
     }
 };
 
+// Slotted pages of one heap file. Safe to share between threads: every
+// call latches the page it reads shared and the page it changes
+// exclusively, for as long as it looks at the bytes.
 class RecordManager{
 private:
-    DiskManager& disk;
+    BufferPoolManager& buffer_pool;
+    int file_id; // the heap file this manager owns in the buffer pool
+    FreeSpaceMap& free_space_map;
+    LogManager& log_manager;
     int next_page_id;
 
-    int find_free_page();
+    int find_free_page(int record_size);
+    // Lets change rewrite the version header of record_id under the page's
+    // exclusive latch and logs the result if it returns true. Throws like
+    // get_record if there is no such record.
+    bool change_version(int record_id, const function<bool(VersionHeader&)>& change);
+    void log_change(char* page, LogRecordType type, int page_id, int slot_id,
+                    const char* before, size_t before_size, const char* after, size_t after_size);
+    // Re-applies one logged change unless the page already contains it.
+    void redo(const LogRecord& record);
     // pair<int, int> decode_record_id(int record_id);
     // int encode_record_id(int page_id, int slot_id);
 
 public:
-    RecordManager(DiskManager& dm);
+    // Manages the slotted pages of one heap file, which must already be
+    // attached to the buffer pool as file_id. Replays the file's log records
+    // first if the previous run did not shut down cleanly.
+    RecordManager(BufferPoolManager& bpm, int file_id, FreeSpaceMap& fsm, LogManager& lm);
+
+    // Bytes available to a new record on this page after compaction,
+    // net of the slot entry it would need.
+    static int page_free_space(const char* page);
 
-    DiskManager& get_disk() {
-        return disk;
+    BufferPoolManager& get_buffer_pool() {
+        return buffer_pool;
     }
+    int get_file_id() const { return file_id; }
 
     int insert_record(const Record& record);
     Record get_record(int record_id);
     void delete_record(int record_id);
     int update_record(int record_id, const Record& record);
+
+    // Versions of table rows (mvcc.h); the record bytes above include the
+    // version header, the row bytes below do not.
+    //
+    // Stores row as a new version created by txn_id.
+    int insert_version(const vector<char>& row, timestamp_t txn_id);
+    // The row of the version in record_id if snapshot sees it, otherwise a
+    // Record without data. Throws like get_record if there is no record.
+    Record get_version(int record_id, const Snapshot& snapshot);
+    // Ends the version as deleted (next_record_id -1) or replaced by txn_id.
+    // Returns false if it has already been ended.
+    bool end_version(int record_id, timestamp_t txn_id, int next_record_id = -1);
+    // Makes an ended version the row's newest again, undoing end_version.
+    void reopen_version(int record_id);
+    // Replaces txn_id by commit_ts in the versions' headers.
+    void stamp_versions(vector<int> record_ids, timestamp_t txn_id, timestamp_t commit_ts);
 };
\ No newline at end of file
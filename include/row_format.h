@@ -0,0 +1,68 @@
+#pragma once
+#include "./data_type.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Binary layout of a table row, derived from the table's column types:
+//
+//   [null bitmap: 1 bit per column]
+//   [fixed area: 8 bytes per INT (int64) / FLOAT (double) column, in column order]
+//   [VARCHAR end offsets: uint16 per VARCHAR column, relative to row start]
+//   [VARCHAR bytes, back to back]
+//
+// Every field is found from the precomputed offsets without touching the
+// other fields.
+class RowFormat {
+private:
+    vector<DataType> types;
+    vector<uint16_t> field_offsets; // fixed value, or the VARCHAR's end-offset entry
+    uint16_t var_array_offset;
+    uint16_t var_data_offset;       // also the size of a row with only empty strings
+
+    uint16_t read_u16(const vector<char>& row, size_t offset) const;
+    bool varchar_bounds(const vector<char>& row, int col, uint16_t& start, uint16_t& end) const;
+
+public:
+    explicit RowFormat(const vector<DataType>& column_types);
+
+    // Builds a row from SQL literal text ('abc', 42, 3.5, NULL). Returns
+    // false with a message in error if a value does not fit its column.
+    bool encode(const vector<string>& values, vector<char>& out, string& error) const;
+
+    // Builds a row from typed values: start_row, then one set_* per column
+    // in column order, since VARCHAR bytes are appended as they come.
+    // set_varchar returns false if the row would grow past 64 KB.
+    void start_row(vector<char>& out) const;
+    void set_null(vector<char>& out, int col) const;
+    void set_int(vector<char>& out, int col, int64_t value) const;
+    void set_float(vector<char>& out, int col, double value) const;
+    bool set_varchar(vector<char>& out, int col, string_view value) const;
+    // Sets column col of out to field src_col of a row in format src; the
+    // two columns must have the same type.
+    bool copy_field(const RowFormat& src, const vector<char>& row, int src_col, vector<char>& out, int col) const;
+
+    // True if row is long enough to be a row of this format.
+    bool is_valid(const vector<char>& row) const { return row.size() >= var_data_offset; }
+
+    size_t column_count() const { return types.size(); }
+    DataType column_type(int col) const { return types[col]; }
+    bool is_null(const vector<char>& row, int col) const;
+    int64_t get_int(const vector<char>& row, int col) const;
+    double get_float(const vector<char>& row, int col) const;
+    string_view get_varchar(const vector<char>& row, int col) const;
+
+    // Field as SQL literal text, the form the query layer and the indexes
+    // work with: VARCHAR values are quoted, NULL is "NULL".
+    string field_text(const vector<char>& row, int col) const;
+    vector<string> decode(const vector<char>& row) const;
+
+    // The field's index key (see index_key.h), built from the stored value.
+    string index_key(const vector<char>& row, int col) const;
+    // Index key of a SQL literal compared against a column of the given
+    // type. Returns false if the literal is not a value of that type.
+    static bool literal_index_key(DataType type, const string& literal, string& key);
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include "./protocol.h"
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Blocking client for limbodb-server. A LimboClient is one connection and
+// so one session on the server: its database, prepared statements and
+// open transaction stay until it is closed. Not for use by several
+// threads at once.
+class LimboClient {
+private:
+    int fd = -1;
+    string error;
+    string buffer; // bytes received past the last frame taken
+
+    bool fail(const string& what);
+
+public:
+    LimboClient() = default;
+    ~LimboClient();
+
+    LimboClient(const LimboClient&) = delete;
+    LimboClient& operator=(const LimboClient&) = delete;
+
+    bool connect_unix(const string& path);
+    bool connect_tcp(const string& host, uint16_t port);
+    void close();
+    bool connected() const { return fd >= 0; }
+
+    // Runs one statement. False if the connection failed, which closes it
+    // (see last_error()); otherwise result.ok tells whether the statement
+    // succeeded.
+    bool query(const string& sql, QueryResult& result);
+
+    const string& last_error() const { return error; }
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Wire format between limbodb-server and its clients (client.h).
+//
+// Every message is a frame:
+//
+//   [length: u32][type: u8][body: length bytes]
+//
+// Integers are little-endian; a string is [length: u32][bytes].
+//
+// The client sends QUERY frames whose body is one statement, as it would
+// be typed in the shell: USE, CREATE DATABASE and SHOW DATABASES included.
+// The server answers every QUERY, in order, with any number of ROWS frames
+// and then one RESULT frame:
+//
+//   ROWS    [columns: u32][name: string]...
+//           [rows: u32][value: string]...      rows * columns values, row by row
+//   RESULT  [ok: u8][message: string]
+//           [columns: u32][name: string]...
+//           [rows: u32][value: string]...
+//
+// A SELECT sends its rows in ROWS frames of about ROW_BATCH_BYTES while
+// they are produced, so a result of any size streams through; RESULT
+// carries the rows left over. The result is every frame's rows in order,
+// or none if ok is 0. message holds the [INFO], [ERROR] and [WARNING]
+// lines the statement printed; a statement without a result set has no
+// columns and no rows. Values are in their SQL text, as the shell prints
+// them.
+enum class MessageType : uint8_t {
+    QUERY = 1,
+    RESULT = 2,
+    ROWS = 3,
+};
+
+const size_t FRAME_HEADER_SIZE = 5;
+const uint32_t MAX_FRAME_BYTES = 256 * 1024 * 1024;
+const size_t ROW_BATCH_BYTES = 256 * 1024;
+
+struct QueryResult {
+    bool ok = false;
+    string message;
+    vector<string> columns;
+    vector<vector<string>> rows;
+};
+
+enum class FrameStatus {
+    COMPLETE,
+    INCOMPLETE, // more bytes are needed
+    INVALID,    // unknown type or over MAX_FRAME_BYTES; drop the connection
+};
+
+// Appends a frame holding body to out.
+void append_frame(string& out, MessageType type, const string& body);
+// Reads the frame starting at buffer[pos]. On COMPLETE, type and body are
+// set and pos is moved past the frame.
+FrameStatus read_frame(const string& buffer, size_t& pos, MessageType& type, string& body);
+
+string encode_result(const QueryResult& result);
+// False if body is not a whole RESULT body.
+bool decode_result(const string& body, QueryResult& result);
+string encode_rows(const vector<string>& columns, const vector<vector<string>>& rows);
+// Sets result's columns and appends the rows. False if body is not a
+// whole ROWS body.
+bool decode_rows(const string& body, QueryResult& result);
@@ -0,0 +1,134 @@
+#pragma once
+#include "../database.h"
+#include "../db_config.h"
+#include "../query/query_parser.h"
+#include "./protocol.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct ServerOptions {
+    string socket_path = "limbodb.sock"; // Unix socket; empty for none
+    uint16_t port = 5477;                // TCP on 127.0.0.1; 0 for none
+    unsigned workers = 0;                // statement threads; 0 = one per core
+    bool verbose = false;                // echo the engine's debug output
+    DBConfig config;
+};
+
+// Serves the databases under data/ to clients speaking protocol.h.
+//
+// One thread runs an epoll loop over the listening sockets and every
+// connection: it reads requests, and writes the replies the workers hand
+// back. A pool of worker threads runs the statements. Each connection is
+// a session of its own, with its database and a QueryParser (prepared
+// statements, open transaction), and runs one statement at a time; further
+// requests wait in its buffer. Databases are opened on first USE and shared
+// by every session on them until the server stops.
+class Server {
+private:
+    // What a connection's session holds between statements.
+    struct Session {
+        Database* database = nullptr;
+        unique_ptr<QueryParser> parser;
+    };
+
+    struct Connection {
+        int fd;
+        string in;          // received bytes; a request starts at in_pos
+        size_t in_pos = 0;
+        string out;         // reply bytes not yet sent
+        bool busy = false;  // a worker has its request
+        atomic<bool> closing{false};
+        // Reply bytes handed back by the worker and not sent yet. A worker
+        // streaming rows waits while there are more than MAX_UNSENT_BYTES.
+        atomic<size_t> unsent{0};
+        Session session;    // used by the worker while busy, else by nobody
+    };
+
+    struct Job {
+        shared_ptr<Connection> connection;
+        string sql;
+    };
+
+    // Frames for a connection; the last one of a reply ends its request.
+    struct Reply {
+        shared_ptr<Connection> connection;
+        string frames;
+        bool last;
+    };
+
+    static constexpr size_t MAX_UNSENT_BYTES = 4 * ROW_BATCH_BYTES;
+    // How long a streaming worker waits for its client to read on. The
+    // statement holds its latches meanwhile, so past that it is failed.
+    static constexpr chrono::seconds STALLED_CLIENT_TIMEOUT{30};
+
+    ServerOptions options;
+    int epoll_fd = -1;
+    int wake_fd = -1;       // eventfd: replies are ready or stop() was called
+    int signal_fd = -1;
+    vector<int> listen_fds;
+    unordered_map<int, shared_ptr<Connection>> connections;
+    atomic<bool> stopping{false};
+
+    mutex jobs_latch;
+    condition_variable jobs_cv;
+    deque<Job> jobs;
+    bool workers_stop = false;
+    vector<thread> workers;
+
+    mutex replies_latch;
+    deque<Reply> replies;
+    condition_variable replies_sent; // a connection's unsent went down
+
+    mutex databases_latch;
+    map<string, unique_ptr<Database>> databases;
+
+    bool listen_unix(const string& path);
+    bool listen_tcp(uint16_t port);
+    bool watch(int fd, uint32_t events, int op);
+
+    void accept_connections(int listen_fd);
+    void read_connection(const shared_ptr<Connection>& connection);
+    void write_connection(const shared_ptr<Connection>& connection);
+    // Hands the next buffered request of an idle connection to the workers.
+    void dispatch(const shared_ptr<Connection>& connection);
+    void close_connection(const shared_ptr<Connection>& connection);
+    // Marks a connection whose worker is still running as gone.
+    void abandon_connection(const shared_ptr<Connection>& connection);
+    void take_replies();
+
+    void worker_loop();
+    // Queues frames for the event loop to send. Unless they end the reply,
+    // first waits for the connection to catch up on what it was sent;
+    // false if it did not, or is gone.
+    bool send_reply(const shared_ptr<Connection>& connection, string frames, bool last);
+    // Runs one statement in the connection's session. Rows go to the client
+    // in ROWS frames as they are produced; the rest comes back.
+    QueryResult execute(const shared_ptr<Connection>& connection, const string& sql);
+    Database* open_database(const string& name);
+
+public:
+    explicit Server(ServerOptions options);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Serves until stop() or SIGINT/SIGTERM, then closes every session
+    // (rolling back open transactions) and database. False if it could
+    // not listen.
+    bool run();
+    // May be called from any thread.
+    void stop();
+};
@@ -3,30 +3,75 @@
 #include "./catalog_manager.h"
 #include "./record_manager.h"
 #include "./index_manager.h"
+#include "./transaction_manager.h"
 #include <string>
 #include <vector>
 
 using namespace std;
 
+// Rows are kept as versions (mvcc.h). Writes add versions stamped with the
+// transaction's id and record them in the Transaction; reads go through a
+// Snapshot. Every version has its own index entries, so a reader whose
+// snapshot still sees an old version finds it by its old keys; the entries
+// go when the version is collected.
 class TableManager {
 private:
     CatalogManager& catalog;
-    RecordManager& record_mgr;
     IndexManager& index_mgr;
 
+    // Positions in schema of the columns that have an index.
+    vector<int> indexed_positions(const string& table_name, const TableSchema& schema);
+    // Adds every version in the table to the (empty) indexes on columns.
+    // Returns the number of versions.
+    int index_rows(const string& table_name, const TableSchema& schema, const vector<string>& columns);
+    // Deletes a version and its index entries; row is its row bytes.
+    void remove_version(const string& table_name, const TableSchema& schema, RecordManager& heap, int record_id, const vector<char>& row);
+    // The writes after savepoint, newest first. latched: the caller holds
+    // every latch they need.
+    void undo(Transaction& transaction, const Savepoint& savepoint, bool latched);
+
 public:
-    TableManager(CatalogManager& cat, RecordManager& rm, IndexManager& im);
+    TableManager(CatalogManager& cat, IndexManager& im);
 
     bool create_table(const string& table_name, const vector<string>& columns, const vector<DataType>& types, int primary_key_idx);
 
     bool column_exists(const string& table_name, const string& column_name);
+    // Creates an index on the column, keyed by the column's type, and fills
+    // it from the rows already in the table.
+    bool create_index(const string& table_name, const string& column_name);
     
-    int insert_into(const string& table_name, const vector<string>& values);
-    bool delete_from(const string& table_name, int record_id);
-    bool update(const string& table_name, int record_id, const vector<string>& new_values);
-    Record select(const string& table_name, int record_id);
-    vector<Record> scan(const string& table_name); // optional: full scan
-    void printTable(const std::string& tableName);
+    int insert_into(const string& table_name, const vector<string>& values, Transaction& transaction);
+    // Deletes the row whose version transaction sees at record_id; -1
+    // deletes every row it sees.
+    bool delete_from(const string& table_name, int record_id, Transaction& transaction);
+    // Replaces the row whose version transaction sees at record_id with a
+    // new version. Fails if another transaction has changed the row since.
+    bool update(const string& table_name, int record_id, const vector<string>& new_values, Transaction& transaction);
+    Record select(const string& table_name, int record_id, const Snapshot& snapshot);
+    vector<Record> scan(const string& table_name, const Snapshot& snapshot); // optional: full scan
+    void printTable(const std::string& tableName, const Snapshot& snapshot);
+    // Recreates every index of every table from the rows on disk. Used after
+    // crash recovery, when the saved index files may not match the heap.
+    void rebuild_indexes();
+
+    // Removes versions no snapshot sees any more, with their index entries,
+    // unless their slots have been reused since. The TransactionManager's
+    // collector calls it from its own thread.
+    void collect_garbage(const vector<DeadVersion>& versions);
+    // Undoes the transaction's writes, newest first: removes the versions it
+    // created and makes the ones it ended the newest again. The caller then
+    // ends the transaction without committing it.
+    void rollback(Transaction& transaction);
+    // Undoes only the writes after savepoint, those of a statement that
+    // failed part way; the transaction stays open. The caller holds the
+    // table latch and the write latch of the statement's table.
+    void rollback_statement(Transaction& transaction, const Savepoint& savepoint);
+    // After a crash: removes the versions whose creating commit did not
+    // finish and the dead ones, and makes the versions whose ending commit
+    // did not finish the newest again. New transactions get ids above any
+    // found: only a run that ended without a checkpoint, and so with the
+    // log to recover from, can leave them behind.
+    void recover_versions(TransactionManager& transactions);
 
 
     std::vector<string> unpack_record(const Record& rec, const TableSchema& schema);
@@ -0,0 +1,40 @@
+#pragma once
+#include "./data_type.h"
+#include "./mvcc.h"
+#include "./record_manager.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// What ANALYZE learned about one column.
+struct ColumnStats {
+    int64_t null_count = 0;
+    int64_t distinct = 0;   // estimated number of distinct non-NULL values
+    // Equi-depth histogram of the non-NULL values: bounds[i] is the index
+    // key (index_key.h) of the last value of bucket i, and every bucket
+    // holds about the same number of values.
+    vector<string> bounds;
+};
+
+// Table statistics for the planner's cost estimates, gathered by ANALYZE
+// and kept in data/<db>/table_<id>.stats. They describe the table as it
+// was then; the planner scales the row count by how much the heap has
+// grown since.
+struct TableStats {
+    int64_t row_count = 0;
+    int64_t page_count = 0;
+    vector<ColumnStats> columns;
+
+    // Reads every row of heap that snapshot sees once. The histograms and
+    // distinct counts come from a random sample of at most SAMPLE_ROWS rows.
+    static TableStats collect(RecordManager& heap, const vector<DataType>& column_types, const Snapshot& snapshot);
+
+    bool save(const string& path) const;
+    // False if the file is missing or does not hold stats for column_count columns.
+    static bool load(const string& path, size_t column_count, TableStats& stats);
+
+    static constexpr size_t SAMPLE_ROWS = 30000;
+    static constexpr size_t HISTOGRAM_BUCKETS = 100;
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include "./log_manager.h"
+#include "./mvcc.h"
+#include "./record_manager.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class TransactionManager;
+
+// A version a transaction created or ended, to be stamped at commit or
+// undone at rollback.
+struct VersionWrite {
+    string table_name;
+    RecordManager* heap;
+    int record_id;
+};
+
+// A version that stopped being any row's newest at end_ts. Nobody needs it
+// once every open snapshot is past end_ts.
+struct DeadVersion {
+    string table_name;
+    int record_id;
+    timestamp_t end_ts;
+};
+
+// How far a transaction's lists of writes went at some point. Rolling back
+// to it undoes only what came after: one failed statement's changes.
+struct Savepoint {
+    size_t writes = 0;
+    size_t ended = 0;
+};
+
+// One transaction: the snapshot it reads and the versions it has written,
+// which are also its undo information (TableManager::rollback). Destroying
+// it without a commit only ends its snapshot.
+struct Transaction {
+    TransactionManager* manager;
+    Snapshot snapshot;
+    vector<VersionWrite> writes;
+    vector<DeadVersion> ended;  // end_ts filled in at commit
+    bool open = true;
+
+    explicit Transaction(TransactionManager* manager) : manager(manager) {}
+    ~Transaction();
+    Transaction(const Transaction&) = delete;
+    Transaction& operator=(const Transaction&) = delete;
+
+    timestamp_t id() const { return snapshot.txn_id; }
+    Savepoint savepoint() const { return {writes.size(), ended.size()}; }
+};
+
+// Hands out snapshots and commit timestamps for the versions in mvcc.h.
+//
+// A commit timestamp is the LSN the log was at when the commit began, so
+// timestamps on disk stay below every later one, restarts included.
+// Commits run one at a time: each stamps its versions, logs a COMMIT record
+// holding its timestamp, then publishes the timestamp, and only snapshots
+// taken after that see any of its changes. After a crash, a stamp whose
+// COMMIT record is not in the log belongs to a commit that never finished.
+//
+// Versions a commit ended are queued; a collector thread hands them to a
+// callback once no open snapshot can see them any more.
+class TransactionManager {
+private:
+    LogManager& log_manager;
+
+    mutex latch;                   // guards everything below but commit_latch
+    mutex commit_latch;            // one commit at a time
+    timestamp_t last_commit;       // newest published commit timestamp
+    uint64_t next_txn = 1;
+    multiset<timestamp_t> active;  // read_ts of every open snapshot
+    deque<DeadVersion> garbage;    // in end_ts order
+    timestamp_t log_start;         // stamps below this were checkpointed
+    set<timestamp_t> logged_commits;
+
+    function<void(vector<DeadVersion>&)> collect;
+    chrono::milliseconds collect_interval{0};
+    condition_variable collector_cv;
+    bool stop = false;
+    thread collector;
+
+    void collector_loop();
+    // Removes the queued versions no snapshot sees from the queue.
+    vector<DeadVersion> take_garbage();
+
+public:
+    explicit TransactionManager(LogManager& lm);
+    // Stops the collector after a last round, in which nothing is open.
+    ~TransactionManager();
+
+    TransactionManager(const TransactionManager&) = delete;
+    TransactionManager& operator=(const TransactionManager&) = delete;
+
+    // Starts a transaction reading the newest committed state.
+    unique_ptr<Transaction> begin();
+    // Makes the transaction's writes visible to snapshots taken from now on
+    // and ends it. Durability is up to the caller (LogManager::commit).
+    void commit(Transaction& transaction);
+    // Ends the transaction's snapshot; called by ~Transaction.
+    void finish(Transaction& transaction);
+    // Transactions begun and not yet committed or destroyed.
+    size_t open_transactions();
+
+    // Whether a timestamp found in a version header after a crash is one
+    // of a finished commit. Only valid until the log's next checkpoint.
+    bool is_committed(timestamp_t ts) const;
+    // Gives later transactions ids above txn_id, one found in a version
+    // header: ids restart on every boot.
+    void skip_txn_id(timestamp_t txn_id);
+
+    // Calls collect with batches of dead versions every interval_ms from
+    // a thread of its own. interval_ms 0 leaves collection off.
+    void start_collector(function<void(vector<DeadVersion>&)> collect, unsigned interval_ms);
+};
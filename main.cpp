@@ -1,14 +1,12 @@
 #include "./include/query/query_parser.h"
-#include "./include/disk_manager.h"
-#include "./include/record_manager.h"
-#include "./include/catalog_manager.h"
-#include "./include/table_manager.h"
-#include "./include/index_manager.h"
+#include "./include/database.h"
 #include "./include/global-state.h"
 #include "./include/utils/string_utils.h"
+#include "./include/db_config.h"
 
 #include<filesystem>
 #include<iostream>
+#include<memory>
 #include<string>
 
 using namespace std;
@@ -20,14 +18,12 @@ void run_sql_shell() {
     std::cout << "Welcome to LimboDB (Multi-Database Mode)\n";
     std::cout << "Type `HELP;` for commands.\n";
 
-    QueryParser* parser = nullptr;
+    DBConfig config = DBConfig::from_env();
 
-    // These need to live outside the loop and be managed properly
-    DiskManager* disk_manager = nullptr;
-    RecordManager* record_manager = nullptr;
-    IndexManager* index_manager = nullptr;
-    CatalogManager* catalog_manager = nullptr;
-    TableManager* table_manager = nullptr;
+    // Declared after the database so it is destroyed first: it may still
+    // have a transaction to roll back there
+    unique_ptr<Database> database;
+    unique_ptr<QueryParser> parser;
 
     while (true) {
         std::cout << "lsql> ";
@@ -49,12 +45,9 @@ void run_sql_shell() {
             if (!dbname.empty() && dbname.back() == ';') dbname.pop_back();
             trim(dbname);
 
-            std::string path = "data/" + dbname;
-            if (fs::exists(path)) {
+            if (!Database::create(dbname)) {
                 std::cout << "[ERROR] Database already exists.\n";
             } else {
-                fs::create_directories(path);
-                std::ofstream(path + "/pages.db"); // create empty file
                 std::cout << "[INFO] Database '" << dbname << "' created.\n";
             }
             continue;
@@ -80,36 +73,41 @@ void run_sql_shell() {
             continue;
         }
 
+        // SHOW BUFFER POOL
+        if (q_lower == "show buffer pool;" || q_lower == "show buffer pool") {
+            if (!database) {
+                std::cout << "[ERROR] No database selected. Use: USE dbname;\n";
+                continue;
+            }
+            BufferPoolManager* buffer_pool = &database->get_buffer_pool();
+            BufferPoolStats stats = buffer_pool->get_stats();
+            uint64_t lookups = stats.hits + stats.misses;
+            std::cout << "frames:     " << buffer_pool->get_pool_size() << " (" << (buffer_pool->get_pool_size() * PAGE_SIZE) / 1024 << " KB)\n";
+            std::cout << "hits:       " << stats.hits << "\n";
+            std::cout << "misses:     " << stats.misses << "\n";
+            std::cout << "evictions:  " << stats.evictions << "\n";
+            std::cout << "writebacks: " << stats.writebacks << "\n";
+            std::cout << "mapped reads: " << stats.mapped_reads << (database->get_disk_manager().get_io_mode() == IoMode::MMAP ? "" : " (mmap off)") << "\n";
+            std::cout << "hit ratio:  " << (lookups ? (100.0 * stats.hits / lookups) : 0.0) << "%\n";
+            continue;
+        }
+
         // USE DATABASE
         if (q_lower.find("use ") == 0) {
             std::string dbname = query.substr(4);
             if (!dbname.empty() && dbname.back() == ';') dbname.pop_back();
             trim(dbname);
 
-            std::string db_path = "data/" + dbname;
-            if (!fs::exists(db_path)) {
+            if (!Database::exists(dbname)) {
                 std::cout << "[ERROR] Database '" << dbname << "' does not exist.\n";
                 continue;
             }
 
-            
-            // Clean up old managers
-            delete parser;
-            delete table_manager;
-            delete catalog_manager;
-            delete index_manager;
-            delete record_manager;
-            delete disk_manager;
-            
-            CURRENT_DATABASE = dbname;
-            // Re-initialize managers with new database path
-            disk_manager = new DiskManager(db_path + "/pages.db");
-            record_manager = new RecordManager(*disk_manager);
-            index_manager = new IndexManager();
-            catalog_manager = new CatalogManager(*record_manager, *index_manager);
-            table_manager = new TableManager(*catalog_manager, *record_manager, *index_manager);
-            parser = new QueryParser(*catalog_manager, *table_manager, *index_manager);
-
+            // Close the old database first: it checkpoints as it closes
+            parser.reset();
+            database.reset();
+            database = make_unique<Database>(dbname, config);
+            parser = database->open_session();
             std::cout << "[INFO] Switched to database: " << dbname << "\n";
             continue;
         }
@@ -124,16 +122,13 @@ void run_sql_shell() {
             if (!success) {
                 std::cout << "[ERROR] Failed to execute query.\n";
             }
+            database->end_statement(*parser);
         }
     }
 
     // Clean up on exit
-    delete parser;
-    delete table_manager;
-    delete catalog_manager;
-    delete index_manager;
-    delete record_manager;
-    delete disk_manager;
+    parser.reset();
+    database.reset();
 }
 
 
@@ -0,0 +1,42 @@
+#include "./include/server/server.h"
+
+#include<cstdlib>
+#include<iostream>
+#include<string>
+
+using namespace std;
+
+namespace {
+    void usage() {
+        cout << "Usage: limbodb-server [--socket path] [--port n] [--workers n] [--verbose]\n"
+             << "  --socket path  Unix socket to listen on (default limbodb.sock, \"\" for none)\n"
+             << "  --port n       TCP port on 127.0.0.1 (default 5477, 0 for none)\n"
+             << "  --workers n    statement threads (default one per core)\n"
+             << "  --verbose      echo the engine's debug output\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    options.config = DBConfig::from_env();
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--socket" && has_value) {
+            options.socket_path = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            options.port = static_cast<uint16_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--workers" && has_value) {
+            options.workers = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else {
+            usage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Server server(options);
+    return server.run() ? 0 : 1;
+}
@@ -0,0 +1,372 @@
+#include "../include/buffer_pool_manager.h"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+#define BPM_DEBUG_PREFIX "[DEBUG][BUFFER_POOL] "
+
+BufferPoolManager::BufferPoolManager(size_t num_frames, LogManager* log_manager)
+    : log(log_manager), pool_size(num_frames == 0 ? 1 : num_frames), frames(pool_size), clock_hand(0) {
+    free_frames.reserve(pool_size);
+    for (size_t i = pool_size; i > 0; --i) {
+        free_frames.push_back(i - 1);
+    }
+    page_table.reserve(pool_size);
+    std::cout << BPM_DEBUG_PREFIX << "BufferPoolManager initialized with " << pool_size
+              << " frames (" << (pool_size * PAGE_SIZE) / 1024 << " KB)." << std::endl;
+}
+
+BufferPoolManager::~BufferPoolManager() {
+    checkpoint();
+    std::cout << BPM_DEBUG_PREFIX << "BufferPoolManager destroyed. hits=" << stats.hits
+              << ", misses=" << stats.misses << ", evictions=" << stats.evictions
+              << ", writebacks=" << stats.writebacks << std::endl;
+}
+
+void BufferPoolManager::attach_file(int file_id, DiskManager& disk) {
+    lock_guard<mutex> guard(latch);
+    files[file_id] = &disk;
+}
+
+bool BufferPoolManager::detach_file(int file_id, bool write_back_dirty) {
+    unique_lock<mutex> pool(latch);
+    if (!files.count(file_id)) return true;
+    // A victim of the file may be being written out
+    io_done.wait(pool, [&] {
+        return none_of(frames.begin(), frames.end(), [&](const Page& frame) {
+            return frame.file_id == file_id && frame.io_busy;
+        });
+    });
+    for (size_t i = 0; i < pool_size; ++i) {
+        Page& frame = frames[i];
+        if (frame.file_id != file_id) continue;
+        if (frame.pin_count > 0) {
+            std::cerr << "[ERROR][BUFFER_POOL] Cannot detach file " << file_id << ": page " << frame.page_id << " is pinned." << std::endl;
+            return false;
+        }
+        if (write_back_dirty && !write_back(frame)) return false;
+        page_table.erase(page_key(frame.file_id, frame.page_id));
+        frame.file_id = -1;
+        frame.page_id = -1;
+        frame.is_dirty = false;
+        free_frames.push_back(i);
+    }
+    if (write_back_dirty) {
+        files[file_id]->flush();
+    }
+    files.erase(file_id);
+    return true;
+}
+
+DiskManager* BufferPoolManager::disk_for(int file_id) {
+    auto it = files.find(file_id);
+    return it == files.end() ? nullptr : it->second;
+}
+
+bool BufferPoolManager::write_out(DiskManager* disk, const Page& frame) {
+    if (log) {
+        log->flush_to(get_page_lsn(frame.data));
+    }
+    if (!disk || !disk->write_page(frame.page_id, frame.data)) {
+        std::cerr << "[ERROR][BUFFER_POOL] Failed to write back page " << frame.file_id << ":" << frame.page_id << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool BufferPoolManager::write_back(Page& frame) {
+    if (!frame.is_dirty) return true;
+    if (!write_out(disk_for(frame.file_id), frame)) return false;
+    frame.is_dirty = false;
+    stats.writebacks++;
+    return true;
+}
+
+// Picks a frame for a new page: a free frame if one is left, otherwise a CLOCK victim.
+// The victim is written back if dirty and removed from the page table.
+bool BufferPoolManager::acquire_frame(size_t& frame_id, unique_lock<mutex>& pool) {
+    if (!free_frames.empty()) {
+        frame_id = free_frames.back();
+        free_frames.pop_back();
+        return true;
+    }
+
+    // Two sweeps are enough: the first clears reference bits, the second finds a victim.
+    for (size_t step = 0; step < 2 * pool_size; ++step) {
+        Page& frame = frames[clock_hand];
+        size_t current = clock_hand;
+        clock_hand = (clock_hand + 1) % pool_size;
+
+        if (frame.pin_count > 0 || frame.io_busy) continue;
+        if (frame.ref_bit) {
+            frame.ref_bit = false;
+            continue;
+        }
+        // Writing it would change the file under a mapped reader
+        if (frame.is_dirty && mapped_views.count(page_key(frame.file_id, frame.page_id))) continue;
+
+        if (frame.is_dirty) {
+            // Written without the pool latch. Being io_busy, the page is
+            // not pinned by anyone meanwhile, so its bytes stay as they are.
+            DiskManager* disk = disk_for(frame.file_id);
+            frame.io_busy = true;
+            pool.unlock();
+            bool written = write_out(disk, frame);
+            pool.lock();
+            frame.io_busy = false;
+            io_done.notify_all();
+            if (!written) continue;
+            frame.is_dirty = false;
+            stats.writebacks++;
+        }
+        page_table.erase(page_key(frame.file_id, frame.page_id));
+        stats.evictions++;
+        frame.file_id = -1;
+        frame.page_id = -1;
+        frame_id = current;
+        return true;
+    }
+
+    std::cerr << "[ERROR][BUFFER_POOL] All " << pool_size << " frames are pinned; cannot evict." << std::endl;
+    return false;
+}
+
+Page* BufferPoolManager::fetch_page(int file_id, int page_id) {
+    unique_lock<mutex> pool(latch);
+    return pin_page(file_id, page_id, pool);
+}
+
+Page* BufferPoolManager::pin_page(int file_id, int page_id, unique_lock<mutex>& pool) {
+    uint64_t key = page_key(file_id, page_id);
+    while (true) {
+        auto it = page_table.find(key);
+        if (it != page_table.end()) {
+            Page& frame = frames[it->second];
+            if (frame.io_busy) {
+                // Being read in or evicted; look it up again once that is done
+                io_done.wait(pool);
+                continue;
+            }
+            frame.pin_count++;
+            frame.ref_bit = true;
+            stats.hits++;
+            return &frame;
+        }
+
+        DiskManager* disk = disk_for(file_id);
+        if (!disk || page_id < 0 || page_id >= disk->get_num_pages()) {
+            return nullptr;
+        }
+
+        size_t frame_id;
+        if (!acquire_frame(frame_id, pool)) {
+            return nullptr;
+        }
+        if (page_table.count(key)) {
+            // Read in by another thread while a victim was being written
+            free_frames.push_back(frame_id);
+            continue;
+        }
+
+        // In the page table but io_busy until the read is done, so a second
+        // reader of the page waits for this one instead of reading it again
+        Page& frame = frames[frame_id];
+        frame.file_id = file_id;
+        frame.page_id = page_id;
+        frame.pin_count = 1;
+        frame.is_dirty = false;
+        frame.ref_bit = true;
+        frame.io_busy = true;
+        page_table[key] = frame_id;
+        stats.misses++;
+
+        pool.unlock();
+        bool read = disk->read_page(page_id, frame.data);
+        pool.lock();
+        frame.io_busy = false;
+        io_done.notify_all();
+        if (!read) {
+            page_table.erase(key);
+            frame.file_id = -1;
+            frame.page_id = -1;
+            frame.pin_count = 0;
+            free_frames.push_back(frame_id);
+            return nullptr;
+        }
+        return &frame;
+    }
+}
+
+PageView BufferPoolManager::fetch_page_view(int file_id, int page_id) {
+    PageView view;
+    unique_lock<mutex> pool(latch);
+    DiskManager* disk = disk_for(file_id);
+    uint64_t key = page_key(file_id, page_id);
+    if (disk && page_table.find(key) == page_table.end()) {
+        if (const char* mapped = disk->page_view(page_id)) {
+            view.file_id = file_id;
+            view.page_id = page_id;
+            view.data = mapped;
+            mapped_views[key]++;
+            stats.mapped_reads++;
+            return view;
+        }
+    }
+
+    Page* frame = pin_page(file_id, page_id, pool);
+    if (frame) {
+        view.file_id = file_id;
+        view.page_id = page_id;
+        view.data = frame->get_data();
+        view.pinned = true;
+        view.latch = &frame->latch;
+    }
+    return view;
+}
+
+void BufferPoolManager::release_page_view(PageView& view) {
+    if (view.pinned) {
+        unpin_page(view.file_id, view.page_id, false);
+    } else if (view.data) {
+        lock_guard<mutex> guard(latch);
+        auto it = mapped_views.find(page_key(view.file_id, view.page_id));
+        if (--it->second == 0) {
+            mapped_views.erase(it);
+            views_released.notify_all();
+        }
+    }
+    view = PageView();
+}
+
+Page* BufferPoolManager::new_page(int file_id, int& page_id) {
+    unique_lock<mutex> pool(latch);
+    DiskManager* disk = disk_for(file_id);
+    if (!disk) return nullptr;
+
+    size_t frame_id;
+    if (!acquire_frame(frame_id, pool)) {
+        return nullptr;
+    }
+
+    page_id = disk->allocate_page();
+    if (page_id < 0) {
+        free_frames.push_back(frame_id);
+        return nullptr;
+    }
+
+    Page& frame = frames[frame_id];
+    memset(frame.data, 0, PAGE_SIZE);
+    frame.file_id = file_id;
+    frame.page_id = page_id;
+    frame.pin_count = 1;
+    frame.is_dirty = false;
+    frame.ref_bit = true;
+    page_table[page_key(file_id, page_id)] = frame_id;
+    std::cout << BPM_DEBUG_PREFIX << "New page " << file_id << ":" << page_id << " placed in frame " << frame_id << std::endl;
+    return &frame;
+}
+
+bool BufferPoolManager::unpin_page(int file_id, int page_id, bool is_dirty) {
+    lock_guard<mutex> guard(latch);
+    auto it = page_table.find(page_key(file_id, page_id));
+    if (it == page_table.end()) {
+        std::cerr << "[ERROR][BUFFER_POOL] unpin_page: page " << file_id << ":" << page_id << " is not resident." << std::endl;
+        return false;
+    }
+
+    Page& frame = frames[it->second];
+    if (frame.pin_count <= 0) {
+        std::cerr << "[ERROR][BUFFER_POOL] unpin_page: page " << file_id << ":" << page_id << " is not pinned." << std::endl;
+        return false;
+    }
+
+    frame.pin_count--;
+    if (is_dirty) frame.is_dirty = true;
+    return true;
+}
+
+bool BufferPoolManager::flush_frame(size_t frame_id, unique_lock<mutex>& pool) {
+    Page& frame = frames[frame_id];
+    // Waiting lets go of the latch, so the frame may hold another page after
+    while (frame.page_id >= 0) {
+        if (frame.io_busy) {
+            io_done.wait(pool);
+        } else if (frame.is_dirty && mapped_views.count(page_key(frame.file_id, frame.page_id))) {
+            views_released.wait(pool);
+        } else {
+            break;
+        }
+    }
+    if (frame.page_id < 0 || !frame.is_dirty) return true;
+
+    // Pinned, the frame keeps its page while the pool latch is let go, so
+    // that whoever is changing the page can finish first. The shared frame
+    // latch then keeps the bytes as they are during the write, and io_busy
+    // makes other flushers of the page wait for it.
+    frame.pin_count++;
+    pool.unlock();
+    bool ok = true;
+    {
+        shared_lock<shared_mutex> reading(frame.latch);
+        pool.lock();
+        while (frame.io_busy) io_done.wait(pool);
+        if (frame.is_dirty) {
+            DiskManager* disk = disk_for(frame.file_id);
+            frame.io_busy = true;
+            // Cleared first: a change made after the write sets it again
+            frame.is_dirty = false;
+            pool.unlock();
+            ok = write_out(disk, frame);
+            pool.lock();
+            frame.io_busy = false;
+            io_done.notify_all();
+            if (ok) stats.writebacks++;
+            else frame.is_dirty = true;
+        }
+        frame.pin_count--;
+    }
+    return ok;
+}
+
+bool BufferPoolManager::flush_page(int file_id, int page_id) {
+    unique_lock<mutex> pool(latch);
+    auto it = page_table.find(page_key(file_id, page_id));
+    if (it == page_table.end()) return false;
+    return flush_frame(it->second, pool);
+}
+
+bool BufferPoolManager::flush_all_pages() {
+    std::cout << BPM_DEBUG_PREFIX << "Flushing all dirty pages." << std::endl;
+    unique_lock<mutex> pool(latch);
+    bool ok = true;
+    for (size_t i = 0; i < pool_size; ++i) {
+        if (!flush_frame(i, pool)) {
+            ok = false;
+        }
+    }
+    for (auto& [file_id, disk] : files) {
+        disk->flush();
+    }
+    return ok;
+}
+
+void BufferPoolManager::checkpoint() {
+    if (!flush_all_pages()) {
+        std::cerr << "[ERROR][BUFFER_POOL] Skipping checkpoint: some pages could not be written." << std::endl;
+        return;
+    }
+    if (log) {
+        log->checkpoint();
+    }
+}
+
+int BufferPoolManager::get_num_pages(int file_id) {
+    lock_guard<mutex> guard(latch);
+    DiskManager* disk = disk_for(file_id);
+    return disk ? disk->get_num_pages() : 0;
+}
+
+BufferPoolStats BufferPoolManager::get_stats() {
+    lock_guard<mutex> guard(latch);
+    return stats;
+}
@@ -3,8 +3,9 @@
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <filesystem>
+#include <unordered_set>
 #include "../include/record_iterator.h"
-#include "../include/table_manager.h"
 
 // ANSI color codes for debug output
 #define COLOR_RESET   "\033[0m"
@@ -63,7 +64,7 @@ std::string TableSchema::serialize() const {
         if(i + 1 < column_types.size()) oss << ",";
     }
     oss<<"|";
-    oss << primary_key_idx;
+    oss << primary_key_idx << "|" << table_id;
     DEBUG_CATALOG("Serialized schema for table '" << table_name << "': " << oss.str());
     return oss.str();
 }
@@ -85,8 +86,8 @@ TableSchema TableSchema::deserialize(const std::string& record_str) {
     }
     parts.push_back(content.substr(start));
 
-    if(parts.size() != 4) {
-        DEBUG_CATALOG("Failed to decerialize: expected 4 parts but got " << parts.size());
+    if(parts.size() != 5) {
+        DEBUG_CATALOG("Failed to decerialize: expected 5 parts but got " << parts.size());
         return TableSchema{};
     }
 
@@ -115,29 +116,47 @@ TableSchema TableSchema::deserialize(const std::string& record_str) {
         schema.primary_key_idx = -1;
     }
 
+    try{
+        schema.table_id = static_cast<uint32_t>(std::stoul(parts[4]));
+    } catch(...) {
+        DEBUG_CATALOG("Failed to parse table_id from '" << parts[4] << "'");
+        return TableSchema{};
+    }
+
     DEBUG_CATALOG("Deserialized schema for table '" << schema.table_name << "' with columns: " << parts[1]);
     return schema;
 }
 
 // ---------- CatalogManager Methods ----------
 
-CatalogManager::CatalogManager(RecordManager& rm, IndexManager& im)
-    : record_manager(rm), index_manager(im) {
+CatalogManager::CatalogManager(RecordManager& catalog_heap, IndexManager& im, LogManager& lm,
+                               const std::string& dir, IoMode mode)
+    : record_manager(catalog_heap), index_manager(im), log_manager(lm), db_dir(dir), io_mode(mode) {
     DEBUG_CATALOG("Initializing CatalogManager");
     load_catalog();
+
+    // Spill files of queries that were running when the process stopped
+    std::error_code ec;
+    std::filesystem::remove_all(temp_dir(), ec);
+}
+
+CatalogManager::~CatalogManager() {
+    // Each heap writes its dirty pages back and leaves the buffer pool.
+    heaps.clear();
 }
 
 void CatalogManager::load_catalog() {
     DEBUG_CATALOG("Loading catalog from disk");
-    RecordIterator iter(record_manager.get_disk());
+    RecordIterator iter(record_manager);
     int count = 0;
 
     while (iter.has_next()) {
         try {
-            auto [rec, page_id, slot_id] = iter.next_with_location();
+            Record rec = iter.next();
             TableSchema schema = TableSchema::deserialize(rec.to_string());
             if (!schema.table_name.empty()) {
                 schema_cache[schema.table_name] = schema;
+                next_table_id = std::max(next_table_id, schema.table_id + 1);
                 ++count;
             }
         } catch (const std::exception& e) {
@@ -145,9 +164,58 @@ void CatalogManager::load_catalog() {
         }
     }
 
+    remove_orphan_heaps();
+    for (const auto& [name, schema] : schema_cache) {
+        open_heap(schema.table_id);
+        TableStats stats;
+        if (TableStats::load(stats_path(schema.table_id), schema.columns.size(), stats)) {
+            stats_cache[name] = std::move(stats);
+        }
+    }
+
     DEBUG_CATALOG("Loaded " << count << " table schemas into cache");
 }
 
+std::string CatalogManager::heap_path(uint32_t table_id) const {
+    return db_dir + "/table_" + std::to_string(table_id);
+}
+
+std::string CatalogManager::stats_path(uint32_t table_id) const {
+    return heap_path(table_id) + ".stats";
+}
+
+void CatalogManager::open_heap(uint32_t table_id) {
+    heaps[table_id] = std::make_unique<HeapFile>(heap_path(table_id), static_cast<int>(table_id),
+                                                 record_manager.get_buffer_pool(), log_manager, io_mode);
+}
+
+void CatalogManager::remove_orphan_heaps() {
+    std::unordered_set<uint32_t> live;
+    for (const auto& [name, schema] : schema_cache) {
+        live.insert(schema.table_id);
+    }
+
+    std::error_code ec;
+    std::unordered_set<uint32_t> orphans;
+    for (const auto& entry : std::filesystem::directory_iterator(db_dir, ec)) {
+        std::string stem = entry.path().stem().string();
+        std::string ext = entry.path().extension().string();
+        if (stem.rfind("table_", 0) != 0 || (ext != ".db" && ext != ".fsm" && ext != ".stats")) continue;
+        try {
+            uint32_t table_id = static_cast<uint32_t>(std::stoul(stem.substr(6)));
+            if (!live.count(table_id)) orphans.insert(table_id);
+        } catch (...) {
+            continue;
+        }
+    }
+
+    for (uint32_t table_id : orphans) {
+        DEBUG_CATALOG("Removing heap file of dropped table id " << table_id);
+        HeapFile::remove_files(heap_path(table_id));
+        std::filesystem::remove(stats_path(table_id), ec);
+    }
+}
+
 bool CatalogManager::create_table(const std::string& table_name, const std::vector<std::string>& columns, const std::vector<DataType>& types, int primary_key_idx) {
     std::string norm_table = normalize_identifier(table_name);
     std::vector<std::string> norm_columns = normalize_identifiers(columns);
@@ -174,10 +242,12 @@ bool CatalogManager::create_table(const std::string& table_name, const std::vect
     schema.columns = norm_columns;
     schema.column_types = types;
     schema.primary_key_idx = primary_key_idx;
-    
+    schema.table_id = next_table_id++;
+
     Record record(schema.serialize());
     record_manager.insert_record(record);
     schema_cache[norm_table] = schema;
+    open_heap(schema.table_id);
 
     DEBUG_CATALOG("Table '" << norm_table << "' created with columns: " << schema.serialize());
     return true;
@@ -195,7 +265,7 @@ bool CatalogManager::drop_table(const std::string& table_name) {
     TableSchema schema = schema_cache[norm_table];
     std::string serialized_schema = schema.serialize();
 
-    RecordIterator iterator(record_manager.get_disk());
+    RecordIterator iterator(record_manager);
     bool found = false;
 
     while (iterator.has_next()) {
@@ -223,12 +293,23 @@ bool CatalogManager::drop_table(const std::string& table_name) {
         }
     }
 
-    TableManager tm(*this, record_manager, index_manager);
-    int deleted = tm.delete_from(norm_table, -1);
-    DEBUG_CATALOG("Deleted " << deleted << " data records from table '" << norm_table << "'");
-
+    // The rows go with the file: forget its cached pages without writing
+    // them, and make the catalog change durable before the file goes.
+    // Table ids only grow within a run and every boot that replays the log
+    // ends with a checkpoint, so the table's records left in the log cannot
+    // reach a later table with the same id. Emptying the log is left for
+    // when no transaction is open: recovery needs it to tell their commits.
+    heaps[schema.table_id]->mark_dropped();
+    heaps.erase(schema.table_id);
     schema_cache.erase(norm_table);
-    DEBUG_CATALOG("Table '" << norm_table << "' dropped from cache");
+    stats_cache.erase(norm_table);
+    log_manager.commit();
+    log_manager.request_checkpoint();
+    HeapFile::remove_files(heap_path(schema.table_id));
+    std::error_code ec;
+    std::filesystem::remove(stats_path(schema.table_id), ec);
+
+    DEBUG_CATALOG("Table '" << norm_table << "' dropped");
     return true;
 }
 
@@ -243,6 +324,11 @@ TableSchema CatalogManager::get_schema(const std::string& table_name) {
     return schema_cache[norm_table];
 }
 
+const TableSchema* CatalogManager::find_schema(const std::string& table_name) const {
+    auto schema = schema_cache.find(normalize_identifier(table_name));
+    return schema == schema_cache.end() ? nullptr : &schema->second;
+}
+
 std::vector<std::string> CatalogManager::list_tables() {
     std::vector<std::string> names;
     for (const auto& [name, _] : schema_cache) {
@@ -252,6 +338,21 @@ std::vector<std::string> CatalogManager::list_tables() {
     return names;
 }
 
+RecordManager* CatalogManager::get_heap(const std::string& table_name) {
+    std::string norm_table = normalize_identifier(table_name);
+    auto schema = schema_cache.find(norm_table);
+    if (schema == schema_cache.end()) return nullptr;
+    auto heap = heaps.find(schema->second.table_id);
+    return heap == heaps.end() ? nullptr : &heap->second->records();
+}
+
+std::mutex* CatalogManager::get_write_latch(const std::string& table_name) {
+    auto schema = schema_cache.find(normalize_identifier(table_name));
+    if (schema == schema_cache.end()) return nullptr;
+    auto heap = heaps.find(schema->second.table_id);
+    return heap == heaps.end() ? nullptr : &heap->second->write_latch();
+}
+
 bool CatalogManager::column_exists(const std::string& table_name, const std::string& column_name) {
     std::string norm_table = normalize_identifier(table_name);
     std::string norm_col = normalize_identifier(column_name);
@@ -259,3 +360,21 @@ bool CatalogManager::column_exists(const std::string& table_name, const std::str
     const auto& columns = schema_cache[norm_table].columns;
     return std::find(columns.begin(), columns.end(), norm_col) != columns.end();
 }
+
+const TableStats* CatalogManager::find_stats(const std::string& table_name) const {
+    auto stats = stats_cache.find(normalize_identifier(table_name));
+    return stats == stats_cache.end() ? nullptr : &stats->second;
+}
+
+bool CatalogManager::set_stats(const std::string& table_name, TableStats stats) {
+    std::string norm_table = normalize_identifier(table_name);
+    auto schema = schema_cache.find(norm_table);
+    if (schema == schema_cache.end()) return false;
+    if (!stats.save(stats_path(schema->second.table_id))) {
+        DEBUG_CATALOG("Could not write statistics of table '" << norm_table << "'");
+        return false;
+    }
+    stats_cache[norm_table] = std::move(stats);
+    DEBUG_CATALOG("Saved statistics of table '" << norm_table << "'");
+    return true;
+}
@@ -0,0 +1,105 @@
+#include "../include/database.h"
+#include "../include/global-state.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+
+namespace fs = std::filesystem;
+
+bool Database::exists(const string& name) {
+    return fs::exists(path(name));
+}
+
+bool Database::create(const string& name) {
+    if (exists(name)) return false;
+    fs::create_directories(path(name));
+    std::ofstream(path(name) + "/pages.db"); // create empty file
+    return true;
+}
+
+vector<string> Database::list() {
+    vector<string> names;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator("data", ec)) {
+        if (entry.is_directory()) names.push_back(entry.path().filename().string());
+    }
+    sort(names.begin(), names.end());
+    return names;
+}
+
+Database::Database(const string& name, const DBConfig& config) : name(name), config(config) {
+    CURRENT_DATABASE = name;
+    string db_path = path(name);
+    // pages.db holds the catalog; each table's rows live in their own
+    // table_<id>.db, opened by the catalog on the same buffer pool.
+    IoMode io_mode = config.use_mmap ? IoMode::MMAP : IoMode::PREAD;
+    disk_manager = make_unique<DiskManager>(db_path + "/pages.db", io_mode);
+    log_manager = make_unique<LogManager>(db_path + "/wal.log", config.group_commit_us);
+    buffer_pool = make_unique<BufferPoolManager>(config.buffer_pool_bytes / PAGE_SIZE, log_manager.get());
+    buffer_pool->attach_file(CATALOG_FILE_ID, *disk_manager);
+    free_space_map = make_unique<FreeSpaceMap>(db_path + "/pages.fsm");
+    catalog_heap = make_unique<RecordManager>(*buffer_pool, CATALOG_FILE_ID, *free_space_map, *log_manager);
+    index_manager = make_unique<IndexManager>(*buffer_pool, *log_manager);
+    catalog_manager = make_unique<CatalogManager>(*catalog_heap, *index_manager, *log_manager, db_path, io_mode);
+    table_manager = make_unique<TableManager>(*catalog_manager, *index_manager);
+    transaction_manager = make_unique<TransactionManager>(*log_manager);
+    bool recovering = log_manager->needs_recovery();
+    if (recovering) {
+        // Undo what the crash left half committed while the log still
+        // tells which commits finished. Before the rebuild, which reads
+        // every version.
+        table_manager->recover_versions(*transaction_manager);
+    }
+    if (index_manager->needs_rebuild()) {
+        table_manager->rebuild_indexes();
+    }
+    if (recovering || log_manager->checkpoint_due()) {
+        // Every file has been replayed; start the next table id on an
+        // empty log so a new table cannot pick up stale records.
+        buffer_pool->checkpoint();
+    }
+    TableManager* tables = table_manager.get();
+    transaction_manager->start_collector([tables](vector<DeadVersion>& versions) {
+        tables->collect_garbage(versions);
+    }, config.gc_interval_ms);
+}
+
+Database::~Database() {
+    // Index and table files write their pages back as they close; the
+    // buffer pool then checkpoints the log.
+    transaction_manager.reset();
+    table_manager.reset();
+    catalog_manager.reset();
+    index_manager.reset();
+    catalog_heap.reset();
+    free_space_map.reset();
+    buffer_pool.reset();
+    log_manager.reset();
+    disk_manager.reset();
+}
+
+unique_ptr<QueryParser> Database::open_session() {
+    return make_unique<QueryParser>(*catalog_manager, *table_manager, *index_manager, *transaction_manager, config);
+}
+
+void Database::end_statement(const QueryParser& session) {
+    if (!session.in_transaction()) {
+        log_manager->commit();
+    }
+    auto checkpoint_due = [this] {
+        return log_manager->checkpoint_due() || log_manager->size() > config.wal_checkpoint_bytes;
+    };
+    if (checkpoint_due()) {
+        // The collector and other sessions' statements may be changing
+        // pages; keep them out meanwhile
+        unique_lock<shared_mutex> checkpointing(catalog_manager->table_latch());
+        // Recovery finds a crashed transaction's versions through the
+        // log, so it must not be emptied under an open one. Another
+        // session may have checkpointed while this one waited.
+        if (transaction_manager->open_transactions() == 0 && checkpoint_due()) {
+            buffer_pool->checkpoint();
+        }
+    }
+}
@@ -0,0 +1,701 @@
+#include "../include/disk_btree.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#define BTREE_DEBUG_PREFIX "[DEBUG][DISK_BTREE] "
+
+namespace {
+    const uint32_t BTREE_MAGIC = 0x3250424C; // "LBP2"
+    const uint32_t BTREE_MAGIC_V1 = 0x5450424C; // "LBPT": slots without key hints
+    const int META_PAGE = 0;
+
+    // Meta page: magic, page LSN, file id, root page, key format.
+    const int META_FILE_ID_OFFSET = PAGE_LSN_OFFSET + sizeof(lsn_t);
+    const int META_ROOT_OFFSET = META_FILE_ID_OFFSET + sizeof(int32_t);
+    const int META_KEY_FORMAT_OFFSET = META_ROOT_OFFSET + sizeof(int32_t);
+
+    // Node header: flags (2), entry count (2), page LSN (8), free offset (2),
+    // prefix length (2), link (4): right sibling of a leaf, leftmost child
+    // of an internal node.
+    const int NODE_COUNT_OFFSET = 2;
+    const int NODE_FREE_OFFSET = PAGE_LSN_OFFSET + sizeof(lsn_t);
+    const int NODE_PREFIX_OFFSET = NODE_FREE_OFFSET + sizeof(uint16_t);
+    const int NODE_LINK_OFFSET = NODE_PREFIX_OFFSET + sizeof(uint16_t);
+    const int NODE_HEADER_SIZE = NODE_LINK_OFFSET + sizeof(int32_t);
+    const uint16_t NODE_LEAF = 1;
+    // Slot: [uint16 entry offset][uint32 key hint]
+    const int SLOT_HINT_OFFSET = sizeof(uint16_t);
+    const int SLOT_SIZE = SLOT_HINT_OFFSET + sizeof(uint32_t);
+
+    template <typename T>
+    T read_at(const char* page, int offset) {
+        T value;
+        memcpy(&value, page + offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void write_at(char* page, int offset, T value) {
+        memcpy(page + offset, &value, sizeof(T));
+    }
+
+    // Entry: [uint16 key length][key][int32 record id][int32 child, internal only]
+    struct Entry {
+        string_view key;
+        int record_id;
+        int child;
+    };
+
+    // An entry copied out of its page, for splits.
+    struct OwnedEntry {
+        string key;
+        int record_id;
+        int child;
+    };
+
+    bool is_leaf(const char* node) { return read_at<uint16_t>(node, 0) & NODE_LEAF; }
+    int entry_count(const char* node) { return read_at<uint16_t>(node, NODE_COUNT_OFFSET); }
+    int node_link(const char* node) { return read_at<int32_t>(node, NODE_LINK_OFFSET); }
+    void set_node_link(char* node, int page_id) { write_at<int32_t>(node, NODE_LINK_OFFSET, page_id); }
+    // Every key in the node starts with the same prefix_length bytes.
+    int prefix_length(const char* node) { return read_at<uint16_t>(node, NODE_PREFIX_OFFSET); }
+
+    int entry_size(size_t key_size, bool leaf) {
+        return static_cast<int>(sizeof(uint16_t) + key_size + sizeof(int32_t) + (leaf ? 0 : sizeof(int32_t)));
+    }
+
+    int entry_offset(const char* node, int i) {
+        return read_at<uint16_t>(node, NODE_HEADER_SIZE + i * SLOT_SIZE);
+    }
+
+    uint32_t slot_hint(const char* node, int i) {
+        return read_at<uint32_t>(node, NODE_HEADER_SIZE + i * SLOT_SIZE + SLOT_HINT_OFFSET);
+    }
+
+    void set_slot_hint(char* node, int i, uint32_t hint) {
+        write_at<uint32_t>(node, NODE_HEADER_SIZE + i * SLOT_SIZE + SLOT_HINT_OFFSET, hint);
+    }
+
+    // The 4 key bytes after the node's prefix as a big-endian number, zero
+    // padded. Keys that share the prefix order like their hints wherever the
+    // hints differ, so a search only has to go out to the entry itself when
+    // they are equal.
+    uint32_t key_hint(string_view key, int prefix) {
+        uint32_t hint = 0;
+        for (size_t i = prefix; i < static_cast<size_t>(prefix) + sizeof(hint); ++i) {
+            hint = (hint << 8) | (i < key.size() ? static_cast<unsigned char>(key[i]) : 0);
+        }
+        return hint;
+    }
+
+    string_view entry_key(const char* node, int i) {
+        int offset = entry_offset(node, i);
+        return string_view(node + offset + sizeof(uint16_t), read_at<uint16_t>(node, offset));
+    }
+
+    Entry entry_at(const char* node, int i) {
+        int offset = entry_offset(node, i);
+        uint16_t key_size = read_at<uint16_t>(node, offset);
+        int after_key = offset + sizeof(uint16_t) + key_size;
+        Entry entry;
+        entry.key = string_view(node + offset + sizeof(uint16_t), key_size);
+        entry.record_id = read_at<int32_t>(node, after_key);
+        entry.child = is_leaf(node) ? -1 : read_at<int32_t>(node, after_key + sizeof(int32_t));
+        return entry;
+    }
+
+    int compare(string_view a, int a_record_id, string_view b, int b_record_id) {
+        int c = a.compare(b);
+        if (c != 0) return c;
+        return a_record_id < b_record_id ? -1 : (a_record_id > b_record_id ? 1 : 0);
+    }
+
+    // Number of entries below (key, record_id), or at or below it when
+    // or_equal is set. The binary search runs over the slot hints, which
+    // sit together at the front of the page; only probes whose hint equals
+    // the key's read the entry.
+    int count_below(const char* node, string_view key, int record_id, bool or_equal) {
+        int count = entry_count(node);
+        if (count == 0) return 0;
+        int prefix = prefix_length(node);
+        if (prefix > 0) {
+            int c = key.substr(0, prefix).compare(entry_key(node, 0).substr(0, prefix));
+            if (c != 0) return c < 0 ? 0 : count;
+        }
+        uint32_t hint = key_hint(key, prefix);
+        int lo = 0, hi = count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            uint32_t mid_hint = slot_hint(node, mid);
+            bool below;
+            if (mid_hint != hint) {
+                below = mid_hint < hint;
+            } else {
+                Entry entry = entry_at(node, mid);
+                int c = compare(entry.key, entry.record_id, key, record_id);
+                below = or_equal ? c <= 0 : c < 0;
+            }
+            if (below) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    // First position whose entry is >= (key, record_id).
+    int lower_bound(const char* node, string_view key, int record_id) {
+        return count_below(node, key, record_id, false);
+    }
+
+    // Child of an internal node whose subtree covers (key, record_id).
+    int child_for(const char* node, string_view key, int record_id) {
+        int lo = count_below(node, key, record_id, true);
+        return lo == 0 ? node_link(node) : entry_at(node, lo - 1).child;
+    }
+
+    void init_node(char* node, bool leaf, int link) {
+        write_at<uint16_t>(node, 0, leaf ? NODE_LEAF : 0);
+        write_at<uint16_t>(node, NODE_COUNT_OFFSET, 0);
+        write_at<uint16_t>(node, NODE_FREE_OFFSET, PAGE_SIZE);
+        write_at<uint16_t>(node, NODE_PREFIX_OFFSET, 0);
+        set_node_link(node, link);
+    }
+
+    // Sets the node's prefix length and recomputes every hint for it.
+    void set_prefix_length(char* node, int prefix) {
+        write_at<uint16_t>(node, NODE_PREFIX_OFFSET, static_cast<uint16_t>(prefix));
+        int count = entry_count(node);
+        for (int i = 0; i < count; ++i) set_slot_hint(node, i, key_hint(entry_key(node, i), prefix));
+    }
+
+    size_t common_prefix(string_view a, string_view b) {
+        size_t length = 0;
+        while (length < a.size() && length < b.size() && a[length] == b[length]) length++;
+        return length;
+    }
+
+    int contiguous_free(const char* node) {
+        return read_at<uint16_t>(node, NODE_FREE_OFFSET) - (NODE_HEADER_SIZE + entry_count(node) * SLOT_SIZE);
+    }
+
+    // Moves the live entries to the end of the page; removed entries leave
+    // holes behind until then.
+    void compact_node(char* node) {
+        bool leaf = is_leaf(node);
+        int count = entry_count(node);
+        char scratch[PAGE_SIZE];
+        int free_offset = PAGE_SIZE;
+        for (int i = 0; i < count; ++i) {
+            int offset = entry_offset(node, i);
+            int size = entry_size(read_at<uint16_t>(node, offset), leaf);
+            free_offset -= size;
+            memcpy(scratch + free_offset, node + offset, size);
+            write_at<uint16_t>(node, NODE_HEADER_SIZE + i * SLOT_SIZE, static_cast<uint16_t>(free_offset));
+        }
+        memcpy(node + free_offset, scratch + free_offset, PAGE_SIZE - free_offset);
+        write_at<uint16_t>(node, NODE_FREE_OFFSET, static_cast<uint16_t>(free_offset));
+    }
+
+    // Returns false if the node has no room for the entry even after compaction.
+    bool insert_entry(char* node, int pos, string_view key, int record_id, int child) {
+        bool leaf = is_leaf(node);
+        int size = entry_size(key.size(), leaf);
+        if (contiguous_free(node) < size + SLOT_SIZE) {
+            compact_node(node);
+            if (contiguous_free(node) < size + SLOT_SIZE) return false;
+        }
+
+        // The prefix only shrinks here; splits work it out afresh.
+        int count = entry_count(node);
+        int prefix = prefix_length(node);
+        if (count == 0) {
+            write_at<uint16_t>(node, NODE_PREFIX_OFFSET, static_cast<uint16_t>(key.size()));
+        } else if (key.size() < static_cast<size_t>(prefix) || key.compare(0, prefix, entry_key(node, 0).substr(0, prefix)) != 0) {
+            set_prefix_length(node, static_cast<int>(common_prefix(key, entry_key(node, 0).substr(0, prefix))));
+        }
+
+        int offset = read_at<uint16_t>(node, NODE_FREE_OFFSET) - size;
+        write_at<uint16_t>(node, offset, static_cast<uint16_t>(key.size()));
+        memcpy(node + offset + sizeof(uint16_t), key.data(), key.size());
+        int after_key = offset + sizeof(uint16_t) + key.size();
+        write_at<int32_t>(node, after_key, record_id);
+        if (!leaf) write_at<int32_t>(node, after_key + sizeof(int32_t), child);
+
+        char* slots = node + NODE_HEADER_SIZE;
+        memmove(slots + (pos + 1) * SLOT_SIZE, slots + pos * SLOT_SIZE, (count - pos) * SLOT_SIZE);
+        write_at<uint16_t>(node, NODE_HEADER_SIZE + pos * SLOT_SIZE, static_cast<uint16_t>(offset));
+        set_slot_hint(node, pos, key_hint(key, prefix_length(node)));
+        write_at<uint16_t>(node, NODE_COUNT_OFFSET, static_cast<uint16_t>(count + 1));
+        write_at<uint16_t>(node, NODE_FREE_OFFSET, static_cast<uint16_t>(offset));
+        return true;
+    }
+
+    void remove_entry(char* node, int pos) {
+        int count = entry_count(node);
+        char* slots = node + NODE_HEADER_SIZE;
+        memmove(slots + pos * SLOT_SIZE, slots + (pos + 1) * SLOT_SIZE, (count - pos - 1) * SLOT_SIZE);
+        write_at<uint16_t>(node, NODE_COUNT_OFFSET, static_cast<uint16_t>(count - 1));
+    }
+
+    vector<OwnedEntry> read_entries(const char* node) {
+        vector<OwnedEntry> entries;
+        int count = entry_count(node);
+        entries.reserve(count + 1);
+        for (int i = 0; i < count; ++i) {
+            Entry entry = entry_at(node, i);
+            entries.push_back({string(entry.key), entry.record_id, entry.child});
+        }
+        return entries;
+    }
+
+    void write_entries(char* node, bool leaf, int link, const vector<OwnedEntry>& entries, size_t from, size_t to) {
+        init_node(node, leaf, link);
+        // Sorted, so the first and last entries share the least
+        if (from < to) {
+            insert_entry(node, 0, entries[from].key, entries[from].record_id, entries[from].child);
+            set_prefix_length(node, static_cast<int>(common_prefix(entries[from].key, entries[to - 1].key)));
+            from++;
+        }
+        for (size_t i = from; i < to; ++i) {
+            insert_entry(node, entry_count(node), entries[i].key, entries[i].record_id, entries[i].child);
+        }
+    }
+
+    // Whether the node takes one more entry with the longest key allowed
+    // without splitting, once compacted.
+    bool can_absorb(const char* node) {
+        bool leaf = is_leaf(node);
+        int count = entry_count(node);
+        int used = NODE_HEADER_SIZE + count * SLOT_SIZE;
+        for (int i = 0; i < count; ++i) used += entry_size(read_at<uint16_t>(node, entry_offset(node, i)), leaf);
+        return PAGE_SIZE - used >= entry_size(MAX_INDEX_KEY_SIZE, leaf) + SLOT_SIZE;
+    }
+
+    // Index of the first entry of the right half when splitting by size, so
+    // both halves keep room for more entries whatever the key lengths are.
+    size_t split_point(const vector<OwnedEntry>& entries, bool leaf) {
+        int total = 0;
+        for (const OwnedEntry& entry : entries) total += entry_size(entry.key.size(), leaf) + SLOT_SIZE;
+        int left = 0;
+        size_t mid = 0;
+        while (mid < entries.size() - 1 && left < total / 2) {
+            left += entry_size(entries[mid].key.size(), leaf) + SLOT_SIZE;
+            mid++;
+        }
+        return max<size_t>(mid, 1);
+    }
+}
+
+DiskBPlusTree::DiskBPlusTree(const string& path, int new_file_id, uint32_t new_key_format, BufferPoolManager& bpm, LogManager& lm)
+    : buffer_pool(bpm), log_manager(lm), disk(path), file_id(new_file_id), key_format(new_key_format), root_page(-1), dropped(false), old_layout(false) {
+    vector<char> meta(PAGE_SIZE, 0);
+    if (disk.get_num_pages() == 0) disk.allocate_page();
+    if (!disk.read_page(META_PAGE, meta.data())) {
+        throw std::runtime_error("Failed to read index file " + path);
+    }
+
+    uint32_t magic = read_at<uint32_t>(meta.data(), 0);
+    bool created = magic == 0;
+    if (created) {
+        // New file. The meta page is written straight to disk rather than
+        // through the log, so the file id is known before any of the file's
+        // log records are replayed.
+        write_at<uint32_t>(meta.data(), 0, BTREE_MAGIC);
+        write_at<int32_t>(meta.data(), META_FILE_ID_OFFSET, file_id);
+        write_at<int32_t>(meta.data(), META_ROOT_OFFSET, -1);
+        write_at<uint32_t>(meta.data(), META_KEY_FORMAT_OFFSET, key_format);
+        if (!disk.write_page(META_PAGE, meta)) {
+            throw std::runtime_error("Failed to initialize index file " + path);
+        }
+        disk.flush();
+    } else if (magic != BTREE_MAGIC && magic != BTREE_MAGIC_V1) {
+        throw std::runtime_error("Not an index file: " + path);
+    } else {
+        file_id = read_at<int32_t>(meta.data(), META_FILE_ID_OFFSET);
+        key_format = read_at<uint32_t>(meta.data(), META_KEY_FORMAT_OFFSET);
+        old_layout = magic == BTREE_MAGIC_V1;
+    }
+
+    buffer_pool.attach_file(file_id, disk);
+    // A new file has nothing in the log yet. Records there with its id
+    // are those of a dropped index that had it before the crash.
+    if (!created && log_manager.needs_recovery()) {
+        std::cout << BTREE_DEBUG_PREFIX << "Replaying the log for index file " << file_id << "." << std::endl;
+        log_manager.replay([this](const LogRecord& record) {
+            if (record.file_id == file_id) redo(record);
+        });
+    }
+
+    Page* frame = buffer_pool.fetch_page(file_id, META_PAGE);
+    if (!frame) {
+        throw std::runtime_error("Failed to read the meta page of " + path);
+    }
+    root_page = read_at<int32_t>(frame->get_data(), META_ROOT_OFFSET);
+    buffer_pool.unpin_page(file_id, META_PAGE, false);
+    std::cout << BTREE_DEBUG_PREFIX << "Opened " << path << " as file " << file_id << ", root page " << root_page << "." << std::endl;
+}
+
+DiskBPlusTree::~DiskBPlusTree() {
+    if (!buffer_pool.detach_file(file_id, !dropped)) {
+        std::cerr << "[ERROR][DISK_BTREE] Could not detach index file " << file_id << " from the buffer pool." << std::endl;
+    }
+}
+
+DiskBPlusTree::LatchedNode DiskBPlusTree::latch_node(int page_id, bool exclusive) {
+    Page* frame = buffer_pool.fetch_page(file_id, page_id);
+    if (!frame) {
+        throw std::runtime_error("Failed to fetch index page " + std::to_string(page_id));
+    }
+    if (exclusive) frame->latch.lock();
+    else frame->latch.lock_shared();
+    return {page_id, frame, exclusive};
+}
+
+void DiskBPlusTree::release(LatchedNode& node, bool dirty) {
+    if (!node.frame) return;
+    if (node.exclusive) node.frame->latch.unlock();
+    else node.frame->latch.unlock_shared();
+    buffer_pool.unpin_page(file_id, node.page_id, dirty);
+    node = LatchedNode();
+}
+
+void DiskBPlusTree::release_all(vector<LatchedNode>& nodes) {
+    for (LatchedNode& node : nodes) release(node);
+    nodes.clear();
+}
+
+DiskBPlusTree::LatchedNode DiskBPlusTree::new_node(bool leaf, vector<char>& before) {
+    int page_id;
+    Page* frame = buffer_pool.new_page(file_id, page_id);
+    if (!frame) {
+        throw std::runtime_error("Failed to allocate an index page");
+    }
+    // Nothing links to the node yet, so the latch is free
+    frame->latch.lock();
+    before.assign(PAGE_SIZE, 0); // new_page hands out zeroed frames
+    init_node(frame->get_data(), leaf, -1);
+    return {page_id, frame, true};
+}
+
+// The page must not be unpinned before its log record exists.
+void DiskBPlusTree::finish_edit(LatchedNode& node, const vector<char>& before) {
+    LogRecord record;
+    record.type = LogRecordType::PAGE_WRITE;
+    record.file_id = file_id;
+    record.page_id = node.page_id;
+    diff_page(before.data(), node.data(), record.after);
+    if (record.after.empty()) {
+        release(node);
+        return;
+    }
+    set_page_lsn(node.data(), log_manager.append(record));
+    release(node, true);
+}
+
+void DiskBPlusTree::set_root(int page_id) {
+    vector<char> before;
+    LatchedNode meta = latch_node(META_PAGE, true);
+    before.assign(meta.data(), meta.data() + PAGE_SIZE);
+    write_at<int32_t>(meta.data(), META_ROOT_OFFSET, page_id);
+    finish_edit(meta, before);
+    root_page = page_id;
+}
+
+void DiskBPlusTree::redo(const LogRecord& record) {
+    if (record.type != LogRecordType::PAGE_WRITE || record.page_id < 0) return;
+
+    // Allocation is not logged; recreate pages a crash cut off the file.
+    while (record.page_id >= buffer_pool.get_num_pages(file_id)) {
+        int page_id;
+        if (!buffer_pool.new_page(file_id, page_id)) {
+            throw std::runtime_error("Failed to allocate index page during recovery");
+        }
+        buffer_pool.unpin_page(file_id, page_id, true);
+    }
+
+    Page* frame = buffer_pool.fetch_page(file_id, record.page_id);
+    if (!frame) {
+        throw std::runtime_error("Failed to fetch index page during recovery");
+    }
+    char* page = frame->get_data();
+    if (get_page_lsn(page) >= record.lsn) {
+        buffer_pool.unpin_page(file_id, record.page_id, false);
+        return;
+    }
+    apply_page_diff(page, record.after);
+    set_page_lsn(page, record.lsn);
+    buffer_pool.unpin_page(file_id, record.page_id, true);
+}
+
+// Descends to the leaf covering (key, record_id), latch coupling all the way.
+DiskBPlusTree::LatchedNode DiskBPlusTree::find_leaf(string_view key, int record_id) {
+    shared_lock<shared_mutex> root(root_latch);
+    if (root_page < 0) return LatchedNode();
+    LatchedNode node = latch_node(root_page, false);
+    root.unlock();
+    while (!is_leaf(node.data())) {
+        LatchedNode child = latch_node(child_for(node.data(), key, record_id), false);
+        release(node);
+        node = child;
+    }
+    return node;
+}
+
+// Leaf holding the last entry before cursor (before every entry if the
+// cursor has not started). fence is set to the separator the leaf's
+// entries are all at or above; it stays unstarted for the leftmost leaf.
+DiskBPlusTree::LatchedNode DiskBPlusTree::find_leaf_before(const IndexCursor& cursor, IndexCursor& fence) {
+    fence = IndexCursor();
+    shared_lock<shared_mutex> root(root_latch);
+    if (root_page < 0) return LatchedNode();
+    LatchedNode node = latch_node(root_page, false);
+    root.unlock();
+    while (!is_leaf(node.data())) {
+        // Entries of child i are >= separator i; take the last child whose
+        // separator is below the cursor.
+        const char* data = node.data();
+        int count = entry_count(data);
+        int lo = cursor.started ? lower_bound(data, cursor.key, cursor.record_id) : count;
+        int child = node_link(data);
+        if (lo > 0) {
+            Entry separator = entry_at(data, lo - 1);
+            fence.key = string(separator.key);
+            fence.record_id = separator.record_id;
+            fence.started = true;
+            child = separator.child;
+        }
+        LatchedNode next = latch_node(child, false);
+        release(node);
+        node = next;
+    }
+    return node;
+}
+
+bool DiskBPlusTree::insert(string_view key, int record_id) {
+    if (key.size() > MAX_INDEX_KEY_SIZE) {
+        std::cerr << "[ERROR][DISK_BTREE] Key of " << key.size() << " bytes exceeds the index limit of "
+                  << MAX_INDEX_KEY_SIZE << "." << std::endl;
+        return false;
+    }
+
+    vector<char> before;
+    unique_lock<shared_mutex> root(root_latch);
+    if (root_page < 0) {
+        LatchedNode node = new_node(true, before);
+        insert_entry(node.data(), 0, key, record_id, -1);
+        int page_id = node.page_id;
+        finish_edit(node, before);
+        set_root(page_id);
+        return true;
+    }
+
+    // Latched nodes from the highest one a split could reach down to the leaf
+    vector<LatchedNode> path;
+    path.push_back(latch_node(root_page, true));
+    while (true) {
+        const char* node = path.back().data();
+        if (can_absorb(node)) {
+            for (size_t i = 0; i + 1 < path.size(); ++i) release(path[i]);
+            path.erase(path.begin(), path.end() - 1);
+            if (root.owns_lock()) root.unlock();
+        }
+        if (is_leaf(node)) break;
+        path.push_back(latch_node(child_for(node, key, record_id), true));
+    }
+
+    LatchedNode leaf = path.back();
+    path.pop_back();
+    before.assign(leaf.data(), leaf.data() + PAGE_SIZE);
+    int pos = lower_bound(leaf.data(), key, record_id);
+    if (pos < entry_count(leaf.data())) {
+        Entry entry = entry_at(leaf.data(), pos);
+        if (compare(entry.key, entry.record_id, key, record_id) == 0) {
+            release(leaf); // already indexed
+            release_all(path);
+            return true;
+        }
+    }
+    if (insert_entry(leaf.data(), pos, key, record_id, -1)) {
+        finish_edit(leaf, before);
+        release_all(path);
+        return true;
+    }
+
+    // Full: divide the entries plus the new one between this leaf and a new
+    // right sibling, and post the sibling's first entry to the parent.
+    vector<OwnedEntry> entries = read_entries(leaf.data());
+    entries.insert(entries.begin() + pos, {string(key), record_id, -1});
+    size_t mid = split_point(entries, true);
+
+    vector<char> right_before;
+    LatchedNode right = new_node(true, right_before);
+    int leaf_id = leaf.page_id, right_id = right.page_id;
+    write_entries(right.data(), true, node_link(leaf.data()), entries, mid, entries.size());
+    write_entries(leaf.data(), true, right_id, entries, 0, mid);
+    finish_edit(right, right_before);
+    finish_edit(leaf, before);
+
+    insert_into_parent(path, leaf_id, entries[mid].key, entries[mid].record_id, right_id);
+    release_all(path);
+    return true;
+}
+
+void DiskBPlusTree::insert_into_parent(vector<LatchedNode>& path, int left_page, const string& key, int record_id, int right_page) {
+    vector<char> before;
+    if (path.empty()) {
+        LatchedNode root = new_node(false, before);
+        set_node_link(root.data(), left_page);
+        insert_entry(root.data(), 0, key, record_id, right_page);
+        int root_id = root.page_id;
+        finish_edit(root, before);
+        set_root(root_id);
+        return;
+    }
+
+    LatchedNode parent = path.back();
+    path.pop_back();
+    before.assign(parent.data(), parent.data() + PAGE_SIZE);
+    int pos = lower_bound(parent.data(), key, record_id);
+    if (insert_entry(parent.data(), pos, key, record_id, right_page)) {
+        finish_edit(parent, before);
+        return;
+    }
+
+    // The middle entry moves up; its child becomes the leftmost child of the
+    // new right node.
+    vector<OwnedEntry> entries = read_entries(parent.data());
+    entries.insert(entries.begin() + pos, {key, record_id, right_page});
+    size_t mid = split_point(entries, false);
+    OwnedEntry up = entries[mid];
+
+    vector<char> right_before;
+    LatchedNode right = new_node(false, right_before);
+    int parent_id = parent.page_id, right_id = right.page_id;
+    write_entries(right.data(), false, up.child, entries, mid + 1, entries.size());
+    write_entries(parent.data(), false, node_link(parent.data()), entries, 0, mid);
+    finish_edit(right, right_before);
+    finish_edit(parent, before);
+
+    insert_into_parent(path, parent_id, up.key, up.record_id, right_id);
+}
+
+bool DiskBPlusTree::remove(string_view key, int record_id) {
+    shared_lock<shared_mutex> root(root_latch);
+    if (root_page < 0) return false;
+    LatchedNode node = latch_node(root_page, true);
+    root.unlock();
+    while (!is_leaf(node.data())) {
+        LatchedNode child = latch_node(child_for(node.data(), key, record_id), true);
+        release(node);
+        node = child;
+    }
+
+    int pos = lower_bound(node.data(), key, record_id);
+    if (pos >= entry_count(node.data())) {
+        release(node);
+        return false;
+    }
+    Entry entry = entry_at(node.data(), pos);
+    if (compare(entry.key, entry.record_id, key, record_id) != 0) {
+        release(node);
+        return false;
+    }
+    vector<char> before(node.data(), node.data() + PAGE_SIZE);
+    remove_entry(node.data(), pos);
+    finish_edit(node, before);
+    return true;
+}
+
+PostingList DiskBPlusTree::search(string_view key) {
+    return range_search(key, key);
+}
+
+PostingList DiskBPlusTree::range_search(string_view start_key, string_view end_key, bool end_inclusive) {
+    PostingList result;
+    if (start_key > end_key) return result;
+
+    LatchedNode leaf = find_leaf(start_key, INT_MIN);
+    bool first = true;
+    while (leaf.frame) {
+        const char* data = leaf.data();
+        int count = entry_count(data);
+        int i = first ? lower_bound(data, start_key, INT_MIN) : 0;
+        for (; i < count; ++i) {
+            Entry entry = entry_at(data, i);
+            if (entry.key > end_key || (!end_inclusive && entry.key == end_key)) {
+                release(leaf);
+                return result;
+            }
+            result.add(entry.record_id);
+        }
+        int next = node_link(data);
+        LatchedNode sibling = next >= 0 ? latch_node(next, false) : LatchedNode();
+        release(leaf);
+        leaf = sibling;
+        first = false;
+    }
+    return result;
+}
+
+void DiskBPlusTree::scan_ordered(IndexCursor& cursor, bool descending, size_t max_entries, vector<int>& record_ids) {
+    size_t added = 0;
+    while (!cursor.finished && added < max_entries) {
+        IndexCursor fence;
+        LatchedNode leaf = descending ? find_leaf_before(cursor, fence)
+                                      : (cursor.started ? find_leaf(cursor.key, cursor.record_id) : find_leaf("", INT_MIN));
+        if (!leaf.frame) {
+            cursor.finished = true; // empty tree
+            return;
+        }
+        bool first = true;
+        while (leaf.frame && added < max_entries) {
+            const char* data = leaf.data();
+            int count = entry_count(data);
+            int i;
+            if (descending) {
+                i = cursor.started ? lower_bound(data, cursor.key, cursor.record_id) - 1 : count - 1;
+            } else {
+                i = 0;
+                if (first && cursor.started) {
+                    i = lower_bound(data, cursor.key, cursor.record_id);
+                    if (i < count && compare(entry_at(data, i).key, entry_at(data, i).record_id, cursor.key, cursor.record_id) == 0) i++;
+                }
+            }
+            int last = -1;
+            for (; i >= 0 && i < count && added < max_entries; i += descending ? -1 : 1) {
+                record_ids.push_back(entry_at(data, i).record_id);
+                last = i;
+                added++;
+            }
+            if (last >= 0) {
+                Entry entry = entry_at(data, last);
+                cursor.key = string(entry.key);
+                cursor.record_id = entry.record_id;
+                cursor.started = true;
+            }
+            bool leaf_done = descending ? i < 0 : i >= count;
+            int next = node_link(data);
+            if (!leaf_done) {
+                release(leaf);
+                return;
+            }
+
+            if (descending) {
+                // Everything left is below the leaf's fence; a leaf emptied by
+                // deletes is passed over the same way.
+                release(leaf);
+                if (!fence.started) cursor.finished = true;
+                else cursor = fence;
+                break;
+            }
+            LatchedNode sibling = next >= 0 ? latch_node(next, false) : LatchedNode();
+            release(leaf);
+            leaf = sibling;
+            first = false;
+        }
+        if (!descending && !leaf.frame) cursor.finished = true;
+        release(leaf);
+    }
+}
@@ -5,48 +5,163 @@
 
 #include "../include/disk_manager.h"
 #include <iostream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 using namespace std;
 
-DiskManager::DiskManager(const string& filename) : file_name(filename) {
+const int MIN_MAPPING_PAGES = 256; // map at least 1 MB up front
+
+DiskManager::DiskManager(const string& filename, IoMode mode)
+    : fd(-1), file_name(filename), num_pages(0), io_mode(mode), mapping(nullptr) {
     cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] DiskManager constructor called with file: " << filename << COLOR_RESET << endl;
-    db_file.open(filename, ios::in | ios::out | ios::binary);
-    if(!db_file.is_open()){
+    fd = ::open(filename.c_str(), O_RDWR | O_BINARY);
+    bool created = false;
+    if (fd < 0 && errno == ENOENT) {
         cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] File does not exist. Creating new file: " << filename << COLOR_RESET << endl;
-        db_file.open(filename, std::ios::out | std::ios::binary);
-        std::vector<char> zero_page(PAGE_SIZE, 0);
-        db_file.write(zero_page.data(), PAGE_SIZE);
-        db_file.close();
-        db_file.open(filename, ios::in | ios::out | ios::binary);
+        fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_BINARY, 0644);
+        created = true;
+    }
+    if (fd < 0) {
+        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] Failed to open " + filename + ": " + strerror(errno) + COLOR_RESET);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] fstat failed for " + filename + COLOR_RESET);
+    }
+    num_pages = static_cast<int>(st.st_size / PAGE_SIZE);
+
+#ifdef _WIN32
+    if (io_mode == IoMode::MMAP) {
+        cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] mmap is not supported on this platform; using positioned reads." << COLOR_RESET << endl;
+        io_mode = IoMode::PREAD;
+    }
+#endif
+    if (io_mode == IoMode::MMAP && !grow_mapping(max(num_pages.load() * 2, MIN_MAPPING_PAGES))) {
+        cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Could not map " << filename << "; using positioned reads." << COLOR_RESET << endl;
+        io_mode = IoMode::PREAD;
+    }
+
+    if (created) {
+        allocate_page();
     }
 }
 
 DiskManager::~DiskManager() {
     cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] DiskManager destructor called." << COLOR_RESET << endl;
     flush();
-    db_file.close();
+    unmap_all();
+    ::close(fd);
 }
 
-bool DiskManager::write_page(int page_id, const vector<char>& data) {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Writing page " << page_id << COLOR_RESET << endl;
-    db_file.clear();
-
-    db_file.seekp(page_id * PAGE_SIZE, ios::beg);
-    if (!db_file) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Seekp failed for page " << page_id << COLOR_RESET << "\n";
+// Installs a mapping covering at least min_pages. Caller must hold alloc_mutex
+// (or be the constructor).
+bool DiskManager::grow_mapping(int min_pages) {
+#ifdef _WIN32
+    return false;
+#else
+    Mapping* current = mapping.load();
+    if (current && current->capacity >= min_pages) return true;
+
+    int capacity = current ? max(current->capacity * 2, min_pages) : min_pages;
+    void* base = mmap(nullptr, static_cast<size_t>(capacity) * PAGE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] mmap of " << capacity << " pages failed: " << strerror(errno) << COLOR_RESET << "\n";
         return false;
     }
 
-    db_file.write(data.data(), PAGE_SIZE);
-    if (!db_file) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Write failed for page " << page_id << COLOR_RESET << "\n";
+    Mapping* next = new Mapping{static_cast<char*>(base), capacity};
+    mappings.push_back(next);
+    mapping.store(next);
+    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Mapped " << file_name << " with capacity " << capacity << " pages." << COLOR_RESET << endl;
+    return true;
+#endif
+}
+
+void DiskManager::unmap_all() {
+#ifndef _WIN32
+    for (Mapping* m : mappings) {
+        munmap(m->base, static_cast<size_t>(m->capacity) * PAGE_SIZE);
+        delete m;
+    }
+#endif
+    mappings.clear();
+    mapping.store(nullptr);
+}
+
+const char* DiskManager::page_view(int page_id) {
+    Mapping* current = mapping.load();
+    if (!current || page_id < 0 || page_id >= num_pages.load() || page_id >= current->capacity) {
+        return nullptr;
+    }
+    return current->base + static_cast<size_t>(page_id) * PAGE_SIZE;
+}
+
+bool DiskManager::read_at(char* buf, size_t count, long long offset) {
+    size_t done = 0;
+#ifdef _WIN32
+    lock_guard<mutex> lock(io_mutex);
+    if (_lseeki64(fd, offset, SEEK_SET) < 0) return false;
+#endif
+    while (done < count) {
+#ifdef _WIN32
+        int n = _read(fd, buf + done, static_cast<unsigned>(count - done));
+#else
+        ssize_t n = ::pread(fd, buf + done, count - done, offset + done);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+bool DiskManager::write_at(const char* buf, size_t count, long long offset) {
+    size_t done = 0;
+#ifdef _WIN32
+    lock_guard<mutex> lock(io_mutex);
+    if (_lseeki64(fd, offset, SEEK_SET) < 0) return false;
+#endif
+    while (done < count) {
+#ifdef _WIN32
+        int n = _write(fd, buf + done, static_cast<unsigned>(count - done));
+#else
+        ssize_t n = ::pwrite(fd, buf + done, count - done, offset + done);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+bool DiskManager::write_page(int page_id, const vector<char>& data) {
+    return write_page(page_id, data.data());
+}
+
+bool DiskManager::write_page(int page_id, const char* data) {
+    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Writing page " << page_id << COLOR_RESET << endl;
+    if (page_id < 0) {
+        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Invalid page id " << page_id << COLOR_RESET << "\n";
         return false;
     }
 
-    db_file.flush();
-    if (!db_file) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Flush failed for page " << page_id << COLOR_RESET << "\n";
+    if (!write_at(data, PAGE_SIZE, static_cast<long long>(page_id) * PAGE_SIZE)) {
+        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Write failed for page " << page_id << ": " << strerror(errno) << COLOR_RESET << "\n";
         return false;
     }
 
@@ -55,59 +170,65 @@ bool DiskManager::write_page(int page_id, const vector<char>& data) {
 }
 
 std::vector<char> DiskManager::read_page(int page_id) {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Reading page " << page_id << COLOR_RESET << endl;
     std::vector<char> page(PAGE_SIZE);
+    if (!read_page(page_id, page.data())) {
+        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] Partial read" + COLOR_RESET);
+    }
+    return page;
+}
 
-    std::ifstream file(file_name, std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] Failed to open file" + COLOR_RESET);
+bool DiskManager::read_page(int page_id, char* out) {
+    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Reading page " << page_id << COLOR_RESET << endl;
+    if (page_id < 0 || page_id >= num_pages.load()) {
+        std::cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Page " << page_id << " is beyond end of file" << COLOR_RESET << std::endl;
+        return false;
     }
 
-    file.seekg(page_id * PAGE_SIZE);
-    if (!file.good()) {
-        std::cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Seekg failed for page " << page_id << COLOR_RESET << std::endl;
-        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] Seekg failed" + COLOR_RESET);
+    if (const char* view = page_view(page_id)) {
+        memcpy(out, view, PAGE_SIZE);
+        return true;
     }
 
-    file.read(page.data(), PAGE_SIZE);
-    if (file.gcount() < PAGE_SIZE) {
+    if (!read_at(out, PAGE_SIZE, static_cast<long long>(page_id) * PAGE_SIZE)) {
         std::cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Could not read full page " << page_id << COLOR_RESET << std::endl;
-        throw std::runtime_error(string(COLOR_ERROR) + "[DEBUG][DISK_MANAGER] Partial read" + COLOR_RESET);
+        return false;
     }
 
     cout << COLOR_SUCCESS << "[DEBUG][DISK_MANAGER] Page " << page_id << " read successfully." << COLOR_RESET << endl;
-    return page;
+    return true;
 }
 
 void DiskManager::flush(){
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Flushing db_file." << COLOR_RESET << endl;
-    db_file.flush();
+    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Syncing " << file_name << " to disk." << COLOR_RESET << endl;
+#ifdef _WIN32
+    _commit(fd);
+#elif defined(__APPLE__)
+    fsync(fd);
+#else
+    fdatasync(fd);
+#endif
 }
 
 int DiskManager::get_num_pages() {
-    cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Getting number of pages." << COLOR_RESET << endl;
-    db_file.clear();
-    db_file.seekg(0, ios::end);
-    streampos file_size = db_file.tellg();
-
-    if (file_size == -1) {
-        cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Failed to get file size." << COLOR_RESET << "\n";
-        return -1;
-    }
-    int num_pages = static_cast<int>(file_size / PAGE_SIZE);
-    cout << COLOR_SUCCESS << "[DEBUG][DISK_MANAGER] Number of pages: " << num_pages << COLOR_RESET << endl;
-    return num_pages;
+    return num_pages.load();
 }
 
 int DiskManager::allocate_page() {
     cout << COLOR_DEBUG << "[DEBUG][DISK_MANAGER] Allocating new page." << COLOR_RESET << endl;
-    int new_page_id = get_num_pages();
+    // Allocations are serialized; the new page only becomes visible through
+    // get_num_pages once it exists on disk and is covered by the mapping.
+    lock_guard<mutex> lock(alloc_mutex);
+    int new_page_id = num_pages.load();
 
-    vector<char> zero_page(PAGE_SIZE, 0);
-    if (!write_page(new_page_id, zero_page)) {
+    static const vector<char> zero_page(PAGE_SIZE, 0);
+    if (!write_at(zero_page.data(), PAGE_SIZE, static_cast<long long>(new_page_id) * PAGE_SIZE)) {
         cerr << COLOR_ERROR << "[DEBUG][DISK_MANAGER] [ERROR] Failed to write zero page for allocation." << COLOR_RESET << "\n";
         return -1;
     }
+    if (io_mode == IoMode::MMAP) {
+        grow_mapping(new_page_id + 1);
+    }
+    num_pages.store(new_page_id + 1);
 
     cout << COLOR_SUCCESS << "[DEBUG][DISK_MANAGER] Allocated new page with ID " << new_page_id << "." << COLOR_RESET << endl;
     return new_page_id;
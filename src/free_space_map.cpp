@@ -0,0 +1,146 @@
+#include "../include/free_space_map.h"
+#include <iostream>
+#include <cstring>
+
+#define FSM_DEBUG_PREFIX "[DEBUG][FREE_SPACE_MAP] "
+
+namespace {
+    const uint32_t FSM_MAGIC = 0x4D53464C; // "LFSM"
+    const int NUM_CATEGORIES = 256;
+
+    struct FsmHeader {
+        uint32_t magic;
+        uint32_t num_pages; // heap pages covered by the map
+    };
+}
+
+FreeSpaceMap::FreeSpaceMap(const string& fork_file)
+    : fork(fork_file), candidates(NUM_CATEGORIES) {
+    load();
+    std::cout << FSM_DEBUG_PREFIX << "Loaded free-space map " << fork_file << " covering "
+              << categories.size() << " heap pages." << std::endl;
+}
+
+FreeSpaceMap::~FreeSpaceMap() {
+    flush();
+}
+
+uint8_t FreeSpaceMap::category_for(int free_bytes) {
+    if (free_bytes <= 0) return 0;
+    int category = free_bytes / FSM_CATEGORY_STEP;
+    return static_cast<uint8_t>(category >= NUM_CATEGORIES ? NUM_CATEGORIES - 1 : category);
+}
+
+void FreeSpaceMap::load() {
+    vector<char> buf(PAGE_SIZE, 0);
+    if (!fork.read_page(0, buf.data())) {
+        return; // fresh fork: the owner fills it in
+    }
+
+    FsmHeader header;
+    memcpy(&header, buf.data(), sizeof(header));
+    if (header.magic != FSM_MAGIC) {
+        std::cout << FSM_DEBUG_PREFIX << "Free-space map has no header; it will be rebuilt." << std::endl;
+        return;
+    }
+
+    categories.assign(header.num_pages, 0);
+    for (uint32_t base = 0; base < header.num_pages; base += PAGE_SIZE) {
+        int fork_page = 1 + base / PAGE_SIZE;
+        if (!fork.read_page(fork_page, buf.data())) {
+            // Truncated fork; keep what we have and let the owner rebuild the rest.
+            categories.resize(base);
+            break;
+        }
+        uint32_t count = min<uint32_t>(PAGE_SIZE, header.num_pages - base);
+        memcpy(&categories[base], buf.data(), count);
+    }
+
+    candidate_slots.assign(categories.size(), -1);
+    for (int page_id = 0; page_id < (int)categories.size(); ++page_id) {
+        add_candidate(page_id);
+    }
+}
+
+void FreeSpaceMap::add_candidate(int page_id) {
+    uint8_t category = categories[page_id];
+    if (category == 0) return;
+    candidate_slots[page_id] = static_cast<int>(candidates[category].size());
+    candidates[category].push_back(page_id);
+}
+
+void FreeSpaceMap::remove_candidate(int page_id) {
+    int slot = candidate_slots[page_id];
+    if (slot < 0) return;
+    // The last page of the list takes the leaving page's place
+    vector<int>& list = candidates[categories[page_id]];
+    list[slot] = list.back();
+    candidate_slots[list[slot]] = slot;
+    list.pop_back();
+    candidate_slots[page_id] = -1;
+}
+
+int FreeSpaceMap::get_num_pages() {
+    lock_guard<mutex> guard(latch);
+    return static_cast<int>(categories.size());
+}
+
+int FreeSpaceMap::find_page(int needed_bytes) {
+    lock_guard<mutex> guard(latch);
+    int min_category = (needed_bytes + FSM_CATEGORY_STEP - 1) / FSM_CATEGORY_STEP;
+    if (min_category < 1) min_category = 1;
+
+    for (int category = min_category; category < NUM_CATEGORIES; ++category) {
+        if (!candidates[category].empty()) {
+            return candidates[category].back();
+        }
+    }
+    return -1;
+}
+
+void FreeSpaceMap::update(int page_id, int free_bytes) {
+    if (page_id < 0) return;
+    lock_guard<mutex> guard(latch);
+    if (page_id >= (int)categories.size()) {
+        categories.resize(page_id + 1, 0);
+        candidate_slots.resize(page_id + 1, -1);
+        dirty_fork_pages.insert(0); // header page count changed
+    }
+
+    uint8_t category = category_for(free_bytes);
+    if (categories[page_id] == category) return;
+
+    remove_candidate(page_id);
+    categories[page_id] = category;
+    add_candidate(page_id);
+    dirty_fork_pages.insert(1 + page_id / PAGE_SIZE);
+}
+
+void FreeSpaceMap::write_header() {
+    vector<char> buf(PAGE_SIZE, 0);
+    FsmHeader header{FSM_MAGIC, static_cast<uint32_t>(categories.size())};
+    memcpy(buf.data(), &header, sizeof(header));
+    while (fork.get_num_pages() < 1) fork.allocate_page();
+    fork.write_page(0, buf.data());
+}
+
+void FreeSpaceMap::flush() {
+    lock_guard<mutex> guard(latch);
+    if (dirty_fork_pages.empty()) return;
+
+    vector<char> buf(PAGE_SIZE);
+    for (int fork_page : dirty_fork_pages) {
+        if (fork_page == 0) continue;
+        size_t base = static_cast<size_t>(fork_page - 1) * PAGE_SIZE;
+        if (base >= categories.size()) continue;
+        size_t count = min<size_t>(PAGE_SIZE, categories.size() - base);
+        memset(buf.data(), 0, PAGE_SIZE);
+        memcpy(buf.data(), &categories[base], count);
+        while (fork.get_num_pages() <= fork_page) fork.allocate_page();
+        fork.write_page(fork_page, buf.data());
+    }
+    write_header();
+    fork.flush();
+    dirty_fork_pages.clear();
+    std::cout << FSM_DEBUG_PREFIX << "Flushed free-space map (" << categories.size() << " pages)." << std::endl;
+}
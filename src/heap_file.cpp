@@ -0,0 +1,30 @@
+#include "../include/heap_file.h"
+#include <cstdio>
+#include <iostream>
+
+#define HEAP_DEBUG_PREFIX "[DEBUG][HEAP_FILE] "
+
+HeapFile::HeapFile(const string& base_path, int id, BufferPoolManager& bpm, LogManager& lm, IoMode io_mode)
+    : buffer_pool(bpm), file_id(id), disk(base_path + ".db", io_mode),
+      free_space_map(base_path + ".fsm"), dropped(false) {
+    // The record manager reads (and possibly recovers) its pages right away,
+    // so the file has to be reachable through the pool first.
+    buffer_pool.attach_file(file_id, disk);
+    record_manager = make_unique<RecordManager>(buffer_pool, file_id, free_space_map, lm);
+    std::cout << HEAP_DEBUG_PREFIX << "Opened " << base_path << ".db as file " << file_id << "." << std::endl;
+}
+
+HeapFile::~HeapFile() {
+    record_manager.reset();
+    if (!buffer_pool.detach_file(file_id, !dropped)) {
+        std::cerr << "[ERROR][HEAP_FILE] Could not detach file " << file_id << " from the buffer pool." << std::endl;
+    }
+}
+
+void HeapFile::remove_files(const string& base_path) {
+    for (const string& path : {base_path + ".db", base_path + ".fsm"}) {
+        if (std::remove(path.c_str()) != 0) {
+            std::cerr << "[ERROR][HEAP_FILE] Could not remove " << path << "." << std::endl;
+        }
+    }
+}
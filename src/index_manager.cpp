@@ -7,12 +7,31 @@ using namespace std;
 
 #define DEBUG_INDEX_MANAGER(msg) cout << "[DEBUG][INDEX_MANAGER] " << msg << endl;
 
-IndexManager::IndexManager() {
+namespace {
+    // Stored in each index file: the column type the keys were built from.
+    // 0 is what files from before typed keys hold.
+    uint32_t key_format_of(DataType type) {
+        return 1 + static_cast<uint32_t>(type);
+    }
+
+    // Keys are binary; print them as hex.
+    string key_text(const string& key) {
+        static const char digits[] = "0123456789abcdef";
+        string text;
+        for (unsigned char c : key) {
+            text += digits[c >> 4];
+            text += digits[c & 0xF];
+        }
+        return text;
+    }
+}
+
+IndexManager::IndexManager(BufferPoolManager& bpm, LogManager& lm)
+    : buffer_pool(bpm), log_manager(lm), index_dir("data/" + CURRENT_DATABASE + "/indexes") {
     load_indexes();
 }
-// Destructor to clean up B+ trees
+// Destructor to clean up B+ trees; each one writes its dirty pages back
 IndexManager::~IndexManager() {
-    save_indexes();
     for (auto& table : indexes) {
         for (auto& column : table.second) {
             delete column.second;
@@ -20,6 +39,24 @@ IndexManager::~IndexManager() {
     }
 }
 
+string IndexManager::index_path(const string& table_name, const string& column_name) const {
+    return index_dir + "/" + table_name + "_" + column_name + ".bpt";
+}
+
+DiskBPlusTree* IndexManager::find_index(const string& table_name, const string& column_name) {
+    auto table_it = indexes.find(table_name);
+    if (table_it == indexes.end()) {
+        DEBUG_INDEX_MANAGER("Table not found in indexes");
+        return nullptr;
+    }
+    auto col_it = table_it->second.find(column_name);
+    if (col_it == table_it->second.end()) {
+        DEBUG_INDEX_MANAGER("Column index not found");
+        return nullptr;
+    }
+    return col_it->second;
+}
+
 bool IndexManager::column_exists(const string& table_name, const string& column_name) {
     DEBUG_INDEX_MANAGER("Checking if column '" << column_name << "' exists in table '" << table_name << "'");
     auto table_it = indexes.find(table_name);
@@ -33,9 +70,20 @@ bool IndexManager::column_exists(const string& table_name, const string& column_
     return exists;
 }
 
+vector<string> IndexManager::indexed_columns(const string& table_name) {
+    vector<string> columns;
+    auto table_it = indexes.find(table_name);
+    if (table_it != indexes.end()) {
+        for (const auto& [column_name, _] : table_it->second) {
+            columns.push_back(column_name);
+        }
+    }
+    return columns;
+}
+
 // Create index
-bool IndexManager::create_index(const string& table_name, const string& column_name) {
-    DEBUG_INDEX_MANAGER("Creating index on table '" << table_name << "', column '" << column_name << "'");
+bool IndexManager::create_index(const string& table_name, const string& column_name, DataType key_type) {
+    DEBUG_INDEX_MANAGER("Creating " << to_string(key_type) << " index on table '" << table_name << "', column '" << column_name << "'");
     
     // Check if index already exists
     if (indexes[table_name].find(column_name) != indexes[table_name].end()) {
@@ -43,8 +91,10 @@ bool IndexManager::create_index(const string& table_name, const string& column_n
         return false;
     }
     
-    indexes[table_name][column_name] = new BPlusTree<string, set<int>>();
-    DEBUG_INDEX_MANAGER("Index created successfully");
+    fs::create_directories(index_dir);
+    DiskBPlusTree* tree = new DiskBPlusTree(index_path(table_name, column_name), next_file_id++, key_format_of(key_type), buffer_pool, log_manager);
+    indexes[table_name][column_name] = tree;
+    DEBUG_INDEX_MANAGER("Index created successfully as file " << tree->get_file_id());
     return true;
 }
 
@@ -56,11 +106,18 @@ bool IndexManager::drop_index(const string& table_name, const string& column_nam
     if (table_it != indexes.end()) {
         auto col_it = table_it->second.find(column_name);
         if (col_it != table_it->second.end()) {
+            col_it->second->mark_dropped();
             delete col_it->second; // Clean up B+ tree
             table_it->second.erase(col_it);
             if (table_it->second.empty()) {
                 indexes.erase(table_it);
             }
+            // Its records stay in the log until the next checkpoint. File ids
+            // only grow within a run, and a new index file replays nothing,
+            // so none of them can reach a later index with the same id.
+            log_manager.request_checkpoint();
+            std::error_code ec;
+            fs::remove(index_path(table_name, column_name), ec);
             DEBUG_INDEX_MANAGER("Index dropped successfully");
             return true;
         }
@@ -71,131 +128,61 @@ bool IndexManager::drop_index(const string& table_name, const string& column_nam
 
 // Insert entry
 bool IndexManager::insert_entry(const string& table_name, const string& column_name, const string& key, int record_id) {
-    DEBUG_INDEX_MANAGER("Inserting entry: table='" << table_name << "', column='" << column_name << "', key='" << key << "', record_id=" << record_id);
+    DEBUG_INDEX_MANAGER("Inserting entry: table='" << table_name << "', column='" << column_name << "', key=" << key_text(key) << ", record_id=" << record_id);
     
-    auto table_it = indexes.find(table_name);
-    if (table_it == indexes.end()) {
-        DEBUG_INDEX_MANAGER("Table not found in indexes");
+    DiskBPlusTree* btree = find_index(table_name, column_name);
+    if (!btree || !btree->insert(key, record_id)) {
         return false;
     }
     
-    auto col_it = table_it->second.find(column_name);
-    if (col_it == table_it->second.end()) {
-        DEBUG_INDEX_MANAGER("Column index not found");
-        return false;
-    }
-    
-    BPlusTree<string, set<int>>* btree = col_it->second;
-    
-    // Search for existing entry
-    vector<set<int>> existing = btree->search(key);
-    set<int> record_set;
-    
-    if (!existing.empty()) {
-        record_set = existing[0]; // Get the existing set
-    }
-    
-    record_set.insert(record_id);
-    btree->insert(key, record_set); // Insert/update the set
-    
     DEBUG_INDEX_MANAGER("Entry inserted successfully");
     return true;
 }
 
 // Delete entry
 bool IndexManager::delete_entry(const string& table_name, const string& column_name, const string& key, int record_id) {
-    DEBUG_INDEX_MANAGER("Deleting entry: table='" << table_name << "', column='" << column_name << "', key='" << key << "', record_id=" << record_id);
-    
-    auto table_it = indexes.find(table_name);
-    if (table_it == indexes.end()) {
-        DEBUG_INDEX_MANAGER("Table not found in indexes");
-        return false;
-    }
+    DEBUG_INDEX_MANAGER("Deleting entry: table='" << table_name << "', column='" << column_name << "', key=" << key_text(key) << ", record_id=" << record_id);
     
-    auto col_it = table_it->second.find(column_name);
-    if (col_it == table_it->second.end()) {
-        DEBUG_INDEX_MANAGER("Column index not found");
+    DiskBPlusTree* btree = find_index(table_name, column_name);
+    if (!btree) {
         return false;
     }
-    
-    BPlusTree<string, set<int>>* btree = col_it->second;
-    
-    // Search for existing entry
-    vector<set<int>> existing = btree->search(key);
-    if (existing.empty()) {
+    if (!btree->remove(key, record_id)) {
         DEBUG_INDEX_MANAGER("Key not found in index");
         return false;
     }
     
-    set<int> record_set = existing[0];
-    record_set.erase(record_id);
-    
-    if (record_set.empty()) {
-        btree->remove(key, existing[0]); // Remove the entire entry
-        DEBUG_INDEX_MANAGER("Key '" << key << "' erased from index as it became empty");
-    } else {
-        btree->insert(key, record_set); // Update with new set
-    }
-    
     DEBUG_INDEX_MANAGER("Entry deleted successfully");
     return true;
 }
 
 // Search by key
-vector<int> IndexManager::search(const string& table_name, const string& column_name, const string& key) {
-    DEBUG_INDEX_MANAGER("Searching for key '" << key << "' in table '" << table_name << "', column '" << column_name << "'");
-    vector<int> result;
+PostingList IndexManager::search(const string& table_name, const string& column_name, const string& key) {
+    DEBUG_INDEX_MANAGER("Searching for key " << key_text(key) << " in table '" << table_name << "', column '" << column_name << "'");
+    PostingList result;
     
-    auto table_it = indexes.find(table_name);
-    if (table_it == indexes.end()) {
-        DEBUG_INDEX_MANAGER("Table not found in indexes");
+    DiskBPlusTree* btree = find_index(table_name, column_name);
+    if (!btree) {
         return result;
     }
     
-    auto col_it = table_it->second.find(column_name);
-    if (col_it == table_it->second.end()) {
-        DEBUG_INDEX_MANAGER("Column index not found");
-        return result;
-    }
-    
-    BPlusTree<string, set<int>>* btree = col_it->second;
-    vector<set<int>> search_result = btree->search(key);
-    
-    if (!search_result.empty()) {
-        const set<int>& record_set = search_result[0];
-        result.assign(record_set.begin(), record_set.end());
-    }
+    result = btree->search(key);
     
     DEBUG_INDEX_MANAGER("Search found " << result.size() << " record(s)");
     return result;
 }
 
 // Range search
-vector<int> IndexManager::range_search(const string& table_name, const string& column_name, const string& start_key, const string& end_key) {
-    DEBUG_INDEX_MANAGER("Range search: table='" << table_name << "', column='" << column_name << "', start_key='" << start_key << "', end_key='" << end_key << "'");
-    vector<int> result;
-    
-    auto table_it = indexes.find(table_name);
-    if (table_it == indexes.end()) {
-        DEBUG_INDEX_MANAGER("Table not found in indexes");
-        return result;
-    }
+PostingList IndexManager::range_search(const string& table_name, const string& column_name, const string& start_key, const string& end_key, bool end_inclusive) {
+    DEBUG_INDEX_MANAGER("Range search: table='" << table_name << "', column='" << column_name << "', start_key=" << key_text(start_key) << ", end_key=" << key_text(end_key) << (end_inclusive ? " inclusive" : " exclusive"));
+    PostingList result;
     
-    auto col_it = table_it->second.find(column_name);
-    if (col_it == table_it->second.end()) {
-        DEBUG_INDEX_MANAGER("Column index not found");
+    DiskBPlusTree* btree = find_index(table_name, column_name);
+    if (!btree) {
         return result;
     }
     
-    BPlusTree<string, set<int>>* btree = col_it->second;
-    vector<set<int>> range_result = btree->range_search(start_key, end_key);
-    
-    set<int> unique_records; // Use set to avoid duplicates
-    for (const auto& record_set : range_result) {
-        unique_records.insert(record_set.begin(), record_set.end());
-    }
-    
-    result.assign(unique_records.begin(), unique_records.end());
+    result = btree->range_search(start_key, end_key, end_inclusive);
     
     DEBUG_INDEX_MANAGER("Range search found " << result.size() << " record(s)");
     return result;
@@ -203,89 +190,77 @@ vector<int> IndexManager::range_search(const string& table_name, const string& c
 
 
 
-void IndexManager::save_indexes() {
-    if (CURRENT_DATABASE.empty()) {
-        cerr << "[ERROR] No database selected. Cannot save indexes." << endl;
-        return;
-    }
-
-    string dir = "data/" + CURRENT_DATABASE + "/indexes";
-    DEBUG_INDEX_MANAGER("Saving indexes to " << dir);
-    fs::create_directories(dir); // create database/indexes folder
-
-    for (const auto& [table_name, columns] : indexes) {
-        for (const auto& [column_name, btree] : columns) {
-            string filename = dir + "/" + table_name + "_" + column_name + ".idx";
-            ofstream out(filename);
-
-            if (!out.is_open()) {
-                cerr << "[ERROR] Could not open " << filename << " for writing." << endl;
-                continue;
-            }
-
-            auto leaf = btree->get_leftmost_leaf();
-            while (leaf) {
-                for (size_t i = 0; i < leaf->keys.size(); ++i) {
-                    out << leaf->keys[i] << "|";
-                    for (auto it = leaf->values[i].begin(); it != leaf->values[i].end(); ++it) {
-                        if (it != leaf->values[i].begin()) out << ",";
-                        out << *it;
-                    }
-                    out << "\n";
-                }
-                leaf = leaf->next;
-            }
-
-            out.close();
-            DEBUG_INDEX_MANAGER("Saved index " << filename);
-        }
-    }
-}
-
 void IndexManager::load_indexes() {
     if (CURRENT_DATABASE.empty()) {
         cerr << "[ERROR] No database selected. Cannot load indexes." << endl;
         return;
     }
 
-    string dir = "data/" + CURRENT_DATABASE + "/indexes";
-    DEBUG_INDEX_MANAGER("Loading indexes from " << dir);
-
-    if (!fs::exists(dir)) return;
+    DEBUG_INDEX_MANAGER("Opening indexes in " << index_dir);
+    if (!fs::exists(index_dir)) return;
 
-    for (const auto& entry : fs::directory_iterator(dir)) {
+    vector<fs::path> legacy;
+    for (const auto& entry : fs::directory_iterator(index_dir)) {
         string filename = entry.path().filename().string();
-        if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".idx") == 0) {
-            string name = filename.substr(0, filename.size() - 4);
-            size_t pos = name.find('_');
-
-            if (pos == string::npos) continue;
-
-            string table = name.substr(0, pos);
-            string column = name.substr(pos + 1);
-
-            BPlusTree<string, set<int>>* tree = new BPlusTree<string, set<int>>();
-            ifstream in(entry.path());
-            string line;
-            while (getline(in, line)) {
-                size_t sep = line.find('|');
-                if (sep == string::npos) continue;
+        string extension = entry.path().extension().string();
+        if (extension == ".idx") {
+            // Text dump written by earlier versions on shutdown.
+            legacy.push_back(entry.path());
+            continue;
+        }
+        if (extension != ".bpt") continue;
 
-                string key = line.substr(0, sep);
-                string ids_str = line.substr(sep + 1);
-                set<int> ids;
+        string name = entry.path().stem().string();
+        size_t pos = name.find('_');
+        if (pos == string::npos) continue;
 
-                stringstream ss(ids_str);
-                string id;
-                while (getline(ss, id, ',')) {
-                    ids.insert(stoi(id));
-                }
+        string table = name.substr(0, pos);
+        string column = name.substr(pos + 1);
 
-                tree->insert(key, ids);
+        try {
+            DiskBPlusTree* tree = new DiskBPlusTree(entry.path().string(), next_file_id, 0, buffer_pool, log_manager);
+            next_file_id = max(next_file_id, tree->get_file_id() + 1);
+            if (tree->get_key_format() == 0 || tree->has_old_layout()) {
+                // Keys stored as text, which orders 10 before 9, or nodes
+                // without key hints.
+                DEBUG_INDEX_MANAGER("Index " << table << "." << column << " was written by an older version; it will be rebuilt");
+                delete tree;
+                legacy.push_back(entry.path());
+                continue;
             }
-
             indexes[table][column] = tree;
-            DEBUG_INDEX_MANAGER("Loaded index: " << table << "." << column);
+            DEBUG_INDEX_MANAGER("Opened index: " << table << "." << column);
+        } catch (const exception& e) {
+            cerr << "[ERROR][INDEX_MANAGER] " << e.what() << "; the index will be rebuilt." << endl;
+            legacy.push_back(entry.path());
         }
     }
+
+    // The tables are the source of truth: drop what cannot be opened and
+    // recreate it from the rows once the catalog is loaded. The column type
+    // is not known here; the rebuild recreates the index with it.
+    for (const fs::path& path : legacy) {
+        string name = path.stem().string();
+        size_t pos = name.find('_');
+        std::error_code ec;
+        fs::remove(path, ec);
+        if (pos == string::npos) continue;
+        string table = name.substr(0, pos);
+        string column = name.substr(pos + 1);
+        if (!column_exists(table, column)) {
+            create_index(table, column, DataType::UNKNOWN);
+        }
+        rebuild_needed = true;
+    }
+}
+
+bool IndexManager::scan_ordered(const string& table_name, const string& column_name, IndexCursor& cursor, bool descending, size_t max_entries, vector<int>& record_ids) {
+    DiskBPlusTree* btree = find_index(table_name, column_name);
+    if (!btree) {
+        return false;
+    }
+    size_t before = record_ids.size();
+    btree->scan_ordered(cursor, descending, max_entries, record_ids);
+    DEBUG_INDEX_MANAGER("Ordered walk on " << table_name << "." << column_name << (descending ? " descending" : "") << " read " << record_ids.size() - before << " entries");
+    return true;
 }
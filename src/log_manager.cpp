@@ -0,0 +1,430 @@
+#include "../include/log_manager.h"
+#include "../include/disk_manager.h"
+#include <iostream>
+#include <stdexcept>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define LOG_DEBUG_PREFIX "[DEBUG][LOG_MANAGER] "
+
+namespace {
+    const uint32_t LOG_MAGIC = 0x4C41574C; // "LWAL"
+    const uint32_t LOG_VERSION = 2;
+    const int LOG_HEADER_SIZE = 16;        // magic, version, base LSN
+    // size, checksum, lsn, type + 3 pad, file_id, page_id, slot_id, before_len, after_len
+    const int LOG_RECORD_HEADER_SIZE = 40;
+
+    struct Crc32Table {
+        uint32_t entries[256];
+        Crc32Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[i] = c;
+            }
+        }
+    };
+
+    uint32_t crc32(const char* data, size_t len) {
+        static const Crc32Table table;
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < len; ++i) {
+            crc = table.entries[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    template <typename T>
+    void put(vector<char>& out, size_t& pos, T value) {
+        memcpy(&out[pos], &value, sizeof(T));
+        pos += sizeof(T);
+    }
+
+    template <typename T>
+    T get(const char* in, size_t& pos) {
+        T value;
+        memcpy(&value, in + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    vector<char> serialize(const LogRecord& record) {
+        uint32_t total = LOG_RECORD_HEADER_SIZE + record.before.size() + record.after.size();
+        vector<char> out(total, 0);
+        size_t pos = 0;
+        put<uint32_t>(out, pos, total);
+        put<uint32_t>(out, pos, 0); // checksum, filled in below
+        put<uint64_t>(out, pos, record.lsn);
+        put<uint8_t>(out, pos, static_cast<uint8_t>(record.type));
+        pos += 3;
+        put<int32_t>(out, pos, record.file_id);
+        put<int32_t>(out, pos, record.page_id);
+        put<int32_t>(out, pos, record.slot_id);
+        put<uint32_t>(out, pos, static_cast<uint32_t>(record.before.size()));
+        put<uint32_t>(out, pos, static_cast<uint32_t>(record.after.size()));
+        if (!record.before.empty()) memcpy(&out[pos], record.before.data(), record.before.size());
+        pos += record.before.size();
+        if (!record.after.empty()) memcpy(&out[pos], record.after.data(), record.after.size());
+
+        uint32_t checksum = crc32(out.data() + 8, total - 8);
+        memcpy(&out[4], &checksum, sizeof(checksum));
+        return out;
+    }
+
+    // Parses the record at buf[0..available). Returns its size, or 0 if the
+    // bytes are not an intact record for expected_lsn (torn or missing tail).
+    size_t deserialize(const char* buf, size_t available, lsn_t expected_lsn, LogRecord& record) {
+        if (available < (size_t)LOG_RECORD_HEADER_SIZE) return 0;
+        size_t pos = 0;
+        uint32_t total = get<uint32_t>(buf, pos);
+        uint32_t checksum = get<uint32_t>(buf, pos);
+        if (total < (uint32_t)LOG_RECORD_HEADER_SIZE || total > available) return 0;
+        if (crc32(buf + 8, total - 8) != checksum) return 0;
+
+        record.lsn = get<uint64_t>(buf, pos);
+        if (record.lsn != expected_lsn) return 0;
+        record.type = static_cast<LogRecordType>(get<uint8_t>(buf, pos));
+        pos += 3;
+        record.file_id = get<int32_t>(buf, pos);
+        record.page_id = get<int32_t>(buf, pos);
+        record.slot_id = get<int32_t>(buf, pos);
+        uint32_t before_len = get<uint32_t>(buf, pos);
+        uint32_t after_len = get<uint32_t>(buf, pos);
+        if (LOG_RECORD_HEADER_SIZE + before_len + after_len != total) return 0;
+        record.before.assign(buf + pos, buf + pos + before_len);
+        pos += before_len;
+        record.after.assign(buf + pos, buf + pos + after_len);
+        return total;
+    }
+
+    bool write_fully(int fd, const char* buf, size_t count, long long offset) {
+        size_t done = 0;
+#ifdef _WIN32
+        if (_lseeki64(fd, offset, SEEK_SET) < 0) return false;
+#endif
+        while (done < count) {
+#ifdef _WIN32
+            int n = _write(fd, buf + done, static_cast<unsigned>(count - done));
+#else
+            ssize_t n = ::pwrite(fd, buf + done, count - done, offset + done);
+#endif
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            done += n;
+        }
+        return true;
+    }
+
+    vector<char> read_file(int fd) {
+        struct stat st;
+        vector<char> contents;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) return contents;
+        contents.resize(st.st_size);
+        size_t done = 0;
+#ifdef _WIN32
+        _lseeki64(fd, 0, SEEK_SET);
+#endif
+        while (done < contents.size()) {
+#ifdef _WIN32
+            int n = _read(fd, contents.data() + done, static_cast<unsigned>(contents.size() - done));
+#else
+            ssize_t n = ::pread(fd, contents.data() + done, contents.size() - done, done);
+#endif
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += n;
+        }
+        contents.resize(done);
+        return contents;
+    }
+
+    void sync_fd(int fd) {
+#ifdef _WIN32
+        _commit(fd);
+#elif defined(__APPLE__)
+        fsync(fd);
+#else
+        fdatasync(fd);
+#endif
+    }
+
+    bool truncate_fd(int fd, long long size) {
+#ifdef _WIN32
+        return _chsize_s(fd, size) == 0;
+#else
+        return ftruncate(fd, size) == 0;
+#endif
+    }
+}
+
+lsn_t get_page_lsn(const char* page) {
+    lsn_t lsn;
+    memcpy(&lsn, page + PAGE_LSN_OFFSET, sizeof(lsn));
+    return lsn;
+}
+
+void set_page_lsn(char* page, lsn_t lsn) {
+    memcpy(page + PAGE_LSN_OFFSET, &lsn, sizeof(lsn));
+}
+
+void diff_page(const char* before, const char* after, vector<char>& out) {
+    // Unchanged gaps shorter than a run header are cheaper to copy than to skip.
+    const int RUN_HEADER_SIZE = 2 * sizeof(uint16_t);
+    out.clear();
+    int pos = 0;
+    while (pos < PAGE_SIZE) {
+        while (pos < PAGE_SIZE && before[pos] == after[pos]) pos++;
+        if (pos == PAGE_SIZE) break;
+
+        int start = pos, end = pos;
+        while (pos < PAGE_SIZE) {
+            if (before[pos] != after[pos]) {
+                end = ++pos;
+            } else if (pos - end >= RUN_HEADER_SIZE) {
+                break;
+            } else {
+                pos++;
+            }
+        }
+
+        uint16_t offset = static_cast<uint16_t>(start), length = static_cast<uint16_t>(end - start);
+        size_t at = out.size();
+        out.resize(at + RUN_HEADER_SIZE + length);
+        memcpy(&out[at], &offset, sizeof(offset));
+        memcpy(&out[at + sizeof(offset)], &length, sizeof(length));
+        memcpy(&out[at + RUN_HEADER_SIZE], after + start, length);
+    }
+}
+
+void apply_page_diff(char* page, const vector<char>& diff) {
+    size_t pos = 0;
+    while (pos + 2 * sizeof(uint16_t) <= diff.size()) {
+        uint16_t offset, length;
+        memcpy(&offset, &diff[pos], sizeof(offset));
+        memcpy(&length, &diff[pos + sizeof(offset)], sizeof(length));
+        pos += 2 * sizeof(uint16_t);
+        if (pos + length > diff.size() || offset + length > PAGE_SIZE) return;
+        memcpy(page + offset, &diff[pos], length);
+        pos += length;
+    }
+}
+
+LogManager::LogManager(const string& log_file, unsigned group_commit_us)
+    : fd(-1), file_name(log_file), group_commit_us(group_commit_us),
+      base_lsn(LOG_HEADER_SIZE), next_lsn(LOG_HEADER_SIZE), durable_lsn(LOG_HEADER_SIZE),
+      last_commit_lsn(LOG_HEADER_SIZE), flush_requested(false), flushing(false), stop(false),
+      recovery_needed(false) {
+    fd = ::open(log_file.c_str(), O_RDWR | O_CREAT | O_BINARY, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("[ERROR][LOG_MANAGER] Failed to open " + log_file + ": " + strerror(errno));
+    }
+    open_log();
+    flusher = thread(&LogManager::flusher_loop, this);
+    std::cout << LOG_DEBUG_PREFIX << "Opened " << log_file << " (next LSN " << next_lsn << ", "
+              << (recovery_needed ? "recovery needed" : "clean") << ")." << std::endl;
+}
+
+LogManager::~LogManager() {
+    {
+        lock_guard<mutex> lock(latch);
+        stop = true;
+    }
+    flush_cv.notify_one();
+    flusher.join();
+    ::close(fd);
+}
+
+long long LogManager::file_offset(lsn_t lsn) const {
+    return LOG_HEADER_SIZE + static_cast<long long>(lsn - base_lsn);
+}
+
+bool LogManager::write_header(lsn_t base) {
+    vector<char> header(LOG_HEADER_SIZE, 0);
+    size_t pos = 0;
+    put<uint32_t>(header, pos, LOG_MAGIC);
+    put<uint32_t>(header, pos, LOG_VERSION);
+    put<uint64_t>(header, pos, base);
+    return write_fully(fd, header.data(), header.size(), 0);
+}
+
+// Reads the header and finds the end of the intact prefix of the log. A torn
+// tail left by a crash in the middle of a write is cut off so new records
+// are appended right after the last good one.
+void LogManager::open_log() {
+    vector<char> contents = read_file(fd);
+
+    size_t pos = 0;
+    if (contents.size() >= (size_t)LOG_HEADER_SIZE && get<uint32_t>(contents.data(), pos) == LOG_MAGIC) {
+        uint32_t version = get<uint32_t>(contents.data(), pos);
+        base_lsn = get<uint64_t>(contents.data(), pos);
+        if (version != LOG_VERSION) {
+            // Records in another layout cannot be replayed; keep the LSN base.
+            std::cerr << "[ERROR][LOG_MANAGER] " << file_name << " has log version " << version
+                      << "; discarding its records." << std::endl;
+            truncate_fd(fd, 0);
+            write_header(base_lsn);
+            sync_fd(fd);
+            contents.clear();
+        }
+    } else {
+        if (!contents.empty()) {
+            std::cerr << "[ERROR][LOG_MANAGER] " << file_name << " has no valid header; starting a new log." << std::endl;
+        }
+        base_lsn = LOG_HEADER_SIZE;
+        truncate_fd(fd, 0);
+        write_header(base_lsn);
+        sync_fd(fd);
+        contents.clear();
+    }
+
+    lsn_t lsn = base_lsn;
+    size_t offset = LOG_HEADER_SIZE;
+    LogRecord record;
+    while (offset < contents.size()) {
+        size_t len = deserialize(contents.data() + offset, contents.size() - offset, lsn, record);
+        if (len == 0) break;
+        offset += len;
+        lsn += len;
+    }
+    if (offset < contents.size()) {
+        std::cout << LOG_DEBUG_PREFIX << "Discarding " << contents.size() - offset << " bytes of torn log tail." << std::endl;
+        truncate_fd(fd, offset);
+        sync_fd(fd);
+    }
+
+    next_lsn = durable_lsn = last_commit_lsn = lsn;
+    recovery_needed = lsn > base_lsn;
+}
+
+void LogManager::replay(const function<void(const LogRecord&)>& apply) {
+    vector<char> contents = read_file(fd);
+    lsn_t lsn = base_lsn;
+    size_t offset = LOG_HEADER_SIZE;
+    LogRecord record;
+    size_t count = 0;
+    while (offset < contents.size() && lsn < durable_lsn) {
+        size_t len = deserialize(contents.data() + offset, contents.size() - offset, lsn, record);
+        if (len == 0) break;
+        apply(record);
+        offset += len;
+        lsn += len;
+        count++;
+    }
+    std::cout << LOG_DEBUG_PREFIX << "Replayed " << count << " log records." << std::endl;
+}
+
+lsn_t LogManager::append(LogRecord& record) {
+    lock_guard<mutex> lock(latch);
+    record.lsn = next_lsn;
+    vector<char> bytes = serialize(record);
+    log_buffer.insert(log_buffer.end(), bytes.begin(), bytes.end());
+    next_lsn += bytes.size();
+    return record.lsn;
+}
+
+void LogManager::flush_to(lsn_t lsn) {
+    unique_lock<mutex> lock(latch);
+    lsn_t target = min(lsn + 1, next_lsn);
+    if (durable_lsn >= target) return;
+    flush_requested = true;
+    flush_cv.notify_one();
+    durable_cv.wait(lock, [&] { return durable_lsn >= target; });
+}
+
+void LogManager::commit() {
+    lsn_t lsn;
+    {
+        lock_guard<mutex> lock(latch);
+        if (next_lsn == last_commit_lsn) return;
+    }
+    LogRecord record;
+    record.type = LogRecordType::COMMIT;
+    lsn = append(record);
+    {
+        lock_guard<mutex> lock(latch);
+        last_commit_lsn = next_lsn;
+    }
+    flush_to(lsn);
+}
+
+void LogManager::flusher_loop() {
+    unique_lock<mutex> lock(latch);
+    while (true) {
+        flush_cv.wait(lock, [&] { return stop || flush_requested; });
+        if (!stop && group_commit_us > 0) {
+            // Give concurrent committers a moment to join this sync.
+            flush_cv.wait_for(lock, chrono::microseconds(group_commit_us), [&] { return stop; });
+        }
+        flush_requested = false;
+
+        if (log_buffer.empty()) {
+            durable_cv.notify_all();
+            if (stop) break;
+            continue;
+        }
+
+        vector<char> batch;
+        batch.swap(log_buffer);
+        lsn_t start = durable_lsn;
+        lsn_t end = next_lsn;
+        flushing = true;
+        lock.unlock();
+
+        bool ok = write_fully(fd, batch.data(), batch.size(), file_offset(start));
+        if (ok) sync_fd(fd);
+
+        lock.lock();
+        flushing = false;
+        if (!ok) {
+            // Commits cannot be acknowledged without their log records.
+            std::cerr << "[ERROR][LOG_MANAGER] Write to " << file_name << " failed: " << strerror(errno) << std::endl;
+            std::abort();
+        }
+        durable_lsn = end;
+        durable_cv.notify_all();
+    }
+}
+
+void LogManager::checkpoint() {
+    unique_lock<mutex> lock(latch);
+    if (!log_buffer.empty() || flushing) {
+        flush_requested = true;
+        flush_cv.notify_one();
+        durable_cv.wait(lock, [&] { return log_buffer.empty() && !flushing; });
+    }
+
+    // The old records are no longer needed; keep counting from where they ended.
+    base_lsn = next_lsn;
+    last_commit_lsn = next_lsn;
+    if (!write_header(base_lsn) || !truncate_fd(fd, LOG_HEADER_SIZE)) {
+        std::cerr << "[ERROR][LOG_MANAGER] Failed to reset " << file_name << " at checkpoint." << std::endl;
+        return;
+    }
+    sync_fd(fd);
+    recovery_needed = false;
+    checkpoint_requested = false;
+    std::cout << LOG_DEBUG_PREFIX << "Checkpoint at LSN " << base_lsn << "." << std::endl;
+}
+
+lsn_t LogManager::size() {
+    lock_guard<mutex> lock(latch);
+    return next_lsn - base_lsn;
+}
+
+lsn_t LogManager::current_lsn() {
+    lock_guard<mutex> lock(latch);
+    return next_lsn;
+}
@@ -0,0 +1,251 @@
+#include "../include/posting_list.h"
+#include <algorithm>
+#include <iterator>
+
+bool PostingList::Container::contains(uint16_t low) const {
+    if (is_bitmap()) return (bitmap[low >> 6] >> (low & 63)) & 1;
+    return binary_search(array.begin(), array.end(), low);
+}
+
+bool PostingList::Container::add(uint16_t low) {
+    if (is_bitmap()) {
+        uint64_t mask = 1ULL << (low & 63);
+        if (bitmap[low >> 6] & mask) return false;
+        bitmap[low >> 6] |= mask;
+        cardinality++;
+        return true;
+    }
+    // Ids usually arrive in ascending order.
+    if (array.empty() || array.back() < low) {
+        array.push_back(low);
+    } else {
+        auto it = lower_bound(array.begin(), array.end(), low);
+        if (*it == low) return false;
+        array.insert(it, low);
+    }
+    cardinality++;
+    if (cardinality > ARRAY_LIMIT) to_bitmap();
+    return true;
+}
+
+bool PostingList::Container::remove(uint16_t low) {
+    if (is_bitmap()) {
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(bitmap[low >> 6] & mask)) return false;
+        bitmap[low >> 6] &= ~mask;
+        cardinality--;
+        if (cardinality <= ARRAY_LIMIT) to_array();
+        return true;
+    }
+    auto it = lower_bound(array.begin(), array.end(), low);
+    if (it == array.end() || *it != low) return false;
+    array.erase(it);
+    cardinality--;
+    return true;
+}
+
+void PostingList::Container::to_bitmap() {
+    if (is_bitmap()) return;
+    bitmap.assign(BITMAP_WORDS, 0);
+    for (uint16_t low : array) {
+        bitmap[low >> 6] |= 1ULL << (low & 63);
+    }
+    vector<uint16_t>().swap(array);
+}
+
+void PostingList::Container::to_array() {
+    if (!is_bitmap()) return;
+    array.clear();
+    array.reserve(cardinality);
+    for (uint32_t word = 0; word < BITMAP_WORDS; ++word) {
+        uint64_t bits = bitmap[word];
+        while (bits) {
+            array.push_back(static_cast<uint16_t>(word * 64 + countr_zero(bits)));
+            bits &= bits - 1;
+        }
+    }
+    vector<uint64_t>().swap(bitmap);
+}
+
+void PostingList::Container::normalize() {
+    if (cardinality > ARRAY_LIMIT) to_bitmap();
+    else to_array();
+}
+
+PostingList::PostingList(const vector<int>& ids) {
+    for (int id : ids) add(id);
+}
+
+PostingList::Container* PostingList::find_container(uint16_t key) {
+    auto it = lower_bound(containers.begin(), containers.end(), key,
+                          [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != containers.end() && it->key == key ? &*it : nullptr;
+}
+
+const PostingList::Container* PostingList::find_container(uint16_t key) const {
+    return const_cast<PostingList*>(this)->find_container(key);
+}
+
+bool PostingList::add(int id) {
+    uint32_t value = static_cast<uint32_t>(id);
+    uint16_t key = static_cast<uint16_t>(value >> 16);
+
+    Container* container = nullptr;
+    if (!containers.empty() && containers.back().key == key) {
+        container = &containers.back();
+    } else if (containers.empty() || containers.back().key < key) {
+        containers.push_back(Container{key});
+        container = &containers.back();
+    } else {
+        auto it = lower_bound(containers.begin(), containers.end(), key,
+                              [](const Container& c, uint16_t k) { return c.key < k; });
+        if (it == containers.end() || it->key != key) {
+            it = containers.insert(it, Container{key});
+        }
+        container = &*it;
+    }
+
+    if (!container->add(static_cast<uint16_t>(value))) return false;
+    count++;
+    return true;
+}
+
+bool PostingList::remove(int id) {
+    uint32_t value = static_cast<uint32_t>(id);
+    Container* container = find_container(static_cast<uint16_t>(value >> 16));
+    if (!container || !container->remove(static_cast<uint16_t>(value))) return false;
+    count--;
+    if (container->cardinality == 0) {
+        containers.erase(containers.begin() + (container - containers.data()));
+    }
+    return true;
+}
+
+bool PostingList::contains(int id) const {
+    uint32_t value = static_cast<uint32_t>(id);
+    const Container* container = find_container(static_cast<uint16_t>(value >> 16));
+    return container && container->contains(static_cast<uint16_t>(value));
+}
+
+void PostingList::clear() {
+    containers.clear();
+    count = 0;
+}
+
+bool PostingList::Cursor::next(int& id) {
+    while (container < list->containers.size()) {
+        const Container& current = list->containers[container];
+        uint32_t high = static_cast<uint32_t>(current.key) << 16;
+        if (!current.is_bitmap()) {
+            if (position < current.array.size()) {
+                id = static_cast<int>(high | current.array[position++]);
+                return true;
+            }
+        } else {
+            while (position < 65536) {
+                // Bits below position in its word have been returned already.
+                uint64_t bits = current.bitmap[position / 64] >> (position % 64);
+                if (bits) {
+                    position += countr_zero(bits);
+                    id = static_cast<int>(high | position++);
+                    return true;
+                }
+                position = (position / 64 + 1) * 64;
+            }
+        }
+        container++;
+        position = 0;
+    }
+    return false;
+}
+
+vector<int> PostingList::to_vector() const {
+    vector<int> ids;
+    ids.reserve(count);
+    for_each([&](int id) { ids.push_back(id); });
+    return ids;
+}
+
+PostingList::Container PostingList::intersect(const Container& a, const Container& b) {
+    Container result{a.key};
+    if (a.is_bitmap() && b.is_bitmap()) {
+        result.bitmap.resize(BITMAP_WORDS);
+        for (uint32_t word = 0; word < BITMAP_WORDS; ++word) {
+            result.bitmap[word] = a.bitmap[word] & b.bitmap[word];
+            result.cardinality += popcount(result.bitmap[word]);
+        }
+        result.normalize();
+    } else if (a.is_bitmap() || b.is_bitmap()) {
+        const Container& array_side = a.is_bitmap() ? b : a;
+        const Container& bitmap_side = a.is_bitmap() ? a : b;
+        for (uint16_t low : array_side.array) {
+            if (bitmap_side.contains(low)) result.array.push_back(low);
+        }
+        result.cardinality = result.array.size();
+    } else {
+        set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                         back_inserter(result.array));
+        result.cardinality = result.array.size();
+    }
+    return result;
+}
+
+PostingList::Container PostingList::unite(const Container& a, const Container& b) {
+    Container result{a.key};
+    if (a.is_bitmap() || b.is_bitmap()) {
+        const Container& bitmap_side = a.is_bitmap() ? a : b;
+        const Container& other = a.is_bitmap() ? b : a;
+        result.bitmap = bitmap_side.bitmap;
+        if (other.is_bitmap()) {
+            for (uint32_t word = 0; word < BITMAP_WORDS; ++word) result.bitmap[word] |= other.bitmap[word];
+        } else {
+            for (uint16_t low : other.array) result.bitmap[low >> 6] |= 1ULL << (low & 63);
+        }
+        for (uint64_t word : result.bitmap) result.cardinality += popcount(word);
+    } else {
+        set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                  back_inserter(result.array));
+        result.cardinality = result.array.size();
+        result.normalize();
+    }
+    return result;
+}
+
+void PostingList::intersect_with(const PostingList& other) {
+    vector<Container> result;
+    size_t i = 0, j = 0;
+    count = 0;
+    while (i < containers.size() && j < other.containers.size()) {
+        if (containers[i].key < other.containers[j].key) {
+            ++i;
+        } else if (other.containers[j].key < containers[i].key) {
+            ++j;
+        } else {
+            Container both = intersect(containers[i], other.containers[j]);
+            if (both.cardinality > 0) {
+                count += both.cardinality;
+                result.push_back(std::move(both));
+            }
+            ++i, ++j;
+        }
+    }
+    containers.swap(result);
+}
+
+void PostingList::union_with(const PostingList& other) {
+    vector<Container> result;
+    result.reserve(containers.size() + other.containers.size());
+    size_t i = 0, j = 0;
+    count = 0;
+    while (i < containers.size() || j < other.containers.size()) {
+        if (j == other.containers.size() || (i < containers.size() && containers[i].key < other.containers[j].key)) {
+            result.push_back(std::move(containers[i++]));
+        } else if (i == containers.size() || other.containers[j].key < containers[i].key) {
+            result.push_back(other.containers[j++]);
+        } else {
+            result.push_back(unite(containers[i++], other.containers[j++]));
+        }
+        count += result.back().cardinality;
+    }
+    containers.swap(result);
+}
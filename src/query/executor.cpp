@@ -0,0 +1,1350 @@
+#include "../../include/query/executor.h"
+#include "../../include/index_key.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    // Whether a three-way comparison result satisfies op.
+    bool compare_holds(CompareOp op, int c) {
+        switch (op) {
+            case CompareOp::EQ: return c == 0;
+            case CompareOp::NE: return c != 0;
+            case CompareOp::LT: return c < 0;
+            case CompareOp::LE: return c <= 0;
+            case CompareOp::GT: return c > 0;
+            default: return c >= 0;
+        }
+    }
+
+    vector<string> pick(const vector<string>& values, const vector<int>& columns) {
+        vector<string> result;
+        for (int column : columns) result.push_back(values[column]);
+        return result;
+    }
+
+    vector<DataType> pick(const vector<DataType>& values, const vector<int>& columns) {
+        vector<DataType> result;
+        for (int column : columns) result.push_back(values[column]);
+        return result;
+    }
+
+    // Reads the version at record_id into row if snapshot sees it. Ids from
+    // the user (record_id = N) may name a slot the heap never had; those
+    // give false.
+    bool fetch_row(RecordManager& heap, const Snapshot& snapshot, const RowFormat& format, int record_id, Row& row) {
+        try {
+            Record rec = heap.get_version(record_id, snapshot);
+            if (!format.is_valid(rec.data)) return false;
+            row.record_id = record_id;
+            row.data = std::move(rec.data);
+            return true;
+        } catch (const runtime_error&) {
+            return false;
+        }
+    }
+
+    // A row's index keys for the sort keys; index keys order typed values
+    // correctly as plain bytes.
+    vector<string> sort_key(const RowFormat& format, const vector<SortKey>& keys, const Row& row) {
+        vector<string> key;
+        key.reserve(keys.size());
+        for (const SortKey& sort_key : keys) {
+            key.push_back(format.index_key(row.data, sort_key.column));
+        }
+        return key;
+    }
+
+    bool sorts_before(const vector<SortKey>& keys, const vector<string>& a, const vector<string>& b) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            int c = a[i].compare(b[i]);
+            if (c != 0) return keys[i].descending ? c > 0 : c < 0;
+        }
+        return false;
+    }
+
+    // Names the run files of every Sort in the process apart.
+    atomic<uint64_t> next_run_id{0};
+
+    // Run file row: [int32 record id][uint32 size][row bytes].
+    void write_row(ofstream& out, const Row& row) {
+        uint32_t size = static_cast<uint32_t>(row.data.size());
+        out.write(reinterpret_cast<const char*>(&row.record_id), sizeof(row.record_id));
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(row.data.data(), size);
+    }
+
+    bool read_row(ifstream& in, Row& row) {
+        uint32_t size;
+        if (!in.read(reinterpret_cast<char*>(&row.record_id), sizeof(row.record_id))) return false;
+        if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+            throw runtime_error("Spill file is truncated");
+        }
+        row.data.resize(size);
+        if (!in.read(row.data.data(), size)) {
+            throw runtime_error("Spill file is truncated");
+        }
+        return true;
+    }
+
+    vector<DataType> aggregate_types(const vector<AggregateSpec>& specs, const vector<DataType>& input_types) {
+        vector<DataType> types;
+        for (const AggregateSpec& spec : specs) {
+            switch (spec.function) {
+                case AggregateFunction::COUNT: types.push_back(DataType::INT); break;
+                case AggregateFunction::AVG: types.push_back(DataType::FLOAT); break;
+                default: types.push_back(input_types[spec.column]); break;
+            }
+        }
+        return types;
+    }
+
+    // Folds one row into state.
+    void accumulate_row(const AggregateSpec& spec, AggregateState& state, const RowFormat& input, const Row& row) {
+        if (spec.column < 0) {
+            state.count++;
+            return;
+        }
+        if (input.is_null(row.data, spec.column)) return;
+
+        switch (spec.function) {
+            case AggregateFunction::SUM:
+            case AggregateFunction::AVG:
+                if (input.column_type(spec.column) == DataType::INT) {
+                    int64_t value = input.get_int(row.data, spec.column);
+                    state.int_sum += value;
+                    state.float_sum += static_cast<double>(value);
+                } else {
+                    state.float_sum += input.get_float(row.data, spec.column);
+                }
+                break;
+            case AggregateFunction::MIN:
+            case AggregateFunction::MAX: {
+                string key = input.index_key(row.data, spec.column);
+                int c = key.compare(state.best_key);
+                if (state.count == 0 || (spec.function == AggregateFunction::MIN ? c < 0 : c > 0)) {
+                    state.best_key = std::move(key);
+                    state.best_row = row;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        state.count++;
+    }
+
+    // Sets column col of out to the aggregate's final value.
+    void write_result(const AggregateSpec& spec, const AggregateState& state, const RowFormat& input,
+                      const RowFormat& output, vector<char>& out, int col) {
+        if (spec.function == AggregateFunction::COUNT) {
+            output.set_int(out, col, state.count);
+        } else if (state.count == 0) {
+            output.set_null(out, col);
+        } else if (spec.function == AggregateFunction::AVG) {
+            output.set_float(out, col, state.float_sum / state.count);
+        } else if (spec.function == AggregateFunction::SUM) {
+            if (output.column_type(col) == DataType::INT) output.set_int(out, col, state.int_sum);
+            else output.set_float(out, col, state.float_sum);
+        } else {
+            output.copy_field(input, state.best_row.data, spec.column, out, col);
+        }
+    }
+
+    // Spreads the bits of a hash, so partitions at each depth split the
+    // rows differently from the table's slots and from each other.
+    uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Index key of field col as a value of type target, so INT and FLOAT
+    // join columns match by value. False for NULL, which joins nothing, and
+    // for a FLOAT that no INT equals.
+    bool join_key(const RowFormat& format, const vector<char>& row, int col, DataType target, string& key) {
+        if (format.is_null(row, col)) return false;
+        DataType type = format.column_type(col);
+        if (type == target) {
+            key = format.index_key(row, col);
+        } else if (target == DataType::FLOAT) {
+            key = index_key_float(static_cast<double>(format.get_int(row, col)));
+        } else {
+            double value = format.get_float(row, col);
+            if (!(value >= -9.2e18 && value <= 9.2e18) || value != static_cast<double>(static_cast<int64_t>(value))) return false;
+            key = index_key_int(static_cast<int64_t>(value));
+        }
+        return true;
+    }
+
+    // out = the columns of left_row, then those of right_row.
+    void join_rows(const RowFormat& out, const RowFormat& left, const Row& left_row, const RowFormat& right,
+                   const Row& right_row, Row& row) {
+        row.record_id = -1;
+        out.start_row(row.data);
+        int left_columns = static_cast<int>(left.column_count());
+        for (int i = 0; i < left_columns; ++i) {
+            if (!out.copy_field(left, left_row.data, i, row.data, i)) throw runtime_error("Joined row is larger than 64 KB");
+        }
+        for (int i = 0; i < static_cast<int>(right.column_count()); ++i) {
+            if (!out.copy_field(right, right_row.data, i, row.data, left_columns + i)) {
+                throw runtime_error("Joined row is larger than 64 KB");
+            }
+        }
+    }
+
+    // out[i] = values[i] op constant for every row. One plain loop per
+    // operator, with no branches inside, so the compiler can vectorize the
+    // numeric ones.
+    template <typename T>
+    void compare_column(const T* values, size_t n, T constant, CompareOp op, uint8_t* out) {
+        switch (op) {
+            case CompareOp::EQ: for (size_t i = 0; i < n; ++i) out[i] = values[i] == constant; break;
+            case CompareOp::NE: for (size_t i = 0; i < n; ++i) out[i] = values[i] != constant; break;
+            case CompareOp::LT: for (size_t i = 0; i < n; ++i) out[i] = values[i] < constant; break;
+            case CompareOp::LE: for (size_t i = 0; i < n; ++i) out[i] = values[i] <= constant; break;
+            case CompareOp::GT: for (size_t i = 0; i < n; ++i) out[i] = values[i] > constant; break;
+            default:            for (size_t i = 0; i < n; ++i) out[i] = values[i] >= constant; break;
+        }
+    }
+
+    // Position among the selected non-NULL rows of the smallest (or, for
+    // max, largest) value; -1 if they are all NULL.
+    template <typename T>
+    int best_position(const vector<T>& values, const ColumnVector& column, const vector<uint16_t>& selection, bool max) {
+        int best = -1;
+        for (uint16_t r : selection) {
+            if (column.nulls[r]) continue;
+            if (best < 0 || (max ? values[best] < values[r] : values[r] < values[best])) best = r;
+        }
+        return best;
+    }
+}
+
+Operator::Operator(vector<string> names, vector<DataType> types)
+    : column_names(std::move(names)), column_types(std::move(types)), row_format(column_types) {}
+
+bool Operator::next_batch(Batch& batch) {
+    batch.clear();
+    Row row;
+    while (batch.rows.size() < BATCH_ROWS && next(row)) {
+        batch.rows.push_back(std::move(row));
+    }
+    batch.select_all();
+    return !batch.rows.empty();
+}
+
+// Batch
+
+void Batch::clear() {
+    rows.clear();
+    selection.clear();
+    for (ColumnVector& column : columns) column.decoded = false;
+}
+
+void Batch::select_all() {
+    selection.resize(rows.size());
+    iota(selection.begin(), selection.end(), 0);
+}
+
+const ColumnVector& Batch::column(const RowFormat& format, int col) {
+    if (columns.size() < format.column_count()) columns.resize(format.column_count());
+    ColumnVector& column = columns[col];
+    if (column.decoded) return column;
+
+    size_t n = rows.size();
+    column.nulls.resize(n);
+    for (size_t r = 0; r < n; ++r) column.nulls[r] = format.is_null(rows[r].data, col);
+    switch (format.column_type(col)) {
+        case DataType::INT:
+            column.ints.resize(n);
+            for (size_t r = 0; r < n; ++r) column.ints[r] = column.nulls[r] ? 0 : format.get_int(rows[r].data, col);
+            break;
+        case DataType::FLOAT:
+            column.floats.resize(n);
+            for (size_t r = 0; r < n; ++r) column.floats[r] = column.nulls[r] ? 0 : format.get_float(rows[r].data, col);
+            break;
+        default:
+            column.strings.resize(n);
+            for (size_t r = 0; r < n; ++r) column.strings[r] = column.nulls[r] ? string_view() : format.get_varchar(rows[r].data, col);
+            break;
+    }
+    column.decoded = true;
+    return column;
+}
+
+// SeqScan
+
+SeqScan::SeqScan(RecordManager& heap, const TableSchema& schema, const Snapshot& snapshot)
+    : Operator(schema.columns, schema.column_types), heap(heap), snapshot(snapshot) {}
+
+void SeqScan::open() {
+    iterator = make_unique<RecordIterator>(heap, snapshot);
+}
+
+bool SeqScan::next(Row& row) {
+    while (iterator->has_next()) {
+        auto [rec, page_id, slot_id] = iterator->next_with_location();
+        if (row_format.is_valid(rec.data)) {
+            row.record_id = RecordID(page_id, slot_id).encode();
+            row.data = std::move(rec.data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SeqScan::close() {
+    iterator.reset();
+}
+
+bool SeqScan::next_batch(Batch& batch) {
+    batch.clear();
+    while (batch.rows.empty() && iterator->has_next()) {
+        records.clear();
+        iterator->next_batch(records, BATCH_ROWS);
+        for (Record& rec : records) {
+            if (row_format.is_valid(rec.data)) {
+                batch.rows.push_back({rec.rid.encode(), std::move(rec.data)});
+            }
+        }
+    }
+    batch.select_all();
+    return !batch.rows.empty();
+}
+
+// IndexScan
+
+IndexScan::IndexScan(RecordManager& heap, const TableSchema& schema, const Snapshot& snapshot, PostingList record_ids)
+    : Operator(schema.columns, schema.column_types), heap(heap), snapshot(snapshot), record_ids(std::move(record_ids)) {}
+
+void IndexScan::open() {
+    cursor = make_unique<PostingList::Cursor>(record_ids);
+}
+
+bool IndexScan::next(Row& row) {
+    int record_id;
+    while (cursor->next(record_id)) {
+        if (fetch_row(heap, snapshot, row_format, record_id, row)) return true;
+    }
+    return false;
+}
+
+void IndexScan::close() {
+    cursor.reset();
+}
+
+// IndexOrderScan
+
+IndexOrderScan::IndexOrderScan(RecordManager& heap, IndexManager& indexes, const TableSchema& schema, const Snapshot& snapshot, const SortKey& order)
+    : Operator(schema.columns, schema.column_types), heap(heap), snapshot(snapshot), indexes(indexes),
+      table_name(schema.table_name), column_name(schema.columns[order.column]), descending(order.descending) {}
+
+void IndexOrderScan::open() {
+    cursor = IndexCursor();
+    record_ids.clear();
+    position = 0;
+    chunk = 64;
+}
+
+bool IndexOrderScan::next(Row& row) {
+    while (true) {
+        if (position >= record_ids.size()) {
+            if (cursor.finished) return false;
+            record_ids.clear();
+            position = 0;
+            if (!indexes.scan_ordered(table_name, column_name, cursor, descending, chunk, record_ids) || record_ids.empty()) {
+                return false;
+            }
+            chunk = min(chunk * 2, BATCH_ROWS);
+        }
+        if (fetch_row(heap, snapshot, row_format, record_ids[position++], row)) return true;
+    }
+}
+
+void IndexOrderScan::close() {
+    record_ids.clear();
+}
+
+// Filter
+
+Filter::Filter(unique_ptr<Operator> child, unique_ptr<Predicate> predicate)
+    : Operator(child->names(), child->types()), child(std::move(child)), predicate(std::move(predicate)) {}
+
+void Filter::open() {
+    child->open();
+}
+
+bool Filter::next(Row& row) {
+    while (child->next(row)) {
+        if (matches(*predicate, row)) return true;
+    }
+    return false;
+}
+
+void Filter::close() {
+    child->close();
+}
+
+bool Filter::next_batch(Batch& batch) {
+    while (child->next_batch(batch)) {
+        select(*predicate, batch);
+        if (batch.size() > 0) return true;
+    }
+    return false;
+}
+
+void Filter::select(const Predicate& condition, Batch& batch) {
+    switch (condition.kind) {
+        case Expr::Kind::AND:
+            select(*condition.left, batch);
+            if (batch.size() > 0) select(*condition.right, batch);
+            return;
+        case Expr::Kind::OR: {
+            vector<uint16_t> all = batch.selection;
+            select(*condition.left, batch);
+            vector<uint16_t> left = std::move(batch.selection);
+            batch.selection = std::move(all);
+            select(*condition.right, batch);
+            vector<uint16_t> either;
+            set_union(left.begin(), left.end(), batch.selection.begin(), batch.selection.end(), back_inserter(either));
+            batch.selection = std::move(either);
+            return;
+        }
+        default:
+            select_comparison(condition, batch);
+            return;
+    }
+}
+
+void Filter::select_comparison(const Predicate& comparison, Batch& batch) {
+    size_t n = batch.rows.size();
+    hits.resize(n);
+    uint8_t* out = hits.data();
+    const Literal& value = comparison.value;
+
+    if (comparison.column == RECORD_ID_COLUMN) {
+        for (size_t r = 0; r < n; ++r) {
+            out[r] = value.kind == Literal::Kind::INTEGER && value.int_value == batch.rows[r].record_id;
+        }
+    } else {
+        const ColumnVector& column = batch.column(row_format, comparison.column);
+        const uint8_t* nulls = column.nulls.data();
+        DataType type = row_format.column_type(comparison.column);
+        bool numeric = value.kind == Literal::Kind::INTEGER || value.kind == Literal::Kind::FLOAT;
+
+        // = and != treat NULL as a value; ordering comparisons never match it.
+        if (comparison.key == index_key_null()) {
+            uint8_t flip = comparison.op == CompareOp::NE;
+            uint8_t any = comparison.op == CompareOp::EQ || comparison.op == CompareOp::NE;
+            for (size_t r = 0; r < n; ++r) out[r] = (nulls[r] ^ flip) & any;
+        } else {
+            if (type == DataType::INT && value.kind == Literal::Kind::INTEGER) {
+                compare_column(column.ints.data(), n, value.int_value, comparison.op, out);
+            } else if (type == DataType::FLOAT && numeric) {
+                double constant = value.kind == Literal::Kind::INTEGER ? static_cast<double>(value.int_value) : value.float_value;
+                compare_column(column.floats.data(), n, constant, comparison.op, out);
+            } else if (type == DataType::VARCHAR && (numeric || value.kind == Literal::Kind::STRING)) {
+                // The text literal_index_key reads for an unquoted number
+                string constant = value.kind == Literal::Kind::STRING ? value.text : value.sql();
+                compare_column(column.strings.data(), n, string_view(constant), comparison.op, out);
+            } else {
+                for (uint16_t r : batch.selection) {
+                    out[r] = compare_holds(comparison.op, row_format.index_key(batch.rows[r].data, comparison.column).compare(comparison.key));
+                }
+            }
+            // A NULL field differs from every value.
+            uint8_t null_hit = comparison.op == CompareOp::NE;
+            for (size_t r = 0; r < n; ++r) out[r] = nulls[r] ? null_hit : out[r];
+        }
+    }
+
+    size_t kept = 0;
+    for (uint16_t r : batch.selection) {
+        batch.selection[kept] = r;
+        kept += out[r];
+    }
+    batch.selection.resize(kept);
+}
+
+bool Filter::matches(const Predicate& condition, const Row& row) const {
+    switch (condition.kind) {
+        case Expr::Kind::AND:
+            return matches(*condition.left, row) && matches(*condition.right, row);
+        case Expr::Kind::OR:
+            return matches(*condition.left, row) || matches(*condition.right, row);
+        default:
+            break;
+    }
+
+    if (condition.column == RECORD_ID_COLUMN) {
+        return condition.value.kind == Literal::Kind::INTEGER && condition.value.int_value == row.record_id;
+    }
+    // = and != treat NULL as a value; ordering comparisons never match it.
+    bool ordering = condition.op != CompareOp::EQ && condition.op != CompareOp::NE;
+    if (ordering && (row_format.is_null(row.data, condition.column) || condition.key == index_key_null())) {
+        return false;
+    }
+    return compare_holds(condition.op, row_format.index_key(row.data, condition.column).compare(condition.key));
+}
+
+// Project
+
+Project::Project(unique_ptr<Operator> child, vector<int> columns)
+    : Operator(pick(child->names(), columns), pick(child->types(), columns)), child(std::move(child)), columns(std::move(columns)) {}
+
+void Project::open() {
+    input.clear();
+    position = 0;
+    child->open();
+}
+
+bool Project::next(Row& row) {
+    while (position >= input.size()) {
+        if (!child->next_batch(input)) return false;
+        position = 0;
+    }
+
+    const Row& in = input.rows[input.selection[position++]];
+    row.record_id = in.record_id;
+    row_format.start_row(row.data);
+    for (size_t i = 0; i < columns.size(); ++i) {
+        row_format.copy_field(child->format(), in.data, columns[i], row.data, static_cast<int>(i));
+    }
+    return true;
+}
+
+void Project::close() {
+    child->close();
+}
+
+// Limit
+
+Limit::Limit(unique_ptr<Operator> child, int64_t count)
+    : Operator(child->names(), child->types()), child(std::move(child)), count(count) {}
+
+void Limit::open() {
+    produced = 0;
+    child->open();
+}
+
+bool Limit::next(Row& row) {
+    // Stop pulling once count rows are out, so the child reads no further.
+    if (produced >= count || !child->next(row)) return false;
+    produced++;
+    return true;
+}
+
+void Limit::close() {
+    child->close();
+}
+
+// Sort
+
+Sort::Sort(unique_ptr<Operator> child, vector<SortKey> keys, size_t memory_budget, string temp_dir)
+    : Operator(child->names(), child->types()), child(std::move(child)), keys(std::move(keys)),
+      memory_budget(memory_budget), temp_dir(std::move(temp_dir)) {}
+
+Sort::~Sort() {
+    remove_runs();
+}
+
+void Sort::open() {
+    remove_runs();
+    rows.clear();
+    child->open();
+
+    // Bytes held per row besides its data and keys
+    const size_t ROW_OVERHEAD = sizeof(Row) + sizeof(pair<vector<string>, size_t>);
+
+    vector<pair<vector<string>, size_t>> sort_keys;
+    size_t used = 0;
+    Batch batch;
+    while (child->next_batch(batch)) {
+        for (uint16_t r : batch.selection) {
+            vector<string> key = sort_key(row_format, keys, batch.rows[r]);
+            used += batch.rows[r].data.size() + ROW_OVERHEAD;
+            for (const string& part : key) used += part.size();
+            sort_keys.emplace_back(std::move(key), rows.size());
+            rows.push_back(std::move(batch.rows[r]));
+
+            if (used > memory_budget) {
+                sort_rows(sort_keys);
+                write_run(rows);
+                rows.clear();
+                sort_keys.clear();
+                used = 0;
+            }
+        }
+    }
+    sort_rows(sort_keys);
+    position = 0;
+    if (runs.empty()) return;
+
+    if (!rows.empty()) {
+        write_run(rows);
+        rows.clear();
+    }
+    cout << "[DEBUG][SORT] Spilled " << runs.size() << " sorted runs to " << temp_dir << endl;
+
+    // Merge neighbouring runs until one pass can merge them all; keeping
+    // them in input order keeps the sort stable.
+    while (runs.size() > MERGE_FAN_IN) {
+        vector<string> merged;
+        for (size_t first = 0; first < runs.size(); first += MERGE_FAN_IN) {
+            size_t last = min(first + MERGE_FAN_IN, runs.size());
+            string path = run_path();
+            start_merge(first, last);
+            ofstream out(path, ios::binary);
+            Row row;
+            while (merge_next(row)) {
+                write_row(out, row);
+            }
+            if (!out) throw runtime_error("Cannot write sort run " + path);
+            readers.clear();
+            for (size_t i = first; i < last; ++i) {
+                std::error_code ec;
+                filesystem::remove(runs[i], ec);
+            }
+            merged.push_back(path);
+        }
+        runs = std::move(merged);
+    }
+    start_merge(0, runs.size());
+}
+
+bool Sort::next(Row& row) {
+    if (!runs.empty()) return merge_next(row);
+    if (position >= rows.size()) return false;
+    row = std::move(rows[position++]);
+    return true;
+}
+
+void Sort::close() {
+    rows.clear();
+    remove_runs();
+    child->close();
+}
+
+void Sort::sort_rows(vector<pair<vector<string>, size_t>>& sort_keys) {
+    stable_sort(sort_keys.begin(), sort_keys.end(), [&](const auto& a, const auto& b) {
+        return sorts_before(keys, a.first, b.first);
+    });
+
+    vector<Row> sorted;
+    sorted.reserve(rows.size());
+    for (const auto& entry : sort_keys) {
+        sorted.push_back(std::move(rows[entry.second]));
+    }
+    rows = std::move(sorted);
+}
+
+string Sort::run_path() const {
+    return temp_dir + "/sort_" + std::to_string(next_run_id++) + ".run";
+}
+
+void Sort::write_run(const vector<Row>& run_rows) {
+    std::error_code ec;
+    filesystem::create_directories(temp_dir, ec);
+    runs.push_back(run_path());
+    ofstream out(runs.back(), ios::binary);
+    for (const Row& row : run_rows) {
+        write_row(out, row);
+    }
+    if (!out) throw runtime_error("Cannot write sort run " + runs.back());
+}
+
+bool Sort::comes_after(const RunReader* a, const RunReader* b) const {
+    if (sorts_before(keys, b->key, a->key)) return true;
+    if (sorts_before(keys, a->key, b->key)) return false;
+    return a->run > b->run;
+}
+
+bool Sort::read_row(RunReader& reader) const {
+    if (!::read_row(reader.in, reader.row)) return false;
+    reader.key = sort_key(row_format, keys, reader.row);
+    return true;
+}
+
+void Sort::start_merge(size_t first, size_t last) {
+    readers.clear();
+    merge_heap.clear();
+    for (size_t i = first; i < last; ++i) {
+        auto reader = make_unique<RunReader>();
+        reader->in.open(runs[i], ios::binary);
+        if (!reader->in) throw runtime_error("Cannot read sort run " + runs[i]);
+        reader->run = i;
+        if (read_row(*reader)) merge_heap.push_back(reader.get());
+        readers.push_back(std::move(reader));
+    }
+    make_heap(merge_heap.begin(), merge_heap.end(), [&](const RunReader* a, const RunReader* b) { return comes_after(a, b); });
+}
+
+bool Sort::merge_next(Row& row) {
+    // Min-heap: the front reader holds the smallest row
+    auto after = [&](const RunReader* a, const RunReader* b) { return comes_after(a, b); };
+    if (merge_heap.empty()) return false;
+
+    pop_heap(merge_heap.begin(), merge_heap.end(), after);
+    RunReader* reader = merge_heap.back();
+    row = reader->row;
+    if (read_row(*reader)) {
+        push_heap(merge_heap.begin(), merge_heap.end(), after);
+    } else {
+        merge_heap.pop_back();
+    }
+    return true;
+}
+
+void Sort::remove_runs() {
+    merge_heap.clear();
+    readers.clear();
+    for (const string& path : runs) {
+        std::error_code ec;
+        filesystem::remove(path, ec);
+    }
+    runs.clear();
+}
+
+// TopN
+
+TopN::TopN(unique_ptr<Operator> child, vector<SortKey> keys, int64_t count)
+    : Operator(child->names(), child->types()), child(std::move(child)), keys(std::move(keys)), count(count) {}
+
+void TopN::open() {
+    child->open();
+
+    // Max-heap on sort order, so the front is the row to drop next. The
+    // input position breaks ties, which keeps equal rows in input order
+    // as Sort does.
+    struct Entry {
+        vector<string> key;
+        size_t seq;
+        Row row;
+    };
+    auto before = [&](const Entry& a, const Entry& b) {
+        if (sorts_before(keys, a.key, b.key)) return true;
+        if (sorts_before(keys, b.key, a.key)) return false;
+        return a.seq < b.seq;
+    };
+
+    vector<Entry> heap;
+    size_t seq = 0;
+    Batch batch;
+    while (count > 0 && child->next_batch(batch)) {
+        for (uint16_t r : batch.selection) {
+            Entry entry{sort_key(row_format, keys, batch.rows[r]), seq++, Row()};
+            if (heap.size() < static_cast<size_t>(count)) {
+                entry.row = std::move(batch.rows[r]);
+                heap.push_back(std::move(entry));
+                push_heap(heap.begin(), heap.end(), before);
+            } else if (before(entry, heap.front())) {
+                entry.row = std::move(batch.rows[r]);
+                pop_heap(heap.begin(), heap.end(), before);
+                heap.back() = std::move(entry);
+                push_heap(heap.begin(), heap.end(), before);
+            }
+        }
+    }
+
+    sort_heap(heap.begin(), heap.end(), before);
+    rows.clear();
+    rows.reserve(heap.size());
+    for (Entry& entry : heap) {
+        rows.push_back(std::move(entry.row));
+    }
+    position = 0;
+}
+
+bool TopN::next(Row& row) {
+    if (position >= rows.size()) return false;
+    row = std::move(rows[position++]);
+    return true;
+}
+
+void TopN::close() {
+    rows.clear();
+    child->close();
+}
+
+// Aggregate
+
+Aggregate::Aggregate(unique_ptr<Operator> child, vector<AggregateSpec> specs, vector<string> names)
+    : Operator(std::move(names), aggregate_types(specs, child->types())),
+      child(std::move(child)), specs(std::move(specs)) {}
+
+void Aggregate::open() {
+    child->open();
+    done = false;
+}
+
+bool Aggregate::next(Row& row) {
+    if (done) return false;
+    done = true;
+
+    const RowFormat& input = child->format();
+    vector<AggregateState> states(specs.size());
+    Batch batch;
+    while (child->next_batch(batch)) {
+        for (size_t i = 0; i < specs.size(); ++i) {
+            accumulate(specs[i], states[i], batch);
+        }
+    }
+
+    row.record_id = -1;
+    row_format.start_row(row.data);
+    for (size_t i = 0; i < specs.size(); ++i) {
+        write_result(specs[i], states[i], input, row_format, row.data, static_cast<int>(i));
+    }
+    return true;
+}
+
+void Aggregate::close() {
+    child->close();
+}
+
+void Aggregate::accumulate(const AggregateSpec& spec, AggregateState& state, Batch& batch) {
+    const vector<uint16_t>& selection = batch.selection;
+    if (spec.column < 0) {
+        state.count += selection.size();
+        return;
+    }
+
+    const RowFormat& input = child->format();
+    const ColumnVector& column = batch.column(input, spec.column);
+    DataType type = input.column_type(spec.column);
+    int64_t present = 0;
+    for (uint16_t r : selection) present += !column.nulls[r];
+
+    switch (spec.function) {
+        case AggregateFunction::SUM:
+        case AggregateFunction::AVG:
+            // NULL fields hold 0, so they add nothing.
+            if (type == DataType::INT) {
+                int64_t sum = 0;
+                for (uint16_t r : selection) sum += column.ints[r];
+                state.int_sum += sum;
+                state.float_sum += static_cast<double>(sum);
+            } else {
+                double sum = 0;
+                for (uint16_t r : selection) sum += column.floats[r];
+                state.float_sum += sum;
+            }
+            break;
+        case AggregateFunction::MIN:
+        case AggregateFunction::MAX: {
+            bool max = spec.function == AggregateFunction::MAX;
+            int best;
+            if (type == DataType::INT) best = best_position(column.ints, column, selection, max);
+            else if (type == DataType::FLOAT) best = best_position(column.floats, column, selection, max);
+            else best = best_position(column.strings, column, selection, max);
+            if (best < 0) break;
+
+            // Across batches, compare as everywhere else: by index key.
+            string key = input.index_key(batch.rows[best].data, spec.column);
+            int c = key.compare(state.best_key);
+            if (state.count == 0 || (max ? c > 0 : c < 0)) {
+                state.best_key = std::move(key);
+                state.best_row = batch.rows[best];
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    state.count += present;
+}
+
+// HashAggregate
+
+HashAggregate::HashAggregate(unique_ptr<Operator> child, vector<int> group_columns, vector<AggregateSpec> specs, vector<string> names,
+                             size_t memory_budget, string temp_dir)
+    : Operator(std::move(names), aggregate_types(specs, child->types())), child(std::move(child)),
+      group_columns(std::move(group_columns)), specs(std::move(specs)), memory_budget(memory_budget), temp_dir(std::move(temp_dir)) {}
+
+HashAggregate::~HashAggregate() {
+    remove_files();
+}
+
+void HashAggregate::open() {
+    remove_files();
+    reset_table();
+    depth = 0;
+    child->open();
+
+    Batch batch;
+    while (child->next_batch(batch)) {
+        for (uint16_t r : batch.selection) add_row(batch.rows[r]);
+    }
+    finish_spill();
+}
+
+bool HashAggregate::next(Row& row) {
+    const RowFormat& input = child->format();
+    while (position >= group_keys.size()) {
+        if (pending.empty()) return false;
+
+        // Aggregate the next partition in a fresh table
+        Partition partition = std::move(pending.front());
+        pending.pop_front();
+        reset_table();
+        depth = partition.depth;
+        ifstream in(partition.path, ios::binary);
+        if (!in) throw runtime_error("Cannot read aggregate partition " + partition.path);
+        Row spilled;
+        while (read_row(in, spilled)) add_row(spilled);
+        in.close();
+        std::error_code ec;
+        filesystem::remove(partition.path, ec);
+        finish_spill();
+    }
+
+    size_t group = position++;
+    row.record_id = -1;
+    row_format.start_row(row.data);
+    for (size_t i = 0; i < specs.size(); ++i) {
+        int col = static_cast<int>(i);
+        if (specs[i].function == AggregateFunction::NONE) {
+            row_format.copy_field(input, group_rows[group].data, specs[i].column, row.data, col);
+        } else {
+            write_result(specs[i], states[group * specs.size() + i], input, row_format, row.data, col);
+        }
+    }
+    return true;
+}
+
+void HashAggregate::close() {
+    reset_table();
+    remove_files();
+    child->close();
+}
+
+void HashAggregate::reset_table() {
+    slots.assign(1024, Slot());
+    group_keys.clear();
+    group_rows.clear();
+    states.clear();
+    memory_used = 0;
+    position = 0;
+}
+
+void HashAggregate::add_row(const Row& row) {
+    const RowFormat& input = child->format();
+
+    // Each part is length-prefixed, so ('a', 'bc') and ('ab', 'c') differ.
+    string key;
+    for (int column : group_columns) {
+        string part = input.index_key(row.data, column);
+        uint16_t size = static_cast<uint16_t>(part.size());
+        key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        key += part;
+    }
+    uint64_t hash = std::hash<string>{}(key);
+
+    // Linear probing; the table is never full.
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].group != EMPTY && (slots[i].hash != hash || group_keys[slots[i].group] != key)) {
+        i = (i + 1) & mask;
+    }
+
+    uint32_t group = slots[i].group;
+    if (group == EMPTY) {
+        if (!spill.empty()) {
+            size_t partition = mix(hash + depth) >> 60;
+            write_row(spill[partition], row);
+            spill_rows[partition]++;
+            return;
+        }
+        group = static_cast<uint32_t>(group_keys.size());
+        slots[i] = {hash, group};
+        memory_used += key.size() + row.data.size() + sizeof(Row) + sizeof(string) + 2 * sizeof(Slot) +
+                       specs.size() * sizeof(AggregateState);
+        group_keys.push_back(std::move(key));
+        group_rows.push_back(row);
+        states.resize(states.size() + specs.size());
+        if (group_keys.size() * 10 > slots.size() * 7) grow_table();
+        if (memory_used > memory_budget && depth < MAX_DEPTH) start_spill();
+    }
+
+    AggregateState* group_states = &states[group * specs.size()];
+    for (size_t s = 0; s < specs.size(); ++s) {
+        if (specs[s].function != AggregateFunction::NONE) {
+            accumulate_row(specs[s], group_states[s], input, row);
+        }
+    }
+}
+
+void HashAggregate::grow_table() {
+    vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, Slot());
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.group == EMPTY) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].group != EMPTY) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+void HashAggregate::start_spill() {
+    std::error_code ec;
+    filesystem::create_directories(temp_dir, ec);
+    for (size_t p = 0; p < PARTITIONS; ++p) {
+        spill_paths.push_back(temp_dir + "/agg_" + std::to_string(next_run_id++) + ".part");
+        spill.emplace_back(spill_paths.back(), ios::binary);
+        if (!spill.back()) throw runtime_error("Cannot write aggregate partition " + spill_paths.back());
+        spill_rows.push_back(0);
+    }
+    cout << "[DEBUG][HASH_AGGREGATE] " << group_keys.size() << " groups fill the memory budget; partitioning the rest at depth " << depth << endl;
+}
+
+void HashAggregate::finish_spill() {
+    for (size_t p = 0; p < spill.size(); ++p) {
+        spill[p].close();
+        if (!spill[p]) throw runtime_error("Cannot write aggregate partition " + spill_paths[p]);
+        if (spill_rows[p] > 0) {
+            pending.push_back({spill_paths[p], depth + 1});
+        } else {
+            std::error_code ec;
+            filesystem::remove(spill_paths[p], ec);
+        }
+    }
+    spill.clear();
+    spill_paths.clear();
+    spill_rows.clear();
+}
+
+void HashAggregate::remove_files() {
+    spill.clear();
+    for (const string& path : spill_paths) {
+        std::error_code ec;
+        filesystem::remove(path, ec);
+    }
+    spill_paths.clear();
+    spill_rows.clear();
+    for (const Partition& partition : pending) {
+        std::error_code ec;
+        filesystem::remove(partition.path, ec);
+    }
+    pending.clear();
+}
+
+// SlotCount
+
+SlotCount::SlotCount(RecordManager& heap, const Snapshot& snapshot, string name)
+    : Operator({std::move(name)}, {DataType::INT}), heap(heap), snapshot(snapshot) {}
+
+void SlotCount::open() {
+    done = false;
+}
+
+bool SlotCount::next(Row& row) {
+    if (done) return false;
+    done = true;
+
+    RecordIterator iterator(heap, snapshot);
+    row.record_id = -1;
+    row_format.start_row(row.data);
+    row_format.set_int(row.data, 0, static_cast<int64_t>(iterator.count_remaining()));
+    return true;
+}
+
+void SlotCount::close() {
+}
+
+// IndexNestedLoopJoin
+
+IndexNestedLoopJoin::IndexNestedLoopJoin(unique_ptr<Operator> outer, int outer_key, RecordManager& inner_heap, const Snapshot& snapshot,
+                                         IndexManager& indexes, const TableSchema& inner, int inner_key, bool outer_is_left, const TableSchema& joined)
+    : Operator(joined.columns, joined.column_types), outer(std::move(outer)), outer_key(outer_key), inner_heap(inner_heap),
+      snapshot(snapshot), indexes(indexes), inner_table(inner.table_name), inner_column(inner.columns[inner_key]),
+      key_type(inner.column_types[inner_key]), inner_format(inner.column_types), outer_is_left(outer_is_left) {}
+
+void IndexNestedLoopJoin::open() {
+    outer->open();
+    batch.clear();
+    position = 0;
+    current = nullptr;
+    matches.clear();
+    match = 0;
+}
+
+bool IndexNestedLoopJoin::next(Row& row) {
+    while (true) {
+        while (match < matches.size()) {
+            if (!fetch_row(inner_heap, snapshot, inner_format, matches[match++], inner_row)) continue;
+            if (outer_is_left) join_rows(row_format, outer->format(), *current, inner_format, inner_row, row);
+            else join_rows(row_format, inner_format, inner_row, outer->format(), *current, row);
+            return true;
+        }
+
+        if (position >= batch.selection.size()) {
+            if (!outer->next_batch(batch)) return false;
+            position = 0;
+            continue;
+        }
+        current = &batch.rows[batch.selection[position++]];
+        matches.clear();
+        match = 0;
+        string key;
+        if (join_key(outer->format(), current->data, outer_key, key_type, key)) {
+            matches = indexes.search(inner_table, inner_column, key).to_vector();
+        }
+    }
+}
+
+void IndexNestedLoopJoin::close() {
+    batch.clear();
+    matches.clear();
+    outer->close();
+}
+
+// HashJoin
+
+HashJoin::HashJoin(unique_ptr<Operator> left, int left_key, unique_ptr<Operator> right, int right_key, const TableSchema& joined,
+                   size_t memory_budget, string temp_dir)
+    : Operator(joined.columns, joined.column_types), left(std::move(left)), right(std::move(right)), left_key(left_key),
+      right_key(right_key), memory_budget(memory_budget), temp_dir(std::move(temp_dir)) {
+    // Mixed INT and FLOAT keys are matched as FLOAT values
+    DataType left_type = this->left->types()[left_key];
+    key_type = left_type == this->right->types()[right_key] ? left_type : DataType::FLOAT;
+}
+
+HashJoin::~HashJoin() {
+    remove_files();
+}
+
+void HashJoin::open() {
+    remove_files();
+    reset_table();
+    depth = 0;
+
+    right->open();
+    Batch input;
+    while (right->next_batch(input)) {
+        for (uint16_t r : input.selection) add_build_row(std::move(input.rows[r]));
+    }
+
+    left->open();
+    batch.clear();
+    position = 0;
+    probe = nullptr;
+    match = END;
+    if (build_spill.empty()) {
+        build_table();
+        probe_from_child = true;
+        return;
+    }
+    // Every left row goes to its partition before any is joined
+    while (left->next_batch(input)) {
+        for (uint16_t r : input.selection) add_probe_row(input.rows[r]);
+    }
+    finish_spill();
+    probe_from_child = false;
+}
+
+bool HashJoin::next(Row& row) {
+    while (true) {
+        if (match != END) {
+            const Entry& entry = entries[match];
+            match = next_match(entry.next);
+            join_rows(row_format, left->format(), *probe, right->format(), entry.row, row);
+            return true;
+        }
+        if (!next_probe()) return false;
+        if (!join_key(left->format(), probe->data, left_key, key_type, key)) continue;
+        hash = std::hash<string>{}(key);
+        match = next_match(buckets[hash & (buckets.size() - 1)]);
+    }
+}
+
+void HashJoin::close() {
+    reset_table();
+    batch.clear();
+    remove_files();
+    left->close();
+    right->close();
+}
+
+void HashJoin::reset_table() {
+    entries.clear();
+    buckets.clear();
+    memory_used = 0;
+}
+
+void HashJoin::add_build_row(Row&& row) {
+    string row_key;
+    if (!join_key(right->format(), row.data, right_key, key_type, row_key)) return;
+    uint64_t row_hash = std::hash<string>{}(row_key);
+
+    if (!build_spill.empty()) {
+        size_t partition = mix(row_hash + depth) >> 60;
+        write_row(build_spill[partition], row);
+        build_rows[partition]++;
+        return;
+    }
+    memory_used += row_key.size() + row.data.size() + sizeof(Entry) + 2 * sizeof(uint32_t);
+    entries.push_back({row_hash, std::move(row_key), std::move(row), END});
+    if (memory_used > memory_budget && depth < MAX_DEPTH) start_spill();
+}
+
+void HashJoin::add_probe_row(const Row& row) {
+    string row_key;
+    if (!join_key(left->format(), row.data, left_key, key_type, row_key)) return;
+    size_t partition = mix(std::hash<string>{}(row_key) + depth) >> 60;
+    write_row(probe_spill[partition], row);
+    probe_rows[partition]++;
+}
+
+void HashJoin::build_table() {
+    size_t size = 1;
+    while (size < entries.size() * 2) size *= 2;
+    buckets.assign(size, END);
+    // Chained back to front, so rows with one key come out in input order
+    for (size_t i = entries.size(); i-- > 0;) {
+        uint32_t& bucket = buckets[entries[i].hash & (size - 1)];
+        entries[i].next = bucket;
+        bucket = static_cast<uint32_t>(i);
+    }
+}
+
+void HashJoin::start_spill() {
+    std::error_code ec;
+    filesystem::create_directories(temp_dir, ec);
+    for (size_t p = 0; p < PARTITIONS; ++p) {
+        uint64_t id = next_run_id++;
+        build_paths.push_back(temp_dir + "/join_" + std::to_string(id) + ".build");
+        probe_paths.push_back(temp_dir + "/join_" + std::to_string(id) + ".probe");
+        build_spill.emplace_back(build_paths.back(), ios::binary);
+        probe_spill.emplace_back(probe_paths.back(), ios::binary);
+        if (!build_spill.back() || !probe_spill.back()) throw runtime_error("Cannot write join partition " + build_paths.back());
+        build_rows.push_back(0);
+        probe_rows.push_back(0);
+    }
+    cout << "[DEBUG][HASH_JOIN] " << entries.size() << " right rows fill the memory budget; partitioning both sides at depth " << depth << endl;
+
+    for (Entry& entry : entries) {
+        size_t partition = mix(entry.hash + depth) >> 60;
+        write_row(build_spill[partition], entry.row);
+        build_rows[partition]++;
+    }
+    reset_table();
+}
+
+void HashJoin::finish_spill() {
+    for (size_t p = 0; p < build_spill.size(); ++p) {
+        build_spill[p].close();
+        probe_spill[p].close();
+        if (!build_spill[p] || !probe_spill[p]) throw runtime_error("Cannot write join partition " + build_paths[p]);
+        if (build_rows[p] > 0 && probe_rows[p] > 0) {
+            pending.push_back({build_paths[p], probe_paths[p], depth + 1});
+        } else {
+            // One side is empty, so the pair joins nothing
+            std::error_code ec;
+            filesystem::remove(build_paths[p], ec);
+            filesystem::remove(probe_paths[p], ec);
+        }
+    }
+    build_spill.clear();
+    probe_spill.clear();
+    build_paths.clear();
+    probe_paths.clear();
+    build_rows.clear();
+    probe_rows.clear();
+}
+
+uint32_t HashJoin::next_match(uint32_t entry) const {
+    while (entry != END && (entries[entry].hash != hash || entries[entry].key != key)) entry = entries[entry].next;
+    return entry;
+}
+
+bool HashJoin::next_probe() {
+    while (true) {
+        if (probe_from_child) {
+            if (position < batch.selection.size()) {
+                probe = &batch.rows[batch.selection[position++]];
+                return true;
+            }
+            if (left->next_batch(batch)) {
+                position = 0;
+                continue;
+            }
+            probe_from_child = false;
+        } else if (probe_file.is_open()) {
+            if (read_row(probe_file, probe_row)) {
+                probe = &probe_row;
+                return true;
+            }
+            probe_file.close();
+            std::error_code ec;
+            filesystem::remove(probe_path, ec);
+            probe_path.clear();
+        }
+        if (!open_partition()) return false;
+    }
+}
+
+bool HashJoin::open_partition() {
+    while (!pending.empty()) {
+        Partition partition = std::move(pending.front());
+        pending.pop_front();
+        reset_table();
+        depth = partition.depth;
+
+        std::error_code ec;
+        ifstream build_in(partition.build_path, ios::binary);
+        if (!build_in) throw runtime_error("Cannot read join partition " + partition.build_path);
+        Row row;
+        while (read_row(build_in, row)) add_build_row(std::move(row));
+        build_in.close();
+        filesystem::remove(partition.build_path, ec);
+
+        if (!build_spill.empty()) {
+            // Still too large: split the left rows the same way
+            ifstream probe_in(partition.probe_path, ios::binary);
+            if (!probe_in) throw runtime_error("Cannot read join partition " + partition.probe_path);
+            while (read_row(probe_in, row)) add_probe_row(row);
+            probe_in.close();
+            filesystem::remove(partition.probe_path, ec);
+            finish_spill();
+            continue;
+        }
+
+        build_table();
+        probe_path = partition.probe_path;
+        probe_file.open(probe_path, ios::binary);
+        if (!probe_file) throw runtime_error("Cannot read join partition " + probe_path);
+        return true;
+    }
+    return false;
+}
+
+void HashJoin::remove_files() {
+    std::error_code ec;
+    build_spill.clear();
+    probe_spill.clear();
+    for (const string& path : build_paths) filesystem::remove(path, ec);
+    for (const string& path : probe_paths) filesystem::remove(path, ec);
+    build_paths.clear();
+    probe_paths.clear();
+    build_rows.clear();
+    probe_rows.clear();
+    if (probe_file.is_open()) probe_file.close();
+    if (!probe_path.empty()) filesystem::remove(probe_path, ec);
+    probe_path.clear();
+    for (const Partition& partition : pending) {
+        filesystem::remove(partition.build_path, ec);
+        filesystem::remove(partition.probe_path, ec);
+    }
+    pending.clear();
+}
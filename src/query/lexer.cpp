@@ -0,0 +1,123 @@
+#include "../../include/query/lexer.h"
+#include <cctype>
+
+namespace {
+    bool is_identifier_start(char c) {
+        return isalpha(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool is_identifier_char(char c) {
+        return isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool is_digit(char c) {
+        return isdigit(static_cast<unsigned char>(c));
+    }
+}
+
+bool Lexer::tokenize(vector<Token>& tokens, string& error) {
+    tokens.clear();
+    Token token;
+    while (true) {
+        if (!read_token(token, error)) return false;
+        tokens.push_back(token);
+        if (token.type == TokenType::END) return true;
+    }
+}
+
+bool Lexer::read_token(Token& token, string& error) {
+    // Skip whitespace and comments
+    while (pos < text.size()) {
+        if (isspace(static_cast<unsigned char>(text[pos]))) {
+            pos++;
+        } else if (text.compare(pos, 2, "--") == 0) {
+            while (pos < text.size() && text[pos] != '\n') pos++;
+        } else {
+            break;
+        }
+    }
+
+    token.position = pos;
+    token.text.clear();
+    if (pos >= text.size()) {
+        token.type = TokenType::END;
+        return true;
+    }
+
+    char c = text[pos];
+    if (is_identifier_start(c)) {
+        size_t start = pos;
+        while (pos < text.size() && is_identifier_char(text[pos])) pos++;
+        token.type = TokenType::IDENTIFIER;
+        token.text.assign(text.substr(start, pos - start));
+        return true;
+    }
+
+    if (is_digit(c) || (c == '.' && pos + 1 < text.size() && is_digit(text[pos + 1]))) {
+        size_t start = pos;
+        bool is_float = false;
+        while (pos < text.size() && is_digit(text[pos])) pos++;
+        if (pos < text.size() && text[pos] == '.') {
+            is_float = true;
+            pos++;
+            while (pos < text.size() && is_digit(text[pos])) pos++;
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            size_t exponent = pos + 1;
+            if (exponent < text.size() && (text[exponent] == '+' || text[exponent] == '-')) exponent++;
+            if (exponent < text.size() && is_digit(text[exponent])) {
+                is_float = true;
+                pos = exponent;
+                while (pos < text.size() && is_digit(text[pos])) pos++;
+            }
+        }
+        if (pos < text.size() && is_identifier_char(text[pos])) {
+            error = "malformed number at position " + to_string(start);
+            return false;
+        }
+        token.type = is_float ? TokenType::FLOAT : TokenType::INTEGER;
+        token.text.assign(text.substr(start, pos - start));
+        return true;
+    }
+
+    if (c == '\'' || c == '"') {
+        size_t start = pos++;
+        token.type = TokenType::STRING;
+        while (true) {
+            if (pos >= text.size()) {
+                error = "unterminated string starting at position " + to_string(start);
+                return false;
+            }
+            if (text[pos] == c) {
+                if (pos + 1 < text.size() && text[pos + 1] == c) {
+                    token.text += c;
+                    pos += 2;
+                    continue;
+                }
+                pos++;
+                return true;
+            }
+            token.text += text[pos++];
+        }
+    }
+
+    token.type = TokenType::SYMBOL;
+    if (pos + 1 < text.size()) {
+        string_view two = text.substr(pos, 2);
+        if (two == "!=" || two == "<>" || two == "<=" || two == ">=") {
+            token.text.assign(two);
+            pos += 2;
+            return true;
+        }
+    }
+    switch (c) {
+        case '(': case ')': case ',': case ';': case '*': case '.':
+        case '=': case '<': case '>': case '-': case '?':
+            token.text.assign(1, c);
+            pos++;
+            return true;
+        default:
+            error = string("unexpected character '") + c + "' at position " + to_string(pos);
+            return false;
+    }
+}
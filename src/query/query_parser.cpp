@@ -1,522 +1,890 @@
 #include "../../include/query/query_parser.h"
-#include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
 #include "../../include/record_manager.h"
-#include "pretty.hpp"
-#include <unordered_set>
+#include "../../include/index_key.h"
+#include "../../include/query/result_printer.h"
 
 using namespace std;
 
-QueryParser::QueryParser(CatalogManager& cm, TableManager& tm, IndexManager& im)
-    : catalog_manager(cm), table_manager(tm), index_manager(im) {}
-
+namespace {
+    // The value a literal stands for when the statement runs.
+    const Literal& bind(const Literal& value, const vector<Literal>& parameters) {
+        return value.kind == Literal::Kind::PARAMETER ? parameters[value.parameter] : value;
+    }
 
-bool QueryParser::execute_query(const std::string& query) {
-    string q = query;
-    transform(q.begin(), q.end(), q.begin(), ::tolower);
-
-    if (q.find("create table") == 0) {
-        return parse_create_table(query);
-    } else if (q.find("drop table") == 0) {
-        return parse_drop_table(query);
-    } else if (q.find("insert into") == 0) {
-        return parse_insert(query);
-    } else if (q.find("delete from") == 0) {
-        return parse_delete(query);
-    } else if (q.find("update") == 0) {
-        return parse_update(query);
-    // } else if (q.find("select * from") == 0) {
-    //     return parse_print_table(query);
-    } else if (q.find("select") == 0) {
-        return parse_select(query);
-    } else if(q.find("create index on ") == 0){
-        return parse_create_index(query);
-    }
-
-    cout << "[ERROR] Unsupported or invalid query." << endl;
-    return false;
-}
+    // Position of a column as written: col, or table.col for the schema's
+    // table. A joined schema names its columns qualifier.col; there a bare
+    // col is found if just one of the tables has it.
+    int column_position(const TableSchema& schema, const string& column) {
+        auto it = find(schema.columns.begin(), schema.columns.end(), column);
+        if (it != schema.columns.end()) return static_cast<int>(it - schema.columns.begin());
 
-void QueryParser::trim(string& s) {
-    const char* whitespace = " \t\n\r";
-    size_t start = s.find_first_not_of(whitespace);
-    size_t end = s.find_last_not_of(whitespace);
-    if (start == string::npos || end == string::npos) {
-        s = "";
-    } else {
-        s = s.substr(start, end - start + 1);
+        size_t dot = column.find('.');
+        if (dot != string::npos) {
+            if (column.compare(0, dot, schema.table_name) != 0 || dot != schema.table_name.size()) return -1;
+            it = find(schema.columns.begin(), schema.columns.end(), column.substr(dot + 1));
+            return it == schema.columns.end() ? -1 : static_cast<int>(it - schema.columns.begin());
+        }
+        int found = -1;
+        for (size_t i = 0; i < schema.columns.size(); ++i) {
+            const string& name = schema.columns[i];
+            if (name.size() > column.size() && name.compare(name.size() - column.size(), string::npos, column) == 0 &&
+                name[name.size() - column.size() - 1] == '.') {
+                if (found >= 0) return -1;
+                found = static_cast<int>(i);
+            }
+        }
+        return found;
     }
-}
 
-vector<string> QueryParser::split(const string& s, char delimiter) {
-    vector<string> tokens;
-    string token;
-    istringstream tokenStream(s);
-    while (getline(tokenStream, token, delimiter)) {
-        trim(token);
-        tokens.push_back(token);
+    // Error for a column column_position did not find.
+    void report_unknown_column(const TableSchema& schema, const string& column) {
+        vector<const string*> matches;
+        for (const string& name : schema.columns) {
+            size_t dot = name.find('.');
+            if (dot != string::npos && name.compare(dot + 1, string::npos, column) == 0) matches.push_back(&name);
+        }
+        if (matches.size() > 1) {
+            cout << "[ERROR] Column '" << column << "' is in both tables; name its table, as in " << *matches[0] << "." << endl;
+        } else {
+            cout << "[ERROR] Column '" << column << "' not found in table '" << schema.table_name << "'" << endl;
+        }
     }
-    return tokens;
-}
-
 
-bool QueryParser::parse_create_table(const std::string& query) {
-    std::string query_lower = query;
-    transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t start = query_lower.find("table");
-    if (start == std::string::npos) {
-        cout << "[ERROR] Syntax error in CREATE TABLE." << endl;
-        return false;
+    // Both conditions, or whichever is there.
+    unique_ptr<Predicate> both(unique_ptr<Predicate> left, unique_ptr<Predicate> right) {
+        if (!left) return right;
+        if (!right) return left;
+        auto predicate = make_unique<Predicate>();
+        predicate->kind = Expr::Kind::AND;
+        predicate->left = std::move(left);
+        predicate->right = std::move(right);
+        return predicate;
+    }
+
+    // Moves every column reference of where by offset, between a table's
+    // own positions and the joined row's.
+    void shift_columns(Predicate& where, int offset) {
+        if (where.kind != Expr::Kind::COMPARE) {
+            shift_columns(*where.left, offset);
+            shift_columns(*where.right, offset);
+        } else if (where.column != RECORD_ID_COLUMN) {
+            where.column += offset;
+        }
     }
 
-    size_t open_paren = query.find('(', start);
-    size_t close_paren = query.find_last_of(')');
-
-    if(open_paren == std::string::npos && close_paren == std::string::npos){
-        cout<<"[ERROR] Invalid syntax: expected column definition list in parentheses." << endl;
-        return false;
+    // Planner cost units: reading one heap page in file order costs 1.
+    const double SEQ_PAGE_COST = 1.0;
+    const double RANDOM_PAGE_COST = 4.0;
+    const double ROW_COST = 0.01;         // testing a row during a scan
+    const double FETCH_COST = 0.25;       // looking up one row by id, on top of its page
+    const double INDEX_ENTRY_COST = 0.05; // one id out of a posting list
+
+    // Estimated cost of an index or bitmap path and what it finds.
+    struct IndexPath {
+        bool usable = false;
+        double fraction = 1; // of the table's rows, a superset of the matches
+        double cost = 0;     // of getting their ids from the indexes
+        int lookups = 0;
+    };
+
+    // Fraction of the non-NULL values below key, or up to it if inclusive,
+    // from the histogram; half of the bucket key falls in counts as below.
+    double fraction_below(const ColumnStats& column, const string& key, bool inclusive) {
+        const vector<string>& bounds = column.bounds;
+        if (bounds.empty()) return 0.5;
+        auto it = inclusive ? upper_bound(bounds.begin(), bounds.end(), key) : lower_bound(bounds.begin(), bounds.end(), key);
+        double buckets = static_cast<double>(it - bounds.begin());
+        if (it != bounds.end()) buckets += 0.5;
+        return min(1.0, buckets / bounds.size());
+    }
+
+    // Fraction of the rows a comparison with a constant selects.
+    double selectivity(const Predicate& comparison, const TableStats& stats) {
+        const ColumnStats& column = stats.columns[comparison.column];
+        double rows = max<double>(1, stats.row_count);
+        double null_fraction = column.null_count / rows;
+        double non_null = 1 - null_fraction;
+        bool null_key = comparison.key == index_key_null();
+        double equal = null_key ? null_fraction : (column.distinct > 0 ? non_null / column.distinct : 0);
+
+        double fraction;
+        switch (comparison.op) {
+            case CompareOp::EQ: fraction = equal; break;
+            case CompareOp::NE: fraction = 1 - equal; break;
+            case CompareOp::LT: fraction = null_key ? 0 : non_null * fraction_below(column, comparison.key, false); break;
+            case CompareOp::LE: fraction = null_key ? 0 : non_null * fraction_below(column, comparison.key, true); break;
+            case CompareOp::GT: fraction = null_key ? 0 : non_null * (1 - fraction_below(column, comparison.key, true)); break;
+            default: fraction = null_key ? 0 : non_null * (1 - fraction_below(column, comparison.key, false)); break;
+        }
+        return min(1.0, max(0.0, fraction));
     }
 
-    std::string table_name = query.substr(start + 5, open_paren - (start + 5));
-    trim(table_name);
+    // Reading the rows with the given ids, in id order: each page they
+    // are on is read once, nearly in order when most pages are needed.
+    double fetch_cost(double rows, double pages) {
+        double touched = pages * (1 - exp(-rows / pages));
+        double page_cost = RANDOM_PAGE_COST - (RANDOM_PAGE_COST - SEQ_PAGE_COST) * (touched / pages);
+        return touched * page_cost + rows * (FETCH_COST + ROW_COST);
+    }
 
-    string columns_str = query.substr(open_paren + 1, close_paren - open_paren - 1);
-    cout<< "[DEBUG] columns str: "<< columns_str<<endl;
-    vector<string> column_defs = split(columns_str, ',');
-    vector<string> columns;
-    vector<DataType> types;
-    string primary_key_name;
+    void clear_indexes(Predicate& where) {
+        if (where.kind != Expr::Kind::COMPARE) {
+            clear_indexes(*where.left);
+            clear_indexes(*where.right);
+        } else {
+            where.indexed = false;
+        }
+    }
 
-    for(auto& col_def : column_defs){
-        trim(col_def);
-        string col_def_lower = col_def;
-        std::transform(col_def_lower.begin(), col_def_lower.end(), col_def_lower.begin(), ::tolower);
+    void collect_and(Predicate& where, vector<Predicate*>& conditions) {
+        if (where.kind == Expr::Kind::AND) {
+            collect_and(*where.left, conditions);
+            collect_and(*where.right, conditions);
+        } else {
+            conditions.push_back(&where);
+        }
+    }
 
-        if(col_def_lower.rfind("primary key", 0) == 0){
-            size_t pk_start = col_def.find('(');
-            size_t pk_end = col_def.find(')');
-            if(pk_start == string::npos || pk_end == string::npos || pk_end <= pk_start + 1){
-                cout<<"[ERROR] Invalid PRIMARY KEY syntax."<<endl;
-                return false;
+    // Decides which indexes where should be answered with and clears the
+    // indexed flag of the rest. OR needs an index on both sides; AND uses
+    // the most selective of its indexed conditions, as many as pay off.
+    IndexPath choose_indexes(Predicate& where, const TableStats& stats, double rows, double pages) {
+        IndexPath path;
+        if (where.kind == Expr::Kind::COMPARE) {
+            if (where.column == RECORD_ID_COLUMN) {
+                path = {true, 1 / rows, 0, 1};
+            } else if (where.indexed) {
+                double fraction = selectivity(where, stats);
+                int probes = where.op == CompareOp::NE ? 2 : 1;
+                path = {true, fraction, probes * RANDOM_PAGE_COST + fraction * rows * INDEX_ENTRY_COST, probes};
             }
-
-            primary_key_name = col_def.substr(pk_start + 1, pk_end - pk_start - 1);
-            trim(primary_key_name);
-            continue;
+            return path;
         }
 
-        auto parts = split(col_def, ' ');
-        if(parts.size() != 2){
-            cout<< "[ERROR] Invalid column definition: "<<col_def<<endl;
-            return false;
+        if (where.kind == Expr::Kind::OR) {
+            IndexPath left = choose_indexes(*where.left, stats, rows, pages);
+            IndexPath right = choose_indexes(*where.right, stats, rows, pages);
+            if (!left.usable || !right.usable) {
+                clear_indexes(where);
+                return path;
+            }
+            return {true, left.fraction + right.fraction - left.fraction * right.fraction, left.cost + right.cost,
+                    left.lookups + right.lookups};
         }
 
-        string col_name = parts[0];
-        cout<<"[DEBUG] Column name: " << col_name<<endl;
-        string type_name = parts[1];
-        cout<<"[DEBUG] Type name: " << type_name<<endl;
-
-        std::transform(type_name.begin(), type_name.end(), type_name.begin(), ::toupper);
+        vector<Predicate*> conditions;
+        collect_and(where, conditions);
+        vector<pair<IndexPath, Predicate*>> usable;
+        for (Predicate* condition : conditions) {
+            IndexPath condition_path = choose_indexes(*condition, stats, rows, pages);
+            if (condition_path.usable) usable.push_back({condition_path, condition});
+        }
+        sort(usable.begin(), usable.end(), [](const auto& a, const auto& b) { return a.first.fraction < b.first.fraction; });
+
+        // Each further index narrows the rows to fetch but costs a lookup
+        size_t best = 0;
+        double best_cost = 0;
+        IndexPath combined = {true, 1, 0, 0};
+        for (size_t i = 0; i < usable.size(); ++i) {
+            combined.fraction *= usable[i].first.fraction;
+            combined.cost += usable[i].first.cost;
+            combined.lookups += usable[i].first.lookups;
+            double cost = combined.cost + fetch_cost(combined.fraction * rows, pages);
+            if (i == 0 || cost < best_cost) {
+                best = i + 1;
+                best_cost = cost;
+                path = combined;
+            }
+        }
+        for (size_t i = best; i < usable.size(); ++i) clear_indexes(*usable[i].second);
+        return path;
+    }
 
-        DataType type = parse_type(type_name);
-        if(type == DataType::UNKNOWN){
-            cout<<"[ERROR] Unsupported type: " << type_name << endl;
-            return false;
+    void split_and(const Expr& where, vector<const Expr*>& conditions) {
+        if (where.kind == Expr::Kind::AND) {
+            split_and(*where.left, conditions);
+            split_and(*where.right, conditions);
+        } else {
+            conditions.push_back(&where);
         }
+    }
+}
+
+QueryParser::QueryParser(CatalogManager& cm, TableManager& tm, IndexManager& im, TransactionManager& txm, const DBConfig& config)
+    : catalog_manager(cm), table_manager(tm), index_manager(im), transactions(txm), config(config), plan_cache(config.plan_cache_entries) {}
 
-        columns.push_back(col_name);
-        types.push_back(type);
+QueryParser::~QueryParser() {
+    if (session_transaction) {
+        table_manager.rollback(*session_transaction);
     }
+}
 
-    //Finding the index of the primary key
-    if(primary_key_name.empty()){
-        cout<<"[ERROR] PRIMARY KEY must be specified."<<endl;
+
+bool QueryParser::execute_query(const std::string& query) {
+    shared_ptr<PreparedStatement> plan = prepare(query);
+    if (!plan) {
         return false;
     }
 
-    int pk_idx = -1;
-    for(size_t i = 0; i < columns.size(); i++){
-        if(columns[i] == primary_key_name){
-            pk_idx = static_cast<int>(i);
-            break;
+    if (auto* s = get_if<PrepareStatement>(&plan->statement)) {
+        shared_ptr<PreparedStatement> prepared = prepare(s->body);
+        if (!prepared) {
+            return false;
         }
+        if (holds_alternative<PrepareStatement>(prepared->statement) ||
+            holds_alternative<ExecuteStatement>(prepared->statement) ||
+            holds_alternative<DeallocateStatement>(prepared->statement) ||
+            holds_alternative<TransactionStatement>(prepared->statement)) {
+            cout << "[ERROR] PREPARE, EXECUTE, DEALLOCATE, BEGIN, COMMIT and ROLLBACK cannot be prepared." << endl;
+            return false;
+        }
+        named_statements[s->name] = prepared;
+        cout << "[INFO] Statement '" << s->name << "' prepared with " << prepared->parameter_count << " parameter(s)." << endl;
+        return true;
+    } else if (auto* s = get_if<ExecuteStatement>(&plan->statement)) {
+        auto it = named_statements.find(s->name);
+        if (it == named_statements.end()) {
+            cout << "[ERROR] No prepared statement named '" << s->name << "'." << endl;
+            return false;
+        }
+        return execute(*it->second, s->parameters);
+    } else if (auto* s = get_if<DeallocateStatement>(&plan->statement)) {
+        if (named_statements.erase(s->name) == 0) {
+            cout << "[ERROR] No prepared statement named '" << s->name << "'." << endl;
+            return false;
+        }
+        cout << "[INFO] Statement '" << s->name << "' deallocated." << endl;
+        return true;
+    } else if (auto* s = get_if<TransactionStatement>(&plan->statement)) {
+        return execute_transaction(*s);
     }
 
-    if(pk_idx == -1){
-        cout<< "[ERROR] PRIMARY KEY column '" << primary_key_name << "' not found in the column list." << endl;
+    if (plan->parameter_count > 0) {
+        cout << "[ERROR] '?' parameters can only be used in PREPARE." << endl;
         return false;
     }
-
-    //Call Catalog Manager to create the table
-    return table_manager.create_table(table_name, columns, types, pk_idx);
+    return execute(*plan, {});
 }
 
+shared_ptr<PreparedStatement> QueryParser::prepare(const string& sql) {
+    shared_ptr<PreparedStatement> plan = plan_cache.get(sql);
+    if (plan && plan->schema_version == catalog_manager.get_schema_version()) {
+        return plan;
+    }
 
-bool QueryParser::parse_drop_table(const std::string& query) {
-    std::string query_lower = query;
-    transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
+    shared_lock<shared_mutex> reading(catalog_manager.table_latch());
+    plan = plan_statement(sql);
+    // Only row statements are worth keeping: they are the ones that repeat.
+    if (plan && (holds_alternative<InsertStatement>(plan->statement) ||
+                 holds_alternative<DeleteStatement>(plan->statement) ||
+                 holds_alternative<UpdateStatement>(plan->statement) ||
+                 holds_alternative<SelectStatement>(plan->statement))) {
+        plan_cache.put(sql, plan);
+    }
+    return plan;
+}
 
-    size_t pos1 = query_lower.find("table");
-    if (pos1 == string::npos) {
-        cout << "[ERROR] Syntax error in DROP TABLE." << endl;
+bool QueryParser::execute(PreparedStatement& plan, const vector<Literal>& parameters) {
+    if (static_cast<int>(parameters.size()) != plan.parameter_count) {
+        cout << "[ERROR] Statement takes " << plan.parameter_count << " parameter(s) but " << parameters.size() << " were given." << endl;
         return false;
     }
-    string after_table = query.substr(pos1 + 5);
-    trim(after_table);
 
-    string table_name = after_table;
-    if (!table_name.empty() && table_name.back() == ';') {
-        table_name.pop_back();
-        trim(table_name);
+    bool changes_tables = holds_alternative<CreateTableStatement>(plan.statement) ||
+                          holds_alternative<DropTableStatement>(plan.statement) ||
+                          holds_alternative<CreateIndexStatement>(plan.statement) ||
+                          holds_alternative<AnalyzeStatement>(plan.statement);
+    if (changes_tables && session_transaction) {
+        // Table changes are not versioned, so they could not be rolled back
+        cout << "[ERROR] CREATE, DROP and ANALYZE cannot be run inside a transaction." << endl;
+        return false;
     }
+    shared_lock<shared_mutex> reading(catalog_manager.table_latch(), defer_lock);
+    unique_lock<shared_mutex> changing(catalog_manager.table_latch(), defer_lock);
+    if (changes_tables) changing.lock();
+    else reading.lock();
 
-    bool success = catalog_manager.drop_table(table_name);
-    if (success) {
-        cout << "[INFO] Table '" << table_name << "' dropped." << endl;
+    if (plan.schema_version != catalog_manager.get_schema_version()) {
+        // A table or index was created or dropped since the plan was made.
+        shared_ptr<PreparedStatement> fresh = plan_statement(plan.sql);
+        if (!fresh) {
+            return false;
+        }
+        plan = std::move(*fresh);
+    }
+
+    unique_lock<mutex> writing;
+    if (holds_alternative<InsertStatement>(plan.statement) ||
+        holds_alternative<DeleteStatement>(plan.statement) ||
+        holds_alternative<UpdateStatement>(plan.statement)) {
+        writing = unique_lock<mutex>(*catalog_manager.get_write_latch(plan.schema.table_name));
+    }
+
+    // Outside BEGIN ... COMMIT the statement is a transaction of its own
+    unique_ptr<Transaction> statement_transaction;
+    Transaction* transaction = session_transaction.get();
+    if (!transaction) {
+        statement_transaction = transactions.begin();
+        transaction = statement_transaction.get();
+    }
+    Savepoint savepoint = transaction->savepoint();
+    bool success;
+    if (auto* s = get_if<CreateTableStatement>(&plan.statement)) {
+        success = execute_create_table(*s);
+        if (success) catalog_manager.bump_schema_version();
+    } else if (auto* s = get_if<DropTableStatement>(&plan.statement)) {
+        success = execute_drop_table(*s);
+        if (success) catalog_manager.bump_schema_version();
+    } else if (auto* s = get_if<CreateIndexStatement>(&plan.statement)) {
+        success = execute_create_index(*s);
+        if (success) catalog_manager.bump_schema_version();
+    } else if (holds_alternative<InsertStatement>(plan.statement)) {
+        success = execute_insert(plan, parameters, *transaction);
+    } else if (holds_alternative<DeleteStatement>(plan.statement)) {
+        success = execute_delete(plan, parameters, *transaction);
+    } else if (holds_alternative<UpdateStatement>(plan.statement)) {
+        success = execute_update(plan, parameters, *transaction);
+    } else if (holds_alternative<SelectStatement>(plan.statement)) {
+        success = execute_select(plan, parameters, transaction->snapshot);
+    } else if (auto* s = get_if<AnalyzeStatement>(&plan.statement)) {
+        success = execute_analyze(*s, transaction->snapshot);
     } else {
-        cout << "[ERROR] Table drop failed. Table may not exist." << endl;
-    }
+        cout << "[ERROR] Unsupported or invalid query." << endl;
+        success = false;
+    }
+    // A statement that fails part way leaves no change behind, inside a
+    // transaction from BEGIN too. Undone still under the write latch, so
+    // the next writer of the table never finds them.
+    if (!success) table_manager.rollback_statement(*transaction, savepoint);
+    if (statement_transaction) transactions.commit(*statement_transaction);
     return success;
 }
 
-bool QueryParser::parse_insert(const std::string& query) {
-    std::string query_lower = query;
-    transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t pos_into = query_lower.find("into");
-    if (pos_into == string::npos) {
-        cout << "[ERROR] Syntax error in INSERT INTO." << endl;
-        return false;
+bool QueryParser::execute_transaction(const TransactionStatement& statement) {
+    if (statement.kind == TransactionStatement::Kind::BEGIN) {
+        if (session_transaction) {
+            cout << "[ERROR] A transaction is already open." << endl;
+            return false;
+        }
+        session_transaction = transactions.begin();
+        cout << "[INFO] Transaction started." << endl;
+        return true;
     }
-    string after_into = query.substr(pos_into + 4);
-    trim(after_into);
 
-    size_t pos_values = query_lower.substr(pos_into + 4).find("values");
-    if (pos_values == string::npos) {
-        cout << "[ERROR] Syntax error: missing VALUES clause." << endl;
+    if (!session_transaction) {
+        cout << "[ERROR] No transaction is open." << endl;
         return false;
     }
-
-    string table_and_cols = after_into.substr(0, pos_values);
-    trim(table_and_cols);
-
-    string table_name;
-    vector<string> column_list;
-    size_t paren_open = table_and_cols.find('(');
-    size_t paren_close = table_and_cols.find(')');
-    if (paren_open != string::npos && paren_close != string::npos && paren_close > paren_open) {
-        table_name = table_and_cols.substr(0, paren_open);
-        trim(table_name);
-        string cols_str = table_and_cols.substr(paren_open + 1, paren_close - paren_open - 1);
-        column_list = split(cols_str, ',');
+    if (statement.kind == TransactionStatement::Kind::COMMIT) {
+        // Under the table latch like a statement's commit: no table can be
+        // dropped while its versions are stamped
+        shared_lock<shared_mutex> reading(catalog_manager.table_latch());
+        size_t changes = session_transaction->writes.size();
+        transactions.commit(*session_transaction);
+        cout << "[INFO] Transaction committed (" << changes << " version(s) written)." << endl;
     } else {
-        table_name = table_and_cols;
-        trim(table_name);
+        table_manager.rollback(*session_transaction);
+        cout << "[INFO] Transaction rolled back." << endl;
     }
+    session_transaction.reset();
+    return true;
+}
 
-    string after_values = after_into.substr(pos_values + 6);
-    trim(after_values);
+shared_ptr<PreparedStatement> QueryParser::plan_statement(const string& sql) {
+    auto plan = make_shared<PreparedStatement>();
+    string error;
+    if (!sql_parser.parse(sql, plan->statement, error)) {
+        cout << "[ERROR] Syntax error: " << error << endl;
+        return nullptr;
+    }
+    plan->sql = sql;
+    plan->parameter_count = sql_parser.parameter_count();
+    plan->schema_version = catalog_manager.get_schema_version();
+
+    bool ok = true;
+    if (auto* s = get_if<InsertStatement>(&plan->statement)) {
+        ok = plan_table(*plan, s->table);
+        if (ok && s->columns.empty()) {
+            for (size_t i = 0; i < plan->schema.columns.size(); ++i) plan->columns.push_back(static_cast<int>(i));
+        }
+        for (const string& col : s->columns) {
+            if (!ok) break;
+            int idx = column_position(plan->schema, col);
+            if (idx < 0) {
+                cout << "[ERROR] Column '" << col << "' not found in table '" << s->table << "'." << endl;
+                ok = false;
+            } else if (find(plan->columns.begin(), plan->columns.end(), idx) != plan->columns.end()) {
+                cout << "[ERROR] Column '" << col << "' is listed more than once." << endl;
+                ok = false;
+            } else {
+                plan->columns.push_back(idx);
+            }
+        }
+        for (const vector<Literal>& row : s->rows) {
+            if (ok && row.size() != plan->columns.size()) {
+                cout << "[ERROR] Number of columns and values do not match." << endl;
+                ok = false;
+            }
+        }
+    } else if (auto* s = get_if<DeleteStatement>(&plan->statement)) {
+        ok = plan_table(*plan, s->table) && (plan->where = plan_where(*s->where, plan->schema, s->table));
+    } else if (auto* s = get_if<UpdateStatement>(&plan->statement)) {
+        ok = plan_table(*plan, s->table);
+        for (const auto& assignment : s->assignments) {
+            if (!ok) break;
+            int idx = column_position(plan->schema, assignment.first);
+            if (idx < 0) {
+                cout<<"[ERROR] Column '"<< assignment.first << "' not found in table '" << s->table << "'." << endl;
+                ok = false;
+            }
+            plan->columns.push_back(idx);
+        }
+        ok = ok && (plan->where = plan_where(*s->where, plan->schema, s->table));
+    } else if (auto* s = get_if<SelectStatement>(&plan->statement)) {
+        ok = s->join ? plan_join(*plan, *s) : plan_table(*plan, s->table);
+        if (ok && !s->join && !s->alias.empty()) {
+            cout << "[ERROR] A table alias can only be given in a JOIN." << endl;
+            ok = false;
+        }
+        if (ok && s->items.empty()) {
+            if (!s->group_by.empty()) {
+                cout << "[ERROR] SELECT * cannot be used with GROUP BY." << endl;
+                ok = false;
+            }
+            for (size_t i = 0; i < plan->schema.columns.size(); ++i) plan->columns.push_back(static_cast<int>(i));
+        }
+        for (const string& column : s->group_by) {
+            if (!ok) break;
+            int idx = column_position(plan->schema, column);
+            if (idx < 0) {
+                report_unknown_column(plan->schema, column);
+                ok = false;
+            }
+            plan->group_by.push_back(idx);
+        }
+        bool aggregated = !s->group_by.empty();
+        for (const SelectItem& item : s->items) {
+            if (item.function != AggregateFunction::NONE) aggregated = true;
+        }
+        for (const SelectItem& item : s->items) {
+            if (!ok) break;
+            int idx = item.column.empty() ? -1 : column_position(plan->schema, item.column);
+            if (idx < 0 && !item.column.empty()) {
+                report_unknown_column(plan->schema, item.column);
+                ok = false;
+            } else if ((item.function == AggregateFunction::SUM || item.function == AggregateFunction::AVG) &&
+                       plan->schema.column_types[idx] == DataType::VARCHAR) {
+                cout << "[ERROR] " << item.name() << " needs an INT or FLOAT column." << endl;
+                ok = false;
+            } else if (aggregated && item.function == AggregateFunction::NONE &&
+                       find(plan->group_by.begin(), plan->group_by.end(), idx) == plan->group_by.end()) {
+                cout << "[ERROR] Column '" << item.column << "' must be in GROUP BY or inside an aggregate." << endl;
+                ok = false;
+            }
+            plan->columns.push_back(idx);
+        }
+        for (const OrderItem& item : s->order_by) {
+            if (!ok) break;
+            if (aggregated) {
+                // Sorts the aggregated rows, so it refers to a selected item
+                auto it = find_if(s->items.begin(), s->items.end(),
+                                  [&](const SelectItem& selected) { return selected.name() == item.column; });
+                if (it == s->items.end()) {
+                    cout << "[ERROR] ORDER BY " << item.column << " must be one of the selected items." << endl;
+                    ok = false;
+                }
+                plan->order_by.push_back({static_cast<int>(it - s->items.begin()), item.descending});
+                continue;
+            }
+            int idx = column_position(plan->schema, item.column);
+            if (idx < 0) {
+                report_unknown_column(plan->schema, item.column);
+                ok = false;
+            }
+            bool indexed = idx >= 0 && !s->join && index_manager.column_exists(s->table, plan->schema.columns[idx]);
+            plan->order_by.push_back({idx, item.descending, indexed});
+        }
+        if (ok && s->where) {
+            if (s->join) ok = plan_join_where(*plan, *s->where);
+            else ok = (plan->where = plan_where(*s->where, plan->schema, s->table)) != nullptr;
+        }
+    }
+    return ok ? plan : nullptr;
+}
 
-    if (after_values.empty() || after_values.front() != '(' || (after_values.back() != ';' && after_values.back() != ')')) {
-        cout << "[ERROR] Syntax error in VALUES clause." << endl;
+bool QueryParser::plan_table(PreparedStatement& plan, const string& table_name) {
+    const TableSchema* schema = catalog_manager.find_schema(table_name);
+    if (!schema) {
+        cout << "[ERROR] Table '" << table_name << "' does not exist." << endl;
         return false;
     }
+    plan.schema = *schema;
+    return true;
+}
 
-    if (after_values.back() == ';') {
-        after_values.pop_back();
+bool QueryParser::plan_join(PreparedStatement& plan, const SelectStatement& select) {
+    const JoinClause& clause = *select.join;
+    const TableSchema* left = catalog_manager.find_schema(select.table);
+    const TableSchema* right = catalog_manager.find_schema(clause.table);
+    if (!left || !right) {
+        cout << "[ERROR] Table '" << (left ? clause.table : select.table) << "' does not exist." << endl;
+        return false;
+    }
+    string left_name = select.alias.empty() ? select.table : select.alias;
+    string right_name = clause.alias.empty() ? clause.table : clause.alias;
+    if (left_name == right_name) {
+        cout << "[ERROR] Both tables of the JOIN are called '" << left_name << "'; give one an alias." << endl;
+        return false;
     }
 
-    if (after_values.front() == '(' && after_values.back() == ')') {
-        after_values = after_values.substr(1, after_values.size() - 2);
+    auto join = make_unique<JoinPlan>();
+    join->left = *left;
+    join->right = *right;
+    plan.schema = TableSchema();
+    plan.schema.table_name = left_name + " JOIN " + right_name;
+    for (size_t i = 0; i < left->columns.size(); ++i) {
+        plan.schema.columns.push_back(left_name + "." + left->columns[i]);
+        plan.schema.column_types.push_back(left->column_types[i]);
+    }
+    for (size_t i = 0; i < right->columns.size(); ++i) {
+        plan.schema.columns.push_back(right_name + "." + right->columns[i]);
+        plan.schema.column_types.push_back(right->column_types[i]);
     }
 
-    vector<string> values = split(after_values, ',');
+    // ON names a column of each table, in either order
+    int left_columns = static_cast<int>(left->columns.size());
+    int first = column_position(plan.schema, clause.left_column);
+    int second = column_position(plan.schema, clause.right_column);
+    if (first < 0 || second < 0) {
+        report_unknown_column(plan.schema, first < 0 ? clause.left_column : clause.right_column);
+        return false;
+    }
+    if ((first < left_columns) == (second < left_columns)) {
+        cout << "[ERROR] JOIN ON must compare a column of " << left_name << " with a column of " << right_name << "." << endl;
+        return false;
+    }
+    join->left_key = min(first, second);
+    join->right_key = max(first, second) - left_columns;
+    DataType left_type = left->column_types[join->left_key];
+    DataType right_type = right->column_types[join->right_key];
+    if ((left_type == DataType::VARCHAR) != (right_type == DataType::VARCHAR)) {
+        cout << "[ERROR] JOIN ON cannot compare " << to_string(left_type) << " with " << to_string(right_type) << "." << endl;
+        return false;
+    }
+    plan.join = std::move(join);
+    return true;
+}
 
-    if (!column_list.empty()) {
-        auto schema = catalog_manager.get_schema(table_name);
-        if (schema.columns.size() != values.size() || column_list.size() != values.size()) {
-            cout << "[ERROR] Number of columns and values do not match." << endl;
-            return false;
-        }
-        vector<string> reordered_values(schema.columns.size());
-        for (size_t i = 0; i < column_list.size(); ++i) {
-            string col = column_list[i];
-            trim(col);
-            auto it = std::find(schema.columns.begin(), schema.columns.end(), col);
-            if (it == schema.columns.end()) {
-                cout << "[ERROR] Column '" << col << "' not found in table '" << table_name << "'." << endl;
+bool QueryParser::plan_join_where(PreparedStatement& plan, const Expr& where) {
+    JoinPlan& join = *plan.join;
+    int left_columns = static_cast<int>(join.left.columns.size());
+
+    // Conditions on one table alone are checked while reading it, where
+    // its indexes can narrow the rows; the rest filter the joined rows.
+    vector<const Expr*> conditions;
+    split_and(where, conditions);
+    for (const Expr* condition : conditions) {
+        unique_ptr<Predicate> predicate = plan_where(*condition, plan.schema, plan.schema.table_name);
+        if (!predicate) return false;
+
+        // Which tables the condition reads: 1 left, 2 right, 3 both
+        int tables = 0;
+        vector<const Predicate*> stack = {predicate.get()};
+        while (!stack.empty()) {
+            const Predicate* node = stack.back();
+            stack.pop_back();
+            if (node->kind != Expr::Kind::COMPARE) {
+                stack.push_back(node->left.get());
+                stack.push_back(node->right.get());
+            } else if (node->column == RECORD_ID_COLUMN) {
+                cout << "[ERROR] record_id cannot be used with JOIN." << endl;
                 return false;
+            } else {
+                tables |= node->column < left_columns ? 1 : 2;
             }
-            size_t idx = std::distance(schema.columns.begin(), it);
-            reordered_values[idx] = values[i];
         }
-        values = reordered_values;
-    }
 
-    int record_id = table_manager.insert_into(table_name, values);
-    if (record_id == -1) {
-        cout << "[ERROR] Insert failed." << endl;
-        return false;
+        if (tables == 1) {
+            mark_indexed(*predicate, join.left);
+            join.left_where = both(std::move(join.left_where), std::move(predicate));
+        } else if (tables == 2) {
+            shift_columns(*predicate, -left_columns);
+            mark_indexed(*predicate, join.right);
+            join.right_where = both(std::move(join.right_where), std::move(predicate));
+        } else {
+            plan.where = both(std::move(plan.where), std::move(predicate));
+        }
     }
-
-    cout << "[INFO] Inserted record ID: " << record_id << endl;
     return true;
 }
 
-bool QueryParser::parse_delete(const std::string& query) {
-    std::string query_lower = query;
-    transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t pos_from = query_lower.find("from");
-    if (pos_from == string::npos) {
-        cout << "[ERROR] Syntax error in DELETE." << endl;
-        return false;
+void QueryParser::mark_indexed(Predicate& where, const TableSchema& schema) {
+    if (where.kind != Expr::Kind::COMPARE) {
+        mark_indexed(*where.left, schema);
+        mark_indexed(*where.right, schema);
+    } else {
+        where.indexed = index_manager.column_exists(schema.table_name, schema.columns[where.column]);
     }
-    string after_from = query.substr(pos_from + 4);
-    trim(after_from);
+}
 
-    size_t pos_where = query_lower.substr(pos_from + 4).find("where");
-    if (pos_where == string::npos) {
-        cout << "[ERROR] DELETE requires WHERE clause." << endl;
-        return false;
+unique_ptr<Predicate> QueryParser::plan_where(const Expr& where, const TableSchema& schema, const string& table_name) {
+    auto predicate = make_unique<Predicate>();
+    predicate->kind = where.kind;
+    if (where.kind != Expr::Kind::COMPARE) {
+        predicate->left = plan_where(*where.left, schema, table_name);
+        predicate->right = plan_where(*where.right, schema, table_name);
+        return predicate->left && predicate->right ? std::move(predicate) : nullptr;
+    }
+
+    predicate->op = where.op;
+    predicate->value = where.value;
+    predicate->column = column_position(schema, where.column);
+    if (predicate->column < 0) {
+        // record_id = N names a row directly, unless the table has such a column
+        if (where.column == "record_id" && where.op == CompareOp::EQ &&
+            (where.value.kind == Literal::Kind::INTEGER || where.value.kind == Literal::Kind::PARAMETER)) {
+            predicate->column = RECORD_ID_COLUMN;
+            return predicate;
+        }
+        report_unknown_column(schema, where.column);
+        return nullptr;
     }
-    string table_name = after_from.substr(0, pos_where);
-    trim(table_name);
 
-    string where_clause = after_from.substr(pos_where + 5);
-    trim(where_clause);
+    predicate->type = schema.column_types[predicate->column];
+    predicate->indexed = index_manager.column_exists(table_name, schema.columns[predicate->column]);
+    // Compare index keys rather than text, so numbers compare as numbers
+    if (where.value.kind != Literal::Kind::PARAMETER &&
+        !RowFormat::literal_index_key(predicate->type, where.value.sql(), predicate->key)) {
+        cout << "[ERROR] " << where.value.sql() << " is not a valid " << to_string(predicate->type) << " for column '" << where.column << "'" << endl;
+        return nullptr;
+    }
+    return predicate;
+}
 
-    string prefix = "record_id =";
-    if (where_clause.find(prefix) != 0) {
-        cout << "[ERROR] DELETE only supports WHERE record_id = <id> for now." << endl;
+bool QueryParser::execute_create_table(const CreateTableStatement& statement) {
+    //Finding the index of the primary key
+    if(statement.primary_key.empty()){
+        cout<<"[ERROR] PRIMARY KEY must be specified."<<endl;
         return false;
     }
-    string id_str = where_clause.substr(prefix.size());
-    trim(id_str);
 
-    if (!id_str.empty() && id_str.back() == ';') {
-        id_str.pop_back();
+    auto it = find(statement.columns.begin(), statement.columns.end(), statement.primary_key);
+    if(it == statement.columns.end()){
+        cout<< "[ERROR] PRIMARY KEY column '" << statement.primary_key << "' not found in the column list." << endl;
+        return false;
     }
+    int pk_idx = static_cast<int>(it - statement.columns.begin());
 
-    int record_id = stoi(id_str);
-
-    bool success = table_manager.delete_from(table_name, record_id);
-    if (!success) {
-        cout << "[ERROR] Delete failed." << endl;
-    } else {
-        cout << "[INFO] Record deleted successfully." << endl;
-    }
-    return success;
+    //Call Catalog Manager to create the table
+    return table_manager.create_table(statement.table, statement.columns, statement.types, pk_idx);
 }
 
-bool QueryParser::parse_update(const std::string& query) {
-    //UPDATE users SET name = 'Alice', age = 30 WHERE id = 1;
-    string query_lower = query;
-    transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-    
-    size_t pos_set = query_lower.find("set");
-    if(pos_set == string::npos){
-        cout<<"[ERROR] Syntax Error: missing SET"<<endl;
-        return false;
-    }
 
-    size_t pos_where = query_lower.find("where");
-    if(pos_where == string::npos){
-        cout<<"[ERROR] UPDATE requires a WHERE clause."<<endl;
+bool QueryParser::execute_drop_table(const DropTableStatement& statement) {
+    // Open transactions may hold versions of the table to stamp or undo.
+    // Under the exclusive table latch the only others are ones from BEGIN;
+    // this statement's own is always there.
+    if (transactions.open_transactions() > 1) {
+        cout << "[ERROR] Tables cannot be dropped while other sessions have a transaction open." << endl;
         return false;
     }
+    bool success = catalog_manager.drop_table(statement.table);
+    if (success) {
+        cout << "[INFO] Table '" << statement.table << "' dropped." << endl;
+    } else {
+        cout << "[ERROR] Table drop failed. Table may not exist." << endl;
+    }
+    return success;
+}
 
-    string table_name = query.substr(6, pos_set - 6);
-    trim(table_name);
+bool QueryParser::execute_insert(const PreparedStatement& plan, const vector<Literal>& parameters, Transaction& transaction) {
+    const InsertStatement& statement = get<InsertStatement>(plan.statement);
 
-    string set_clause = query.substr(pos_set + 3, pos_where - (pos_set + 3));
-    trim(set_clause);
+    bool success = true;
+    vector<string> values;
+    for (const vector<Literal>& row : statement.rows) {
+        // Columns missing from the list are NULL
+        values.assign(plan.schema.columns.size(), "NULL");
+        for (size_t i = 0; i < row.size(); ++i) {
+            values[plan.columns[i]] = bind(row[i], parameters).sql();
+        }
 
-    string where_clause = query.substr(pos_where + 5);
-    trim(where_clause);
-    if(!where_clause.empty() && where_clause.back() == ';') where_clause.pop_back();
+        int record_id = table_manager.insert_into(statement.table, values, transaction);
+        if (record_id == -1) {
+            cout << "[ERROR] Insert failed." << endl;
+            success = false;
+            continue;
+        }
+        cout << "[INFO] Inserted record ID: " << record_id << endl;
+    }
+    return success;
+}
 
-    size_t eq_pos = where_clause.find('=');
-    if(eq_pos == string::npos){
-        cout<<"[ERROR] Invalid WHERE clause."<<endl;
+bool QueryParser::execute_delete(const PreparedStatement& plan, const vector<Literal>& parameters, Transaction& transaction) {
+    const string& table_name = get<DeleteStatement>(plan.statement).table;
+    vector<int> ids;
+    if (!matching_ids(plan, parameters, transaction.snapshot, ids)) {
         return false;
     }
-    string where_col = where_clause.substr(0, eq_pos);
-    string where_val = where_clause.substr(eq_pos + 1);
-    trim(where_col);
-    trim(where_val);
 
-    //validate table and column
-    TableSchema schema = catalog_manager.get_schema(table_name);
-    cout << "[INFO] Columns in table '" << table_name << "': ";
-    for (const auto& col : schema.columns) {
-        cout << col << " ";
-    }
-    cout << endl;
-    if (schema.columns.empty()) {
-        cout << "[ERROR] Table " << table_name << " does not exist." << endl;
-        return false;
+    bool success = true;
+    int deleted = 0;
+    for (int record_id : ids) {
+        if (table_manager.delete_from(table_name, record_id, transaction)) {
+            deleted++;
+        } else {
+            success = false;
+        }
     }
 
-    auto where_it = find(schema.columns.begin(), schema.columns.end(), where_col);
-    if(where_it == schema.columns.end()){
-        cout<<"[ERROR] Column '"<< where_col <<"' not found in table '" << table_name <<"'."<<endl;
-        return false;
+    if (!success) {
+        cout << "[ERROR] Delete failed." << endl;
+    } else if (deleted == 0) {
+        cout << "[INFO] No matching records were deleted." << endl;
+    } else {
+        cout << "[INFO] " << deleted << " record(s) deleted successfully." << endl;
     }
+    return success;
+}
+
+bool QueryParser::execute_update(const PreparedStatement& plan, const vector<Literal>& parameters, Transaction& transaction) {
+    //UPDATE users SET name = 'Alice', age = 30 WHERE id = 1;
+    const UpdateStatement& statement = get<UpdateStatement>(plan.statement);
+    const string& table_name = statement.table;
 
-    int where_col_idx = distance(schema.columns.begin(), where_it);
-    vector<int> matching_ids = index_manager.search(table_name, where_col, where_val);
+    vector<string> assigned_values;
+    for (const auto& assignment : statement.assignments) {
+        assigned_values.push_back(bind(assignment.second, parameters).sql());
+    }
 
-    //Parse SET assignments
-    vector<string> assignments = split(set_clause, ',');
-    if(assignments.empty()){
-        cout<<"[ERROR] No assignments in SET clause."<<endl;
+    vector<int> ids;
+    if (!matching_ids(plan, parameters, transaction.snapshot, ids)) {
         return false;
     }
 
-    //apply changes
-    bool any_success = false;
-    for(int record_id : matching_ids){
-        Record rec = table_manager.select(table_name, record_id);
+    //apply changes; one row that cannot be changed fails the statement,
+    //which is then undone as a whole
+    bool success = true;
+    int updated = 0;
+    RowFormat format(plan.schema.column_types);
+    for(int record_id : ids){
+        Record rec = table_manager.select(table_name, record_id, transaction.snapshot);
         if(rec.data.empty()){
             cout<< "[WARNING] Skipping invalid RecordID: "<<record_id <<endl;
             continue;
         }
 
-        vector<string> current_record = table_manager.unpack_record(rec, schema);
-
-        for(const string& assign : assignments){
-            size_t eq_pos = assign.find("=");
-
-            if(eq_pos == string::npos){
-                cout<<"[ERROR] Invalid assignment: "<< assign << endl;
-                return false;
-            }
-
-            string col = assign.substr(0, eq_pos);
-            string val = assign.substr(eq_pos + 1);
-            trim(col);
-            trim(val);
-
-            auto it = find(schema.columns.begin(), schema.columns.end(), col);
-            if(it == schema.columns.end()){
-                cout<<"[ERROR] Column '"<< col << "' not found in table '" << table_name << "'." << endl;
-                return false;
-            }
-
-            int col_idx = distance(schema.columns.begin(), it);
-            current_record[col_idx] = val;
+        vector<string> current_record = format.decode(rec.data);
+        for (size_t i = 0; i < assigned_values.size(); ++i) {
+            current_record[plan.columns[i]] = assigned_values[i];
         }
 
-        if(table_manager.update(table_name, record_id, current_record)){
-            any_success = true;
+        if(table_manager.update(table_name, record_id, current_record, transaction)){
+            updated++;
             cout<< "[INFO] Record " << record_id << " updated." << endl;
         } else {
             cout << "[ERROR] Failed to update record ID " << record_id << "." << endl;
+            success = false;
+            break;
         }
     }
 
-    if(!any_success){
+    if(success && updated == 0){
         cout << "[INFO] No matching records were updated." << endl;
     }
 
-    return any_success;
+    return success;
 }
 
-bool QueryParser::parse_select(const std::string& query) {
-    std::string query_lower = query;
-    transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
+bool QueryParser::execute_select(const PreparedStatement& plan, const vector<Literal>& parameters, const Snapshot& snapshot) {
+    const SelectStatement& statement = get<SelectStatement>(plan.statement);
 
-    size_t pos_select = query_lower.find("select");
-    size_t pos_from = query_lower.find("from");
-    if (pos_select == string::npos || pos_from == string::npos || pos_from <= pos_select + 6) {
-        cout << "[ERROR] Syntax error in SELECT: Missing or misplaced SELECT/FROM clause." << endl;
+    unique_ptr<Predicate> where;
+    if (plan.where && !(where = bind_predicate(*plan.where, plan.schema, parameters))) {
         return false;
     }
-
-    string select_clause = query.substr(pos_select + 6, pos_from - (pos_select + 6));
-    trim(select_clause);
-
-    string after_from = query.substr(pos_from + 4);
-    trim(after_from);
-
-    size_t pos_where_global = query_lower.find("where", pos_from + 4);
-    string table_name;
-    string where_clause;
-
-    if (pos_where_global != string::npos) {
-        table_name = query.substr(pos_from + 4, pos_where_global - (pos_from + 4));
-        trim(table_name);
-        where_clause = query.substr(pos_where_global + 5);  // 5 = length of "where"
-        trim(where_clause);
-        if (!where_clause.empty() && where_clause.back() == ';') where_clause.pop_back();
-    } else {
-        table_name = query.substr(pos_from + 4);
-        if (!table_name.empty() && table_name.back() == ';') table_name.pop_back();
-        trim(table_name);
+    bool aggregated = !plan.group_by.empty();
+    for (const SelectItem& item : statement.items) {
+        if (item.function != AggregateFunction::NONE) aggregated = true;
     }
-
-    TableSchema schema = catalog_manager.get_schema(table_name);
-    if (schema.table_name.empty()) {
-        cout << "[ERROR] Table '" << table_name << "' does not exist." << endl;
-        return false;
+    // With a LIMIT, an index on the ORDER BY column can hand out the rows
+    // in order and the scan stops once the limit is reached.
+    const SortKey* order = nullptr;
+    if (!aggregated && statement.limit >= 0 && plan.order_by.size() == 1 && plan.order_by[0].indexed) {
+        order = &plan.order_by[0];
     }
 
-    vector<string> selected_columns;
-    vector<int> selected_indices;
-
-    if (select_clause == "*") {
-        selected_columns = schema.columns;
-        for (int i = 0; i < schema.columns.size(); ++i) selected_indices.push_back(i);
+    unique_ptr<Operator> root;
+    bool ordered = false;
+    if (aggregated && !plan.join && !where && plan.group_by.empty() && statement.items.size() == 1 &&
+        statement.items[0].function == AggregateFunction::COUNT && plan.columns[0] < 0) {
+        // COUNT(*) of the whole table: the slot directories have the answer
+        root = make_unique<SlotCount>(*catalog_manager.get_heap(plan.schema.table_name), snapshot, statement.items[0].name());
     } else {
-        selected_columns = split(select_clause, ',');
-        for (auto& col : selected_columns) trim(col);
-
-        for (const string& col : selected_columns) {
-            auto it = find(schema.columns.begin(), schema.columns.end(), col);
-            if (it == schema.columns.end()) {
-                cout << "[ERROR] Column '" << col << "' not found in table '" << table_name << "'" << endl;
-                return false;
+        if (plan.join) {
+            root = join_tables(plan, parameters, snapshot, std::move(where));
+            if (!root) return false;
+        } else {
+            root = scan_rows(plan.schema, snapshot, std::move(where), order, ordered);
+        }
+        if (aggregated) {
+            vector<AggregateSpec> specs;
+            vector<string> names;
+            for (size_t i = 0; i < statement.items.size(); ++i) {
+                specs.push_back({statement.items[i].function, plan.columns[i]});
+                names.push_back(statement.items[i].name());
+            }
+            if (plan.group_by.empty()) {
+                root = make_unique<Aggregate>(std::move(root), std::move(specs), std::move(names));
+            } else {
+                root = make_unique<HashAggregate>(std::move(root), plan.group_by, std::move(specs), std::move(names),
+                                                  config.work_mem_bytes, catalog_manager.temp_dir());
             }
-            selected_indices.push_back(it - schema.columns.begin());
         }
     }
 
-    vector<Record> results;
-    if (!where_clause.empty()) {
-        results = where_clause_handler(where_clause, schema, table_name);
-    } else {
-        results = table_manager.scan(table_name);
-    }
-
-    // Output using pretty table
-    pretty::Table output_table;
-    output_table.add_row(selected_columns);
-
-    for (const Record& rec : results) {
-        string rec_str(rec.data.begin(), rec.data.end());
-        vector<string> row = split(rec_str, '|');
-
-        vector<string> selected_row;
-        for (int idx : selected_indices) {
-            if (idx < row.size()) selected_row.push_back(row[idx]);
-            else selected_row.push_back("");
+    bool limited = false;
+    if (!plan.order_by.empty() && !ordered) {
+        if (statement.limit >= 0) {
+            root = make_unique<TopN>(std::move(root), plan.order_by, statement.limit);
+            limited = true;
+        } else {
+            root = make_unique<Sort>(std::move(root), plan.order_by, config.work_mem_bytes, catalog_manager.temp_dir());
         }
-
-        output_table.add_row(selected_row);
     }
-
-    if (results.empty()) {
-        vector<string> empty_row(selected_columns.size(), "");
-        empty_row[0] = "No matching records";
-        output_table.add_row(empty_row);
+    if (statement.limit >= 0 && !limited) {
+        root = make_unique<Limit>(std::move(root), statement.limit);
+    }
+    if (!aggregated) {
+        root = make_unique<Project>(std::move(root), plan.columns);
     }
 
-    pretty::Printer printer;
-    printer.frame(pretty::FrameStyle::Basic);
-    cout << printer(output_table) << endl;
+    // Rows go to the output as the operators produce them.
+    ResultPrinter printer(cout, root->names());
+    if (result_set) {
+        result_set->columns = root->names();
+        result_set->clear();
+    }
+    Row row;
+    try {
+        root->open();
+        while (root->next(row)) {
+            if (result_set) result_set->add_row(root->format().decode(row.data));
+            else printer.add_row(root->format().decode(row.data));
+        }
+        root->close();
+    } catch (const runtime_error& e) {
+        // Spill files could not be written or read back, or the rows could
+        // not be passed on
+        cout << "[ERROR] " << e.what() << endl;
+        return false;
+    }
+    if (!result_set) printer.finish();
 
     return true;
 }
@@ -544,62 +912,41 @@ void QueryParser::run_interactive() {
     }
 }
 
-bool QueryParser::parse_print_table(const std::string& query) {
-    std::string q = query;
-    transform(q.begin(), q.end(), q.begin(), ::tolower);
-    
-    size_t pos = q.find("select * from ");
-    if (pos == std::string::npos) return false;
-    
-    std::string tableName = query.substr(pos + 13);
-    trim(tableName);
-    
-    if (!tableName.empty() && tableName.back() == ';') {
-        tableName.pop_back();
-    }
-    trim(tableName);
-    
-    if (tableName.empty()) {
-        std::cout << "[ERROR] Missing table name" << std::endl;
-        return false;
-    }
-    
-    table_manager.printTable(tableName);
-    return true;
-}
-
-bool QueryParser::parse_create_index(const std::string& query){
-    string query_lower = query;
-    transform(query_lower.begin(), query_lower.end(), query_lower.begin(), ::tolower);
-
-    size_t on_pos = query_lower.find("on");
-    if(on_pos == string::npos){
-        std::cout << "[ERROR] Syntax error in CREATE INDEX query." << std::endl;
+bool QueryParser::execute_analyze(const AnalyzeStatement& statement, const Snapshot& snapshot) {
+    vector<string> tables;
+    if (statement.table.empty()) {
+        tables = catalog_manager.list_tables();
+        sort(tables.begin(), tables.end());
+    } else if (catalog_manager.find_schema(statement.table)) {
+        tables.push_back(statement.table);
+    } else {
+        cout << "[ERROR] Table '" << statement.table << "' does not exist." << endl;
         return false;
     }
 
-    string after_on = query.substr(on_pos + 2);
-    trim(after_on);
-
-    size_t paren_start = after_on.find('(');
-    size_t paren_end = after_on.find(')');
-
-    if (paren_start == std::string::npos || paren_end == std::string::npos || paren_end <= paren_start) {
-        std::cout << "[ERROR] Expected format: CREATE INDEX ON table(column);" << std::endl;
-        return false;
+    for (const string& table : tables) {
+        const TableSchema& schema = *catalog_manager.find_schema(table);
+        TableStats stats = TableStats::collect(*catalog_manager.get_heap(table), schema.column_types, snapshot);
+        int64_t rows = stats.row_count, pages = stats.page_count;
+        if (!catalog_manager.set_stats(table, std::move(stats))) {
+            cout << "[ERROR] Could not save the statistics of table '" << table << "'." << endl;
+            return false;
+        }
+        cout << "[INFO] Analyzed table '" << table << "': " << rows << " rows in " << pages << " pages." << endl;
     }
+    return true;
+}
 
-    std::string table = after_on.substr(0, paren_start);
-    std::string column = after_on.substr(paren_start + 1, paren_end - paren_start - 1);
-    trim(table);
-    trim(column);
+bool QueryParser::execute_create_index(const CreateIndexStatement& statement){
+    const string& table = statement.table;
+    const string& column = statement.column;
 
     if (!catalog_manager.column_exists(table, column)) {
         std::cout << "[ERROR] Column '" << column << "' does not exist in table '" << table << "'\n";
         return false;
     }
 
-    if (index_manager.create_index(table, column)) {
+    if (table_manager.create_index(table, column)) {
         std::cout << "[INFO] Index created on " << table << "(" << column << ")\n";
         return true;
     } else {
@@ -618,356 +965,222 @@ bool QueryParser::parse_create_index(const std::string& query){
 #define DEBUG_SUCCESS_LABEL     DEBUG_COLOR_GREEN "[SUCCESS]" DEBUG_COLOR_RESET
 #define DEBUG_LABEL             DEBUG_COLOR_YELLOW "[DEBUG]" DEBUG_COLOR_RESET
 #define DEBUG_EQHANDLER         DEBUG_COLOR_YELLOW "[EQHANDLER]" DEBUG_COLOR_RESET
+#define DEBUG_PLANNER_LABEL     DEBUG_COLOR_YELLOW "[PLANNER]" DEBUG_COLOR_RESET
 #define DEBUG_ERROR             std::cout << DEBUG_ERROR_LABEL << DEBUG_EQHANDLER << " "
 #define DEBUG_SUCCESS           std::cout << DEBUG_SUCCESS_LABEL << DEBUG_EQHANDLER << " "
 #define DEBUG                   std::cout << DEBUG_LABEL << DEBUG_EQHANDLER << " "
-
-vector<Record> QueryParser::where_clause_handler(const std::string& where_clause, const TableSchema& schema, const string& table_name) {
-    string clause = where_clause;
-    trim(clause);
-
-    // Handle OR first because it has lower precedence than AND
-    size_t or_pos = clause.find(" OR ");
-    if (or_pos != string::npos) {
-        string left = clause.substr(0, or_pos);
-        string right = clause.substr(or_pos + 4);
-        auto left_result = where_clause_handler(left, schema, table_name);
-        auto right_result = where_clause_handler(right, schema, table_name);
-        return union_records(left_result, right_result);
-    }
-
-    // Handle AND next
-    size_t and_pos = clause.find(" AND ");
-    if (and_pos != string::npos) {
-        string left = clause.substr(0, and_pos);
-        string right = clause.substr(and_pos + 5);
-        auto left_result = where_clause_handler(left, schema, table_name);
-        auto right_result = where_clause_handler(right, schema, table_name);
-        return intersect_records(left_result, right_result);
-    }
-
-    // Handle basic comparisons
-    if (clause.find(">=") != string::npos) {
-        return handle_greater_equal(clause, schema, table_name);
-    } else if (clause.find("<=") != string::npos) {
-        return handle_lesser_equal(clause, schema, table_name);
-    } else if (clause.find("!=") != string::npos) {
-        return handle_not_equal(clause, schema, table_name);
-    } else if (clause.find('=') != string::npos) {
-        return handle_equal(clause, schema, table_name);
-    } else if (clause.find('>') != string::npos) {
-        return handle_greater(clause, schema, table_name);
-    } else if (clause.find('<') != string::npos) {
-        return handle_lesser(clause, schema, table_name);
-    } else {
-        DEBUG_ERROR << "Unsupported or malformed WHERE clause: " << clause << std::endl;
-        return {};
-    }
+#define DEBUG_PLANNER           std::cout << DEBUG_LABEL << DEBUG_PLANNER_LABEL << " "
+
+unique_ptr<Predicate> QueryParser::bind_predicate(const Predicate& where, const TableSchema& schema, const vector<Literal>& parameters) {
+    auto bound = make_unique<Predicate>();
+    bound->kind = where.kind;
+    if (where.kind != Expr::Kind::COMPARE) {
+        bound->left = bind_predicate(*where.left, schema, parameters);
+        bound->right = bind_predicate(*where.right, schema, parameters);
+        return bound->left && bound->right ? std::move(bound) : nullptr;
+    }
+
+    bound->column = where.column;
+    bound->type = where.type;
+    bound->op = where.op;
+    bound->indexed = where.indexed;
+    bound->value = bind(where.value, parameters);
+    bound->key = where.key;
+    if (where.value.kind == Literal::Kind::PARAMETER && where.column != RECORD_ID_COLUMN &&
+        !RowFormat::literal_index_key(where.type, bound->value.sql(), bound->key)) {
+        cout << "[ERROR] " << bound->value.sql() << " is not a valid " << to_string(where.type) << " for column '" << schema.columns[where.column] << "'" << endl;
+        return nullptr;
+    }
+    return bound;
 }
 
-vector<Record> QueryParser::intersect_records(const vector<Record>& a, const vector<Record>& b) {
-    unordered_set<string> keys_b;
-    for (const auto& rec : b) {
-        keys_b.insert(string(rec.data.begin(), rec.data.end()));
-    }
-
-    vector<Record> result;
-    for (const auto& rec : a) {
-        string rec_str(rec.data.begin(), rec.data.end());
-        if (keys_b.count(rec_str)) {
-            result.push_back(rec);
-        }
-    }
-    return result;
+void QueryParser::choose_access_path(Predicate& where, const TableSchema& schema, RecordManager& heap) {
+    const TableStats* stats = catalog_manager.find_stats(schema.table_name);
+    if (!stats) return; // not analyzed: every index that applies is used
+
+    // The table may have grown since ANALYZE; assume its rows per page have not changed
+    double pages = max(1, heap.get_buffer_pool().get_num_pages(heap.get_file_id()));
+    double rows = stats->page_count > 0 ? stats->row_count * pages / stats->page_count : stats->row_count;
+    rows = max(1.0, rows);
+
+    IndexPath path = choose_indexes(where, *stats, rows, pages);
+    double seq_cost = pages * SEQ_PAGE_COST + rows * ROW_COST;
+    double index_cost = path.cost + fetch_cost(path.fraction * rows, pages);
+    const char* index_path = path.lookups > 1 ? "bitmap scan" : "index scan";
+    bool use_index = path.usable && index_cost < seq_cost;
+    if (!use_index) clear_indexes(where);
+    if (!config.log_plans) return;
+
+    ostringstream costs;
+    costs << fixed << setprecision(1) << "seq scan " << seq_cost;
+    if (path.usable) costs << ", " << index_path << " " << index_cost << " (" << path.fraction * rows << " rows)";
+    DEBUG_PLANNER << schema.table_name << ": " << costs.str() << "; using " << (use_index ? index_path : "seq scan") << std::endl;
 }
 
-vector<Record> QueryParser::union_records(const vector<Record>& a, const vector<Record>& b) {
-    unordered_set<string> seen;
-    vector<Record> result;
-
-    for (const auto& rec : a) {
-        string rec_str(rec.data.begin(), rec.data.end());
-        if (seen.insert(rec_str).second) {
-            result.push_back(rec);
-        }
-    }
-    for (const auto& rec : b) {
-        string rec_str(rec.data.begin(), rec.data.end());
-        if (seen.insert(rec_str).second) {
-            result.push_back(rec);
-        }
+unique_ptr<Operator> QueryParser::scan_rows(const TableSchema& schema, const Snapshot& snapshot, unique_ptr<Predicate> where, const SortKey* order, bool& ordered) {
+    RecordManager& heap = *catalog_manager.get_heap(schema.table_name);
+    ordered = false;
+    if (where) choose_access_path(*where, schema, heap);
+
+    PostingList ids;
+    bool exact = false;
+    unique_ptr<Operator> scan;
+    if (where && index_ids(*where, schema, ids, exact)) {
+        scan = make_unique<IndexScan>(heap, schema, snapshot, std::move(ids));
+        if (exact) return scan;
+    } else if (order) {
+        // Every row has to be looked at anyway; take them in index order.
+        scan = make_unique<IndexOrderScan>(heap, index_manager, schema, snapshot, *order);
+        ordered = true;
+    } else {
+        scan = make_unique<SeqScan>(heap, schema, snapshot);
     }
-    return result;
+    return where ? make_unique<Filter>(std::move(scan), std::move(where)) : std::move(scan);
 }
 
-
-vector<Record> QueryParser::handle_equal(const std::string& where_clause,const TableSchema& schema, const string& table_name){
-    size_t op_pos = where_clause.find("=");
-    vector<Record> results;
-
-    if(op_pos == string::npos){
-        DEBUG_ERROR << "Expected operator '=' not found in the WHERE clause." << std::endl;
-        return {};
-    }
-
-    string col = where_clause.substr(0, op_pos);
-    string val = where_clause.substr(op_pos + 1);
-    trim(col), trim(val);
-
-    auto it = find(schema.columns.begin(), schema.columns.end(), col);
-    if(it == schema.columns.end()) {
-        DEBUG_ERROR << "Column '"<<col<< "' not found in the table '"<< table_name << endl;
-        return {};
-    }
-
-    int col_idx = it - schema.columns.begin();
-
-    vector<int> matching_ids = index_manager.search(table_name, col, val);
-    if(matching_ids.empty()){
-        DEBUG_ERROR << "No Matching ids found for " << col << " = " << val << " in the table '" << table_name << "'" << endl;
-        return {};
-    }
-
-    for(int id : matching_ids){
-        Record rec = table_manager.select(table_name, id);
-        string rec_str(rec.data.begin(), rec.data.end());
-        vector<string> row = split(rec_str, '|');
-        if(row.size() > col_idx && row[col_idx] == val){
-            results.push_back(rec);
-        }
-    }
-
-    if (!results.empty()) {
-        DEBUG_SUCCESS << "Found " << results.size() << " record(s) for " << col << " = " << val << " in table '" << table_name << "'" << std::endl;
+unique_ptr<Operator> QueryParser::join_tables(const PreparedStatement& plan, const vector<Literal>& parameters, const Snapshot& snapshot, unique_ptr<Predicate> where) {
+    const JoinPlan& join = *plan.join;
+    unique_ptr<Predicate> left_where, right_where;
+    if ((join.left_where && !(left_where = bind_predicate(*join.left_where, join.left, parameters))) ||
+        (join.right_where && !(right_where = bind_predicate(*join.right_where, join.right, parameters)))) {
+        return nullptr;
+    }
+
+    int left_columns = static_cast<int>(join.left.columns.size());
+    bool left_indexed = index_manager.column_exists(join.left.table_name, join.left.columns[join.left_key]);
+    bool right_indexed = index_manager.column_exists(join.right.table_name, join.right.columns[join.right_key]);
+    // Given the choice, the table with conditions of its own is the outer
+    // one: fewer rows means fewer lookups.
+    bool right_inner = right_indexed && (!left_indexed || left_where || !right_where);
+    bool ordered;
+    unique_ptr<Operator> rows;
+    if (right_inner) {
+        // The right table's rows are fetched by id, so its conditions are
+        // checked on the joined rows.
+        rows = make_unique<IndexNestedLoopJoin>(scan_rows(join.left, snapshot, std::move(left_where), nullptr, ordered), join.left_key,
+                                                *catalog_manager.get_heap(join.right.table_name), snapshot, index_manager, join.right,
+                                                join.right_key, true, plan.schema);
+        if (right_where) shift_columns(*right_where, left_columns);
+        where = both(std::move(right_where), std::move(where));
+    } else if (left_indexed) {
+        rows = make_unique<IndexNestedLoopJoin>(scan_rows(join.right, snapshot, std::move(right_where), nullptr, ordered), join.right_key,
+                                                *catalog_manager.get_heap(join.left.table_name), snapshot, index_manager, join.left,
+                                                join.left_key, false, plan.schema);
+        where = both(std::move(left_where), std::move(where));
+    } else {
+        rows = make_unique<HashJoin>(scan_rows(join.left, snapshot, std::move(left_where), nullptr, ordered), join.left_key,
+                                     scan_rows(join.right, snapshot, std::move(right_where), nullptr, ordered), join.right_key,
+                                     plan.schema, config.work_mem_bytes, catalog_manager.temp_dir());
     }
-    return results;
+    return where ? make_unique<Filter>(std::move(rows), std::move(where)) : std::move(rows);
 }
 
-vector<Record> QueryParser::handle_not_equal(const std::string& where_clause, const TableSchema& schema, const string& table_name) {
-    size_t op_pos = where_clause.find("!=");
-    vector<Record> results;
-
-    if(op_pos == string::npos){
-        DEBUG_ERROR << "Expected operator '!=' not found in the WHERE clause." << std::endl;
-        return {};
+bool QueryParser::matching_ids(const PreparedStatement& plan, const vector<Literal>& parameters, const Snapshot& snapshot, vector<int>& ids) {
+    unique_ptr<Predicate> where = bind_predicate(*plan.where, plan.schema, parameters);
+    if (!where) {
+        return false;
     }
 
-    string col = where_clause.substr(0, op_pos);
-    string val = where_clause.substr(op_pos + 2); // Skip "!="
-    trim(col), trim(val);
-
-    auto it = find(schema.columns.begin(), schema.columns.end(), col);
-    if (it == schema.columns.end()) {
-        DEBUG_ERROR << "Column '" << col << "' not found in table '" << table_name << "'" << std::endl;
-        return {};
+    // Collected before any row changes, so the scan never sees its own writes.
+    bool ordered;
+    unique_ptr<Operator> rows = scan_rows(plan.schema, snapshot, std::move(where), nullptr, ordered);
+    Batch batch;
+    rows->open();
+    while (rows->next_batch(batch)) {
+        for (uint16_t r : batch.selection) ids.push_back(batch.rows[r].record_id);
     }
+    rows->close();
+    return true;
+}
 
-    int col_idx = it - schema.columns.begin();
-
-    // If index exists, use two range searches
-    vector<int> matching_ids;
-    if (index_manager.column_exists(table_name, col)) {
-        vector<int> less_than = index_manager.range_search(table_name, col, "", val);     // col < val
-        vector<int> greater_than = index_manager.range_search(table_name, col, val + '\1', "~"); // col > val ('~' is high ASCII)
-
-        matching_ids.insert(matching_ids.end(), less_than.begin(), less_than.end());
-        matching_ids.insert(matching_ids.end(), greater_than.begin(), greater_than.end());
-    } else {
-        // Fallback to full scan if no index
-        for (const Record& rec : table_manager.scan(table_name)) {
-            string rec_str(rec.data.begin(), rec.data.end());
-            vector<string> row = split(rec_str, '|');
-            if (row.size() > col_idx && row[col_idx] != val) {
-                results.push_back(rec);
+bool QueryParser::index_ids(const Predicate& where, const TableSchema& schema, PostingList& ids, bool& exact) {
+    switch (where.kind) {
+        case Expr::Kind::OR: {
+            PostingList right;
+            bool left_exact, right_exact;
+            if (!index_ids(*where.left, schema, ids, left_exact) || !index_ids(*where.right, schema, right, right_exact)) {
+                return false;
             }
+            ids.union_with(right);
+            exact = left_exact && right_exact;
+            return true;
         }
-        if (!results.empty()) {
-            DEBUG_SUCCESS << "Found " << results.size() << " record(s) for " << col << " != " << val << " in table '" << table_name << "'" << std::endl;
-        }
-        return results;
-    }
-
-    // Fetch and filter records by checking column != value
-    for (int id : matching_ids) {
-        Record rec = table_manager.select(table_name, id);
-        string rec_str(rec.data.begin(), rec.data.end());
-        vector<string> row = split(rec_str, '|');
-        if (row.size() > col_idx && row[col_idx] != val) {
-            results.push_back(rec);
+        case Expr::Kind::AND: {
+            PostingList right;
+            bool left_exact = false, right_exact = false;
+            bool left = index_ids(*where.left, schema, ids, left_exact);
+            if (left && ids.empty()) {
+                exact = true;
+                return true;
+            }
+            bool right_found = index_ids(*where.right, schema, right, right_exact);
+            if (left && right_found) {
+                ids.intersect_with(right);
+            } else if (right_found) {
+                ids = std::move(right);
+            }
+            exact = left && left_exact && right_found && right_exact;
+            return left || right_found;
         }
+        default:
+            if (where.column != RECORD_ID_COLUMN && !where.indexed) {
+                DEBUG << "Column '" << schema.columns[where.column] << "' has no index; rows are filtered" << std::endl;
+                return false;
+            }
+            ids = handle_comparison(where, schema);
+            exact = true;
+            return true;
     }
-
-    if (!results.empty()) {
-        DEBUG_SUCCESS << "Found " << results.size() << " record(s) for " << col << " != " << val << " in table '" << table_name << "'" << std::endl;
-    }
-    return results;
 }
 
-vector<Record> QueryParser::handle_greater(const std::string& where_clause, const TableSchema& schema, const string& table_name){
-    size_t op_pos = where_clause.find(">");
-    vector<Record> results;
-
-    if(op_pos == string::npos){
-        DEBUG_ERROR << "Expected operator '>' not found in the WHERE clause." << std::endl;
-        return {};
-    }
-
-    string col = where_clause.substr(0, op_pos);
-    string val = where_clause.substr(op_pos+1);
-    trim(col), trim(val);
-
-    auto it = find(schema.columns.begin(), schema.columns.end(), col);
-    if (it == schema.columns.end()) {
-        DEBUG_ERROR << "Column '" << col << "' not found in table '" << table_name << "'" << std::endl;
-        return {};
-    }
-
-    int col_idx = it - schema.columns.begin();
-
-    //if Index exists use range search
-    vector<int> matching_ids;
-    if(index_manager.column_exists(table_name, col)){
-        matching_ids = index_manager.range_search(table_name, col, val + '\1', "~");
-    } else {
-        DEBUG_ERROR << "Column '" << col << "' does not exist in the indices"<<endl;
-    }
+PostingList QueryParser::handle_comparison(const Predicate& comparison, const TableSchema& schema) {
+    const string& table_name = schema.table_name;
+    const Literal& value = comparison.value;
+    CompareOp op = comparison.op;
+    PostingList matching_ids;
 
-    for(int id : matching_ids){
-        Record rec = table_manager.select(table_name, id);
-        string rec_str(rec.data.begin(), rec.data.end());
-        vector<string> row = split(rec_str, '|');
-        if (row.size() > col_idx && row[col_idx] > val) {
-            results.push_back(rec);
+    if (comparison.column == RECORD_ID_COLUMN) {
+        // A negative id would reach delete_from's delete-all case.
+        if (value.kind == Literal::Kind::INTEGER && value.int_value >= 0 && value.int_value <= INT32_MAX) {
+            matching_ids.add(static_cast<int>(value.int_value));
         }
+        return matching_ids;
     }
-    if (!results.empty()) {
-        DEBUG_SUCCESS << "Found " << results.size() << " record(s) for " << col << " > " << val << " in table '" << table_name << "'" << std::endl;
-    }
-    return results;
-}
 
-vector<Record> QueryParser::handle_lesser(const std::string& where_clause, const TableSchema& schema, const string& table_name) {
-    size_t op_pos = where_clause.find("<");
-    vector<Record> results;
+    const string& col = schema.columns[comparison.column];
+    const string& key = comparison.key;
+    string val = value.sql();
 
-    if(op_pos == string::npos){
-        DEBUG_ERROR << "Expected operator '<' not found in the WHERE clause." << std::endl;
+    // = and != treat NULL as a value; ordering comparisons never match it.
+    bool ordering = op != CompareOp::EQ && op != CompareOp::NE;
+    if (ordering && key == index_key_null()) {
         return {};
     }
 
-    string col = where_clause.substr(0, op_pos);
-    string val = where_clause.substr(op_pos+1);
-    trim(col), trim(val);
-
-    auto it = find(schema.columns.begin(), schema.columns.end(), col);
-    if (it == schema.columns.end()) {
-        DEBUG_ERROR << "Column '" << col << "' not found in table '" << table_name << "'" << std::endl;
-        return {};
-    }
-
-    int col_idx = it - schema.columns.begin();
-
-    vector<int> matching_ids;
-    if(index_manager.column_exists(table_name, col)){
-        matching_ids = index_manager.range_search(table_name, col, "", val);
-    } else {
-        DEBUG_ERROR << "Column '" << col << "' does not exist in the indices" << endl;
-    }
-
-    for(int id : matching_ids){
-        Record rec = table_manager.select(table_name, id);
-        string rec_str(rec.data.begin(), rec.data.end());
-        vector<string> row = split(rec_str, '|');
-        if (row.size() > col_idx && row[col_idx] < val) {
-            results.push_back(rec);
+    // The index is kept in step with the heap, so its ids are final.
+    switch (op) {
+        case CompareOp::EQ:
+            matching_ids = index_manager.search(table_name, col, key);
+            break;
+        case CompareOp::NE:
+            matching_ids = index_manager.range_search(table_name, col, index_key_null(), key, false);
+            matching_ids.union_with(index_manager.range_search(table_name, col, index_key_successor(key), index_key_past_values(), false));
+            break;
+        case CompareOp::LT:
+        case CompareOp::LE:
+            matching_ids = index_manager.range_search(table_name, col, index_key_min_value(), key, op == CompareOp::LE);
+            break;
+        default: {
+            string start = op == CompareOp::GT ? index_key_successor(key) : key;
+            matching_ids = index_manager.range_search(table_name, col, start, index_key_past_values(), false);
+            break;
         }
     }
-    if (!results.empty()) {
-        DEBUG_SUCCESS << "Found " << results.size() << " record(s) for " << col << " < " << val << " in table '" << table_name << "'" << std::endl;
-    }
-    return results;
-}
-
-vector<Record> QueryParser::handle_greater_equal(const std::string& where_clause, const TableSchema& schema, const string& table_name) {
-    size_t op_pos = where_clause.find(">=");
-    vector<Record> results;
-
-    if(op_pos == string::npos){
-        DEBUG_ERROR << "Expected operator '>=' not found in the WHERE clause." << std::endl;
-        return {};
-    }
-
-    string col = where_clause.substr(0, op_pos);
-    string val = where_clause.substr(op_pos+2);
-    trim(col), trim(val);
-
-    auto it = find(schema.columns.begin(), schema.columns.end(), col);
-    if (it == schema.columns.end()) {
-        DEBUG_ERROR << "Column '" << col << "' not found in table '" << table_name << "'" << std::endl;
-        return {};
-    }
-
-    int col_idx = it - schema.columns.begin();
 
-    vector<int> matching_ids;
-    if(index_manager.column_exists(table_name, col)){
-        matching_ids = index_manager.range_search(table_name, col, val, "~");
+    if (!matching_ids.empty()) {
+        DEBUG_SUCCESS << "Found " << matching_ids.size() << " record(s) for " << col << " " << to_string(op) << " " << val << " in table '" << table_name << "'" << std::endl;
     } else {
-        DEBUG_ERROR << "Column '" << col << "' does not exist in the indices" << endl;
+        DEBUG << "No records found for " << col << " " << to_string(op) << " " << val << " in table '" << table_name << "'" << std::endl;
     }
-
-    for(int id : matching_ids){
-        Record rec = table_manager.select(table_name, id);
-        string rec_str(rec.data.begin(), rec.data.end());
-        vector<string> row = split(rec_str, '|');
-        if (row.size() > col_idx && row[col_idx] >= val) {
-            results.push_back(rec);
-        }
-    }
-    if (!results.empty()) {
-        DEBUG_SUCCESS << "Found " << results.size() << " record(s) for " << col << " >= " << val << " in table '" << table_name << "'" << std::endl;
-    }
-    return results;
+    return matching_ids;
 }
-
-vector<Record> QueryParser::handle_lesser_equal(const std::string& where_clause, const TableSchema& schema, const string& table_name) {
-    size_t op_pos = where_clause.find("<=");
-    vector<Record> results;
-
-    if(op_pos == string::npos){
-        DEBUG_ERROR << "Expected operator '<=' not found in the WHERE clause." << std::endl;
-        return {};
-    }
-
-    string col = where_clause.substr(0, op_pos);
-    string val = where_clause.substr(op_pos+2);
-    trim(col), trim(val);
-
-    auto it = find(schema.columns.begin(), schema.columns.end(), col);
-    if (it == schema.columns.end()) {
-        DEBUG_ERROR << "Column '" << col << "' not found in table '" << table_name << "'" << std::endl;
-        return {};
-    }
-
-    int col_idx = it - schema.columns.begin();
-
-    vector<int> matching_ids;
-    if(index_manager.column_exists(table_name, col)){
-        matching_ids = index_manager.range_search(table_name, col, "", val + '\1');
-    } else {
-        DEBUG_ERROR << "Column '" << col << "' does not exist in the indices" << endl;
-    }
-
-    for(int id : matching_ids){
-        Record rec = table_manager.select(table_name, id);
-        string rec_str(rec.data.begin(), rec.data.end());
-        vector<string> row = split(rec_str, '|');
-        if (row.size() > col_idx && row[col_idx] <= val) {
-            results.push_back(rec);
-        }
-    }
-    if (!results.empty()) {
-        DEBUG_SUCCESS << "Found " << results.size() << " record(s) for " << col << " <= " << val << " in table '" << table_name << "'" << std::endl;
-    }
-    return results;
-}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "../../include/query/result_printer.h"
+#include <algorithm>
+
+using namespace std;
+
+ResultPrinter::ResultPrinter(ostream& out, vector<string> header)
+    : out(out), header(std::move(header)), widths(this->header.size(), 10) {
+    for (size_t i = 0; i < this->header.size(); ++i) {
+        widths[i] = max(widths[i], this->header[i].size() + 4);
+    }
+}
+
+void ResultPrinter::add_row(vector<string> row) {
+    rows++;
+    if (streaming) {
+        print_row(row, false);
+        return;
+    }
+
+    for (size_t i = 0; i < row.size() && i < widths.size(); ++i) {
+        widths[i] = max(widths[i], row[i].size() + 4);
+    }
+    preview.push_back(std::move(row));
+    if (preview.size() >= PREVIEW_ROWS) {
+        start_streaming();
+    }
+}
+
+void ResultPrinter::finish() {
+    if (rows == 0) {
+        vector<string> empty_row(header.size(), "");
+        if (!empty_row.empty()) empty_row[0] = "No matching records";
+        add_row(std::move(empty_row));
+    }
+    if (!streaming) {
+        start_streaming();
+    }
+    print_border('-');
+    out << endl;
+}
+
+void ResultPrinter::start_streaming() {
+    streaming = true;
+    print_border('-');
+    print_row(header, true);
+    print_border('=');
+    for (const vector<string>& row : preview) {
+        print_row(row, false);
+    }
+    preview.clear();
+    out.flush();
+}
+
+void ResultPrinter::print_border(char fill) {
+    out << '+';
+    for (size_t width : widths) {
+        out << string(width, fill) << '+';
+    }
+    out << '\n';
+}
+
+void ResultPrinter::print_row(const vector<string>& row, bool centered) {
+    out << '|';
+    for (size_t i = 0; i < widths.size(); ++i) {
+        const string& content = i < row.size() ? row[i] : string();
+        size_t padding = widths[i] > content.size() ? widths[i] - content.size() : 0;
+        size_t left_pad = centered ? padding / 2 : min<size_t>(2, padding);
+        size_t right_pad = padding - left_pad;
+        out << string(left_pad, ' ') << content << string(right_pad, ' ') << '|';
+    }
+    out << '\n';
+}
@@ -0,0 +1,521 @@
+#include "../../include/query/sql_parser.h"
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+    bool equals_ignore_case(const string& text, const char* keyword) {
+        size_t i = 0;
+        for (; keyword[i]; ++i) {
+            if (i >= text.size() || toupper(static_cast<unsigned char>(text[i])) != keyword[i]) return false;
+        }
+        return i == text.size();
+    }
+
+    string to_lower(string text) {
+        for (char& c : text) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        return text;
+    }
+
+    // a op b is the same test as b flip(op) a
+    CompareOp flip(CompareOp op) {
+        switch (op) {
+            case CompareOp::LT: return CompareOp::GT;
+            case CompareOp::LE: return CompareOp::GE;
+            case CompareOp::GT: return CompareOp::LT;
+            case CompareOp::GE: return CompareOp::LE;
+            default: return op;
+        }
+    }
+}
+
+string Literal::sql() const {
+    switch (kind) {
+        case Kind::INTEGER: return std::to_string(int_value);
+        case Kind::FLOAT: return text;
+        case Kind::STRING: return "'" + text + "'";
+        case Kind::PARAMETER: return "?";
+        default: return "NULL";
+    }
+}
+
+string to_string(CompareOp op) {
+    switch (op) {
+        case CompareOp::EQ: return "=";
+        case CompareOp::NE: return "!=";
+        case CompareOp::LT: return "<";
+        case CompareOp::LE: return "<=";
+        case CompareOp::GT: return ">";
+        default: return ">=";
+    }
+}
+
+string to_string(AggregateFunction function) {
+    switch (function) {
+        case AggregateFunction::COUNT: return "count";
+        case AggregateFunction::SUM: return "sum";
+        case AggregateFunction::AVG: return "avg";
+        case AggregateFunction::MIN: return "min";
+        case AggregateFunction::MAX: return "max";
+        default: return "";
+    }
+}
+
+string SelectItem::name() const {
+    if (function == AggregateFunction::NONE) return column;
+    return to_string(function) + "(" + (column.empty() ? "*" : column) + ")";
+}
+
+bool SqlParser::parse(const string& sql, Statement& statement, string& error_out) {
+    source = &sql;
+    pos = 0;
+    error.clear();
+    parameters = 0;
+    Lexer lexer(sql);
+    if (!lexer.tokenize(tokens, error_out)) {
+        return false;
+    }
+
+    bool ok;
+    if (accept_keyword("SELECT")) ok = parse_select(statement);
+    else if (accept_keyword("INSERT")) ok = parse_insert(statement);
+    else if (accept_keyword("UPDATE")) ok = parse_update(statement);
+    else if (accept_keyword("DELETE")) ok = parse_delete(statement);
+    else if (accept_keyword("CREATE")) ok = parse_create(statement);
+    else if (accept_keyword("DROP")) ok = parse_drop(statement);
+    else if (accept_keyword("PREPARE")) ok = parse_prepare(statement);
+    else if (accept_keyword("EXECUTE")) ok = parse_execute(statement);
+    else if (accept_keyword("DEALLOCATE")) ok = parse_deallocate(statement);
+    else if (accept_keyword("ANALYZE")) ok = parse_analyze(statement);
+    else if (accept_keyword("BEGIN")) ok = parse_transaction(TransactionStatement::Kind::BEGIN, statement);
+    else if (accept_keyword("COMMIT")) ok = parse_transaction(TransactionStatement::Kind::COMMIT, statement);
+    else if (accept_keyword("ROLLBACK")) ok = parse_transaction(TransactionStatement::Kind::ROLLBACK, statement);
+    else ok = fail("a statement");
+
+    if (ok) {
+        accept_symbol(";");
+        if (peek().type != TokenType::END) ok = fail("end of statement");
+    }
+    if (!ok) error_out = error;
+    return ok;
+}
+
+bool SqlParser::fail(const string& expected) {
+    if (error.empty()) {
+        const Token& token = peek();
+        string found = token.type == TokenType::END ? "end of input" : "'" + token.text + "'";
+        error = "expected " + expected + " but found " + found + " at position " + std::to_string(token.position);
+    }
+    return false;
+}
+
+bool SqlParser::accept_keyword(const char* keyword) {
+    if (peek().type == TokenType::IDENTIFIER && equals_ignore_case(peek().text, keyword)) {
+        pos++;
+        return true;
+    }
+    return false;
+}
+
+bool SqlParser::expect_keyword(const char* keyword) {
+    return accept_keyword(keyword) || fail(keyword);
+}
+
+bool SqlParser::accept_symbol(const char* symbol) {
+    if (peek().type == TokenType::SYMBOL && peek().text == symbol) {
+        pos++;
+        return true;
+    }
+    return false;
+}
+
+bool SqlParser::expect_symbol(const char* symbol) {
+    return accept_symbol(symbol) || fail(string("'") + symbol + "'");
+}
+
+bool SqlParser::expect_identifier(string& name, const char* what) {
+    if (peek().type != TokenType::IDENTIFIER) return fail(what);
+    name = to_lower(tokens[pos++].text);
+    return true;
+}
+
+bool SqlParser::expect_column(string& name) {
+    if (!expect_identifier(name, "a column name")) return false;
+    if (!accept_symbol(".")) return true;
+    string column;
+    if (!expect_identifier(column, "a column name")) return false;
+    name += "." + column;
+    return true;
+}
+
+bool SqlParser::parse_alias(string& alias) {
+    static const char* const clauses[] = {"JOIN", "INNER", "ON", "WHERE", "GROUP", "ORDER", "LIMIT"};
+
+    if (accept_keyword("AS")) return expect_identifier(alias, "an alias");
+    if (peek().type != TokenType::IDENTIFIER) return true;
+    for (const char* clause : clauses) {
+        if (equals_ignore_case(peek().text, clause)) return true;
+    }
+    return expect_identifier(alias, "an alias");
+}
+
+bool SqlParser::parse_literal(Literal& literal) {
+    if (accept_symbol("?")) {
+        literal.kind = Literal::Kind::PARAMETER;
+        literal.parameter = parameters++;
+        return true;
+    }
+
+    bool negative = accept_symbol("-");
+    const Token& token = peek();
+    try {
+        if (token.type == TokenType::INTEGER) {
+            literal.kind = Literal::Kind::INTEGER;
+            literal.text = (negative ? "-" : "") + token.text;
+            literal.int_value = stoll(literal.text);
+        } else if (token.type == TokenType::FLOAT) {
+            literal.kind = Literal::Kind::FLOAT;
+            literal.text = (negative ? "-" : "") + token.text;
+            literal.float_value = stod(literal.text);
+        } else if (!negative && token.type == TokenType::STRING) {
+            literal.kind = Literal::Kind::STRING;
+            literal.text = token.text;
+        } else if (!negative && token.type == TokenType::IDENTIFIER && equals_ignore_case(token.text, "NULL")) {
+            literal.kind = Literal::Kind::NULL_VALUE;
+            literal.text.clear();
+        } else {
+            return fail("a value");
+        }
+    } catch (const out_of_range&) {
+        error = "number out of range at position " + std::to_string(token.position);
+        return false;
+    }
+    pos++;
+    return true;
+}
+
+bool SqlParser::parse_compare_op(CompareOp& op) {
+    if (peek().type == TokenType::SYMBOL) {
+        const string& symbol = peek().text;
+        if (symbol == "=") op = CompareOp::EQ;
+        else if (symbol == "!=" || symbol == "<>") op = CompareOp::NE;
+        else if (symbol == "<") op = CompareOp::LT;
+        else if (symbol == "<=") op = CompareOp::LE;
+        else if (symbol == ">") op = CompareOp::GT;
+        else if (symbol == ">=") op = CompareOp::GE;
+        else return fail("a comparison operator");
+        pos++;
+        return true;
+    }
+    return fail("a comparison operator");
+}
+
+unique_ptr<Expr> SqlParser::parse_condition() {
+    unique_ptr<Expr> left = parse_and();
+    while (left && accept_keyword("OR")) {
+        unique_ptr<Expr> right = parse_and();
+        if (!right) return nullptr;
+        auto node = make_unique<Expr>();
+        node->kind = Expr::Kind::OR;
+        node->left = std::move(left);
+        node->right = std::move(right);
+        left = std::move(node);
+    }
+    return left;
+}
+
+unique_ptr<Expr> SqlParser::parse_and() {
+    unique_ptr<Expr> left = parse_primary();
+    while (left && accept_keyword("AND")) {
+        unique_ptr<Expr> right = parse_primary();
+        if (!right) return nullptr;
+        auto node = make_unique<Expr>();
+        node->kind = Expr::Kind::AND;
+        node->left = std::move(left);
+        node->right = std::move(right);
+        left = std::move(node);
+    }
+    return left;
+}
+
+unique_ptr<Expr> SqlParser::parse_primary() {
+    if (accept_symbol("(")) {
+        unique_ptr<Expr> inner = parse_condition();
+        if (!inner || !expect_symbol(")")) return nullptr;
+        return inner;
+    }
+
+    auto node = make_unique<Expr>();
+    node->kind = Expr::Kind::COMPARE;
+    bool is_keyword_null = peek().type == TokenType::IDENTIFIER && equals_ignore_case(peek().text, "NULL");
+    if (peek().type == TokenType::IDENTIFIER && !is_keyword_null) {
+        // col op value
+        if (!expect_column(node->column) || !parse_compare_op(node->op) || !parse_literal(node->value)) return nullptr;
+    } else {
+        // value op col
+        CompareOp op;
+        if (!parse_literal(node->value) || !parse_compare_op(op) || !expect_column(node->column)) {
+            return nullptr;
+        }
+        node->op = flip(op);
+    }
+    return node;
+}
+
+bool SqlParser::parse_create(Statement& statement) {
+    if (accept_keyword("INDEX")) {
+        CreateIndexStatement create;
+        if (!expect_keyword("ON") || !expect_identifier(create.table, "a table name") ||
+            !expect_symbol("(") || !expect_identifier(create.column, "a column name") || !expect_symbol(")")) {
+            return false;
+        }
+        statement = std::move(create);
+        return true;
+    }
+
+    CreateTableStatement create;
+    if (!expect_keyword("TABLE") || !expect_identifier(create.table, "a table name") || !expect_symbol("(")) {
+        return false;
+    }
+    do {
+        if (accept_keyword("PRIMARY")) {
+            if (!expect_keyword("KEY") || !expect_symbol("(") ||
+                !expect_identifier(create.primary_key, "a column name") || !expect_symbol(")")) {
+                return false;
+            }
+            continue;
+        }
+
+        string column, type_name;
+        if (!expect_identifier(column, "a column name")) return false;
+        size_t type_pos = pos;
+        if (!expect_identifier(type_name, "a column type")) return false;
+        for (char& c : type_name) c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+        DataType type = parse_type(type_name);
+        if (type == DataType::UNKNOWN) {
+            error = "unsupported type " + tokens[type_pos].text + " at position " + std::to_string(tokens[type_pos].position);
+            return false;
+        }
+        if (accept_keyword("PRIMARY")) {
+            if (!expect_keyword("KEY")) return false;
+            create.primary_key = column;
+        }
+        create.columns.push_back(column);
+        create.types.push_back(type);
+    } while (accept_symbol(","));
+
+    if (!expect_symbol(")")) return false;
+    statement = std::move(create);
+    return true;
+}
+
+bool SqlParser::parse_drop(Statement& statement) {
+    DropTableStatement drop;
+    if (!expect_keyword("TABLE") || !expect_identifier(drop.table, "a table name")) return false;
+    statement = std::move(drop);
+    return true;
+}
+
+bool SqlParser::parse_insert(Statement& statement) {
+    InsertStatement insert;
+    if (!expect_keyword("INTO") || !expect_identifier(insert.table, "a table name")) return false;
+
+    if (accept_symbol("(")) {
+        do {
+            string column;
+            if (!expect_identifier(column, "a column name")) return false;
+            insert.columns.push_back(column);
+        } while (accept_symbol(","));
+        if (!expect_symbol(")")) return false;
+    }
+
+    if (!expect_keyword("VALUES")) return false;
+    do {
+        if (!expect_symbol("(")) return false;
+        vector<Literal> row;
+        do {
+            Literal value;
+            if (!parse_literal(value)) return false;
+            row.push_back(std::move(value));
+        } while (accept_symbol(","));
+        if (!expect_symbol(")")) return false;
+        insert.rows.push_back(std::move(row));
+    } while (accept_symbol(","));
+
+    statement = std::move(insert);
+    return true;
+}
+
+bool SqlParser::parse_delete(Statement& statement) {
+    DeleteStatement del;
+    if (!expect_keyword("FROM") || !expect_identifier(del.table, "a table name") || !expect_keyword("WHERE")) {
+        return false;
+    }
+    del.where = parse_condition();
+    if (!del.where) return false;
+    statement = std::move(del);
+    return true;
+}
+
+bool SqlParser::parse_update(Statement& statement) {
+    UpdateStatement update;
+    if (!expect_identifier(update.table, "a table name") || !expect_keyword("SET")) return false;
+    do {
+        pair<string, Literal> assignment;
+        if (!expect_identifier(assignment.first, "a column name") || !expect_symbol("=") ||
+            !parse_literal(assignment.second)) {
+            return false;
+        }
+        update.assignments.push_back(std::move(assignment));
+    } while (accept_symbol(","));
+
+    if (!expect_keyword("WHERE")) return false;
+    update.where = parse_condition();
+    if (!update.where) return false;
+    statement = std::move(update);
+    return true;
+}
+
+bool SqlParser::parse_select_item(SelectItem& item) {
+    static const pair<const char*, AggregateFunction> functions[] = {
+        {"COUNT", AggregateFunction::COUNT}, {"SUM", AggregateFunction::SUM}, {"AVG", AggregateFunction::AVG},
+        {"MIN", AggregateFunction::MIN}, {"MAX", AggregateFunction::MAX},
+    };
+
+    if (!expect_identifier(item.column, "a column name or *")) return false;
+    if (accept_symbol(".")) {
+        string column;
+        if (!expect_identifier(column, "a column name")) return false;
+        item.column += "." + column;
+        return true;
+    }
+    if (!accept_symbol("(")) return true;
+
+    // The name was a function: COUNT(*) or f(col)
+    const Token& name = tokens[pos - 2];
+    for (const auto& [keyword, function] : functions) {
+        if (equals_ignore_case(name.text, keyword)) item.function = function;
+    }
+    if (item.function == AggregateFunction::NONE) {
+        error = "unknown function " + name.text + " at position " + std::to_string(name.position);
+        return false;
+    }
+    item.column.clear();
+    if (item.function == AggregateFunction::COUNT && accept_symbol("*")) {
+        return expect_symbol(")");
+    }
+    return expect_column(item.column) && expect_symbol(")");
+}
+
+bool SqlParser::parse_select(Statement& statement) {
+    SelectStatement select;
+    if (!accept_symbol("*")) {
+        do {
+            SelectItem item;
+            if (!parse_select_item(item)) return false;
+            select.items.push_back(std::move(item));
+        } while (accept_symbol(","));
+    }
+
+    if (!expect_keyword("FROM") || !expect_identifier(select.table, "a table name") || !parse_alias(select.alias)) {
+        return false;
+    }
+    bool inner = accept_keyword("INNER");
+    if (accept_keyword("JOIN")) {
+        JoinClause join;
+        if (!expect_identifier(join.table, "a table name") || !parse_alias(join.alias) || !expect_keyword("ON") ||
+            !expect_column(join.left_column) || !expect_symbol("=") || !expect_column(join.right_column)) {
+            return false;
+        }
+        select.join = std::move(join);
+    } else if (inner) {
+        return fail("JOIN");
+    }
+    if (accept_keyword("WHERE")) {
+        select.where = parse_condition();
+        if (!select.where) return false;
+    }
+    if (accept_keyword("GROUP")) {
+        if (!expect_keyword("BY")) return false;
+        do {
+            string column;
+            if (!expect_column(column)) return false;
+            select.group_by.push_back(std::move(column));
+        } while (accept_symbol(","));
+    }
+    if (accept_keyword("ORDER")) {
+        if (!expect_keyword("BY")) return false;
+        do {
+            OrderItem item;
+            SelectItem sorted;
+            if (!parse_select_item(sorted)) return false;
+            item.column = sorted.name();
+            if (accept_keyword("DESC")) item.descending = true;
+            else accept_keyword("ASC");
+            select.order_by.push_back(std::move(item));
+        } while (accept_symbol(","));
+    }
+    if (accept_keyword("LIMIT")) {
+        if (peek().type != TokenType::INTEGER) return fail("a row count");
+        try {
+            select.limit = stoll(tokens[pos].text);
+        } catch (const out_of_range&) {
+            error = "number out of range at position " + std::to_string(peek().position);
+            return false;
+        }
+        pos++;
+    }
+    statement = std::move(select);
+    return true;
+}
+
+bool SqlParser::parse_prepare(Statement& statement) {
+    PrepareStatement prepare;
+    if (!expect_identifier(prepare.name, "a statement name") || !expect_keyword("AS")) return false;
+    if (peek().type == TokenType::END) return fail("a statement");
+
+    // The body runs to the end of the text; QueryParser parses it on its own.
+    prepare.body = source->substr(peek().position);
+    pos = tokens.size() - 1;
+    statement = std::move(prepare);
+    return true;
+}
+
+bool SqlParser::parse_execute(Statement& statement) {
+    ExecuteStatement execute;
+    if (!expect_identifier(execute.name, "a statement name")) return false;
+    if (accept_symbol("(")) {
+        do {
+            Literal value;
+            if (!parse_literal(value)) return false;
+            if (value.kind == Literal::Kind::PARAMETER) {
+                error = "EXECUTE takes values, not parameters, at position " + std::to_string(tokens[pos - 1].position);
+                return false;
+            }
+            execute.parameters.push_back(std::move(value));
+        } while (accept_symbol(","));
+        if (!expect_symbol(")")) return false;
+    }
+    statement = std::move(execute);
+    return true;
+}
+
+bool SqlParser::parse_deallocate(Statement& statement) {
+    DeallocateStatement deallocate;
+    accept_keyword("PREPARE");
+    if (!expect_identifier(deallocate.name, "a statement name")) return false;
+    statement = std::move(deallocate);
+    return true;
+}
+
+bool SqlParser::parse_analyze(Statement& statement) {
+    AnalyzeStatement analyze;
+    if (peek().type == TokenType::IDENTIFIER && !expect_identifier(analyze.table, "a table name")) return false;
+    statement = std::move(analyze);
+    return true;
+}
+
+bool SqlParser::parse_transaction(TransactionStatement::Kind kind, Statement& statement) {
+    if (kind == TransactionStatement::Kind::BEGIN) accept_keyword("TRANSACTION");
+    statement = TransactionStatement{kind};
+    return true;
+}
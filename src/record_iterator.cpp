@@ -10,34 +10,63 @@ using namespace std;
 
 // Remove 'valid' member and all logic related to it
 
-RecordIterator::RecordIterator(DiskManager& disk_manager) 
-    : disk(disk_manager), current_page_id(0), current_slot_id(0) {
-    try {
-        page = disk.read_page(current_page_id);
+RecordIterator::RecordIterator(RecordManager& heap, const Snapshot& snapshot)
+    : RecordIterator(heap) {
+    this->snapshot = snapshot;
+    versioned = true;
+    // The constructor below stopped on the first live record, which this
+    // snapshot may not see
+    if (current_page_id >= 0) load_next_valid_record();
+}
+
+RecordIterator::RecordIterator(RecordManager& heap)
+    : buffer_pool(heap.get_buffer_pool()), file_id(heap.get_file_id()), current_page_id(0), current_slot_id(0), versioned(false) {
+    if (load_page(current_page_id)) {
         cout << COLOR_GREEN << DEBUG_PREFIX << "Initialized at page " << current_page_id << "." << COLOR_RESET << endl;
         load_next_valid_record();
-    } catch (...) {
+    } else {
         cout << COLOR_RED << DEBUG_PREFIX << "No pages available at initialization." << COLOR_RESET << endl;
         current_page_id = -1; // No valid page => end iterator
     }
 }
 
+RecordIterator::~RecordIterator() {
+    release_page();
+}
+
+bool RecordIterator::load_page(int page_id) {
+    release_page();
+    page = buffer_pool.fetch_page_view(file_id, page_id);
+    return page.data != nullptr;
+}
+
+void RecordIterator::release_page() {
+    buffer_pool.release_page_view(page);
+}
+
+bool RecordIterator::is_visible(uint16_t offset, uint16_t size) const {
+    if (offset == INVALID_SLOT || size == 0) return false;
+    if (!versioned) return true;
+    return size >= VERSION_HEADER_SIZE && snapshot.sees(read_version_header(page.data + offset));
+}
+
 void RecordIterator::load_next_valid_record() {
     while (current_page_id >= 0) {
-        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
+        shared_lock<shared_mutex> reading = page.read_latch();
+        const uint16_t* header_ptr = reinterpret_cast<const uint16_t*>(page.data);
         uint16_t slot_count = header_ptr[0];
 
         cout << COLOR_GREEN << DEBUG_PREFIX << "Scanning page " << current_page_id << " with " << slot_count << " slots." << COLOR_RESET << endl;
 
         // Scan slots in current page
         while (current_slot_id < slot_count) {
-            uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + current_slot_id * SLOT_SIZE]);
+            const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(page.data + HEADER_SIZE + current_slot_id * SLOT_SIZE);
             uint16_t offset = slot_entry[0];
             uint16_t size = slot_entry[1];
 
             cout << COLOR_GREEN << DEBUG_PREFIX << "Checking slot " << current_slot_id << ": offset=" << offset << ", size=" << size << "." << COLOR_RESET << endl;
 
-            if (offset != INVALID_SLOT && size > 0) {
+            if (is_visible(offset, size)) {
                 // Found valid record to yield next
                 cout << COLOR_GREEN << DEBUG_PREFIX << "Found valid record at page " << current_page_id << ", slot " << current_slot_id << "." << COLOR_RESET << endl;
                 return;
@@ -47,11 +76,10 @@ void RecordIterator::load_next_valid_record() {
 
         // No valid slot found in current page, advance to next page
         cout << COLOR_RED << DEBUG_PREFIX << "No valid record found in page " << current_page_id << ". Moving to next page." << COLOR_RESET << endl;
-        try {
-            current_page_id++;
-            page = disk.read_page(current_page_id);
-            current_slot_id = 0;
-        } catch (...) {
+        reading.unlock();
+        current_page_id++;
+        current_slot_id = 0;
+        if (!load_page(current_page_id)) {
             cout << COLOR_RED << DEBUG_PREFIX << "No more pages available after page " << current_page_id - 1 << "." << COLOR_RESET << endl;
             current_page_id = -1; // mark iteration end
             return;
@@ -70,7 +98,9 @@ Record RecordIterator::next() {
         return Record(vector<char>()); // Return empty record
     }
 
-    uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
+    // A writer may have changed the slot since load_next_valid_record
+    shared_lock<shared_mutex> reading = page.read_latch();
+    const uint16_t* header_ptr = reinterpret_cast<const uint16_t*>(page.data);
     uint16_t slot_count = header_ptr[0];
 
     if (current_slot_id >= slot_count) {
@@ -78,20 +108,22 @@ Record RecordIterator::next() {
         return Record(vector<char>());
     }
 
-    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + current_slot_id * SLOT_SIZE]);
+    const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(page.data + HEADER_SIZE + current_slot_id * SLOT_SIZE);
     uint16_t offset = slot_entry[0];
     uint16_t size = slot_entry[1];
 
-    if (offset == INVALID_SLOT || size == 0) {
+    if (!is_visible(offset, size)) {
         cout << COLOR_RED << DEBUG_PREFIX << "Invalid record at current slot. Returning empty record." << COLOR_RESET << endl;
         return Record(vector<char>());
     }
 
-    vector<char> record_data(page.begin() + offset, page.begin() + offset + size);
+    uint16_t skip = versioned ? VERSION_HEADER_SIZE : 0;
+    vector<char> record_data(page.data + offset + skip, page.data + offset + size);
     Record record(record_data);
 
     cout << COLOR_GREEN << DEBUG_PREFIX << "Returning record from page " << current_page_id << ", slot " << current_slot_id << "." << COLOR_RESET << endl;
 
+    reading.unlock();
     current_slot_id++;
     load_next_valid_record();
 
@@ -99,48 +131,70 @@ Record RecordIterator::next() {
 }
 
 std::tuple<Record, int, int> RecordIterator::next_with_location() {
-    while (true) {
-        if (!has_next()) {
-            cout << COLOR_RED << DEBUG_PREFIX << "No more records available. Returning empty tuple." << COLOR_RESET << endl;
-            return {Record(vector<char>()), -1, -1};
-        }
+    int page_id = current_page_id;
+    int slot_id = current_slot_id;
+    Record rec = next();
+    if (rec.data.empty()) {
+        return {rec, -1, -1};
+    }
+    rec.rid = RecordID(page_id, slot_id);
+    return {rec, page_id, slot_id};
+}
 
-        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
+size_t RecordIterator::next_batch(vector<Record>& out, size_t max_records) {
+    size_t added = 0;
+    int first_page = current_page_id;
+    uint16_t skip = versioned ? VERSION_HEADER_SIZE : 0;
+    while (current_page_id >= 0) {
+        shared_lock<shared_mutex> reading = page.read_latch();
+        const uint16_t* header_ptr = reinterpret_cast<const uint16_t*>(page.data);
         uint16_t slot_count = header_ptr[0];
 
-        if (current_slot_id >= slot_count) {
-            // No more slots on current page; try to load next page
-            try {
-                current_page_id++;
-                page = disk.read_page(current_page_id);
-                current_slot_id = 0;
-            } catch (...) {
-                cout << COLOR_RED << DEBUG_PREFIX << "No more pages available after page " << current_page_id - 1 << "." << COLOR_RESET << endl;
-                current_page_id = -1;
-                continue;  // loop again and will return empty tuple on next iteration
+        for (; current_slot_id < slot_count; ++current_slot_id) {
+            const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(page.data + HEADER_SIZE + current_slot_id * SLOT_SIZE);
+            uint16_t offset = slot_entry[0];
+            uint16_t size = slot_entry[1];
+            if (!is_visible(offset, size)) continue;
+            // Stop on a live slot, as next() expects
+            if (added == max_records) {
+                cout << COLOR_GREEN << DEBUG_PREFIX << "Read " << added << " records from pages " << first_page << "-" << current_page_id << "." << COLOR_RESET << endl;
+                return added;
             }
-            continue;
+            out.emplace_back(vector<char>(page.data + offset + skip, page.data + offset + size), RecordID(current_page_id, current_slot_id));
+            added++;
         }
 
-        uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + current_slot_id * SLOT_SIZE]);
-        uint16_t offset = slot_entry[0];
-        uint16_t size = slot_entry[1];
-
-        int slot_id = current_slot_id;
-        int page_id = current_page_id;
-        current_slot_id++;
-
-        if (offset == INVALID_SLOT || size == 0) {
-            cout << COLOR_RED << DEBUG_PREFIX << "Invalid record at page " << page_id << ", slot " << slot_id << ". Skipping." << COLOR_RESET << endl;
-            continue; // skip invalid slot
+        reading.unlock();
+        current_page_id++;
+        current_slot_id = 0;
+        if (!load_page(current_page_id)) {
+            current_page_id = -1;
         }
+    }
+    cout << COLOR_GREEN << DEBUG_PREFIX << "Read " << added << " records from page " << first_page << " to the end." << COLOR_RESET << endl;
+    return added;
+}
 
-        vector<char> record_data(page.begin() + offset, page.begin() + offset + size);
-        RecordID rid(page_id, slot_id);
-        Record rec(record_data, rid);
+size_t RecordIterator::count_remaining() {
+    size_t count = 0;
+    int first_page = current_page_id;
+    while (current_page_id >= 0) {
+        shared_lock<shared_mutex> reading = page.read_latch();
+        const uint16_t* header_ptr = reinterpret_cast<const uint16_t*>(page.data);
+        uint16_t slot_count = header_ptr[0];
 
-        cout << COLOR_GREEN << DEBUG_PREFIX << "Returning record from page " << page_id << ", slot " << slot_id << "." << COLOR_RESET << endl;
+        for (; current_slot_id < slot_count; ++current_slot_id) {
+            const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(page.data + HEADER_SIZE + current_slot_id * SLOT_SIZE);
+            if (is_visible(slot_entry[0], slot_entry[1])) count++;
+        }
 
-        return {rec, page_id, slot_id};
+        reading.unlock();
+        current_page_id++;
+        current_slot_id = 0;
+        if (!load_page(current_page_id)) {
+            current_page_id = -1;
+        }
     }
+    cout << COLOR_GREEN << DEBUG_PREFIX << "Counted " << count << " records from page " << first_page << " to the end." << COLOR_RESET << endl;
+    return count;
 }
@@ -1,122 +1,307 @@
 #include "../include/record_manager.h"
 #include <iostream>
+#include <algorithm>
 #include <iomanip> // for std::hex and std::setw
 #include "../include/record_id.h"
 
 #define RM_DEBUG_PREFIX "[DEBUG][RECORD_MANAGER] "
 
-RecordManager::RecordManager(DiskManager& dm) : disk(dm), next_page_id(0) {
-    std::cout << RM_DEBUG_PREFIX << "RecordManager initialized." << std::endl;
-}
+namespace {
+    uint16_t* slot_at(char* page, int slot_id) {
+        return reinterpret_cast<uint16_t*>(page + HEADER_SIZE + slot_id * SLOT_SIZE);
+    }
 
-int RecordManager::find_free_page() {
-    int page_id = 0;
-    std::cout << RM_DEBUG_PREFIX << "Searching for free page starting at page_id = 0" << std::endl;
-    while (true) {
-        std::vector<char> page;
-        bool page_exists = true;
-
-        try {
-            page = disk.read_page(page_id);
-            std::cout << RM_DEBUG_PREFIX << "Read page " << page_id << std::endl;
-        } catch (...) {
-            std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " does not exist yet. Allocating new page." << std::endl;
-            page_id = disk.allocate_page();
-            page = vector<char>(PAGE_SIZE, 0);
-            page_exists = false;
+    // Pages come back zeroed from DiskManager::allocate_page; give them a valid header.
+    void init_page_if_needed(char* page) {
+        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page);
+        if (header_ptr[0] == 0 && header_ptr[1] == 0) {
+            header_ptr[1] = PAGE_SIZE;
         }
+    }
 
-        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
+    // Slides all live records to the end of the page so the free space is contiguous.
+    // Slot numbers (and therefore record ids) do not change.
+    void compact_page(char* page) {
+        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page);
         uint16_t slot_count = header_ptr[0];
-        uint16_t free_offset = header_ptr[1];
-
-        if (!page_exists) {
-            std::cout << RM_DEBUG_PREFIX << "Initializing header for new page " << page_id << std::endl;
-            slot_count = 0;
-            free_offset = PAGE_SIZE;
-            header_ptr[0] = slot_count;
-            header_ptr[1] = free_offset;
-            bool success = disk.write_page(page_id, page);
-            if (!success) {
-                std::cerr << "[ERROR][RECORD_MANAGER] Failed to write page " << page_id << std::endl;
-                throw std::runtime_error("Failed to write page");
-            }
-            return page_id;
+
+        char scratch[PAGE_SIZE];
+        uint16_t free_offset = PAGE_SIZE;
+        for (int i = 0; i < slot_count; ++i) {
+            uint16_t* slot_entry = slot_at(page, i);
+            if (slot_entry[0] == INVALID_SLOT || slot_entry[1] == 0) continue;
+            free_offset -= slot_entry[1];
+            memcpy(scratch + free_offset, page + slot_entry[0], slot_entry[1]);
+            slot_entry[0] = free_offset;
         }
+        memcpy(page + free_offset, scratch + free_offset, PAGE_SIZE - free_offset);
+        header_ptr[1] = free_offset;
+    }
 
-        int available = free_offset - (HEADER_SIZE + slot_count * SLOT_SIZE);
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " available space for record + slot: " << available << std::endl;
+    // Stores size bytes under slot_id, appending slot entries if slot_id is
+    // past the end of the slot array and compacting the page if the free gap
+    // is too small. Deterministic, so redo rebuilds exactly the same page.
+    bool place_record(char* page, int slot_id, const char* data, uint16_t size) {
+        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page);
+        uint16_t slot_count = header_ptr[0];
+        int new_slots = slot_id >= slot_count ? slot_id + 1 - slot_count : 0;
+        int needed = size + new_slots * SLOT_SIZE;
+
+        int contiguous = header_ptr[1] - (HEADER_SIZE + slot_count * SLOT_SIZE);
+        if (contiguous < needed) {
+            std::cout << RM_DEBUG_PREFIX << "Compacting page to make room." << std::endl;
+            compact_page(page);
+            contiguous = header_ptr[1] - (HEADER_SIZE + slot_count * SLOT_SIZE);
+        }
+        if (contiguous < needed) return false;
 
-        if (available >= 4 + SLOT_SIZE) { // minimum record size + slot size
-            std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " has enough space. Using this page." << std::endl;
-            return page_id;
+        for (int i = slot_count; i < slot_id; ++i) {
+            uint16_t* gap = slot_at(page, i);
+            gap[0] = INVALID_SLOT;
+            gap[1] = 0;
         }
 
-        page_id++;
-        std::cout << RM_DEBUG_PREFIX << "Moving to next page: " << page_id << std::endl;
+        uint16_t free_offset = header_ptr[1] - size;
+        memcpy(&page[free_offset], data, size);
+        uint16_t* slot_entry = slot_at(page, slot_id);
+        slot_entry[0] = free_offset;
+        slot_entry[1] = size;
+        if (new_slots) header_ptr[0] = slot_id + 1;
+        header_ptr[1] = free_offset;
+        return true;
+    }
+
+    void remove_record(char* page, int slot_id) {
+        uint16_t* slot_entry = slot_at(page, slot_id);
+        slot_entry[0] = INVALID_SLOT;
+        slot_entry[1] = 0;
+    }
+
+    // Overwrites in place when the new image is not larger, otherwise moves
+    // the record within the page. The caller checks that it fits.
+    bool replace_record(char* page, int slot_id, const char* data, uint16_t size) {
+        uint16_t* slot_entry = slot_at(page, slot_id);
+        if (slot_entry[0] != INVALID_SLOT && size <= slot_entry[1]) {
+            memcpy(&page[slot_entry[0]], data, size);
+            slot_entry[1] = size;
+            return true;
+        }
+        remove_record(page, slot_id);
+        return place_record(page, slot_id, data, size);
     }
 }
 
-int RecordManager::insert_record(const Record& record) {
-    std::cout << RM_DEBUG_PREFIX << "Inserting record: " << record.to_string() << std::endl;
-    int page_id = find_free_page();
-    std::vector<char> page;
-
-    try {
-        page = disk.read_page(page_id);
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " read successfully." << std::endl;
-    } catch (...) {
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " does not exist. Initializing new." << std::endl;
-        page = std::vector<char>(PAGE_SIZE, 0);
-        uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
-        header_ptr[0] = 0;          // slot_count
-        header_ptr[1] = PAGE_SIZE;  // free_offset
-    }
-
-    uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page.data());
+int RecordManager::page_free_space(const char* page) {
+    const uint16_t* header_ptr = reinterpret_cast<const uint16_t*>(page);
     uint16_t slot_count = header_ptr[0];
-    uint16_t free_offset = header_ptr[1];
+    if (slot_count == 0 && header_ptr[1] == 0) {
+        return PAGE_SIZE - HEADER_SIZE - SLOT_SIZE; // never initialized
+    }
 
-    std::cout << RM_DEBUG_PREFIX << "Current slot_count: " << slot_count << ", free_offset: " << free_offset << std::endl;
+    int live_bytes = 0;
+    bool has_dead_slot = false;
+    for (int i = 0; i < slot_count; ++i) {
+        const uint16_t* slot_entry = reinterpret_cast<const uint16_t*>(page + HEADER_SIZE + i * SLOT_SIZE);
+        if (slot_entry[0] == INVALID_SLOT || slot_entry[1] == 0) {
+            has_dead_slot = true;
+        } else {
+            live_bytes += slot_entry[1];
+        }
+    }
 
-    uint16_t rec_size = static_cast<uint16_t>(record.data.size());
-    std::cout << RM_DEBUG_PREFIX << "Record size: " << rec_size << std::endl;
+    int free_bytes = PAGE_SIZE - HEADER_SIZE - slot_count * SLOT_SIZE - live_bytes;
+    if (!has_dead_slot) free_bytes -= SLOT_SIZE;
+    return free_bytes > 0 ? free_bytes : 0;
+}
 
-    int available = free_offset - (HEADER_SIZE + slot_count * SLOT_SIZE);
-    if (available < rec_size + SLOT_SIZE) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Not enough space in page " << page_id << " for record size " << rec_size << std::endl;
-        throw std::runtime_error("Page does not have enough space");
+RecordManager::RecordManager(BufferPoolManager& bpm, int file, FreeSpaceMap& fsm, LogManager& lm)
+    : buffer_pool(bpm), file_id(file), free_space_map(fsm), log_manager(lm), next_page_id(0) {
+    if (log_manager.needs_recovery()) {
+        std::cout << RM_DEBUG_PREFIX << "Previous run did not shut down cleanly; replaying the log for file " << file_id << "." << std::endl;
+        log_manager.replay([this](const LogRecord& record) {
+            if (record.file_id == file_id) redo(record);
+        });
+    }
+
+    // Pages the map has never seen (new map, or pages added after the last
+    // clean shutdown) are summarized once here.
+    int num_pages = buffer_pool.get_num_pages(file_id);
+    for (int page_id = free_space_map.get_num_pages(); page_id < num_pages; ++page_id) {
+        PageView view = buffer_pool.fetch_page_view(file_id, page_id);
+        if (!view.data) break;
+        free_space_map.update(page_id, page_free_space(view.data));
+        buffer_pool.release_page_view(view);
+    }
+    std::cout << RM_DEBUG_PREFIX << "RecordManager initialized." << std::endl;
+}
+
+// Must be called while the page is still pinned, after it was modified, so
+// the frame cannot be written before its log record exists.
+void RecordManager::log_change(char* page, LogRecordType type, int page_id, int slot_id,
+                               const char* before, size_t before_size, const char* after, size_t after_size) {
+    LogRecord record;
+    record.type = type;
+    record.file_id = file_id;
+    record.page_id = page_id;
+    record.slot_id = slot_id;
+    if (before) record.before.assign(before, before + before_size);
+    if (after) record.after.assign(after, after + after_size);
+    set_page_lsn(page, log_manager.append(record));
+}
+
+void RecordManager::redo(const LogRecord& record) {
+    if (record.type == LogRecordType::COMMIT || record.page_id < 0) return;
+
+    // Allocation is not logged; recreate pages a crash cut off the file.
+    while (record.page_id >= buffer_pool.get_num_pages(file_id)) {
+        int page_id;
+        if (!buffer_pool.new_page(file_id, page_id)) {
+            throw std::runtime_error("Failed to allocate page during recovery");
+        }
+        buffer_pool.unpin_page(file_id, page_id, true);
+    }
+
+    Page* frame = buffer_pool.fetch_page(file_id, record.page_id);
+    if (!frame) {
+        std::cerr << "[ERROR][RECORD_MANAGER] Failed to fetch page " << record.page_id << " during recovery" << std::endl;
+        throw std::runtime_error("Failed to fetch page");
+    }
+    char* page = frame->get_data();
+    if (get_page_lsn(page) >= record.lsn) {
+        buffer_pool.unpin_page(file_id, record.page_id, false); // already on disk
+        return;
+    }
+
+    init_page_if_needed(page);
+    bool ok = true;
+    switch (record.type) {
+        case LogRecordType::INSERT:
+            ok = place_record(page, record.slot_id, record.after.data(), static_cast<uint16_t>(record.after.size()));
+            break;
+        case LogRecordType::DELETE:
+            remove_record(page, record.slot_id);
+            break;
+        case LogRecordType::UPDATE:
+            ok = replace_record(page, record.slot_id, record.after.data(), static_cast<uint16_t>(record.after.size()));
+            break;
+        case LogRecordType::VERSION: {
+            uint16_t* slot_entry = slot_at(page, record.slot_id);
+            ok = slot_entry[0] != INVALID_SLOT && slot_entry[1] >= record.after.size();
+            if (ok) memcpy(page + slot_entry[0], record.after.data(), record.after.size());
+            break;
+        }
+        default:
+            break;
+    }
+    if (!ok) {
+        std::cerr << "[ERROR][RECORD_MANAGER] Redo of LSN " << record.lsn << " does not fit in page " << record.page_id << std::endl;
+    }
+
+    set_page_lsn(page, record.lsn);
+    free_space_map.update(record.page_id, page_free_space(page));
+    buffer_pool.unpin_page(file_id, record.page_id, true);
+}
+
+int RecordManager::find_free_page(int record_size) {
+    std::cout << RM_DEBUG_PREFIX << "Looking up a page with " << record_size << " free bytes in the free-space map" << std::endl;
+    while (true) {
+        int page_id = free_space_map.find_page(record_size);
+        if (page_id < 0) break;
+
+        Page* frame = buffer_pool.fetch_page(file_id, page_id);
+        if (!frame) {
+            std::cerr << "[ERROR][RECORD_MANAGER] Failed to fetch page " << page_id << std::endl;
+            throw std::runtime_error("Failed to fetch page");
+        }
+        frame->latch.lock_shared();
+        int available = page_free_space(frame->get_data());
+        frame->latch.unlock_shared();
+        buffer_pool.unpin_page(file_id, page_id, false);
+
+        if (available >= record_size) {
+            std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " has " << available << " free bytes. Using this page." << std::endl;
+            return page_id;
+        }
+
+        // The map was stale (e.g. after a crash); correct it and look again.
+        free_space_map.update(page_id, available);
     }
 
-    free_offset -= rec_size;
-    std::cout << RM_DEBUG_PREFIX << "Updated free_offset after inserting record data: " << free_offset << std::endl;
+    std::cout << RM_DEBUG_PREFIX << "No page with free space. Allocating new page." << std::endl;
+    int page_id;
+    Page* frame = buffer_pool.new_page(file_id, page_id);
+    if (!frame) {
+        std::cerr << "[ERROR][RECORD_MANAGER] Failed to allocate a new page" << std::endl;
+        throw std::runtime_error("Failed to allocate page");
+    }
 
-    // Copy record data
-    memcpy(&page[free_offset], record.data.data(), rec_size);
-    std::cout << RM_DEBUG_PREFIX << "Record data copied to page at offset " << free_offset << std::endl;
+    std::cout << RM_DEBUG_PREFIX << "Initializing header for new page " << page_id << std::endl;
+    frame->latch.lock();
+    init_page_if_needed(frame->get_data());
+    int available = page_free_space(frame->get_data());
+    frame->latch.unlock();
+    free_space_map.update(page_id, available);
+    buffer_pool.unpin_page(file_id, page_id, true);
+    return page_id;
+}
 
-    // Write slot entry
-    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_count * SLOT_SIZE]);
-    slot_entry[0] = free_offset;
-    slot_entry[1] = rec_size;
-    std::cout << RM_DEBUG_PREFIX << "Slot entry written at index " << slot_count << ": offset=" << free_offset << ", size=" << rec_size << std::endl;
+int RecordManager::insert_record(const Record& record) {
+    std::cout << RM_DEBUG_PREFIX << "Inserting record of " << record.data.size() << " bytes" << std::endl;
+    if (record.data.empty() || record.data.size() > MAX_RECORD_SIZE) {
+        std::cerr << "[ERROR][RECORD_MANAGER] Record size " << record.data.size() << " is outside 1.." << MAX_RECORD_SIZE << std::endl;
+        throw std::runtime_error("Record does not fit in a page");
+    }
+    uint16_t rec_size = static_cast<uint16_t>(record.data.size());
 
-    // Update header
-    slot_count++;
-    header_ptr[0] = slot_count;
-    header_ptr[1] = free_offset;
-    std::cout << RM_DEBUG_PREFIX << "Header updated: slot_count=" << slot_count << ", free_offset=" << free_offset << std::endl;
+    // Another thread may fill the page between the lookup and the latch;
+    // then look again.
+    int page_id;
+    Page* frame;
+    while (true) {
+        page_id = find_free_page(rec_size);
+        frame = buffer_pool.fetch_page(file_id, page_id);
+        if (!frame) {
+            std::cerr << "[ERROR][RECORD_MANAGER] Failed to fetch page " << page_id << std::endl;
+            throw std::runtime_error("Failed to fetch page");
+        }
+        frame->latch.lock();
+        int available = page_free_space(frame->get_data());
+        if (available >= rec_size) break;
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, false);
+        free_space_map.update(page_id, available);
+    }
+    char* page = frame->get_data();
+    init_page_if_needed(page);
 
-    bool success = disk.write_page(page_id, page);
-    if (!success) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Failed to write page " << page_id << " to disk." << std::endl;
-        throw std::runtime_error("Failed to write page");
+    uint16_t* header_ptr = reinterpret_cast<uint16_t*>(page);
+    uint16_t slot_count = header_ptr[0];
+
+    // Reuse a dead slot if there is one; otherwise append a new slot entry.
+    int slot_id = slot_count;
+    for (int i = 0; i < slot_count; ++i) {
+        uint16_t* slot_entry = slot_at(page, i);
+        if (slot_entry[0] == INVALID_SLOT || slot_entry[1] == 0) {
+            slot_id = i;
+            break;
+        }
     }
-    std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " written to disk." << std::endl;
 
-    std::cout << RM_DEBUG_PREFIX << "Record inserted at page " << page_id << " slot " << (slot_count - 1) << std::endl;
+    if (!place_record(page, slot_id, record.data.data(), rec_size)) {
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, false);
+        std::cerr << "[ERROR][RECORD_MANAGER] Not enough space in page " << page_id << " for record size " << rec_size << std::endl;
+        throw std::runtime_error("Page does not have enough space");
+    }
+    std::cout << RM_DEBUG_PREFIX << "Slot entry written at index " << slot_id << ": offset=" << slot_at(page, slot_id)[0] << ", size=" << rec_size << std::endl;
 
-    RecordID rid(page_id, slot_count - 1);
+    log_change(page, LogRecordType::INSERT, page_id, slot_id, nullptr, 0, record.data.data(), rec_size);
+    free_space_map.update(page_id, page_free_space(page));
+    frame->latch.unlock();
+    buffer_pool.unpin_page(file_id, page_id, true);
+    std::cout << RM_DEBUG_PREFIX << "Record inserted at page " << page_id << " slot " << slot_id << std::endl;
+
+    RecordID rid(page_id, slot_id);
     int record_id = rid.encode();
     return record_id;
 }
@@ -127,16 +312,18 @@ Record RecordManager::get_record(int record_id) {
     auto slot_id = decoded.slot_id;
     std::cout << RM_DEBUG_PREFIX << "Getting record at page " << page_id << ", slot " << slot_id << std::endl;
 
-    std::vector<char> page;
-    try {
-        page = disk.read_page(page_id);
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " read from disk." << std::endl;
-    } catch (...) {
+    Page* frame = buffer_pool.fetch_page(file_id, page_id);
+    if (!frame) {
         std::cerr << "[ERROR][RECORD_MANAGER] Failed to read page " << page_id << std::endl;
         throw std::runtime_error("Page read error");
     }
+    char* page = frame->get_data();
+    frame->latch.lock_shared();
 
-    if (page.size() < HEADER_SIZE + (slot_id + 1) * SLOT_SIZE) {
+    uint16_t slot_count = reinterpret_cast<uint16_t*>(page)[0];
+    if (slot_id >= slot_count) {
+        frame->latch.unlock_shared();
+        buffer_pool.unpin_page(file_id, page_id, false);
         std::cerr << "[ERROR][RECORD_MANAGER] Slot ID " << slot_id << " out of bounds in page " << page_id << std::endl;
         throw std::runtime_error("Invalid slot ID");
     }
@@ -148,13 +335,17 @@ Record RecordManager::get_record(int record_id) {
     std::cout << RM_DEBUG_PREFIX << "Slot entry: offset=" << offset << ", size=" << size << std::endl;
 
     if (offset == INVALID_SLOT || size == 0 || offset + size > PAGE_SIZE) {
+        frame->latch.unlock_shared();
+        buffer_pool.unpin_page(file_id, page_id, false);
         std::cerr << "[ERROR][RECORD_MANAGER] Record not found or invalid range at page " << page_id << ", slot " << slot_id << std::endl;
         throw std::runtime_error("Record not found or invalid range");
     }
 
-    std::vector<char> record_data(page.begin() + offset, page.begin() + offset + size);
+    std::vector<char> record_data(page + offset, page + offset + size);
+    frame->latch.unlock_shared();
+    buffer_pool.unpin_page(file_id, page_id, false);
     std::cout << RM_DEBUG_PREFIX << "Record data retrieved successfully." << std::endl;
-    return Record(record_data);
+    return Record(record_data, decoded);
 }
 
 void RecordManager::delete_record(int record_id) {
@@ -163,7 +354,7 @@ void RecordManager::delete_record(int record_id) {
     auto slot_id = decoded.slot_id;
 
     // Add validation for page_id and slot_id
-    if (decoded.page_id == static_cast<uint16_t>(-1) || decoded.page_id >= disk.get_num_pages()) {
+    if (decoded.page_id == static_cast<uint16_t>(-1) || decoded.page_id >= buffer_pool.get_num_pages(file_id)) {
         std::cerr << "[ERROR][RECORD_MANAGER] Invalid page id " << decoded.page_id << " in delete_record." << std::endl;
         throw std::runtime_error("Invalid page id for deletion");
     }
@@ -174,16 +365,18 @@ void RecordManager::delete_record(int record_id) {
 
     std::cout << RM_DEBUG_PREFIX << "Deleting record at page " << page_id << ", slot " << slot_id << std::endl;
 
-    std::vector<char> page;
-    try {
-        page = disk.read_page(page_id);
-        std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " read from disk for deletion." << std::endl;
-    } catch (...) {
+    Page* frame = buffer_pool.fetch_page(file_id, page_id);
+    if (!frame) {
         std::cerr << "[ERROR][RECORD_MANAGER] Failed to read page " << page_id << " for deletion." << std::endl;
         throw std::runtime_error("Page read error during deletion");
     }
+    char* page = frame->get_data();
+    frame->latch.lock();
 
-    if (page.size() < HEADER_SIZE + (slot_id + 1) * SLOT_SIZE) {
+    uint16_t slot_count = reinterpret_cast<uint16_t*>(page)[0];
+    if (slot_id >= slot_count) {
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, false);
         std::cerr << "[ERROR][RECORD_MANAGER] Slot ID " << slot_id << " out of bounds in page " << page_id << std::endl;
         throw std::runtime_error("Invalid slot ID for deletion");
     }
@@ -193,22 +386,20 @@ void RecordManager::delete_record(int record_id) {
     uint16_t size = slot_entry[1];
 
     if (offset == INVALID_SLOT || size == 0) {
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, false);
         std::cerr << "[WARNING][RECORD_MANAGER] Record at page " << page_id << ", slot " << slot_id << " is already deleted or invalid." << std::endl;
-        // Optional: You could throw here or just log and return
-        return; // Early return to avoid rewriting
+        return;
     }
 
-    slot_entry[0] = INVALID_SLOT;
-    slot_entry[1] = 0;
+    std::vector<char> before(page + offset, page + offset + size);
+    remove_record(page, slot_id);
+    log_change(page, LogRecordType::DELETE, page_id, slot_id, before.data(), before.size(), nullptr, 0);
 
     std::cout << RM_DEBUG_PREFIX << "Slot entry marked as invalid." << std::endl;
-
-    bool success = disk.write_page(page_id, page);
-    if (!success) {
-        std::cerr << "[ERROR][RECORD_MANAGER] Failed to write page " << page_id << " after deletion." << std::endl;
-        throw std::runtime_error("Failed to write page after deletion");
-    }
-    std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " written after deletion." << std::endl;
+    free_space_map.update(page_id, page_free_space(page));
+    frame->latch.unlock();
+    buffer_pool.unpin_page(file_id, page_id, true);
 }
 
 
@@ -218,39 +409,173 @@ int RecordManager::update_record(int record_id, const Record& new_record) {
     auto slot_id = decoded.slot_id;
     std::cout << RM_DEBUG_PREFIX << "Updating record at page " << page_id << ", slot " << slot_id << std::endl;
 
-    std::vector<char> page = disk.read_page(page_id);
-    std::cout << RM_DEBUG_PREFIX << "Page " << page_id << " read from disk for update." << std::endl;
+    Page* frame = buffer_pool.fetch_page(file_id, page_id);
+    if (!frame) {
+        std::cerr << "[ERROR][RECORD_MANAGER] Failed to read page " << page_id << " for update." << std::endl;
+        throw std::runtime_error("Page read error during update");
+    }
+    char* page = frame->get_data();
+    frame->latch.lock();
 
-    uint16_t* slot_entry = reinterpret_cast<uint16_t*>(&page[HEADER_SIZE + slot_id * SLOT_SIZE]);
+    uint16_t slot_count = reinterpret_cast<uint16_t*>(page)[0];
+    if (slot_id >= slot_count) {
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, false);
+        std::cerr << "[ERROR][RECORD_MANAGER] Slot ID " << slot_id << " out of bounds in page " << page_id << std::endl;
+        throw std::runtime_error("Invalid slot ID for update");
+    }
+
+    uint16_t* slot_entry = slot_at(page, slot_id);
     uint16_t offset = slot_entry[0];
     uint16_t size = slot_entry[1];
 
     if (offset == INVALID_SLOT || size == 0) {
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, false);
         std::cerr << "[ERROR][RECORD_MANAGER] Cannot update: Record not found or deleted." << std::endl;
         throw std::runtime_error("Record not found or deleted");
     }
 
+    if (new_record.data.empty() || new_record.data.size() > MAX_RECORD_SIZE) {
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, false);
+        std::cerr << "[ERROR][RECORD_MANAGER] Record size " << new_record.data.size() << " is outside 1.." << MAX_RECORD_SIZE << std::endl;
+        throw std::runtime_error("Record does not fit in a page");
+    }
     uint16_t new_size = static_cast<uint16_t>(new_record.data.size());
 
-    if (new_size <= size) {
-        // Overwrite in place
-        memcpy(&page[offset], new_record.data.data(), new_size);
-        slot_entry[1] = new_size;
+    // Smaller records are overwritten in place. A larger one is moved within
+    // the page if the page can hold it once the old copy is gone, so the
+    // record id stays the same.
+    int free_after_removal = page_free_space(page) + size;
+    if (new_size <= size || free_after_removal >= new_size) {
+        std::vector<char> before(page + offset, page + offset + size);
+        replace_record(page, slot_id, new_record.data.data(), new_size);
+        log_change(page, LogRecordType::UPDATE, page_id, slot_id, before.data(), before.size(), new_record.data.data(), new_size);
+
+        std::cout << RM_DEBUG_PREFIX << "Record updated within page " << page_id << ". New size: " << new_size << std::endl;
+        free_space_map.update(page_id, page_free_space(page));
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, true);
+        return record_id;
+    }
 
-        std::cout << RM_DEBUG_PREFIX << "Record updated in place. New size: " << new_size << std::endl;
+    // Not enough space, delete old and insert new
+    frame->latch.unlock();
+    buffer_pool.unpin_page(file_id, page_id, false);
+    std::cout << RM_DEBUG_PREFIX << "New record too large. Re-inserting in new page." << std::endl;
 
-        bool success = disk.write_page(page_id, page);
-        if (!success) {
-            std::cerr << "[ERROR][RECORD_MANAGER] Failed to write updated page." << std::endl;
-            throw std::runtime_error("Failed to update record");
-        }
-        return record_id;
-    } else {
-        // Not enough space, delete old and insert new
-        std::cout << RM_DEBUG_PREFIX << "New record too large. Re-inserting in new page." << std::endl;
+    delete_record(record_id);
+    return insert_record(new_record);  // new record_id returned
+}
+
+int RecordManager::insert_version(const vector<char>& row, timestamp_t txn_id) {
+    VersionHeader header;
+    header.begin = txn_id;
+    vector<char> record(VERSION_HEADER_SIZE + row.size());
+    write_version_header(record.data(), header);
+    memcpy(record.data() + VERSION_HEADER_SIZE, row.data(), row.size());
+    return insert_record(Record(std::move(record), RecordID()));
+}
 
-        delete_record(record_id);
-        return insert_record(new_record);  // new record_id returned
+Record RecordManager::get_version(int record_id, const Snapshot& snapshot) {
+    Record record = get_record(record_id);
+    if (record.data.size() < VERSION_HEADER_SIZE || !snapshot.sees(read_version_header(record.data.data()))) {
+        return Record(vector<char>(), record.rid);
     }
+    record.data.erase(record.data.begin(), record.data.begin() + VERSION_HEADER_SIZE);
+    return record;
 }
 
+bool RecordManager::change_version(int record_id, const function<bool(VersionHeader&)>& change) {
+    RecordID decoded = RecordID::decode(record_id);
+    auto page_id = decoded.page_id;
+    auto slot_id = decoded.slot_id;
+
+    Page* frame = buffer_pool.fetch_page(file_id, page_id);
+    if (!frame) {
+        std::cerr << "[ERROR][RECORD_MANAGER] Failed to read page " << page_id << " for a version change." << std::endl;
+        throw std::runtime_error("Page read error during version change");
+    }
+    char* page = frame->get_data();
+    frame->latch.lock();
+
+    uint16_t slot_count = reinterpret_cast<uint16_t*>(page)[0];
+    uint16_t* slot_entry = slot_id < slot_count ? slot_at(page, slot_id) : nullptr;
+    if (!slot_entry || slot_entry[0] == INVALID_SLOT || slot_entry[1] < VERSION_HEADER_SIZE) {
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, false);
+        std::cerr << "[ERROR][RECORD_MANAGER] No version at page " << page_id << ", slot " << slot_id << std::endl;
+        throw std::runtime_error("Version not found");
+    }
+
+    char* record = page + slot_entry[0];
+    char before[VERSION_HEADER_SIZE];
+    memcpy(before, record, VERSION_HEADER_SIZE);
+    VersionHeader header = read_version_header(record);
+    bool changed = change(header);
+    if (changed) {
+        write_version_header(record, header);
+        log_change(page, LogRecordType::VERSION, page_id, slot_id, before, VERSION_HEADER_SIZE, record, VERSION_HEADER_SIZE);
+    }
+    frame->latch.unlock();
+    buffer_pool.unpin_page(file_id, page_id, changed);
+    return changed;
+}
+
+bool RecordManager::end_version(int record_id, timestamp_t txn_id, int next_record_id) {
+    return change_version(record_id, [&](VersionHeader& header) {
+        if (header.end != TS_INFINITY) return false;
+        header.end = txn_id;
+        header.next = next_record_id;
+        return true;
+    });
+}
+
+void RecordManager::reopen_version(int record_id) {
+    change_version(record_id, [](VersionHeader& header) {
+        header.end = TS_INFINITY;
+        header.next = -1;
+        return true;
+    });
+}
+
+void RecordManager::stamp_versions(vector<int> record_ids, timestamp_t txn_id, timestamp_t commit_ts) {
+    // Record ids sort by page, so each page is latched once.
+    sort(record_ids.begin(), record_ids.end());
+    size_t stamped = 0;
+    size_t i = 0;
+    while (i < record_ids.size()) {
+        int page_id = RecordID::decode(record_ids[i]).page_id;
+        Page* frame = buffer_pool.fetch_page(file_id, page_id);
+        if (!frame) {
+            std::cerr << "[ERROR][RECORD_MANAGER] Failed to read page " << page_id << " for a commit." << std::endl;
+            throw std::runtime_error("Page read error during commit");
+        }
+        char* page = frame->get_data();
+        frame->latch.lock();
+        uint16_t slot_count = reinterpret_cast<uint16_t*>(page)[0];
+        bool dirty = false;
+        for (; i < record_ids.size() && RecordID::decode(record_ids[i]).page_id == page_id; ++i) {
+            int slot_id = RecordID::decode(record_ids[i]).slot_id;
+            if (slot_id >= slot_count) continue;
+            uint16_t* slot_entry = slot_at(page, slot_id);
+            if (slot_entry[0] == INVALID_SLOT || slot_entry[1] < VERSION_HEADER_SIZE) continue;
+
+            char* record = page + slot_entry[0];
+            VersionHeader header = read_version_header(record);
+            if (header.begin != txn_id && header.end != txn_id) continue; // listed twice
+            char before[VERSION_HEADER_SIZE];
+            memcpy(before, record, VERSION_HEADER_SIZE);
+            if (header.begin == txn_id) header.begin = commit_ts;
+            if (header.end == txn_id) header.end = commit_ts;
+            write_version_header(record, header);
+            log_change(page, LogRecordType::VERSION, page_id, slot_id, before, VERSION_HEADER_SIZE, record, VERSION_HEADER_SIZE);
+            dirty = true;
+            stamped++;
+        }
+        frame->latch.unlock();
+        buffer_pool.unpin_page(file_id, page_id, dirty);
+    }
+    std::cout << RM_DEBUG_PREFIX << "Stamped " << stamped << " version(s) with commit timestamp " << commit_ts << std::endl;
+}
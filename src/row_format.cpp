@@ -0,0 +1,251 @@
+#include "../include/row_format.h"
+#include "../include/index_key.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    const size_t FIXED_FIELD_SIZE = 8;
+    const size_t VAR_ENTRY_SIZE = sizeof(uint16_t);
+
+    bool is_null_literal(const string& value) {
+        if (value.size() != 4) return false;
+        string lower = value;
+        transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        return lower == "null";
+    }
+
+    string unquote(const string& value) {
+        if (value.size() >= 2 && (value.front() == '\'' || value.front() == '"') && value.back() == value.front()) {
+            return value.substr(1, value.size() - 2);
+        }
+        return value;
+    }
+
+    // Whole-string numeric parses; throw like stoll/stod on bad input.
+    int64_t parse_int(const string& value) {
+        size_t used = 0;
+        int64_t v = stoll(value, &used);
+        if (used != value.size()) throw invalid_argument(value);
+        return v;
+    }
+
+    double parse_float(const string& value) {
+        size_t used = 0;
+        double v = stod(value, &used);
+        if (used != value.size()) throw invalid_argument(value);
+        return v;
+    }
+
+    // Shortest decimal text that parses back to the same double.
+    string format_double(double value) {
+        for (int precision = 15; precision <= 17; ++precision) {
+            ostringstream oss;
+            oss.precision(precision);
+            oss << value;
+            if (precision == 17 || stod(oss.str()) == value) return oss.str();
+        }
+        return "";
+    }
+}
+
+RowFormat::RowFormat(const vector<DataType>& column_types) : types(column_types), field_offsets(column_types.size()) {
+    size_t offset = (types.size() + 7) / 8;
+    for (size_t i = 0; i < types.size(); ++i) {
+        if (types[i] != DataType::VARCHAR) {
+            field_offsets[i] = static_cast<uint16_t>(offset);
+            offset += FIXED_FIELD_SIZE;
+        }
+    }
+    var_array_offset = static_cast<uint16_t>(offset);
+    for (size_t i = 0; i < types.size(); ++i) {
+        if (types[i] == DataType::VARCHAR) {
+            field_offsets[i] = static_cast<uint16_t>(offset);
+            offset += VAR_ENTRY_SIZE;
+        }
+    }
+    var_data_offset = static_cast<uint16_t>(offset);
+}
+
+bool RowFormat::encode(const vector<string>& values, vector<char>& out, string& error) const {
+    if (values.size() != types.size()) {
+        error = "expected " + std::to_string(types.size()) + " values, got " + std::to_string(values.size());
+        return false;
+    }
+
+    start_row(out);
+
+    for (size_t i = 0; i < types.size(); ++i) {
+        const string& value = values[i];
+        int col = static_cast<int>(i);
+        if (is_null_literal(value)) {
+            set_null(out, col);
+            continue;
+        }
+
+        try {
+            switch (types[i]) {
+                case DataType::INT:
+                    set_int(out, col, parse_int(value));
+                    break;
+                case DataType::FLOAT:
+                    set_float(out, col, parse_float(value));
+                    break;
+                case DataType::VARCHAR:
+                    if (!set_varchar(out, col, unquote(value))) {
+                        error = "row is too large";
+                        return false;
+                    }
+                    break;
+                default:
+                    error = "column " + std::to_string(i) + " has an unknown type";
+                    return false;
+            }
+        } catch (const exception&) {
+            error = "'" + value + "' is not a valid " + to_string(types[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void RowFormat::start_row(vector<char>& out) const {
+    out.assign(var_data_offset, 0);
+}
+
+void RowFormat::set_null(vector<char>& out, int col) const {
+    out[col / 8] |= static_cast<char>(1 << (col % 8));
+    if (types[col] == DataType::VARCHAR) {
+        set_varchar(out, col, string_view());
+    }
+}
+
+void RowFormat::set_int(vector<char>& out, int col, int64_t value) const {
+    memcpy(&out[field_offsets[col]], &value, sizeof(value));
+}
+
+void RowFormat::set_float(vector<char>& out, int col, double value) const {
+    memcpy(&out[field_offsets[col]], &value, sizeof(value));
+}
+
+bool RowFormat::set_varchar(vector<char>& out, int col, string_view value) const {
+    if (out.size() + value.size() > UINT16_MAX) return false;
+    out.insert(out.end(), value.begin(), value.end());
+    uint16_t end = static_cast<uint16_t>(out.size());
+    memcpy(&out[field_offsets[col]], &end, sizeof(end));
+    return true;
+}
+
+bool RowFormat::copy_field(const RowFormat& src, const vector<char>& row, int src_col, vector<char>& out, int col) const {
+    if (src.is_null(row, src_col)) {
+        set_null(out, col);
+        return true;
+    }
+    switch (types[col]) {
+        case DataType::INT:
+            set_int(out, col, src.get_int(row, src_col));
+            return true;
+        case DataType::FLOAT:
+            set_float(out, col, src.get_float(row, src_col));
+            return true;
+        default:
+            return set_varchar(out, col, src.get_varchar(row, src_col));
+    }
+}
+
+uint16_t RowFormat::read_u16(const vector<char>& row, size_t offset) const {
+    uint16_t v;
+    memcpy(&v, &row[offset], sizeof(v));
+    return v;
+}
+
+bool RowFormat::varchar_bounds(const vector<char>& row, int col, uint16_t& start, uint16_t& end) const {
+    uint16_t entry = field_offsets[col];
+    start = entry == var_array_offset ? var_data_offset : read_u16(row, entry - VAR_ENTRY_SIZE);
+    end = read_u16(row, entry);
+    return start <= end && end <= row.size();
+}
+
+bool RowFormat::is_null(const vector<char>& row, int col) const {
+    return (row[col / 8] >> (col % 8)) & 1;
+}
+
+int64_t RowFormat::get_int(const vector<char>& row, int col) const {
+    int64_t v;
+    memcpy(&v, &row[field_offsets[col]], sizeof(v));
+    return v;
+}
+
+double RowFormat::get_float(const vector<char>& row, int col) const {
+    double v;
+    memcpy(&v, &row[field_offsets[col]], sizeof(v));
+    return v;
+}
+
+string_view RowFormat::get_varchar(const vector<char>& row, int col) const {
+    uint16_t start, end;
+    if (!varchar_bounds(row, col, start, end)) return string_view();
+    return string_view(row.data() + start, end - start);
+}
+
+string RowFormat::field_text(const vector<char>& row, int col) const {
+    if (col < 0 || col >= (int)types.size() || row.size() < var_data_offset) return "";
+    if (is_null(row, col)) return "NULL";
+    switch (types[col]) {
+        case DataType::INT:
+            return std::to_string(get_int(row, col));
+        case DataType::FLOAT:
+            return format_double(get_float(row, col));
+        case DataType::VARCHAR:
+            return "'" + string(get_varchar(row, col)) + "'";
+        default:
+            return "";
+    }
+}
+
+vector<string> RowFormat::decode(const vector<char>& row) const {
+    vector<string> values;
+    values.reserve(types.size());
+    for (size_t i = 0; i < types.size(); ++i) {
+        values.push_back(field_text(row, static_cast<int>(i)));
+    }
+    return values;
+}
+
+string RowFormat::index_key(const vector<char>& row, int col) const {
+    if (is_null(row, col)) return index_key_null();
+    switch (types[col]) {
+        case DataType::INT:
+            return index_key_int(get_int(row, col));
+        case DataType::FLOAT:
+            return index_key_float(get_float(row, col));
+        default:
+            return index_key_varchar(get_varchar(row, col));
+    }
+}
+
+bool RowFormat::literal_index_key(DataType type, const string& literal, string& key) {
+    if (is_null_literal(literal)) {
+        key = index_key_null();
+        return true;
+    }
+    try {
+        switch (type) {
+            case DataType::INT:
+                key = index_key_int(parse_int(literal));
+                return true;
+            case DataType::FLOAT:
+                key = index_key_float(parse_float(literal));
+                return true;
+            case DataType::VARCHAR:
+                key = index_key_varchar(unquote(literal));
+                return true;
+            default:
+                return false;
+        }
+    } catch (const exception&) {
+        return false;
+    }
+}
@@ -0,0 +1,127 @@
+#include "../../include/server/client.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+LimboClient::~LimboClient() {
+    close();
+}
+
+bool LimboClient::fail(const string& what) {
+    error = what + (errno ? string(": ") + strerror(errno) : string());
+    close();
+    return false;
+}
+
+bool LimboClient::connect_unix(const string& path) {
+    close();
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        errno = 0;
+        return fail("Socket path too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return fail("socket");
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        return fail("Cannot connect to " + path);
+    }
+    return true;
+}
+
+bool LimboClient::connect_tcp(const string& host, uint16_t port) {
+    close();
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    int status = getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &addresses);
+    if (status != 0) {
+        errno = 0;
+        return fail("Cannot resolve " + host + ": " + gai_strerror(status));
+    }
+    for (addrinfo* address = addresses; address; address = address->ai_next) {
+        fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) break;
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0) return fail("Cannot connect to " + host + ":" + to_string(port));
+
+    // Requests are small and answered one at a time
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return true;
+}
+
+void LimboClient::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    buffer.clear();
+}
+
+bool LimboClient::query(const string& sql, QueryResult& result) {
+    if (fd < 0) {
+        errno = 0;
+        return fail("Not connected");
+    }
+
+    string request;
+    append_frame(request, MessageType::QUERY, sql);
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t n = ::send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return fail("send");
+        sent += static_cast<size_t>(n);
+    }
+
+    // Rows come in ROWS frames until the RESULT frame ends the reply
+    QueryResult streamed;
+    char chunk[64 * 1024];
+    while (true) {
+        size_t pos = 0;
+        MessageType type;
+        string body;
+        FrameStatus status = read_frame(buffer, pos, type, body);
+        if (status == FrameStatus::COMPLETE) {
+            buffer.erase(0, pos);
+            bool valid = type == MessageType::ROWS ? decode_rows(body, streamed)
+                       : type == MessageType::RESULT && decode_result(body, result);
+            if (!valid) {
+                errno = 0;
+                return fail("Malformed reply from the server");
+            }
+            if (type == MessageType::ROWS) continue;
+            if (!result.ok) {
+                result.rows.clear();
+            } else if (!streamed.rows.empty()) {
+                streamed.rows.insert(streamed.rows.end(), make_move_iterator(result.rows.begin()),
+                                     make_move_iterator(result.rows.end()));
+                result.rows = std::move(streamed.rows);
+            }
+            return true;
+        }
+        if (status == FrameStatus::INVALID) {
+            errno = 0;
+            return fail("Malformed reply from the server");
+        }
+
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0) errno = 0;
+        if (n <= 0) return fail("Connection closed by the server");
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+}
@@ -0,0 +1,117 @@
+#include "../../include/server/protocol.h"
+
+namespace {
+    void put_u32(string& out, uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            out.push_back(static_cast<char>((value >> shift) & 0xFF));
+        }
+    }
+
+    void put_string(string& out, const string& value) {
+        put_u32(out, static_cast<uint32_t>(value.size()));
+        out += value;
+    }
+
+    bool get_u32(const string& in, size_t& pos, uint32_t& value) {
+        if (in.size() - pos < 4) return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(in[pos + i])) << (8 * i);
+        }
+        pos += 4;
+        return true;
+    }
+
+    bool get_string(const string& in, size_t& pos, string& value) {
+        uint32_t length;
+        if (!get_u32(in, pos, length) || in.size() - pos < length) return false;
+        value.assign(in, pos, length);
+        pos += length;
+        return true;
+    }
+
+    void put_rows(string& out, const vector<string>& columns, const vector<vector<string>>& rows) {
+        put_u32(out, static_cast<uint32_t>(columns.size()));
+        for (const string& column : columns) put_string(out, column);
+        put_u32(out, static_cast<uint32_t>(rows.size()));
+        for (const vector<string>& row : rows) {
+            for (size_t i = 0; i < columns.size(); ++i) {
+                put_string(out, i < row.size() ? row[i] : string());
+            }
+        }
+    }
+
+    // Sets the columns and appends the rows; the rest of body must be them
+    bool get_rows(const string& body, size_t& pos, QueryResult& result) {
+        uint32_t columns, rows;
+        if (!get_u32(body, pos, columns)) return false;
+        if ((body.size() - pos) / 4 < columns) return false;
+        result.columns.assign(columns, string());
+        for (string& column : result.columns) {
+            if (!get_string(body, pos, column)) return false;
+        }
+        if (!get_u32(body, pos, rows)) return false;
+        // Every value takes at least its 4-byte length; rows without columns
+        // cannot be told apart
+        if (rows > 0 && (columns == 0 || (body.size() - pos) / 4 / columns < rows)) return false;
+        size_t first = result.rows.size();
+        result.rows.resize(first + rows, vector<string>(columns));
+        for (size_t r = first; r < result.rows.size(); ++r) {
+            for (string& value : result.rows[r]) {
+                if (!get_string(body, pos, value)) return false;
+            }
+        }
+        return pos == body.size();
+    }
+}
+
+void append_frame(string& out, MessageType type, const string& body) {
+    put_u32(out, static_cast<uint32_t>(body.size()));
+    out.push_back(static_cast<char>(type));
+    out += body;
+}
+
+FrameStatus read_frame(const string& buffer, size_t& pos, MessageType& type, string& body) {
+    size_t at = pos;
+    uint32_t length;
+    if (buffer.size() - at < FRAME_HEADER_SIZE || !get_u32(buffer, at, length)) return FrameStatus::INCOMPLETE;
+    uint8_t raw_type = static_cast<uint8_t>(buffer[at++]);
+    if (length > MAX_FRAME_BYTES ||
+        raw_type < static_cast<uint8_t>(MessageType::QUERY) || raw_type > static_cast<uint8_t>(MessageType::ROWS)) {
+        return FrameStatus::INVALID;
+    }
+    if (buffer.size() - at < length) return FrameStatus::INCOMPLETE;
+
+    type = static_cast<MessageType>(raw_type);
+    body.assign(buffer, at, length);
+    pos = at + length;
+    return FrameStatus::COMPLETE;
+}
+
+string encode_result(const QueryResult& result) {
+    string body;
+    body.push_back(result.ok ? 1 : 0);
+    put_string(body, result.message);
+    put_rows(body, result.columns, result.rows);
+    return body;
+}
+
+bool decode_result(const string& body, QueryResult& result) {
+    if (body.empty()) return false;
+    size_t pos = 0;
+    result.ok = body[pos++] != 0;
+    if (!get_string(body, pos, result.message)) return false;
+    result.rows.clear();
+    return get_rows(body, pos, result);
+}
+
+string encode_rows(const vector<string>& columns, const vector<vector<string>>& rows) {
+    string body;
+    put_rows(body, columns, rows);
+    return body;
+}
+
+bool decode_rows(const string& body, QueryResult& result) {
+    size_t pos = 0;
+    return get_rows(body, pos, result);
+}
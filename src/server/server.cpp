@@ -0,0 +1,523 @@
+#include "../../include/server/server.h"
+#include "../../include/utils/string_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <streambuf>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // The reply message of the statement this thread is running, if any
+    thread_local string* captured_messages = nullptr;
+    thread_local string pending_line;
+
+    bool is_message(const string& line) {
+        return line.rfind("[INFO]", 0) == 0 || line.rfind("[ERROR]", 0) == 0 || line.rfind("[WARNING]", 0) == 0;
+    }
+
+    void keep_line() {
+        if (is_message(pending_line)) *captured_messages += pending_line;
+        pending_line.clear();
+    }
+
+    // Takes the place of cout's buffer while the server runs. The engine
+    // reports to the user on cout; on a worker running a statement, the
+    // lines that are messages ([INFO], [ERROR], [WARNING]) go into the
+    // client's reply. Everything else, the debug output and other threads'
+    // lines, is dropped, or echoed to the console with --verbose.
+    class SessionOutput : public streambuf {
+    private:
+        streambuf* console;
+        bool verbose;
+        mutex console_latch;
+
+        void put(const char* data, streamsize count) {
+            if (captured_messages) {
+                for (streamsize i = 0; i < count; ++i) {
+                    pending_line.push_back(data[i]);
+                    if (data[i] == '\n') keep_line();
+                }
+            }
+            if (verbose) {
+                lock_guard<mutex> lock(console_latch);
+                console->sputn(data, count);
+            }
+        }
+
+    protected:
+        int overflow(int c) override {
+            if (c != traits_type::eof()) {
+                char ch = traits_type::to_char_type(c);
+                put(&ch, 1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        streamsize xsputn(const char* data, streamsize count) override {
+            put(data, count);
+            return count;
+        }
+
+        int sync() override {
+            if (verbose) {
+                lock_guard<mutex> lock(console_latch);
+                console->pubsync();
+            }
+            return 0;
+        }
+
+    public:
+        SessionOutput(streambuf* console, bool verbose) : console(console), verbose(verbose) {}
+    };
+
+    // Names become paths under data/; keep them to one plain component
+    bool valid_database_name(const string& name) {
+        return !name.empty() && all_of(name.begin(), name.end(), [](unsigned char c) {
+            return isalnum(c) || c == '_' || c == '-';
+        });
+    }
+
+    // The statement text without its ';', for the commands the server
+    // handles itself.
+    string command_text(const string& sql) {
+        string command = sql;
+        trim(command);
+        if (!command.empty() && command.back() == ';') command.pop_back();
+        trim(command);
+        return command;
+    }
+}
+
+Server::Server(ServerOptions options) : options(std::move(options)) {
+    if (this->options.workers == 0) {
+        this->options.workers = max(1u, thread::hardware_concurrency());
+    }
+}
+
+Server::~Server() {
+    for (int fd : listen_fds) ::close(fd);
+    if (signal_fd >= 0) ::close(signal_fd);
+    if (wake_fd >= 0) ::close(wake_fd);
+    if (epoll_fd >= 0) ::close(epoll_fd);
+}
+
+bool Server::watch(int fd, uint32_t events, int op) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    return epoll_ctl(epoll_fd, op, fd, &event) == 0;
+}
+
+bool Server::listen_unix(const string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        cout << "[ERROR] Socket path too long: " << path << endl;
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // A socket left behind by a server that did not stop cleanly
+    struct stat existing;
+    if (::stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        ::unlink(path.c_str());
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(fd, SOMAXCONN) < 0 || !watch(fd, EPOLLIN, EPOLL_CTL_ADD)) {
+        cout << "[ERROR] Cannot listen on " << path << ": " << strerror(errno) << endl;
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    listen_fds.push_back(fd);
+    cout << "[INFO] Listening on " << path << endl;
+    return true;
+}
+
+bool Server::listen_tcp(uint16_t port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    if (fd < 0 || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(fd, SOMAXCONN) < 0 || !watch(fd, EPOLLIN, EPOLL_CTL_ADD)) {
+        cout << "[ERROR] Cannot listen on 127.0.0.1:" << port << ": " << strerror(errno) << endl;
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    listen_fds.push_back(fd);
+    cout << "[INFO] Listening on 127.0.0.1:" << port << endl;
+    return true;
+}
+
+bool Server::run() {
+    // Blocked before any thread starts, so every thread inherits the mask
+    // and the signals only arrive through signal_fd
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (epoll_fd < 0 || wake_fd < 0 || signal_fd < 0 ||
+        !watch(wake_fd, EPOLLIN, EPOLL_CTL_ADD) || !watch(signal_fd, EPOLLIN, EPOLL_CTL_ADD)) {
+        cout << "[ERROR] Cannot set up the event loop: " << strerror(errno) << endl;
+        return false;
+    }
+    if ((!options.socket_path.empty() && !listen_unix(options.socket_path)) ||
+        (options.port != 0 && !listen_tcp(options.port))) {
+        return false;
+    }
+    if (listen_fds.empty()) {
+        cout << "[ERROR] Nothing to listen on." << endl;
+        return false;
+    }
+    cout << "[INFO] Serving with " << options.workers << " worker thread(s)." << endl;
+
+    SessionOutput output(cout.rdbuf(), options.verbose);
+    streambuf* console = cout.rdbuf(&output);
+    for (unsigned i = 0; i < options.workers; ++i) {
+        workers.emplace_back(&Server::worker_loop, this);
+    }
+
+    epoll_event events[64];
+    while (!stopping) {
+        int ready = epoll_wait(epoll_fd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd) {
+                take_replies();
+            } else if (fd == signal_fd) {
+                signalfd_siginfo info;
+                while (::read(signal_fd, &info, sizeof(info)) == sizeof(info)) {}
+                stopping = true;
+            } else if (find(listen_fds.begin(), listen_fds.end(), fd) != listen_fds.end()) {
+                accept_connections(fd);
+            } else {
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                shared_ptr<Connection> connection = it->second;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR)) read_connection(connection);
+                if ((events[i].events & EPOLLOUT) && connection->fd >= 0) write_connection(connection);
+            }
+        }
+    }
+
+    // Stop taking work, let the workers finish what they have, then close
+    // the sessions before the databases they use
+    for (int fd : listen_fds) ::close(fd);
+    listen_fds.clear();
+    if (!options.socket_path.empty()) ::unlink(options.socket_path.c_str());
+    {
+        lock_guard<mutex> lock(jobs_latch);
+        workers_stop = true;
+    }
+    jobs_cv.notify_all();
+    {
+        // Workers waiting for a client to read give up
+        lock_guard<mutex> lock(replies_latch);
+    }
+    replies_sent.notify_all();
+    for (thread& worker : workers) worker.join();
+    workers.clear();
+    {
+        lock_guard<mutex> lock(replies_latch);
+        replies.clear();
+    }
+    while (!connections.empty()) {
+        shared_ptr<Connection> connection = connections.begin()->second;
+        close_connection(connection);
+    }
+    {
+        lock_guard<mutex> lock(databases_latch);
+        databases.clear();
+    }
+
+    cout.rdbuf(console);
+    cout << "[INFO] Server stopped." << endl;
+    return true;
+}
+
+void Server::stop() {
+    stopping = true;
+    uint64_t one = 1;
+    if (wake_fd >= 0 && ::write(wake_fd, &one, sizeof(one)) < 0) {
+        // The counter only overflows with billions of wakes pending
+    }
+}
+
+void Server::accept_connections(int listen_fd) {
+    while (true) {
+        int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return; // EAGAIN: none left; otherwise try again on the next event
+        }
+        // Fails harmlessly on Unix sockets
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        auto connection = make_shared<Connection>();
+        connection->fd = fd;
+        if (!watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD)) {
+            ::close(fd);
+            continue;
+        }
+        connections[fd] = std::move(connection);
+    }
+}
+
+void Server::read_connection(const shared_ptr<Connection>& connection) {
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t n = ::recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            connection->in.append(chunk, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+        // The client is gone. A session a worker is using is closed when
+        // the worker hands it back.
+        if (connection->busy) {
+            abandon_connection(connection);
+        } else {
+            close_connection(connection);
+        }
+        return;
+    }
+    dispatch(connection);
+}
+
+void Server::write_connection(const shared_ptr<Connection>& connection) {
+    size_t sent = 0;
+    while (sent < connection->out.size()) {
+        ssize_t n = ::send(connection->fd, connection->out.data() + sent, connection->out.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (connection->busy) {
+            abandon_connection(connection);
+        } else {
+            close_connection(connection);
+        }
+        return;
+    }
+    connection->out.erase(0, sent);
+    if (sent > 0) {
+        {
+            lock_guard<mutex> lock(replies_latch);
+            connection->unsent -= min(sent, connection->unsent.load());
+        }
+        replies_sent.notify_all();
+    }
+    // Only ask for EPOLLOUT while a reply is still waiting to go out
+    uint32_t events = EPOLLIN | EPOLLRDHUP | (connection->out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    watch(connection->fd, events, EPOLL_CTL_MOD);
+}
+
+void Server::dispatch(const shared_ptr<Connection>& connection) {
+    if (connection->busy || connection->closing || connection->fd < 0) return;
+
+    MessageType type;
+    string body;
+    FrameStatus status = read_frame(connection->in, connection->in_pos, type, body);
+    if (status == FrameStatus::INCOMPLETE) {
+        connection->in.erase(0, connection->in_pos);
+        connection->in_pos = 0;
+        return;
+    }
+    if (status == FrameStatus::INVALID || type != MessageType::QUERY) {
+        close_connection(connection);
+        return;
+    }
+
+    connection->busy = true;
+    {
+        lock_guard<mutex> lock(jobs_latch);
+        jobs.push_back({connection, std::move(body)});
+    }
+    jobs_cv.notify_one();
+}
+
+void Server::close_connection(const shared_ptr<Connection>& connection) {
+    if (connection->fd < 0) return;
+    // connection may be the map's own pointer; hold on to the Connection
+    // until its fd is cleared
+    shared_ptr<Connection> keep = connection;
+    int fd = keep->fd;
+    keep->fd = -1;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+    // The session, and any transaction it left open, goes with the last
+    // reference to the connection
+}
+
+void Server::abandon_connection(const shared_ptr<Connection>& connection) {
+    watch(connection->fd, 0, EPOLL_CTL_DEL);
+    {
+        lock_guard<mutex> lock(replies_latch);
+        connection->closing = true;
+    }
+    replies_sent.notify_all();
+}
+
+void Server::take_replies() {
+    uint64_t count;
+    while (::read(wake_fd, &count, sizeof(count)) == sizeof(count)) {}
+
+    deque<Reply> ready;
+    {
+        lock_guard<mutex> lock(replies_latch);
+        ready.swap(replies);
+    }
+    for (Reply& reply : ready) {
+        const shared_ptr<Connection>& connection = reply.connection;
+        if (reply.last) connection->busy = false;
+        if (connection->closing) {
+            if (reply.last) close_connection(connection);
+            continue;
+        }
+        connection->out += reply.frames;
+        write_connection(connection);
+        // Requests sent before this reply came back
+        if (reply.last) dispatch(connection);
+    }
+}
+
+void Server::worker_loop() {
+    while (true) {
+        Job job;
+        {
+            unique_lock<mutex> lock(jobs_latch);
+            jobs_cv.wait(lock, [&] { return workers_stop || !jobs.empty(); });
+            if (jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        QueryResult result = execute(job.connection, job.sql);
+        string reply;
+        append_frame(reply, MessageType::RESULT, encode_result(result));
+        send_reply(job.connection, std::move(reply), true);
+    }
+}
+
+bool Server::send_reply(const shared_ptr<Connection>& connection, string frames, bool last) {
+    {
+        unique_lock<mutex> lock(replies_latch);
+        if (!last) {
+            bool caught_up = replies_sent.wait_for(lock, STALLED_CLIENT_TIMEOUT, [&] {
+                return connection->unsent <= MAX_UNSENT_BYTES || connection->closing || stopping;
+            });
+            if (!caught_up || connection->closing || stopping) return false;
+        }
+        connection->unsent += frames.size();
+        replies.push_back({connection, std::move(frames), last});
+    }
+    uint64_t one = 1;
+    if (::write(wake_fd, &one, sizeof(one)) < 0) {
+        // Already signalled more times than the loop has read
+    }
+    return true;
+}
+
+Database* Server::open_database(const string& name) {
+    // Also keeps two databases from booting at once (CURRENT_DATABASE)
+    lock_guard<mutex> lock(databases_latch);
+    unique_ptr<Database>& database = databases[name];
+    if (!database) {
+        database = make_unique<Database>(name, options.config);
+    }
+    return database.get();
+}
+
+QueryResult Server::execute(const shared_ptr<Connection>& connection, const string& sql) {
+    Session& session = connection->session;
+    QueryResult result;
+    captured_messages = &result.message;
+
+    string command = command_text(sql);
+    string lower = command;
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    if (lower.rfind("create database ", 0) == 0 || lower.rfind("use ", 0) == 0) {
+        bool use = lower.rfind("use ", 0) == 0;
+        string name = command.substr(use ? 4 : 16);
+        trim(name);
+        if (!valid_database_name(name)) {
+            cout << "[ERROR] Invalid database name '" << name << "'." << endl;
+        } else if (!use) {
+            result.ok = Database::create(name);
+            if (result.ok) cout << "[INFO] Database '" << name << "' created." << endl;
+            else cout << "[ERROR] Database already exists." << endl;
+        } else if (!Database::exists(name)) {
+            cout << "[ERROR] Database '" << name << "' does not exist." << endl;
+        } else {
+            // Leaving the old database rolls back a transaction left open there
+            session.parser.reset();
+            session.database = open_database(name);
+            session.parser = session.database->open_session();
+            cout << "[INFO] Switched to database: " << name << endl;
+            result.ok = true;
+        }
+    } else if (lower == "show databases") {
+        result.columns = {"database"};
+        for (const string& name : Database::list()) result.rows.push_back({name});
+        result.ok = true;
+    } else if (!session.parser) {
+        cout << "[ERROR] No database selected. Use: USE dbname;" << endl;
+    } else {
+        ResultSet rows;
+        rows.batch_bytes = ROW_BATCH_BYTES;
+        rows.on_batch = [&](ResultSet& batch) {
+            string frame;
+            append_frame(frame, MessageType::ROWS, encode_rows(batch.columns, batch.rows));
+            if (!send_reply(connection, std::move(frame), false)) {
+                // Ends the statement, which reports it as failed
+                throw runtime_error("The client stopped reading the result.");
+            }
+        };
+        session.parser->set_result_set(&rows);
+        result.ok = session.parser->execute_query(sql);
+        if (!result.ok) cout << "[ERROR] Failed to execute query." << endl;
+        session.parser->set_result_set(nullptr);
+        session.database->end_statement(*session.parser);
+        result.columns = std::move(rows.columns);
+        result.rows = std::move(rows.rows);
+    }
+
+    cout.flush();
+    keep_line();
+    captured_messages = nullptr;
+    return result;
+}
@@ -8,34 +8,14 @@
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <set>
+#include <stdexcept>
+#include <mutex>
+#include <shared_mutex>
 #include "pretty.hpp"
 
 using namespace std;
 
-// Utility function to join a vector of strings with a delimiter
-static string join(const vector<string>& elements, char delimiter) {
-    if (elements.empty()) return "";
-    ostringstream os;
-    auto it = elements.begin();
-    os << *it;
-    ++it;
-    for (; it != elements.end(); ++it) {
-        os << delimiter << *it;
-    }
-    return os.str();
-}
-
-// Utility function to split a string by a delimiter
-static vector<string> split(const string& s, char delimiter) {
-    vector<string> tokens;
-    string token;
-    istringstream tokenStream(s);
-    while (getline(tokenStream, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
-}
-
 #define DEBUG_COLOR_RESET      "\033[0m"
 #define DEBUG_COLOR_YELLOW     "\033[33m"
 #define DEBUG_COLOR_CYAN       "\033[36m"
@@ -43,55 +23,98 @@ static vector<string> split(const string& s, char delimiter) {
 #define DEBUG_TABLE_LABEL      DEBUG_COLOR_CYAN "[TABLE_MANAGER]" DEBUG_COLOR_RESET
 #define DEBUG_TABLE_MANAGER    std::cout << DEBUG_DEBUG_LABEL << DEBUG_TABLE_LABEL << " "
 
-TableManager::TableManager(CatalogManager& cat, RecordManager& rm, IndexManager& im)
-    : catalog(cat), record_mgr(rm), index_mgr(im) {
+namespace {
+    // Record ids come from the user or from an index, so they may name a
+    // slot the table's heap never had; treat that as "no such row".
+    Record fetch_row(RecordManager& heap, int record_id, const Snapshot& snapshot) {
+        try {
+            return heap.get_version(record_id, snapshot);
+        } catch (const std::runtime_error&) {
+            return Record(vector<char>());
+        }
+    }
+
+    // The version at record_id whatever its state; false if there is none.
+    bool fetch_version(RecordManager& heap, int record_id, VersionHeader& header) {
+        try {
+            Record record = heap.get_record(record_id);
+            if (record.data.size() < VERSION_HEADER_SIZE) return false;
+            header = read_version_header(record.data.data());
+            return true;
+        } catch (const std::runtime_error&) {
+            return false;
+        }
+    }
+
+    vector<char> version_row(const Record& record) {
+        return vector<char>(record.data.begin() + VERSION_HEADER_SIZE, record.data.end());
+    }
+}
+
+vector<int> TableManager::indexed_positions(const string& table_name, const TableSchema& schema) {
+    vector<int> positions;
+    for (const string& column : index_mgr.indexed_columns(table_name)) {
+        auto it = find(schema.columns.begin(), schema.columns.end(), column);
+        if (it != schema.columns.end()) positions.push_back(static_cast<int>(it - schema.columns.begin()));
+    }
+    return positions;
+}
+
+TableManager::TableManager(CatalogManager& cat, IndexManager& im)
+    : catalog(cat), index_mgr(im) {
     DEBUG_TABLE_MANAGER << "Initialized TableManager with IndexManager" << std::endl;
 }
 
 bool TableManager::column_exists(const string& table_name, const string& column_name) {
-    TableSchema schema = catalog.get_schema(table_name);
-    return find(schema.columns.begin(), schema.columns.end(), column_name) != schema.columns.end();
+    const TableSchema* schema = catalog.find_schema(table_name);
+    return schema && find(schema->columns.begin(), schema->columns.end(), column_name) != schema->columns.end();
 }
 
-int TableManager::insert_into(const string& table_name, const vector<string>& values) {
+int TableManager::insert_into(const string& table_name, const vector<string>& values, Transaction& transaction) {
     DEBUG_TABLE_MANAGER << "insert_into called for table: " << table_name << std::endl;
-    TableSchema schema = catalog.get_schema(table_name);
-    if (values.size() != schema.columns.size()) {
+    const TableSchema* found = catalog.find_schema(table_name);
+    RecordManager* heap = catalog.get_heap(table_name);
+    if (!found || !heap || values.size() != found->columns.size()) {
         DEBUG_TABLE_MANAGER << "Insert failed: value count does not match schema" << std::endl;
         return -1;
     }
+    const TableSchema& schema = *found;
+
+    RowFormat format(schema.column_types);
+    vector<char> row;
+    string error;
+    if (!format.encode(values, row, error)) {
+        DEBUG_TABLE_MANAGER << "[ERROR] Insert failed: " << error << endl;
+        return -1;
+    }
 
     // Primary Key Uniqueness check
     if(schema.primary_key_idx != -1){
         const string& pk_column = schema.columns[schema.primary_key_idx];
-        const string& pk_value = values[schema.primary_key_idx];
 
-        vector<int> existing = index_mgr.search(table_name, pk_column, pk_value);
-        if(!existing.empty()){
-            DEBUG_TABLE_MANAGER << "[ERROR] Duplicate entry for PRIMARY KEY: " << pk_value << endl;
-            return -1;
+        // The index also holds the key's old versions; only a live one counts.
+        PostingList existing = index_mgr.search(table_name, pk_column, format.index_key(row, schema.primary_key_idx));
+        for (int existing_id : existing.to_vector()) {
+            VersionHeader version;
+            if (fetch_version(*heap, existing_id, version) && is_live(version, transaction.id())) {
+                DEBUG_TABLE_MANAGER << "[ERROR] Duplicate entry for PRIMARY KEY: " << format.field_text(row, schema.primary_key_idx) << endl;
+                return -1;
+            }
         }
     }
 
-    stringstream ss;
-    ss << table_name << "|";
-    for (size_t i = 0; i < values.size(); ++i) {
-        ss << values[i];
-        if (i < values.size() - 1) ss << "|";
-    }
-
-    Record record(ss.str());
-    int record_id = record_mgr.insert_record(record);
+    int record_id = heap->insert_version(row, transaction.id());
+    transaction.writes.push_back({table_name, heap, record_id});
 
-    for (size_t i = 0; i < schema.columns.size(); ++i) {
-        index_mgr.insert_entry(table_name, schema.columns[i], values[i], record_id);
+    for (int i : indexed_positions(table_name, schema)) {
+        index_mgr.insert_entry(table_name, schema.columns[i], format.index_key(row, i), record_id);
     }
 
     DEBUG_TABLE_MANAGER << "Inserted record_id: " << record_id << std::endl;
     return record_id;
 }
 
-bool TableManager::delete_from(const std::string& table_name, int record_id) {
+bool TableManager::delete_from(const std::string& table_name, int record_id, Transaction& transaction) {
     DEBUG_TABLE_MANAGER << "delete_from called for table: " << table_name 
                          << ", record_id: " << record_id << std::endl;
 
@@ -99,24 +122,18 @@ bool TableManager::delete_from(const std::string& table_name, int record_id) {
         int deleted_count = 0;
         std::vector<int> to_delete;
 
-        RecordIterator iterator(record_mgr.get_disk());
-        const std::string table_prefix = table_name + "|";
-        const std::string schema_prefix = "SCHEMA|";
+        RecordManager* heap = catalog.get_heap(table_name);
+        if (!heap) return false;
 
+        RecordIterator iterator(*heap, transaction.snapshot);
         while (iterator.has_next()) {
             auto [rec, page_id, slot_id] = iterator.next_with_location();
-            std::string rec_str = rec.to_string();
-
-            if (rec_str.rfind(schema_prefix, 0) == 0) continue;
-            if (rec_str.rfind(table_prefix, 0) != 0) continue;
-
             RecordID rid(page_id, slot_id);
             to_delete.push_back(rid.encode());
         }
 
         for (int rid_encoded : to_delete) {
-            delete_from(table_name, rid_encoded);
-            deleted_count++;
+            if (delete_from(table_name, rid_encoded, transaction)) deleted_count++;
         }
 
         DEBUG_TABLE_MANAGER << "Deleted " << deleted_count 
@@ -124,121 +141,117 @@ bool TableManager::delete_from(const std::string& table_name, int record_id) {
         return true;
     }
 
-    record_mgr.delete_record(record_id);
+    // The version only gets an end; snapshots that still see it keep
+    // reading it, through its index entries too, until it is collected.
+    const TableSchema* found = catalog.find_schema(table_name);
+    RecordManager* heap = catalog.get_heap(table_name);
+    if (!found || !heap) return false;
+    RowFormat format(found->column_types);
+    Record old_record = fetch_row(*heap, record_id, transaction.snapshot);
+    if (!format.is_valid(old_record.data)) {
+        DEBUG_TABLE_MANAGER << "[ERROR] Record " << record_id << " is not a row of " << table_name << endl;
+        return false;
+    }
+    if (!heap->end_version(record_id, transaction.id())) {
+        DEBUG_TABLE_MANAGER << "[ERROR] Record " << record_id << " was changed by another transaction" << endl;
+        return false;
+    }
+    transaction.writes.push_back({table_name, heap, record_id});
+    transaction.ended.push_back({table_name, record_id, 0});
     return true;
 }
 
-bool TableManager::update(const string& table_name, int record_id, const vector<string>& new_values) {
+bool TableManager::update(const string& table_name, int record_id, const vector<string>& new_values, Transaction& transaction) {
     DEBUG_TABLE_MANAGER << "update called for table: " << table_name << std::endl;
-    TableSchema schema = catalog.get_schema(table_name);
-    if (new_values.size() != schema.columns.size()) {
+    const TableSchema* found = catalog.find_schema(table_name);
+    RecordManager* heap = catalog.get_heap(table_name);
+    if (!found || !heap || new_values.size() != found->columns.size()) {
         DEBUG_TABLE_MANAGER << "Update failed: value count mismatch" << std::endl;
         return false;
     }
+    const TableSchema& schema = *found;
 
-    Record old_record = record_mgr.get_record(record_id);
-    stringstream ss_old(old_record.to_string());
-    vector<string> old_tokens;
-    string token;
-    
-    // Extract table name and values
-    std::getline(ss_old, token, '|'); // Skip table name
-    while (std::getline(ss_old, token, '|')) {
-        old_tokens.push_back(token);
+    RowFormat format(schema.column_types);
+    Record old_record = fetch_row(*heap, record_id, transaction.snapshot);
+    if (!format.is_valid(old_record.data)) {
+        DEBUG_TABLE_MANAGER << "[ERROR] Record " << record_id << " is not a row of " << table_name << endl;
+        return false;
     }
 
-    for (size_t i = 0; i < old_tokens.size(); ++i) {
-        index_mgr.delete_entry(table_name, schema.columns[i], old_tokens[i], record_id);
+    vector<char> row;
+    string error;
+    if (!format.encode(new_values, row, error)) {
+        DEBUG_TABLE_MANAGER << "Update failed: " << error << std::endl;
+        return false;
     }
 
-    stringstream ss;
-    ss << table_name << "|";
-    for (size_t i = 0; i < new_values.size(); ++i) {
-        ss << new_values[i];
-        if (i < new_values.size() - 1) ss << "|";
+    // The new version goes in first so the old one can point at it. The old
+    // version and its index entries stay for the snapshots that see it;
+    // the new one is only found once this transaction commits.
+    int new_record_id = heap->insert_version(row, transaction.id());
+    if (!heap->end_version(record_id, transaction.id(), new_record_id)) {
+        heap->delete_record(new_record_id);
+        DEBUG_TABLE_MANAGER << "[ERROR] Record " << record_id << " was changed by another transaction" << endl;
+        return false;
     }
+    transaction.writes.push_back({table_name, heap, new_record_id});
+    transaction.writes.push_back({table_name, heap, record_id});
+    transaction.ended.push_back({table_name, record_id, 0});
 
-    Record new_record(ss.str());
-    record_mgr.update_record(record_id, new_record);
-
-    for (size_t i = 0; i < new_values.size(); ++i) {
-        index_mgr.insert_entry(table_name, schema.columns[i], new_values[i], record_id);
+    for (int i : indexed_positions(table_name, schema)) {
+        index_mgr.insert_entry(table_name, schema.columns[i], format.index_key(row, i), new_record_id);
     }
 
     return true;
 }
 
-Record TableManager::select(const string& table_name, int record_id) {
+Record TableManager::select(const string& table_name, int record_id, const Snapshot& snapshot) {
     DEBUG_TABLE_MANAGER << "select called for table: " << table_name 
                          << ", record_id: " << record_id << std::endl;
     
-    Record rec = record_mgr.get_record(record_id);
-    string rec_str(rec.data.begin(), rec.data.end());
-    vector<string> fields = split(rec_str, '|');
-
-    if (!fields.empty() && fields[0] == table_name) {
-        // Remove the first field (table name)
-        fields.erase(fields.begin());
-        string updated_data = join(fields, '|');
-        return Record(vector<char>(updated_data.begin(), updated_data.end()), rec.get_record_id());
+    const TableSchema* schema = catalog.find_schema(table_name);
+    RecordManager* heap = catalog.get_heap(table_name);
+    if (!schema || !heap) return Record(vector<char>());
+
+    Record rec = fetch_row(*heap, record_id, snapshot);
+    if (!RowFormat(schema->column_types).is_valid(rec.data)) {
+        // Stale index entry
+        return Record(vector<char>(), rec.get_record_id());
     }
-
     return rec;
 }
 
-vector<Record> TableManager::scan(const string& table_name) {
+vector<Record> TableManager::scan(const string& table_name, const Snapshot& snapshot) {
     DEBUG_TABLE_MANAGER << "scan called for table: " << table_name << std::endl;
     vector<Record> records;
-    RecordIterator it(record_mgr.get_disk());
-    const std::string schema_prefix = "SCHEMA|";
-    const std::string table_prefix = table_name + "|";
-    
-    while (it.has_next()) {
-        Record rec = it.next();
-        std::string rec_str(rec.data.begin(), rec.data.end());
-        
-        if (rec_str.rfind(schema_prefix, 0) == 0) continue;
-        if (rec_str.rfind(table_prefix, 0) != 0) continue;
-        
-        rec_str = rec_str.substr(table_prefix.size());
-        rec.data = std::vector<char>(rec_str.begin(), rec_str.end());
-        records.push_back(rec);
-    }
-    
+    RecordManager* heap = catalog.get_heap(table_name);
+    if (!heap) return records;
+
+    RecordIterator it(*heap, snapshot);
+    it.next_batch(records, SIZE_MAX);
+
     DEBUG_TABLE_MANAGER << "Scanned " << records.size() 
                         << " records from table: " << table_name << std::endl;
     return records;
 }
 
-void TableManager::printTable(const std::string& tableName) {
+void TableManager::printTable(const std::string& tableName, const Snapshot& snapshot) {
     TableSchema schema = catalog.get_schema(tableName);
     if (schema.table_name.empty()) {
         std::cerr << "[ERROR] Table '" << tableName << "' does not exist." << std::endl;
         return;
     }
 
-    std::vector<Record> records = scan(tableName);
+    std::vector<Record> records = scan(tableName, snapshot);
     pretty::Table table;
 
     // Add header row
     table.add_row(schema.columns);
 
     // Add data rows
+    RowFormat format(schema.column_types);
     for (const auto& rec : records) {
-        std::string recStr(rec.data.begin(), rec.data.end());
-        std::vector<std::string> values;
-        std::stringstream ss(recStr);
-        std::string field;
-        
-        while (std::getline(ss, field, '|')) {
-            values.push_back(field);
-        }
-        
-        // Pad with empty strings if needed
-        if (values.size() < schema.columns.size()) {
-            values.resize(schema.columns.size(), "");
-        }
-        table.add_row(values);
+        table.add_row(format.decode(rec.data));
     }
 
     // Handle empty table
@@ -254,33 +267,216 @@ void TableManager::printTable(const std::string& tableName) {
     std::cout << printer(table) << std::endl;
 }
 
-std::vector<string> TableManager::unpack_record(const Record& rec, const TableSchema& schema) {
-    DEBUG_TABLE_MANAGER << "unpack_record called for table: " << schema.table_name << std::endl;
-    string record_str = string(rec.data.begin(), rec.data.end());
-    DEBUG_TABLE_MANAGER << "Raw record string: " << record_str << std::endl;
+void TableManager::rebuild_indexes() {
+    for (const string& table_name : catalog.list_tables()) {
+        TableSchema schema = catalog.get_schema(table_name);
+        vector<string> columns = index_mgr.indexed_columns(table_name);
+        if (schema.primary_key_idx >= 0 &&
+            find(columns.begin(), columns.end(), schema.columns[schema.primary_key_idx]) == columns.end()) {
+            columns.push_back(schema.columns[schema.primary_key_idx]);
+        }
+
+        for (const string& column : columns) {
+            index_mgr.drop_index(table_name, column);
+        }
+        vector<string> created;
+        for (const string& column : columns) {
+            auto it = find(schema.columns.begin(), schema.columns.end(), column);
+            if (it == schema.columns.end()) continue; // index of a column that no longer exists
+            index_mgr.create_index(table_name, column, schema.column_types[it - schema.columns.begin()]);
+            created.push_back(column);
+        }
 
-    stringstream ss(record_str);
-    string token;
+        int rows = index_rows(table_name, schema, created);
+        DEBUG_TABLE_MANAGER << "Rebuilt " << created.size() << " index(es) on " << table_name
+                            << " from " << rows << " rows" << std::endl;
+    }
+}
 
-    // Skip table name
-    getline(ss, token, '|');
+int TableManager::index_rows(const string& table_name, const TableSchema& schema, const vector<string>& columns) {
+    vector<int> positions;
+    for (const string& column : columns) {
+        positions.push_back(find(schema.columns.begin(), schema.columns.end(), column) - schema.columns.begin());
+    }
 
-    vector<string> fields;
-    while (getline(ss, token, '|')) {
-        fields.push_back(token);
+    // Every version, whoever sees it: a dead one's entries go when it is
+    // collected.
+    RowFormat format(schema.column_types);
+    RecordIterator iterator(*catalog.get_heap(table_name));
+    int rows = 0;
+    while (iterator.has_next()) {
+        auto [rec, page_id, slot_id] = iterator.next_with_location();
+        if (rec.data.size() < VERSION_HEADER_SIZE) continue;
+        vector<char> row = version_row(rec);
+        if (!format.is_valid(row)) continue;
+
+        int record_id = RecordID(page_id, slot_id).encode();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            index_mgr.insert_entry(table_name, columns[i], format.index_key(row, positions[i]), record_id);
+        }
+        rows++;
     }
+    return rows;
+}
+
+void TableManager::remove_version(const string& table_name, const TableSchema& schema, RecordManager& heap, int record_id, const vector<char>& row) {
+    // Entries first: once the slot is free, an insert can reuse it
+    RowFormat format(schema.column_types);
+    if (format.is_valid(row)) {
+        for (int i : indexed_positions(table_name, schema)) {
+            index_mgr.delete_entry(table_name, schema.columns[i], format.index_key(row, i), record_id);
+        }
+    }
+    heap.delete_record(record_id);
+}
+
+void TableManager::collect_garbage(const vector<DeadVersion>& versions) {
+    // Keeps the tables from being dropped meanwhile; each table's write
+    // latch keeps its writers out while its versions go
+    shared_lock<shared_mutex> reading(catalog.table_latch());
+    unique_lock<mutex> writing;
+    string locked_table;
+    size_t removed = 0;
+    for (const DeadVersion& version : versions) {
+        const TableSchema* schema = catalog.find_schema(version.table_name);
+        RecordManager* heap = catalog.get_heap(version.table_name);
+        if (!schema || !heap) continue; // dropped since
+        if (version.table_name != locked_table || !writing.owns_lock()) {
+            if (writing.owns_lock()) writing.unlock();
+            writing = unique_lock<mutex>(*catalog.get_write_latch(version.table_name));
+            locked_table = version.table_name;
+        }
 
-    if (fields.size() != schema.columns.size()) {
-        DEBUG_TABLE_MANAGER << "[WARN] unpacked field count mismatch: expected "
-                            << schema.columns.size() << ", got " << fields.size() << std::endl;
-    } else {
-        DEBUG_TABLE_MANAGER << "Unpacked fields: ";
-        for (const auto& f : fields) {
-            std::cout << "[" << f << "] ";
+        Record record(vector<char>{});
+        try {
+            record = heap->get_record(version.record_id);
+        } catch (const std::runtime_error&) {
+            continue;
         }
-        std::cout << std::endl;
+        // A version is only ended once, so its end tells it from whatever
+        // took its slot after a drop and create of the table
+        if (record.data.size() < VERSION_HEADER_SIZE || read_version_header(record.data.data()).end != version.end_ts) continue;
+        remove_version(version.table_name, *schema, *heap, version.record_id, version_row(record));
+        removed++;
     }
+    DEBUG_TABLE_MANAGER << "Collected " << removed << " dead version(s)" << std::endl;
+}
+
+void TableManager::rollback(Transaction& transaction) {
+    shared_lock<shared_mutex> reading(catalog.table_latch());
+    undo(transaction, Savepoint{}, false);
+}
+
+void TableManager::rollback_statement(Transaction& transaction, const Savepoint& savepoint) {
+    undo(transaction, savepoint, true);
+}
+
+void TableManager::undo(Transaction& transaction, const Savepoint& savepoint, bool latched) {
+    unique_lock<mutex> writing;
+    string locked_table;
+    size_t removed = 0, reopened = 0;
+    // Versions the transaction wrote before the savepoint. One of them
+    // written again after it was created there and ended here.
+    set<pair<RecordManager*, int>> earlier;
+    for (size_t i = 0; i < savepoint.writes; ++i) {
+        earlier.insert({transaction.writes[i].heap, transaction.writes[i].record_id});
+    }
+    // A version updated twice is listed twice: as the first update's new
+    // version and the second one's old
+    set<pair<RecordManager*, int>> undone;
+    for (size_t i = transaction.writes.size(); i-- > savepoint.writes;) {
+        const VersionWrite& write = transaction.writes[i];
+        const TableSchema* schema = catalog.find_schema(write.table_name);
+        if (!schema || !undone.insert({write.heap, write.record_id}).second) continue;
+        if (!latched && (write.table_name != locked_table || !writing.owns_lock())) {
+            if (writing.owns_lock()) writing.unlock();
+            writing = unique_lock<mutex>(*catalog.get_write_latch(write.table_name));
+            locked_table = write.table_name;
+        }
+
+        Record record = write.heap->get_record(write.record_id);
+        if (record.data.size() < VERSION_HEADER_SIZE) continue;
+        VersionHeader version = read_version_header(record.data.data());
+        bool created_here = version.begin == transaction.id() && !earlier.count({write.heap, write.record_id});
+        if (created_here) {
+            remove_version(write.table_name, *schema, *write.heap, write.record_id, version_row(record));
+            removed++;
+        } else if (version.end == transaction.id()) {
+            write.heap->reopen_version(write.record_id);
+            reopened++;
+        }
+    }
+    transaction.writes.resize(savepoint.writes);
+    transaction.ended.resize(savepoint.ended);
+    DEBUG_TABLE_MANAGER << "Rolled back: removed " << removed << " version(s), reopened " << reopened << std::endl;
+}
 
+void TableManager::recover_versions(TransactionManager& transactions) {
+    for (const string& table_name : catalog.list_tables()) {
+        const TableSchema& schema = *catalog.find_schema(table_name);
+        RecordManager& heap = *catalog.get_heap(table_name);
+
+        // Found first, changed after: the iterator keeps its page pinned
+        vector<pair<int, Record>> removals;
+        vector<int> reopened;
+        RecordIterator iterator(heap);
+        while (iterator.has_next()) {
+            auto [rec, page_id, slot_id] = iterator.next_with_location();
+            if (rec.data.size() < VERSION_HEADER_SIZE) continue;
+            VersionHeader version = read_version_header(rec.data.data());
+            int record_id = RecordID(page_id, slot_id).encode();
+            if (is_txn_id(version.begin)) transactions.skip_txn_id(version.begin);
+            if (is_txn_id(version.end)) transactions.skip_txn_id(version.end);
+            bool created = !is_txn_id(version.begin) && transactions.is_committed(version.begin);
+            bool ended = !is_txn_id(version.end) && version.end != TS_INFINITY && transactions.is_committed(version.end);
+            if (!created || ended) {
+                // No snapshot from before the crash is left to see a dead version
+                removals.emplace_back(record_id, std::move(rec));
+            } else if (version.end != TS_INFINITY) {
+                reopened.push_back(record_id);
+            }
+        }
+
+        for (auto& [record_id, rec] : removals) {
+            remove_version(table_name, schema, heap, record_id, version_row(rec));
+        }
+        for (int record_id : reopened) {
+            heap.reopen_version(record_id);
+        }
+        DEBUG_TABLE_MANAGER << "Recovered " << table_name << ": removed " << removals.size()
+                            << " version(s), reopened " << reopened.size() << std::endl;
+    }
+}
+
+bool TableManager::create_index(const string& table_name, const string& column_name) {
+    TableSchema schema = catalog.get_schema(table_name);
+    auto it = find(schema.columns.begin(), schema.columns.end(), column_name);
+    if (it == schema.columns.end() || !catalog.get_heap(table_name)) {
+        return false;
+    }
+
+    if (!index_mgr.create_index(table_name, column_name, schema.column_types[it - schema.columns.begin()])) {
+        return false;
+    }
+    int rows = index_rows(table_name, schema, {column_name});
+    DEBUG_TABLE_MANAGER << "Indexed " << rows << " existing rows of " << table_name << "." << column_name << std::endl;
+    return true;
+}
+
+std::vector<string> TableManager::unpack_record(const Record& rec, const TableSchema& schema) {
+    DEBUG_TABLE_MANAGER << "unpack_record called for table: " << schema.table_name << std::endl;
+    RowFormat format(schema.column_types);
+    if (!format.is_valid(rec.data)) {
+        DEBUG_TABLE_MANAGER << "[WARN] record is not a row of " << schema.table_name << std::endl;
+        return {};
+    }
+
+    vector<string> fields = format.decode(rec.data);
+    DEBUG_TABLE_MANAGER << "Unpacked fields: ";
+    for (const auto& f : fields) {
+        std::cout << "[" << f << "] ";
+    }
+    std::cout << std::endl;
     return fields;
 }
 
@@ -290,7 +486,7 @@ bool TableManager::create_table(const string& table_name, const vector<string>&
     }
 
     const string& pk_column = columns[primary_key_idx];
-    index_mgr.create_index(table_name, pk_column);
+    index_mgr.create_index(table_name, pk_column, types[primary_key_idx]);
 
     return true;
 }
\ No newline at end of file
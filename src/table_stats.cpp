@@ -0,0 +1,138 @@
+#include "../include/table_stats.h"
+#include "../include/index_key.h"
+#include "../include/record_iterator.h"
+#include "../include/row_format.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+namespace {
+    const uint32_t STATS_MAGIC = 0x5354424c; // "LBTS"
+
+    template <typename T>
+    void write_value(ofstream& out, T value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool read_value(ifstream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+    // Distinct values of the whole column from a sample of it (Haas and
+    // Stokes' Duj1): values seen once in the sample hint at many unseen ones.
+    int64_t estimate_distinct(const vector<string>& sorted_keys, int64_t column_values) {
+        size_t n = sorted_keys.size();
+        if (n == 0) return 0;
+        double d = 0, seen_once = 0;
+        for (size_t i = 0; i < n;) {
+            size_t j = i + 1;
+            while (j < n && sorted_keys[j] == sorted_keys[i]) j++;
+            d++;
+            if (j - i == 1) seen_once++;
+            i = j;
+        }
+        if (static_cast<int64_t>(n) >= column_values) return static_cast<int64_t>(d);
+        double estimate = n * d / (n - seen_once + seen_once * n / static_cast<double>(column_values));
+        return static_cast<int64_t>(min(max(estimate, d), static_cast<double>(column_values)));
+    }
+}
+
+TableStats TableStats::collect(RecordManager& heap, const vector<DataType>& column_types, const Snapshot& snapshot) {
+    TableStats stats;
+    RowFormat format(column_types);
+    size_t column_count = column_types.size();
+    stats.columns.resize(column_count);
+    stats.page_count = heap.get_buffer_pool().get_num_pages(heap.get_file_id());
+
+    // Reservoir sample of the rows' index keys, with a fixed seed so the
+    // same table always gets the same stats
+    vector<vector<string>> sample;
+    mt19937_64 random(42);
+    RecordIterator iterator(heap, snapshot);
+    vector<Record> records;
+    while (iterator.next_batch(records, 2048) > 0) {
+        for (const Record& record : records) {
+            if (!format.is_valid(record.data)) continue;
+            stats.row_count++;
+            size_t slot = sample.size();
+            if (slot >= SAMPLE_ROWS) {
+                slot = uniform_int_distribution<uint64_t>(0, stats.row_count - 1)(random);
+                if (slot >= SAMPLE_ROWS) continue;
+            } else {
+                sample.emplace_back();
+            }
+            vector<string>& keys = sample[slot];
+            keys.resize(column_count);
+            for (size_t c = 0; c < column_count; ++c) {
+                keys[c] = format.index_key(record.data, static_cast<int>(c));
+            }
+        }
+        records.clear();
+    }
+
+    const string null_key = index_key_null();
+    for (size_t c = 0; c < column_count; ++c) {
+        vector<string> keys;
+        int64_t sample_nulls = 0;
+        for (const vector<string>& row : sample) {
+            if (row[c] == null_key) sample_nulls++;
+            else keys.push_back(row[c]);
+        }
+        sort(keys.begin(), keys.end());
+
+        ColumnStats& column = stats.columns[c];
+        double scale = sample.empty() ? 0 : static_cast<double>(stats.row_count) / sample.size();
+        column.null_count = static_cast<int64_t>(sample_nulls * scale + 0.5);
+        column.distinct = estimate_distinct(keys, stats.row_count - column.null_count);
+        size_t buckets = min(HISTOGRAM_BUCKETS, keys.size());
+        for (size_t b = 1; b <= buckets; ++b) {
+            column.bounds.push_back(keys[b * keys.size() / buckets - 1]);
+        }
+    }
+    return stats;
+}
+
+bool TableStats::save(const string& path) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    write_value(out, STATS_MAGIC);
+    write_value(out, row_count);
+    write_value(out, page_count);
+    write_value(out, static_cast<uint32_t>(columns.size()));
+    for (const ColumnStats& column : columns) {
+        write_value(out, column.null_count);
+        write_value(out, column.distinct);
+        write_value(out, static_cast<uint32_t>(column.bounds.size()));
+        for (const string& bound : column.bounds) {
+            write_value(out, static_cast<uint32_t>(bound.size()));
+            out.write(bound.data(), bound.size());
+        }
+    }
+    out.close();
+    return static_cast<bool>(out);
+}
+
+bool TableStats::load(const string& path, size_t column_count, TableStats& stats) {
+    ifstream in(path, ios::binary);
+    uint32_t magic, columns;
+    if (!read_value(in, magic) || magic != STATS_MAGIC || !read_value(in, stats.row_count) ||
+        !read_value(in, stats.page_count) || !read_value(in, columns) || columns != column_count) {
+        return false;
+    }
+    stats.columns.assign(columns, ColumnStats());
+    for (ColumnStats& column : stats.columns) {
+        uint32_t bounds;
+        if (!read_value(in, column.null_count) || !read_value(in, column.distinct) || !read_value(in, bounds)) return false;
+        column.bounds.resize(bounds);
+        for (string& bound : column.bounds) {
+            uint32_t size;
+            if (!read_value(in, size)) return false;
+            bound.resize(size);
+            if (!in.read(bound.data(), size)) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,135 @@
+#include "../include/transaction_manager.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#define TXN_DEBUG_PREFIX "[DEBUG][TRANSACTION_MANAGER] "
+
+Transaction::~Transaction() {
+    if (open && manager) manager->finish(*this);
+}
+
+TransactionManager::TransactionManager(LogManager& lm)
+    : log_manager(lm), last_commit(lm.current_lsn() - 1), log_start(lm.current_lsn() - lm.size()) {
+    // Every commit of an earlier run logged its stamps, so its timestamp is
+    // below the log's current LSN.
+    if (log_manager.needs_recovery()) {
+        log_manager.replay([this](const LogRecord& record) {
+            if (record.type == LogRecordType::COMMIT && record.after.size() == sizeof(timestamp_t)) {
+                timestamp_t commit_ts;
+                memcpy(&commit_ts, record.after.data(), sizeof(commit_ts));
+                logged_commits.insert(commit_ts);
+            }
+        });
+    }
+    std::cout << TXN_DEBUG_PREFIX << "Snapshots start at timestamp " << last_commit << "." << std::endl;
+}
+
+TransactionManager::~TransactionManager() {
+    {
+        lock_guard<mutex> lock(latch);
+        stop = true;
+    }
+    collector_cv.notify_one();
+    if (collector.joinable()) collector.join();
+}
+
+unique_ptr<Transaction> TransactionManager::begin() {
+    auto transaction = make_unique<Transaction>(this);
+    lock_guard<mutex> lock(latch);
+    transaction->snapshot.read_ts = last_commit;
+    transaction->snapshot.txn_id = TXN_ID_FLAG | next_txn++;
+    active.insert(last_commit);
+    return transaction;
+}
+
+void TransactionManager::commit(Transaction& transaction) {
+    if (!transaction.open) return;
+    if (!transaction.writes.empty()) {
+        lock_guard<mutex> committing(commit_latch);
+        // Each commit logs at least one stamp, so the next one starts at a
+        // higher LSN.
+        timestamp_t commit_ts = max<timestamp_t>(log_manager.current_lsn(), last_commit + 1);
+
+        unordered_map<RecordManager*, vector<int>> by_heap;
+        for (const VersionWrite& write : transaction.writes) {
+            by_heap[write.heap].push_back(write.record_id);
+        }
+        for (auto& [heap, record_ids] : by_heap) {
+            heap->stamp_versions(std::move(record_ids), transaction.id(), commit_ts);
+        }
+        LogRecord record;
+        record.type = LogRecordType::COMMIT;
+        record.after.resize(sizeof(commit_ts));
+        memcpy(record.after.data(), &commit_ts, sizeof(commit_ts));
+        log_manager.append(record);
+
+        lock_guard<mutex> lock(latch);
+        last_commit = commit_ts;
+        for (DeadVersion& version : transaction.ended) {
+            version.end_ts = commit_ts;
+            garbage.push_back(std::move(version));
+        }
+    }
+    transaction.writes.clear();
+    transaction.ended.clear();
+    finish(transaction);
+}
+
+void TransactionManager::finish(Transaction& transaction) {
+    lock_guard<mutex> lock(latch);
+    if (!transaction.open) return;
+    active.erase(active.find(transaction.snapshot.read_ts));
+    transaction.open = false;
+}
+
+size_t TransactionManager::open_transactions() {
+    lock_guard<mutex> lock(latch);
+    return active.size();
+}
+
+bool TransactionManager::is_committed(timestamp_t ts) const {
+    return ts < log_start || logged_commits.count(ts) > 0;
+}
+
+void TransactionManager::skip_txn_id(timestamp_t txn_id) {
+    lock_guard<mutex> lock(latch);
+    next_txn = max<uint64_t>(next_txn, (txn_id & ~TXN_ID_FLAG) + 1);
+}
+
+vector<DeadVersion> TransactionManager::take_garbage() {
+    lock_guard<mutex> lock(latch);
+    timestamp_t horizon = active.empty() ? last_commit : *active.begin();
+    vector<DeadVersion> dead;
+    while (!garbage.empty() && garbage.front().end_ts <= horizon) {
+        dead.push_back(std::move(garbage.front()));
+        garbage.pop_front();
+    }
+    return dead;
+}
+
+void TransactionManager::start_collector(function<void(vector<DeadVersion>&)> collect, unsigned interval_ms) {
+    if (interval_ms == 0 || collector.joinable()) return;
+    this->collect = std::move(collect);
+    collect_interval = chrono::milliseconds(interval_ms);
+    collector = thread(&TransactionManager::collector_loop, this);
+}
+
+void TransactionManager::collector_loop() {
+    unique_lock<mutex> lock(latch);
+    while (true) {
+        collector_cv.wait_for(lock, collect_interval, [&] { return stop; });
+        bool stopping = stop;
+        lock.unlock();
+
+        vector<DeadVersion> dead = take_garbage();
+        if (!dead.empty()) {
+            std::cout << TXN_DEBUG_PREFIX << "Collecting " << dead.size() << " dead version(s)." << std::endl;
+            collect(dead);
+        }
+
+        lock.lock();
+        if (stopping) break;
+    }
+}
@@ -0,0 +1,91 @@
+// ANALYZE saves a table's statistics next to its heap (table_<id>.stats),
+// where the database finds them when it opens again, and the planner
+// weighs its access paths with them. Without statistics, or with a
+// .stats file it cannot read, every usable index is taken.
+#include "sql_session.h"
+#include <fstream>
+
+namespace {
+    const int ROWS = 5000;
+
+    // t(id, k, u): k (0 or 1) and u (unique) are indexed
+    void create_table(SqlSession& session) {
+        CHECK(session.run("CREATE TABLE t (id INT, k INT, u INT, PRIMARY KEY(id));"));
+        CHECK(session.run("CREATE INDEX ON t(k);"));
+        CHECK(session.run("CREATE INDEX ON t(u);"));
+        for (int first = 0; first < ROWS; first += 1000) {
+            string insert = "INSERT INTO t VALUES ";
+            for (int id = first; id < first + 1000; ++id) {
+                if (id > first) insert += ", ";
+                insert += "(" + to_string(id) + ", " + to_string(id % 2) + ", " + to_string(ROWS - id) + ")";
+            }
+            CHECK(session.run(insert + ";"));
+        }
+    }
+
+    vector<fs::path> stats_files(const string& name) {
+        vector<fs::path> files;
+        for (const auto& entry : fs::directory_iterator(Database::path(name))) {
+            if (entry.path().extension() == ".stats") files.push_back(entry.path());
+        }
+        return files;
+    }
+
+    // Runs a query that should count rows and returns what the planner
+    // printed for it
+    string plan_of(SqlSession& session, const string& sql, const string& rows) {
+        CapturedOutput output;
+        CHECK_EQ(session.value(sql), rows);
+        if (output.contains("using seq scan")) return "seq scan";
+        if (output.contains("using index scan")) return "index scan";
+        return "no statistics";
+    }
+
+    void statistics_survive_a_restart() {
+        ScratchDirectory scratch("analyze");
+        QuietOutput quiet;
+        DBConfig config;
+        config.log_plans = true;
+        Database::create("db");
+        {
+            Database database("db", config);
+            SqlSession session(database);
+            create_table(session);
+            CHECK_EQ(plan_of(session, "SELECT COUNT(*) FROM t WHERE k = 0;", "2500"), "no statistics");
+            CHECK(stats_files("db").empty());
+
+            CHECK(session.run("ANALYZE t;"));
+            CHECK_EQ(stats_files("db").size(), 1u);
+            CHECK_EQ(plan_of(session, "SELECT COUNT(*) FROM t WHERE k = 0;", "2500"), "seq scan");
+            CHECK_EQ(plan_of(session, "SELECT COUNT(*) FROM t WHERE u = 1230;", "1"), "index scan");
+        }
+        {
+            Database database("db", config);
+            SqlSession session(database);
+            CHECK_EQ(plan_of(session, "SELECT COUNT(*) FROM t WHERE k = 0;", "2500"), "seq scan");
+            CHECK_EQ(plan_of(session, "SELECT COUNT(*) FROM t WHERE u = 1230;", "1"), "index scan");
+            CHECK(!session.run("ANALYZE missing;"));
+        }
+
+        // A .stats file that cannot be read is as good as none
+        ofstream(stats_files("db")[0], ios::binary | ios::trunc) << "junk";
+        {
+            Database database("db", config);
+            SqlSession session(database);
+            CHECK_EQ(plan_of(session, "SELECT COUNT(*) FROM t WHERE k = 0;", "2500"), "no statistics");
+            CHECK(session.run("ANALYZE;"));
+            CHECK_EQ(plan_of(session, "SELECT COUNT(*) FROM t WHERE k = 0;", "2500"), "seq scan");
+
+            // Dropping the table drops its statistics with it
+            CHECK(session.run("DROP TABLE t;"));
+            CHECK(stats_files("db").empty());
+            create_table(session);
+            CHECK_EQ(plan_of(session, "SELECT COUNT(*) FROM t WHERE k = 0;", "2500"), "no statistics");
+        }
+    }
+}
+
+int main() {
+    statistics_survive_a_restart();
+    return test_result();
+}
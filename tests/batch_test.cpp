@@ -0,0 +1,157 @@
+// Scans, filters and aggregates work on a batch of rows at a time. Over a
+// table of several batches, with deleted rows and NULLs among the live
+// ones, they must give what row at a time evaluation gives.
+#include "sql_session.h"
+#include <cmath>
+#include <optional>
+#include <set>
+
+namespace {
+    const int ROWS = 7000; // over three batches
+
+    struct Row {
+        int id;
+        optional<int> v;
+        optional<double> f;
+        optional<string> s;
+    };
+
+    vector<Row> make_rows() {
+        const char* names[] = {"a", "ab", "b", "zz"};
+        vector<Row> rows;
+        for (int id = 0; id < ROWS; ++id) {
+            Row row{id, {}, {}, {}};
+            if (id % 13 != 0) row.v = (id * 37) % 1001 - 500;
+            if (id % 17 != 0) row.f = ((id * 53) % 800 - 400) / 4.0;
+            if (id % 11 != 0) row.s = names[id % 4];
+            rows.push_back(row);
+        }
+        return rows;
+    }
+
+    template <typename T>
+    string sql_value(const optional<T>& value) {
+        if (!value) return "NULL";
+        if constexpr (is_same_v<T, string>) return "'" + *value + "'";
+        else return to_string(*value);
+    }
+
+    struct Expected {
+        size_t count = 0, v_count = 0, f_count = 0;
+        long long v_sum = 0;
+        double f_sum = 0;
+        int v_min = 0, v_max = 0;
+    };
+
+    template <typename Where>
+    Expected expected(const vector<Row>& rows, Where where) {
+        Expected e;
+        for (const Row& row : rows) {
+            if (!where(row)) continue;
+            e.count++;
+            if (row.v) {
+                if (e.v_count == 0 || *row.v < e.v_min) e.v_min = *row.v;
+                if (e.v_count == 0 || *row.v > e.v_max) e.v_max = *row.v;
+                e.v_sum += *row.v;
+                e.v_count++;
+            }
+            if (row.f) {
+                e.f_sum += *row.f;
+                e.f_count++;
+            }
+        }
+        return e;
+    }
+
+    void check_aggregates(SqlSession& session, const string& where, const Expected& e) {
+        ResultSet result;
+        CHECK(session.run("SELECT COUNT(*), COUNT(v), SUM(v), MIN(v), MAX(v), AVG(f) FROM m WHERE " + where + ";",
+                          &result));
+        CHECK_EQ(result.rows.size(), 1u);
+        if (result.rows.size() != 1) return;
+        const vector<string>& row = result.rows[0];
+        CHECK_EQ(row[0], to_string(e.count));
+        CHECK_EQ(row[1], to_string(e.v_count));
+        CHECK_EQ(row[2], to_string(e.v_sum));
+        CHECK_EQ(row[3], to_string(e.v_min));
+        CHECK_EQ(row[4], to_string(e.v_max));
+        CHECK(e.f_count > 0 && fabs(stod(row[5]) - e.f_sum / e.f_count) < 1e-3);
+    }
+
+    void batches_match_row_at_a_time() {
+        ScratchDirectory scratch("batches");
+        QuietOutput quiet;
+        Database::create("db");
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        CHECK(session.run("CREATE TABLE m (id INT, v INT, f FLOAT, s VARCHAR, PRIMARY KEY(id));"));
+        vector<Row> rows = make_rows();
+        for (int first = 0; first < ROWS; first += 500) {
+            string insert = "INSERT INTO m VALUES ";
+            for (int id = first; id < first + 500; ++id) {
+                const Row& row = rows[id];
+                if (id > first) insert += ", ";
+                insert += "(" + to_string(id) + ", " + sql_value(row.v) + ", " + sql_value(row.f) + ", " +
+                          sql_value(row.s) + ")";
+            }
+            CHECK(session.run(insert + ";"));
+        }
+
+        // Leaves gaps of deleted rows in every batch
+        CHECK(session.run("DELETE FROM m WHERE v < -400 AND s = 'b';"));
+        vector<Row> live;
+        for (const Row& row : rows) {
+            if (!(row.v && *row.v < -400 && row.s && *row.s == "b")) live.push_back(row);
+        }
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM m;"), to_string(live.size()));
+
+        // = and != take NULL as a value, the ordering comparisons never match it
+        check_aggregates(session, "v > 100 AND f < 0",
+                         expected(live, [](const Row& r) { return r.v && *r.v > 100 && r.f && *r.f < 0; }));
+        check_aggregates(session, "v != 3 OR s = 'zz'",
+                         expected(live, [](const Row& r) { return !r.v || *r.v != 3 || (r.s && *r.s == "zz"); }));
+        check_aggregates(session, "s = 'ab' AND v > 0 OR f >= 90",
+                         expected(live, [](const Row& r) {
+                             return (r.s && *r.s == "ab" && r.v && *r.v > 0) || (r.f && *r.f >= 90);
+                         }));
+        check_aggregates(session, "s >= 'b' AND id > 3000",
+                         expected(live, [](const Row& r) { return r.s && *r.s >= "b" && r.id > 3000; }));
+        size_t null_names = 0;
+        for (const Row& row : live) null_names += !row.s;
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM m WHERE s = NULL;"), to_string(null_names));
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM m WHERE s != NULL;"), to_string(live.size() - null_names));
+
+        // Every row comes out once, whichever batch it is in
+        ResultSet result;
+        CHECK(session.run("SELECT id FROM m WHERE id >= 2000 AND id < 4200;", &result));
+        size_t wanted = 0;
+        for (const Row& row : live) wanted += row.id >= 2000 && row.id < 4200;
+        CHECK_EQ(result.rows.size(), wanted);
+        set<string> ids;
+        for (const vector<string>& row : result.rows) ids.insert(row[0]);
+        CHECK_EQ(ids.size(), wanted);
+    }
+
+    // All rows of a batch filtered out, or none there to aggregate
+    void empty_batches() {
+        ScratchDirectory scratch("batches_empty");
+        QuietOutput quiet;
+        Database::create("db");
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        CHECK(session.run("CREATE TABLE m (id INT, v INT, PRIMARY KEY(id));"));
+        ResultSet result;
+        CHECK(session.run("SELECT COUNT(*), SUM(v), MIN(v) FROM m;", &result));
+        CHECK_EQ(result.rows.size(), 1u);
+        if (result.rows.size() == 1) CHECK_EQ(result.rows[0][0], "0");
+        CHECK(session.run("INSERT INTO m VALUES (1, NULL), (2, NULL);"));
+        CHECK_EQ(session.value("SELECT COUNT(v) FROM m;"), "0");
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM m WHERE id > 5;"), "0");
+    }
+}
+
+int main() {
+    batches_match_row_at_a_time();
+    empty_batches();
+    return test_result();
+}
@@ -0,0 +1,87 @@
+// Sessions on several threads sharing a buffer pool much smaller than the
+// table, so pages are evicted and read back while other threads use
+// theirs. Every statement sees whole statements of the others and its own
+// writes, and everything is there after a restart.
+#include "sql_session.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+    const int WRITERS = 4;
+    const int ROWS_PER_WRITER = 1500;
+    const int ROWS_PER_INSERT = 100;
+
+    DBConfig small_pool() {
+        DBConfig config;
+        config.buffer_pool_bytes = 64 * 1024;
+        return config;
+    }
+
+    // Inserts its rows a statement at a time, checking after each that it
+    // sees all of them, then updates them all. Checks are only counted
+    // here: the CHECK macros are not for other threads.
+    void write_rows(Database& database, int owner, atomic<int>& failures) {
+        SqlSession session(database);
+        string pad(120, 'a' + owner);
+        string where = " WHERE owner = " + to_string(owner) + ";";
+        for (int first = 0; first < ROWS_PER_WRITER; first += ROWS_PER_INSERT) {
+            string insert = "INSERT INTO t VALUES ";
+            for (int i = first; i < first + ROWS_PER_INSERT; ++i) {
+                if (i > first) insert += ", ";
+                insert += "(" + to_string(owner * 100000 + i) + ", " + to_string(owner) + ", " + to_string(i) + ", '" + pad + "')";
+            }
+            if (!session.run(insert + ";")) failures++;
+            if (session.value("SELECT COUNT(*) FROM t" + where) != to_string(first + ROWS_PER_INSERT)) failures++;
+        }
+        if (!session.run("UPDATE t SET v = 2 WHERE owner = " + to_string(owner) + ";")) failures++;
+        if (session.value("SELECT SUM(v) FROM t" + where) != to_string(2 * ROWS_PER_WRITER)) failures++;
+    }
+
+    // Whole-table scans while the writers run: each sees a number of whole
+    // INSERT statements, never fewer rows than the scan before.
+    void scan_rows(Database& database, const atomic<bool>& writing, atomic<int>& failures) {
+        SqlSession session(database);
+        long previous = 0;
+        while (writing) {
+            string count = session.value("SELECT COUNT(*) FROM t WHERE v >= 0;");
+            long rows = count[0] == '<' ? -1 : stol(count);
+            if (rows < previous || rows % ROWS_PER_INSERT != 0) failures++;
+            previous = rows;
+        }
+    }
+
+    void sessions_share_a_small_pool() {
+        ScratchDirectory scratch("concurrent_sessions");
+        QuietOutput quiet;
+        Database::create("db");
+        {
+            Database database("db", small_pool());
+            SqlSession session(database);
+            CHECK(session.run("CREATE TABLE t (id INT, owner INT, v INT, pad VARCHAR, PRIMARY KEY(id));"));
+
+            atomic<int> failures{0};
+            atomic<bool> writing{true};
+            thread scanner(scan_rows, ref(database), cref(writing), ref(failures));
+            vector<thread> writers;
+            for (int owner = 0; owner < WRITERS; ++owner) {
+                writers.emplace_back(write_rows, ref(database), owner, ref(failures));
+            }
+            for (thread& writer : writers) writer.join();
+            writing = false;
+            scanner.join();
+            CHECK_EQ(failures.load(), 0);
+            CHECK_EQ(session.value("SELECT COUNT(*) FROM t;"), to_string(WRITERS * ROWS_PER_WRITER));
+        }
+
+        Database database("db", small_pool());
+        SqlSession session(database);
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM t;"), to_string(WRITERS * ROWS_PER_WRITER));
+        CHECK_EQ(session.value("SELECT SUM(v) FROM t;"), to_string(2 * WRITERS * ROWS_PER_WRITER));
+        CHECK_EQ(session.value("SELECT id FROM t WHERE id = 301234;"), "301234");
+    }
+}
+
+int main() {
+    sessions_share_a_small_pool();
+    return test_result();
+}
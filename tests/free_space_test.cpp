@@ -0,0 +1,96 @@
+// Space freed by deletes is found again through the free-space map, also
+// after the heap file has been closed and opened again, instead of the
+// file growing, and pages are offered by the space they have now.
+#include "../include/buffer_pool_manager.h"
+#include "../include/disk_manager.h"
+#include "../include/free_space_map.h"
+#include "../include/log_manager.h"
+#include "../include/record_manager.h"
+#include "test_util.h"
+#include <memory>
+#include <vector>
+
+namespace {
+    const int FILE_ID = 1;
+    const int ROWS = 400;
+
+    // A heap file with everything it needs, closed the way the shell
+    // closes it.
+    struct Heap {
+        DiskManager disk{"heap.db"};
+        LogManager log{"wal.log"};
+        BufferPoolManager buffer_pool{64, &log};
+        FreeSpaceMap free_space_map{"heap.fsm"};
+        unique_ptr<RecordManager> records;
+
+        Heap() {
+            buffer_pool.attach_file(FILE_ID, disk);
+            records = make_unique<RecordManager>(buffer_pool, FILE_ID, free_space_map, log);
+        }
+
+        int pages() { return buffer_pool.get_num_pages(FILE_ID); }
+    };
+
+    string row(int i) {
+        return "row " + to_string(i) + " " + string(200, 'x');
+    }
+
+    vector<int> insert_rows(Heap& heap, int count) {
+        vector<int> ids;
+        for (int i = 0; i < count; ++i) ids.push_back(heap.records->insert_record(Record(row(i))));
+        return ids;
+    }
+
+    void space_is_reused_after_reopen(bool lose_map) {
+        ScratchDirectory scratch(lose_map ? "free_space_lost" : "free_space");
+        QuietOutput quiet;
+        int pages;
+        {
+            Heap heap;
+            vector<int> ids = insert_rows(heap, ROWS);
+            pages = heap.pages();
+            CHECK(pages > 5);
+            for (int id : ids) heap.records->delete_record(id);
+        }
+        // Without the map, opening the heap has to work it out from the pages
+        if (lose_map) fs::remove("heap.fsm");
+        {
+            Heap heap;
+            vector<int> ids = insert_rows(heap, ROWS);
+            CHECK_EQ(heap.pages(), pages);
+            CHECK_EQ(heap.records->get_record(ids[0]).to_string(), row(0));
+            CHECK_EQ(heap.records->get_record(ids[ROWS - 1]).to_string(), row(ROWS - 1));
+
+            // Half the rows go; the other half still fits without new pages
+            for (int i = 0; i < ROWS; i += 2) heap.records->delete_record(ids[i]);
+        }
+        Heap heap;
+        insert_rows(heap, ROWS / 2);
+        CHECK_EQ(heap.pages(), pages);
+    }
+
+    // A page that fills up and empties again is only offered for the space
+    // it has now
+    void pages_are_found_by_their_current_space() {
+        ScratchDirectory scratch("free_space_moves");
+        QuietOutput quiet;
+        FreeSpaceMap map("heap.fsm");
+        for (int round = 0; round < 1000; ++round) {
+            for (int page = 0; page < 10; ++page) map.update(page, round % 2 == 0 ? 3000 : 100);
+        }
+        CHECK_EQ(map.find_page(1000), -1);
+        map.update(7, 2000);
+        CHECK_EQ(map.find_page(1000), 7);
+        map.update(7, 0);
+        CHECK_EQ(map.find_page(1000), -1);
+        int page = map.find_page(50);
+        CHECK(page >= 0 && page < 10 && page != 7);
+    }
+}
+
+int main() {
+    space_is_reused_after_reopen(false);
+    space_is_reused_after_reopen(true);
+    pages_are_found_by_their_current_space();
+    return test_result();
+}
@@ -0,0 +1,90 @@
+// GROUP BY through HashAggregate. With more groups than fit in
+// work_mem_bytes it keeps the groups it has and partitions the rows of the
+// others to the temp directory, partitioning again at the next depth where
+// a partition is still too big. The groups come out the same, NULL keys
+// forming a group of their own, and no partition is left behind.
+#include "sql_session.h"
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <tuple>
+
+namespace {
+    const int ROWS = 30000;
+    const int KEYS = 4000;
+
+    struct Group {
+        long long count = 0, v_count = 0, v_sum = 0;
+        int v_min = 0, max_id = 0;
+    };
+
+    // g(id, k, s, v): s is NULL for every 9th row, v for every 7th
+    void create_table(SqlSession& session, map<pair<int, string>, Group>& groups) {
+        const char* names[] = {"'x'", "'y'", "'z'"};
+        CHECK(session.run("CREATE TABLE g (id INT, k INT, s VARCHAR, v INT, PRIMARY KEY(id));"));
+        for (int first = 0; first < ROWS; first += 1000) {
+            string insert = "INSERT INTO g VALUES ";
+            for (int id = first; id < first + 1000; ++id) {
+                int k = id * 7919 % KEYS;
+                string s = id % 9 == 0 ? "NULL" : names[id % 3];
+                optional<int> v;
+                if (id % 7 != 0) v = id % 1000 - 500;
+                if (id > first) insert += ", ";
+                insert += "(" + to_string(id) + ", " + to_string(k) + ", " + s + ", " + (v ? to_string(*v) : "NULL") + ")";
+
+                Group& group = groups[{k, s}];
+                group.count++;
+                group.max_id = id;
+                if (v) {
+                    if (group.v_count == 0 || *v < group.v_min) group.v_min = *v;
+                    group.v_count++;
+                    group.v_sum += *v;
+                }
+            }
+            CHECK(session.run(insert + ";"));
+        }
+    }
+
+    void spilled_groups_are_all_there() {
+        ScratchDirectory scratch("hash_aggregate_spill");
+        QuietOutput quiet;
+        DBConfig config;
+        config.work_mem_bytes = 16 * 1024;
+        Database::create("db");
+        Database database("db", config);
+        SqlSession session(database);
+        map<pair<int, string>, Group> groups;
+        create_table(session, groups);
+
+        vector<vector<string>> expected;
+        for (const auto& [key, group] : groups) {
+            expected.push_back({to_string(key.first), key.second, to_string(group.count), to_string(group.v_count),
+                                group.v_count ? to_string(group.v_sum) : "NULL",
+                                group.v_count ? to_string(group.v_min) : "NULL", to_string(group.max_id)});
+        }
+        sort(expected.begin(), expected.end());
+
+        ResultSet result;
+        {
+            CapturedOutput output;
+            CHECK(session.run("SELECT k, s, COUNT(*), COUNT(v), SUM(v), MIN(v), MAX(id) FROM g GROUP BY k, s;", &result));
+            CHECK(output.contains("partitioning the rest at depth 1"));
+            CHECK(output.contains("partitioning the rest at depth 2"));
+        }
+        sort(result.rows.begin(), result.rows.end());
+        CHECK_EQ(result.rows.size(), expected.size());
+        CHECK(result.rows == expected);
+        CHECK_EQ(spill_files("db"), 0u);
+
+        // Groups of one column, counted in a query on top
+        CHECK_EQ(session.row_count("SELECT k FROM g GROUP BY k;"), size_t(KEYS));
+        CHECK_EQ(session.row_count("SELECT s, COUNT(*) FROM g GROUP BY s;"), 4u);
+        CHECK_EQ(session.row_count("SELECT k FROM g WHERE id < 100 GROUP BY k ORDER BY k LIMIT 5;"), 5u);
+        CHECK_EQ(spill_files("db"), 0u);
+    }
+}
+
+int main() {
+    spilled_groups_are_all_there();
+    return test_result();
+}
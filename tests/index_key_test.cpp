@@ -0,0 +1,112 @@
+// Index keys order like the values they encode (index_key.h), and a
+// DiskBPlusTree over them hands rows back in that order.
+#include "../include/buffer_pool_manager.h"
+#include "../include/disk_btree.h"
+#include "../include/index_key.h"
+#include "../include/log_manager.h"
+#include "../include/row_format.h"
+#include "test_util.h"
+#include <climits>
+#include <vector>
+
+namespace {
+    string literal_key(DataType type, const string& literal) {
+        string key;
+        CHECK(RowFormat::literal_index_key(type, literal, key));
+        return key;
+    }
+
+    void int_keys_order_numerically() {
+        CHECK(index_key_int(9) < index_key_int(10));
+        CHECK(index_key_int(-1) < index_key_int(0));
+        CHECK(index_key_int(INT64_MIN) < index_key_int(-1));
+        CHECK(index_key_int(99) < index_key_int(INT64_MAX));
+        CHECK(literal_key(DataType::INT, "9") < literal_key(DataType::INT, "10"));
+        CHECK(literal_key(DataType::INT, "-10") < literal_key(DataType::INT, "-9"));
+        CHECK_EQ(index_key_int(42).size(), 9u);
+    }
+
+    void float_keys_order_numerically() {
+        CHECK(index_key_float(9.5) < index_key_float(10.0));
+        CHECK(index_key_float(-2.5) < index_key_float(-1.5));
+        CHECK(index_key_float(-0.5) < index_key_float(0.25));
+        CHECK(index_key_float(-0.0) == index_key_float(0.0));
+        CHECK(literal_key(DataType::FLOAT, "-1.5") < literal_key(DataType::FLOAT, "2"));
+    }
+
+    void null_sorts_below_every_value() {
+        string null_key = literal_key(DataType::VARCHAR, "NULL");
+        CHECK(null_key == index_key_null());
+        CHECK(null_key < literal_key(DataType::VARCHAR, "''"));
+        CHECK(null_key < index_key_int(INT64_MIN));
+        CHECK(null_key < index_key_float(-1e300));
+        CHECK(null_key < index_key_min_value());
+
+        // Every value, the empty string included, lies in [min value, past values)
+        for (const string& key : {index_key_varchar(""), index_key_varchar("\xff\xff"), index_key_int(INT64_MIN), index_key_int(INT64_MAX)}) {
+            CHECK(index_key_min_value() <= key);
+            CHECK(key < index_key_past_values());
+        }
+        CHECK(index_key_varchar("") < index_key_varchar("a"));
+        CHECK(index_key_varchar("a") < index_key_successor(index_key_varchar("a")));
+        CHECK(index_key_successor(index_key_varchar("a")) < index_key_varchar("a\x01"));
+    }
+
+    void tree_returns_rows_in_value_order() {
+        ScratchDirectory scratch("index_key");
+        QuietOutput quiet;
+        LogManager log("wal.log");
+        BufferPoolManager buffer_pool(64, &log);
+        DiskBPlusTree tree("t.bpt", INDEX_FILE_ID_BASE, 1, buffer_pool, log);
+
+        // Record id = position in ascending value order, inserted scrambled
+        vector<int64_t> values = {-100, -1, 0, 9, 10, 11, 99, 100, 1000, 1 << 20};
+        for (size_t i = 0; i < values.size(); ++i) {
+            size_t at = (i * 7) % values.size();
+            CHECK(tree.insert(index_key_int(values[at]), static_cast<int>(at)));
+        }
+        CHECK(tree.insert(index_key_null(), 100));
+
+        IndexCursor cursor;
+        vector<int> ids;
+        tree.scan_ordered(cursor, false, 100, ids);
+        vector<int> expected = {100};
+        for (size_t i = 0; i < values.size(); ++i) expected.push_back(static_cast<int>(i));
+        CHECK(ids == expected);
+
+        // id > 9 as the planner asks for it: [successor of 9, past values)
+        vector<int> above_nine = tree.range_search(index_key_successor(index_key_int(9)), index_key_past_values(), false).to_vector();
+        CHECK((above_nine == vector<int>{4, 5, 6, 7, 8, 9}));
+        // Every non-NULL value, without the NULL entry
+        CHECK_EQ(tree.range_search(index_key_min_value(), index_key_past_values(), false).size(), values.size());
+        CHECK((tree.search(index_key_null()).to_vector() == vector<int>{100}));
+        tree.mark_dropped();
+    }
+
+    void varchar_null_boundary_in_tree() {
+        ScratchDirectory scratch("index_key_varchar");
+        QuietOutput quiet;
+        LogManager log("wal.log");
+        BufferPoolManager buffer_pool(64, &log);
+        DiskBPlusTree tree("t.bpt", INDEX_FILE_ID_BASE, 1, buffer_pool, log);
+
+        CHECK(tree.insert(index_key_null(), 1));
+        CHECK(tree.insert(index_key_varchar(""), 2));
+        CHECK(tree.insert(index_key_varchar(string(1, '\0')), 3));
+        CHECK(tree.insert(index_key_varchar("a"), 4));
+
+        CHECK((tree.search(index_key_varchar("")).to_vector() == vector<int>{2}));
+        CHECK((tree.search(index_key_null()).to_vector() == vector<int>{1}));
+        CHECK((tree.range_search(index_key_min_value(), index_key_past_values(), false).to_vector() == vector<int>{2, 3, 4}));
+        tree.mark_dropped();
+    }
+}
+
+int main() {
+    int_keys_order_numerically();
+    float_keys_order_numerically();
+    null_sorts_below_every_value();
+    tree_returns_rows_in_value_order();
+    varchar_null_boundary_in_tree();
+    return test_result();
+}
@@ -0,0 +1,108 @@
+// Equi-joins. Without an index on either join column HashJoin builds on
+// the right table, partitioning both sides to the temp directory when the
+// right rows do not fit in work_mem_bytes; with one, IndexNestedLoopJoin
+// looks the rows of the other table up in it. All give the same rows, and
+// NULL join keys join nothing.
+#include "sql_session.h"
+#include <algorithm>
+
+namespace {
+    const int USERS = 3000;
+    const int ORDERS = 20000;
+
+    // u(uk, id, grp): every id twice. o(oid, uid, amt): uids up to 2000, so
+    // some find no user, and every 50th one NULL.
+    void create_tables(SqlSession& session) {
+        CHECK(session.run("CREATE TABLE u (uk INT, id INT, grp INT, PRIMARY KEY(uk));"));
+        CHECK(session.run("CREATE TABLE o (oid INT, uid INT, amt INT, PRIMARY KEY(oid));"));
+        string insert = "INSERT INTO u VALUES ";
+        for (int uk = 0; uk < USERS; ++uk) {
+            if (uk > 0) insert += ", ";
+            insert += "(" + to_string(uk) + ", " + to_string(uk % 1500) + ", " + to_string(uk % 10) + ")";
+        }
+        CHECK(session.run(insert + ";"));
+        for (int first = 0; first < ORDERS; first += 1000) {
+            insert = "INSERT INTO o VALUES ";
+            for (int oid = first; oid < first + 1000; ++oid) {
+                if (oid > first) insert += ", ";
+                string uid = oid % 50 == 0 ? "NULL" : to_string(oid * 7919 % 2000);
+                insert += "(" + to_string(oid) + ", " + uid + ", " + to_string(oid % 100) + ")";
+            }
+            CHECK(session.run(insert + ";"));
+        }
+    }
+
+    // uk, oid of the joined rows with grp < max_grp and amt > min_amt
+    vector<vector<string>> expected(int max_grp, int min_amt) {
+        vector<vector<string>> rows;
+        for (int oid = 0; oid < ORDERS; ++oid) {
+            int uid = oid * 7919 % 2000;
+            if (oid % 50 == 0 || uid >= 1500 || oid % 100 <= min_amt) continue;
+            for (int uk : {uid, uid + 1500}) {
+                if (uk % 10 < max_grp) rows.push_back({to_string(uk), to_string(oid)});
+            }
+        }
+        sort(rows.begin(), rows.end());
+        return rows;
+    }
+
+    vector<vector<string>> sorted_rows(SqlSession& session, const string& sql) {
+        ResultSet result;
+        CHECK(session.run(sql, &result));
+        sort(result.rows.begin(), result.rows.end());
+        return result.rows;
+    }
+
+    void check_joins(SqlSession& session) {
+        vector<vector<string>> all = expected(10, -1);
+        vector<vector<string>> rows = sorted_rows(session, "SELECT u.uk, o.oid FROM u JOIN o ON u.id = o.uid;");
+        CHECK_EQ(rows.size(), all.size());
+        CHECK(rows == all);
+        CHECK(sorted_rows(session, "SELECT a.uk, b.oid FROM o b JOIN u a ON b.uid = a.id;") == all);
+        CHECK(sorted_rows(session, "SELECT u.uk, o.oid FROM u JOIN o ON u.id = o.uid WHERE u.grp < 3 AND o.amt > 50;") ==
+              expected(3, 50));
+        CHECK(sorted_rows(session, "SELECT u.uk, o.oid FROM u JOIN o ON u.id = o.uid WHERE o.amt > 97;") ==
+              expected(10, 97));
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM u JOIN o ON u.id = o.uid WHERE u.grp = 4;"),
+                 to_string(expected(5, -1).size() - expected(4, -1).size()));
+    }
+
+    void join_methods_agree() {
+        ScratchDirectory scratch("join");
+        QuietOutput quiet;
+        DBConfig config;
+        config.work_mem_bytes = 16 * 1024;
+        Database::create("db");
+        Database database("db", config);
+        SqlSession session(database);
+        create_tables(session);
+
+        {
+            CapturedOutput output;
+            check_joins(session);
+            CHECK(output.contains("partitioning both sides at depth 1"));
+        }
+        CHECK_EQ(spill_files("db"), 0u);
+
+        // An index on u.id: the rows of o look their users up in it
+        CHECK(session.run("CREATE INDEX ON u(id);"));
+        {
+            CapturedOutput output;
+            check_joins(session);
+            CHECK(!output.contains("[DEBUG][HASH_JOIN]"));
+        }
+        // With both indexed, the table with conditions of its own is the outer one
+        CHECK(session.run("CREATE INDEX ON o(uid);"));
+        {
+            CapturedOutput output;
+            check_joins(session);
+            CHECK(!output.contains("[DEBUG][HASH_JOIN]"));
+        }
+        CHECK_EQ(spill_files("db"), 0u);
+    }
+}
+
+int main() {
+    join_methods_agree();
+    return test_result();
+}
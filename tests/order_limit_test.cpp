@@ -0,0 +1,88 @@
+// ORDER BY with a LIMIT: an index on the sort column is walked in order and
+// stops at the limit, otherwise TopN keeps only the best rows. Either way
+// the rows are the first ones of the fully sorted result.
+#include "sql_session.h"
+
+namespace {
+    const int ROWS = 3000;
+
+    // t(id, name, score): name is indexed and unique, score is not indexed
+    // and has many ties
+    void create_table(SqlSession& session) {
+        CHECK(session.run("CREATE TABLE t (id INT, name VARCHAR, score INT, PRIMARY KEY(id));"));
+        CHECK(session.run("CREATE INDEX ON t(name);"));
+        for (int first = 0; first < ROWS; first += 500) {
+            string insert = "INSERT INTO t VALUES ";
+            for (int id = first; id < first + 500; ++id) {
+                if (id > first) insert += ", ";
+                insert += "(" + to_string(id) + ", 'n" + to_string(100000 + id * 7919 % ROWS) + "', " +
+                          to_string(id * 31 % 97) + ")";
+            }
+            CHECK(session.run(insert + ";"));
+        }
+    }
+
+    vector<vector<string>> rows_of(SqlSession& session, const string& sql) {
+        ResultSet result;
+        CHECK(session.run(sql, &result));
+        return result.rows;
+    }
+
+    // The rows of select + " LIMIT n" must be the first n of select
+    void check_limits(SqlSession& session, const string& select) {
+        vector<vector<string>> all = rows_of(session, select + ";");
+        for (size_t limit : {0, 1, 7, 100, 2500, ROWS + 10}) {
+            vector<vector<string>> first(all.begin(), all.begin() + min(limit, all.size()));
+            CHECK(rows_of(session, select + " LIMIT " + to_string(limit) + ";") == first);
+        }
+    }
+
+    void limits_take_the_first_rows() {
+        ScratchDirectory scratch("order_limit");
+        QuietOutput quiet;
+        Database::create("db");
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        create_table(session);
+
+        // Walks the name index
+        check_limits(session, "SELECT name, id FROM t ORDER BY name");
+        check_limits(session, "SELECT name, id FROM t ORDER BY name DESC");
+        check_limits(session, "SELECT name, id FROM t WHERE score < 10 ORDER BY name");
+        // TopN; id breaks the ties of score
+        check_limits(session, "SELECT score, id FROM t ORDER BY score, id");
+        check_limits(session, "SELECT score, id, name FROM t ORDER BY score DESC, id DESC");
+        check_limits(session, "SELECT id FROM t WHERE score > 50 ORDER BY score, id DESC");
+
+        vector<vector<string>> first = rows_of(session, "SELECT name FROM t ORDER BY name LIMIT 3;");
+        CHECK(first == (vector<vector<string>>{{"'n100000'"}, {"'n100001'"}, {"'n100002'"}}));
+        first = rows_of(session, "SELECT score FROM t ORDER BY score DESC LIMIT 1;");
+        CHECK(first == (vector<vector<string>>{{"96"}}));
+    }
+
+    // The index walk must see the rows as they are now, not as they were
+    // when the index entries were made.
+    void index_walk_sees_changed_rows() {
+        ScratchDirectory scratch("order_limit_changes");
+        QuietOutput quiet;
+        Database::create("db");
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        create_table(session);
+
+        CHECK(session.run("DELETE FROM t WHERE name < 'n100010';"));
+        CHECK(session.run("UPDATE t SET name = 'a' WHERE id = 1234;"));
+        CHECK(session.run("UPDATE t SET name = 'n100005' WHERE id = 42;"));
+        check_limits(session, "SELECT name, id FROM t ORDER BY name");
+        check_limits(session, "SELECT name, id FROM t ORDER BY name DESC");
+        vector<vector<string>> first = rows_of(session, "SELECT name, id FROM t ORDER BY name LIMIT 3;");
+        CHECK(first == (vector<vector<string>>{{"'a'", "1234"}, {"'n100005'", "42"}, {"'n100010'", "1790"}}));
+        CHECK_EQ(session.row_count("SELECT name FROM t ORDER BY name LIMIT 5000;"), size_t(ROWS - 10));
+    }
+}
+
+int main() {
+    limits_take_the_first_rows();
+    index_walk_sees_changed_rows();
+    return test_result();
+}
@@ -0,0 +1,118 @@
+// PostingList intersection and union give the same ids as std::set, for
+// every pairing of array and bitmap containers.
+#include "../include/posting_list.h"
+#include "test_util.h"
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+    const int PAGE = 1 << 16; // ids of one container share id / PAGE
+
+    // count ids from the container of page, spread over its 65536 slots;
+    // more than 4096 makes it a bitmap.
+    void add_ids(vector<int>& ids, int page, int count, mt19937& rng) {
+        set<int> slots;
+        while (static_cast<int>(slots.size()) < count) slots.insert(static_cast<int>(rng() % PAGE));
+        for (int slot : slots) ids.push_back(page * PAGE + slot);
+    }
+
+    vector<int> sorted_unique(vector<int> ids) {
+        set<int> unique(ids.begin(), ids.end());
+        return vector<int>(unique.begin(), unique.end());
+    }
+
+    void check_against_set(const vector<int>& a, const vector<int>& b) {
+        vector<int> left = sorted_unique(a), right = sorted_unique(b);
+        vector<int> expected_and, expected_or;
+        set_intersection(left.begin(), left.end(), right.begin(), right.end(), back_inserter(expected_and));
+        set_union(left.begin(), left.end(), right.begin(), right.end(), back_inserter(expected_or));
+
+        PostingList both(a);
+        both.intersect_with(PostingList(b));
+        CHECK(both.to_vector() == expected_and);
+        CHECK_EQ(both.size(), expected_and.size());
+
+        PostingList either(a);
+        either.union_with(PostingList(b));
+        CHECK(either.to_vector() == expected_or);
+        CHECK_EQ(either.size(), expected_or.size());
+
+        // Both directions give the same set
+        PostingList reversed(b);
+        reversed.intersect_with(PostingList(a));
+        CHECK(reversed.to_vector() == expected_and);
+        reversed = PostingList(b);
+        reversed.union_with(PostingList(a));
+        CHECK(reversed.to_vector() == expected_or);
+    }
+
+    void containers_of_every_kind() {
+        mt19937 rng(7);
+        const int ARRAY = 300, BITMAP = 20000;
+        vector<int> sizes = {ARRAY, BITMAP};
+        for (int a_size : sizes) {
+            for (int b_size : sizes) {
+                vector<int> a, b;
+                add_ids(a, 0, a_size, rng);
+                add_ids(b, 0, b_size, rng);
+                // Pages only one side has, and ids both sides share
+                add_ids(a, 1, a_size, rng);
+                add_ids(b, 2, b_size, rng);
+                for (int i = 0; i < 50; ++i) {
+                    a.push_back(3 * PAGE + i);
+                    b.push_back(3 * PAGE + i);
+                }
+                check_against_set(a, b);
+            }
+        }
+    }
+
+    void bitmap_intersections() {
+        vector<int> evens, multiples_of_3;
+        for (int slot = 0; slot < PAGE; slot += 2) evens.push_back(slot);
+        for (int slot = 0; slot < PAGE; slot += 3) multiples_of_3.push_back(slot);
+        check_against_set(evens, multiples_of_3);
+
+        // A bitmap ANDed with a few ids leaves an array
+        PostingList list(evens);
+        list.intersect_with(PostingList(vector<int>{4, 5, 6}));
+        CHECK((list.to_vector() == vector<int>{4, 6}));
+    }
+
+    void empty_and_disjoint() {
+        check_against_set({}, {1, 2, 3});
+        check_against_set({1, 2, 3}, {});
+        check_against_set({1, PAGE + 1}, {2, 2 * PAGE + 2});
+
+        PostingList list(vector<int>{5, 1, 5, 3});
+        CHECK_EQ(list.size(), 3u);
+        CHECK(list.contains(3));
+        CHECK(!list.add(3));
+        CHECK(list.remove(3));
+        CHECK(!list.contains(3));
+        CHECK((list.to_vector() == vector<int>{1, 5}));
+    }
+
+    void removing_shrinks_a_bitmap_back() {
+        vector<int> ids;
+        for (int slot = 0; slot < 5000; ++slot) ids.push_back(slot);
+        PostingList list(ids);
+        for (int slot = 100; slot < 5000; ++slot) CHECK(list.remove(slot));
+        CHECK_EQ(list.size(), 100u);
+        vector<int> expected(ids.begin(), ids.begin() + 100);
+        CHECK(list.to_vector() == expected);
+        list.union_with(PostingList(vector<int>{100}));
+        CHECK_EQ(list.size(), 101u);
+    }
+}
+
+int main() {
+    containers_of_every_kind();
+    bitmap_intersections();
+    empty_and_disjoint();
+    removing_shrinks_a_bitmap_back();
+    return test_result();
+}
@@ -0,0 +1,73 @@
+// Prepared statements and the plan cache: EXECUTE takes exactly the
+// parameters the statement has, and plans made before a table was dropped
+// and created again, or given an index, are made again for the new table.
+#include "sql_session.h"
+
+namespace {
+    void execute_checks_the_parameter_count() {
+        ScratchDirectory scratch("prepared_parameters");
+        QuietOutput quiet;
+        Database::create("db");
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        CHECK(session.run("CREATE TABLE t (id INT, name VARCHAR, PRIMARY KEY(id));"));
+        CHECK(session.run("INSERT INTO t (id, name) VALUES (1, 'one'), (2, 'two');"));
+        CHECK(session.run("PREPARE get AS SELECT name FROM t WHERE id = ?;"));
+        CHECK_EQ(session.value("EXECUTE get (2);"), "'two'");
+
+        CHECK(!session.run("EXECUTE get ();"));
+        CHECK(!session.run("EXECUTE get (1, 2);"));
+        CHECK(!session.run("EXECUTE get ('one');"));
+        CHECK(!session.run("SELECT name FROM t WHERE id = ?;"));
+        CHECK(!session.run("EXECUTE missing (1);"));
+        // The statement is still there after the failed calls
+        CHECK_EQ(session.value("EXECUTE get (1);"), "'one'");
+
+        CHECK(session.run("PREPARE put AS INSERT INTO t VALUES (?, ?);"));
+        CHECK(!session.run("EXECUTE put (3);"));
+        CHECK(session.run("EXECUTE put (3, 'three');"));
+        CHECK_EQ(session.value("EXECUTE get (3);"), "'three'");
+        CHECK(session.run("DEALLOCATE PREPARE put;"));
+        CHECK(!session.run("EXECUTE put (4, 'four');"));
+    }
+
+    void plans_follow_table_changes() {
+        ScratchDirectory scratch("prepared_ddl");
+        QuietOutput quiet;
+        Database::create("db");
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        CHECK(session.run("CREATE TABLE t (id INT, name VARCHAR, PRIMARY KEY(id));"));
+        CHECK(session.run("INSERT INTO t (id, name) VALUES (1, 'one'), (2, 'two');"));
+        CHECK(session.run("PREPARE get AS SELECT name FROM t WHERE id = ?;"));
+        CHECK_EQ(session.value("EXECUTE get (1);"), "'one'");
+        ResultSet rows;
+        CHECK(session.run("SELECT * FROM t;", &rows));
+        CHECK_EQ(rows.columns.size(), 2u);
+
+        // Same name, other columns: the cached plans must not be used
+        CHECK(session.run("DROP TABLE t;"));
+        CHECK(!session.run("SELECT * FROM t;"));
+        CHECK(!session.run("EXECUTE get (1);"));
+        CHECK(session.run("CREATE TABLE t (id INT, score INT, name VARCHAR, PRIMARY KEY(id));"));
+        CHECK(session.run("INSERT INTO t (id, score, name) VALUES (1, 10, 'uno'), (2, 20, 'dos'), (3, 20, 'tres');"));
+        CHECK(session.run("SELECT * FROM t;", &rows));
+        CHECK_EQ(rows.columns.size(), 3u);
+        CHECK_EQ(rows.rows.size(), 3u);
+        CHECK_EQ(session.value("EXECUTE get (1);"), "'uno'");
+
+        // A plan made before the index was created still finds every row
+        CHECK(session.run("PREPARE by_score AS SELECT COUNT(*) FROM t WHERE score = ?;"));
+        CHECK_EQ(session.value("EXECUTE by_score (20);"), "2");
+        CHECK(session.run("CREATE INDEX ON t(score);"));
+        CHECK(session.run("INSERT INTO t (id, score, name) VALUES (4, 20, 'cuatro');"));
+        CHECK_EQ(session.value("EXECUTE by_score (20);"), "3");
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM t WHERE score = 20;"), "3");
+    }
+}
+
+int main() {
+    execute_checks_the_parameter_count();
+    plans_follow_table_changes();
+    return test_result();
+}
@@ -0,0 +1,108 @@
+// SELECT through the operator tree: index lookups, filters and projection
+// give the rows and columns asked for, whichever access path answers the
+// WHERE, and ResultPrinter prints rows while they are still arriving.
+#include "../include/query/result_printer.h"
+#include "sql_session.h"
+#include <sstream>
+
+namespace {
+    const int ROWS = 300;
+
+    // t(id, name, score): name is indexed, score is not
+    void create_table(SqlSession& session) {
+        CHECK(session.run("CREATE TABLE t (id INT, name VARCHAR, score INT, PRIMARY KEY(id));"));
+        CHECK(session.run("CREATE INDEX ON t(name);"));
+        string insert = "INSERT INTO t (id, name, score) VALUES ";
+        for (int id = 0; id < ROWS; ++id) {
+            if (id > 0) insert += ", ";
+            insert += "(" + to_string(id) + ", 'n" + to_string(id % 10) + "', " + to_string(id % 7) + ")";
+        }
+        CHECK(session.run(insert + ";"));
+    }
+
+    size_t expected(bool (*matches)(int id)) {
+        size_t count = 0;
+        for (int id = 0; id < ROWS; ++id) {
+            if (matches(id)) count++;
+        }
+        return count;
+    }
+
+    void where_picks_the_rows() {
+        ScratchDirectory scratch("select_where");
+        QuietOutput quiet;
+        Database::create("db");
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        create_table(session);
+
+        // Answered by the indexes alone
+        CHECK_EQ(session.row_count("SELECT id FROM t WHERE name = 'n5' OR name = 'n7';"),
+                 expected([](int id) { return id % 10 == 5 || id % 10 == 7; }));
+        CHECK_EQ(session.row_count("SELECT id FROM t WHERE id >= 100 AND name = 'n3';"),
+                 expected([](int id) { return id >= 100 && id % 10 == 3; }));
+        // An index narrows the rows and a filter checks the rest
+        CHECK_EQ(session.row_count("SELECT id FROM t WHERE name = 'n2' AND score = 4;"),
+                 expected([](int id) { return id % 10 == 2 && id % 7 == 4; }));
+        // OR with an unindexed side reads the whole heap
+        CHECK_EQ(session.row_count("SELECT id FROM t WHERE name = 'n2' OR score = 4;"),
+                 expected([](int id) { return id % 10 == 2 || id % 7 == 4; }));
+        CHECK_EQ(session.row_count("SELECT id FROM t WHERE score != 0;"), expected([](int id) { return id % 7 != 0; }));
+        CHECK_EQ(session.row_count("SELECT id FROM t WHERE name = 'none';"), 0u);
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM t WHERE score = 6 AND id < 50;"),
+                 to_string(expected([](int id) { return id % 7 == 6 && id < 50; })));
+    }
+
+    void columns_come_in_the_order_asked() {
+        ScratchDirectory scratch("select_columns");
+        QuietOutput quiet;
+        Database::create("db");
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        create_table(session);
+
+        ResultSet rows;
+        CHECK(session.run("SELECT score, id FROM t WHERE id = 12;", &rows));
+        CHECK_EQ(rows.columns.size(), 2u);
+        CHECK_EQ(rows.rows.size(), 1u);
+        if (rows.rows.size() == 1) {
+            CHECK_EQ(rows.rows[0][0], "5");
+            CHECK_EQ(rows.rows[0][1], "12");
+        }
+        CHECK(session.run("SELECT * FROM t WHERE id = 12;", &rows));
+        CHECK_EQ(rows.columns.size(), 3u);
+        CHECK(rows.rows.size() == 1 && rows.rows[0][1] == "'n2'");
+
+        // A record_id that names no row matches nothing, which is no error
+        CHECK(session.run("DELETE FROM t WHERE record_id = 999999;"));
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM t;"), to_string(ROWS));
+    }
+
+    void rows_are_printed_as_they_arrive() {
+        ostringstream out;
+        ResultPrinter printer(out, {"id", "name"});
+        for (size_t i = 0; i + 1 < ResultPrinter::PREVIEW_ROWS; ++i) printer.add_row({to_string(i), "'x'"});
+        // Widths are still being worked out
+        CHECK(out.str().empty());
+        printer.add_row({"63", "'a much longer value'"});
+        string printed = out.str();
+        CHECK(printed.find("id") != string::npos);
+        CHECK(printed.find("'a much longer value'") != string::npos);
+        printer.add_row({"64", "'y'"});
+        CHECK(out.str().find("'y'") != string::npos);
+        printer.finish();
+        CHECK(out.str().size() > printed.size());
+
+        ostringstream empty;
+        ResultPrinter nothing(empty, {"id"});
+        nothing.finish();
+        CHECK(empty.str().find("No matching records") != string::npos);
+    }
+}
+
+int main() {
+    where_picks_the_rows();
+    columns_come_in_the_order_asked();
+    rows_are_printed_as_they_arrive();
+    return test_result();
+}
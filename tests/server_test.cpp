@@ -0,0 +1,97 @@
+// limbodb-server end to end: clients connect over the Unix socket and run
+// statements in sessions of their own, large results stream back in
+// several frames, and stop() closes every session, rolling back a
+// transaction one of them left open.
+#include "../include/server/client.h"
+#include "../include/server/server.h"
+#include "sql_session.h"
+#include <chrono>
+#include <thread>
+
+namespace {
+    // The server starts listening on its own thread; wait for it
+    bool connect(LimboClient& client, const string& path) {
+        for (int attempt = 0; attempt < 500; ++attempt) {
+            if (client.connect_unix(path)) return true;
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    // True if the statement got a reply and succeeded
+    bool run(LimboClient& client, const string& sql, QueryResult& result) {
+        return client.query(sql, result) && result.ok;
+    }
+
+    void sessions_run_until_stop() {
+        ScratchDirectory scratch("server");
+        QuietOutput quiet;
+        ServerOptions options;
+        options.socket_path = (scratch.path() / "limbodb.sock").string();
+        options.port = 0;
+        options.workers = 2;
+        Server server(options);
+        bool served = false;
+        thread serving([&] { served = server.run(); });
+
+        QueryResult result;
+        LimboClient a;
+        CHECK(connect(a, options.socket_path));
+        CHECK(run(a, "CREATE DATABASE db;", result));
+        CHECK(run(a, "USE db;", result));
+        CHECK(run(a, "CREATE TABLE t (id INT, name VARCHAR, PRIMARY KEY(id));", result));
+        CHECK(run(a, "INSERT INTO t (id, name) VALUES (1, 'one'), (2, 'two');", result));
+        CHECK(run(a, "SELECT id, name FROM t WHERE id >= 1;", result));
+        CHECK_EQ(result.columns.size(), 2u);
+        CHECK_EQ(result.rows.size(), 2u);
+        if (result.rows.size() == 2) CHECK_EQ(result.rows[1][1], "'two'");
+        CHECK(a.query("SELECT * FROM missing;", result));
+        CHECK(!result.ok);
+        CHECK(result.message.find("[ERROR]") != string::npos);
+
+        // A result of several ROWS frames arrives whole and in order
+        CHECK(run(a, "CREATE TABLE big (id INT, pad VARCHAR, PRIMARY KEY(id));", result));
+        const int big_rows = 20000;
+        string pad(100, 'x');
+        for (int first = 0; first < big_rows; first += 500) {
+            string insert = "INSERT INTO big (id, pad) VALUES ";
+            for (int id = first; id < first + 500; ++id) {
+                if (id > first) insert += ", ";
+                insert += "(" + to_string(id) + ", '" + pad + "')";
+            }
+            CHECK(run(a, insert + ";", result));
+        }
+        CHECK(run(a, "SELECT id, pad FROM big ORDER BY id;", result));
+        CHECK_EQ(result.rows.size(), static_cast<size_t>(big_rows));
+        bool in_order = true;
+        for (size_t i = 0; i < result.rows.size(); ++i) {
+            if (result.rows[i][0] != to_string(i)) in_order = false;
+        }
+        CHECK(in_order);
+        CHECK(run(a, "SELECT COUNT(*) FROM big;", result));
+        CHECK(!result.rows.empty() && result.rows[0][0] == to_string(big_rows));
+
+        // b still has its transaction open when the server stops
+        LimboClient b;
+        CHECK(connect(b, options.socket_path));
+        CHECK(run(b, "USE db;", result));
+        CHECK(run(b, "BEGIN;", result));
+        CHECK(run(b, "INSERT INTO t (id, name) VALUES (3, 'three');", result));
+        CHECK(run(b, "SELECT COUNT(*) FROM t;", result));
+        CHECK(!result.rows.empty() && result.rows[0][0] == "3");
+
+        server.stop();
+        serving.join();
+        CHECK(served);
+        CHECK(!a.query("SELECT COUNT(*) FROM t;", result));
+
+        Database database("db", DBConfig());
+        SqlSession session(database);
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM t;"), "2");
+    }
+}
+
+int main() {
+    sessions_run_until_stop();
+    return test_result();
+}
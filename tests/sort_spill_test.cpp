@@ -0,0 +1,92 @@
+// A Sort whose rows do not fit in work_mem_bytes writes sorted runs to the
+// database's temp directory and merges them, in several passes if there
+// are many. The rows come out as an in-memory sort gives them, ties in
+// input order, and no run is left behind.
+#include "sql_session.h"
+#include <stdexcept>
+
+namespace {
+    const int ROWS = 20000;
+
+    DBConfig tiny_work_mem() {
+        DBConfig config;
+        config.work_mem_bytes = 16 * 1024; // a run of about a hundred rows
+        return config;
+    }
+
+    void create_table(const string& name) {
+        Database::create(name);
+        Database database(name, DBConfig());
+        SqlSession session(database);
+        CHECK(session.run("CREATE TABLE t (id INT, score INT, note VARCHAR, PRIMARY KEY(id));"));
+        for (int first = 0; first < ROWS; first += 1000) {
+            string insert = "INSERT INTO t VALUES ";
+            for (int id = first; id < first + 1000; ++id) {
+                if (id > first) insert += ", ";
+                insert += "(" + to_string(id) + ", " + to_string(id * 7919 % 1009) + ", 'note" + to_string(id % 37) + "')";
+            }
+            CHECK(session.run(insert + ";"));
+        }
+    }
+
+    vector<vector<string>> rows_of(const string& name, const DBConfig& config, const string& sql) {
+        Database database(name, config);
+        SqlSession session(database);
+        ResultSet result;
+        CHECK(session.run(sql, &result));
+        return result.rows;
+    }
+
+    void spilled_sort_matches_in_memory_sort() {
+        ScratchDirectory scratch("sort_spill");
+        QuietOutput quiet;
+        create_table("db");
+
+        for (const char* sql : {"SELECT * FROM t ORDER BY score;", "SELECT id, note FROM t ORDER BY note DESC, score;",
+                                 "SELECT id FROM t WHERE score < 500 ORDER BY note, id DESC;"}) {
+            vector<vector<string>> in_memory = rows_of("db", DBConfig(), sql);
+            vector<vector<string>> spilled;
+            {
+                CapturedOutput output;
+                spilled = rows_of("db", tiny_work_mem(), sql);
+                CHECK(output.contains("[DEBUG][SORT] Spilled"));
+            }
+            CHECK_EQ(spilled.size(), in_memory.size());
+            CHECK(spilled == in_memory);
+            CHECK_EQ(spill_files("db"), 0u);
+        }
+
+        // Equal scores stay in id order, the order they were inserted in
+        vector<vector<string>> rows = rows_of("db", tiny_work_mem(), "SELECT score, id FROM t ORDER BY score;");
+        CHECK_EQ(rows.size(), size_t(ROWS));
+        bool in_order = true;
+        for (size_t i = 1; i < rows.size(); ++i) {
+            int score = stoi(rows[i][0]), previous = stoi(rows[i - 1][0]);
+            if (score < previous || (score == previous && stoi(rows[i][1]) < stoi(rows[i - 1][1]))) in_order = false;
+        }
+        CHECK(in_order);
+    }
+
+    // The runs go also when the rows are not all read: here the receiver
+    // of the result gives up after the first batch.
+    void abandoned_sort_removes_its_runs() {
+        ScratchDirectory scratch("sort_spill_abandoned");
+        QuietOutput quiet;
+        create_table("db");
+
+        Database database("db", tiny_work_mem());
+        SqlSession session(database);
+        ResultSet result;
+        result.batch_bytes = 1024;
+        result.on_batch = [](ResultSet&) { throw runtime_error("The client stopped reading the result."); };
+        CHECK(!session.run("SELECT * FROM t ORDER BY note;", &result));
+        CHECK_EQ(spill_files("db"), 0u);
+        CHECK_EQ(session.value("SELECT COUNT(*) FROM t;"), to_string(ROWS));
+    }
+}
+
+int main() {
+    spilled_sort_matches_in_memory_sort();
+    abandoned_sort_removes_its_runs();
+    return test_result();
+}
@@ -0,0 +1,103 @@
+// SqlParser: AND binds tighter than OR, parentheses override it, and text
+// that is not a statement is turned down with a message saying why.
+#include "../include/query/sql_parser.h"
+#include "test_util.h"
+
+namespace {
+    // WHERE of a SELECT, or nullptr after a failed check.
+    unique_ptr<Expr> parse_where(const string& condition) {
+        SqlParser parser;
+        Statement statement;
+        string error;
+        bool parsed = parser.parse("SELECT * FROM t WHERE " + condition + ";", statement, error);
+        CHECK(parsed);
+        if (!parsed) {
+            cerr << "  " << condition << ": " << error << endl;
+            return nullptr;
+        }
+        return std::move(get<SelectStatement>(statement).where);
+    }
+
+    bool is_compare(const Expr* expr, const string& column, CompareOp op, int64_t value) {
+        return expr && expr->kind == Expr::Kind::COMPARE && expr->column == column && expr->op == op &&
+               expr->value.kind == Literal::Kind::INTEGER && expr->value.int_value == value;
+    }
+
+    // Parsing fails, with a message that contains expected
+    void check_rejected(const string& sql, const string& expected) {
+        SqlParser parser;
+        Statement statement;
+        string error;
+        CHECK(!parser.parse(sql, statement, error));
+        if (error.find(expected) == string::npos) {
+            cerr << "  " << sql << ": error '" << error << "' does not mention '" << expected << "'" << endl;
+            CHECK(error.find(expected) != string::npos);
+        }
+    }
+
+    void and_binds_tighter_than_or() {
+        unique_ptr<Expr> where = parse_where("a = 1 OR b = 2 AND c = 3");
+        CHECK(where && where->kind == Expr::Kind::OR);
+        if (!where || where->kind != Expr::Kind::OR) return;
+        CHECK(is_compare(where->left.get(), "a", CompareOp::EQ, 1));
+        CHECK(where->right && where->right->kind == Expr::Kind::AND);
+        if (where->right) {
+            CHECK(is_compare(where->right->left.get(), "b", CompareOp::EQ, 2));
+            CHECK(is_compare(where->right->right.get(), "c", CompareOp::EQ, 3));
+        }
+
+        where = parse_where("a = 1 AND b = 2 OR c = 3");
+        CHECK(where && where->kind == Expr::Kind::OR);
+        if (where) CHECK(where->left && where->left->kind == Expr::Kind::AND);
+    }
+
+    void parentheses_group_first() {
+        unique_ptr<Expr> where = parse_where("(a = 1 OR b = 2) AND c = 3");
+        CHECK(where && where->kind == Expr::Kind::AND);
+        if (!where || where->kind != Expr::Kind::AND) return;
+        CHECK(where->left && where->left->kind == Expr::Kind::OR);
+        CHECK(is_compare(where->right.get(), "c", CompareOp::EQ, 3));
+    }
+
+    void operators_of_the_same_kind_group_left() {
+        unique_ptr<Expr> where = parse_where("a = 1 OR b = 2 OR c = 3");
+        CHECK(where && where->kind == Expr::Kind::OR);
+        if (!where) return;
+        CHECK(where->left && where->left->kind == Expr::Kind::OR);
+        CHECK(is_compare(where->right.get(), "c", CompareOp::EQ, 3));
+    }
+
+    void value_first_comparisons_are_flipped() {
+        unique_ptr<Expr> where = parse_where("5 > a");
+        CHECK(is_compare(where.get(), "a", CompareOp::LT, 5));
+        where = parse_where("5 <= a");
+        CHECK(is_compare(where.get(), "a", CompareOp::GE, 5));
+        where = parse_where("5 != a");
+        CHECK(is_compare(where.get(), "a", CompareOp::NE, 5));
+    }
+
+    void invalid_statements_are_rejected() {
+        check_rejected("", "expected a statement");
+        check_rejected("SELEC * FROM t", "expected a statement");
+        check_rejected("SELECT * FROM", "expected a table name but found end of input");
+        check_rejected("SELECT * FROM t WHERE", "but found end of input");
+        check_rejected("SELECT * FROM t WHERE a =", "but found end of input");
+        check_rejected("SELECT * FROM t WHERE a = 1 AND", "but found end of input");
+        check_rejected("SELECT * FROM t WHERE (a = 1 OR b = 2", "expected ')'");
+        check_rejected("SELECT * FROM t WHERE a = 1 b = 2", "expected end of statement but found 'b'");
+        check_rejected("SELECT * FROM t; SELECT * FROM t", "expected end of statement");
+        check_rejected("SELECT * FROM t WHERE a = 'open", "unterminated string");
+        check_rejected("SELECT * FROM t WHERE a # 1", "unexpected character '#'");
+        check_rejected("INSERT INTO t VALUES (1, 2", "expected ')'");
+        check_rejected("DELETE FROM t", "expected WHERE but found end of input");
+    }
+}
+
+int main() {
+    and_binds_tighter_than_or();
+    parentheses_group_first();
+    operators_of_the_same_kind_group_left();
+    value_first_comparisons_are_flipped();
+    invalid_statements_are_rejected();
+    return test_result();
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "../include/database.h"
+#include "test_util.h"
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <sys/wait.h>
+
+// One session on a Database, running statements the way the server does:
+// results collected instead of printed, end_statement after each one.
+class SqlSession {
+private:
+    Database& database;
+    unique_ptr<QueryParser> parser;
+
+public:
+    explicit SqlSession(Database& db) : database(db), parser(db.open_session()) {}
+
+    bool run(const string& sql, ResultSet* rows = nullptr) {
+        ResultSet ignored;
+        parser->set_result_set(rows ? rows : &ignored);
+        bool ok = parser->execute_query(sql);
+        parser->set_result_set(nullptr);
+        database.end_statement(*parser);
+        return ok;
+    }
+
+    // The single value a query such as SELECT COUNT(*) returns, as the
+    // result shows it (strings quoted), or "<error>" / "<no rows>".
+    string value(const string& sql) {
+        ResultSet rows;
+        if (!run(sql, &rows)) return "<error>";
+        if (rows.rows.empty() || rows.rows[0].empty()) return "<no rows>";
+        return rows.rows[0][0];
+    }
+
+    size_t row_count(const string& sql) {
+        ResultSet rows;
+        CHECK(run(sql, &rows));
+        return rows.rows.size();
+    }
+};
+
+// Files a sort, hash aggregate or hash join has left in the database's
+// temp directory (data/<name>/tmp)
+inline size_t spill_files(const string& name) {
+    fs::path dir = Database::path(name) + "/tmp";
+    if (!fs::exists(dir)) return 0;
+    return distance(fs::directory_iterator(dir), fs::directory_iterator());
+}
+
+// Runs work on the database in a child process that then exits without
+// closing anything: the files are left as a crash (kill -9) would leave
+// them. Checks that fail in the child fail the test.
+inline void crash_after(const string& name, const DBConfig& config, const function<void(Database&)>& work) {
+    cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+        Database* database = new Database(name, config); // never closed
+        work(*database);
+        _exit(test_detail::failures == 0 ? 0 : 1);
+    }
+    int status = 0;
+    CHECK(child > 0 && waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
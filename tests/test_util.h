@@ -0,0 +1,103 @@
+#pragma once
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Checks for the behaviour tests. Each test is an executable of its own
+// that runs its cases and returns test_result() from main, so ctest sees
+// it fail if any check did. A failed check reports itself and the case
+// carries on.
+namespace test_detail {
+    inline int failures = 0;
+
+    template <typename A, typename B>
+    void check_equal(const A& actual, const B& expected, const char* actual_text, const char* expected_text,
+                     const char* file, int line) {
+        if (actual == expected) return;
+        ostringstream message;
+        message << file << ":" << line << ": CHECK_EQ(" << actual_text << ", " << expected_text
+                << ") failed: got " << actual << ", expected " << expected;
+        cerr << message.str() << endl;
+        failures++;
+    }
+}
+
+#define CHECK(condition)                                                                          \
+    do {                                                                                          \
+        if (!(condition)) {                                                                       \
+            cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << endl;      \
+            test_detail::failures++;                                                              \
+        }                                                                                         \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    test_detail::check_equal((actual), (expected), #actual, #expected, __FILE__, __LINE__)
+
+inline int test_result() {
+    if (test_detail::failures == 0) return 0;
+    cerr << test_detail::failures << " check(s) failed." << endl;
+    return 1;
+}
+
+// Swallows what the engine prints to cout ([DEBUG] lines and results) for
+// as long as it lives, so a failing check is easy to find in the output.
+class QuietOutput {
+private:
+    class NullBuffer : public streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        streamsize xsputn(const char*, streamsize count) override { return count; }
+    };
+
+    NullBuffer null_buffer;
+    streambuf* console;
+
+public:
+    QuietOutput() : console(cout.rdbuf(&null_buffer)) {}
+    ~QuietOutput() { cout.rdbuf(console); }
+};
+
+// Collects what the engine prints to cout for as long as it lives, for
+// checks on its [DEBUG] lines.
+class CapturedOutput {
+private:
+    ostringstream text;
+    streambuf* console;
+
+public:
+    CapturedOutput() : console(cout.rdbuf(text.rdbuf())) {}
+    ~CapturedOutput() { cout.rdbuf(console); }
+
+    bool contains(const string& part) const { return text.str().find(part) != string::npos; }
+};
+
+// An empty directory under the system temp directory, made the working
+// directory (databases live under data/ there) until it is removed again.
+class ScratchDirectory {
+private:
+    fs::path previous;
+    fs::path dir;
+
+public:
+    explicit ScratchDirectory(const string& name)
+        : previous(fs::current_path()),
+          dir(fs::temp_directory_path() / ("limbodb_" + name + "_" + to_string(getpid()))) {
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        fs::current_path(dir);
+    }
+
+    ~ScratchDirectory() {
+        fs::current_path(previous);
+        std::error_code ec;
+        fs::remove_all(dir, ec);
+    }
+
+    const fs::path& path() const { return dir; }
+};
@@ -0,0 +1,129 @@
+// Sessions see committed data as of their snapshot, ROLLBACK takes a
+// transaction's changes back, and a statement that fails part way leaves
+// nothing behind.
+#include "sql_session.h"
+
+namespace {
+    string created(const string& name) {
+        Database::create(name);
+        return name;
+    }
+
+    // Two sessions on a new database with a table t of two rows, indexed
+    // on both columns.
+    struct TwoSessions {
+        ScratchDirectory scratch;
+        QuietOutput quiet;
+        Database database;
+        SqlSession a;
+        SqlSession b;
+
+        explicit TwoSessions(const string& name)
+            : scratch(name), database(created("db"), DBConfig()), a(database), b(database) {
+            CHECK(a.run("CREATE TABLE t (id INT, name VARCHAR, PRIMARY KEY(id));"));
+            CHECK(a.run("CREATE INDEX ON t(name);"));
+            CHECK(a.run("INSERT INTO t (id, name) VALUES (1, 'one'), (2, 'two');"));
+        }
+    };
+
+    void snapshots_see_committed_rows_only() {
+        TwoSessions db("snapshots");
+        CHECK(db.a.run("BEGIN;"));
+        CHECK(db.a.run("INSERT INTO t (id, name) VALUES (3, 'three');"));
+        CHECK(db.a.run("UPDATE t SET name = 'uno' WHERE id = 1;"));
+        // Its own changes are visible to the transaction, nobody else's
+        CHECK_EQ(db.a.value("SELECT COUNT(*) FROM t;"), "3");
+        CHECK_EQ(db.a.value("SELECT name FROM t WHERE id = 1;"), "'uno'");
+        CHECK_EQ(db.b.value("SELECT COUNT(*) FROM t;"), "2");
+        CHECK_EQ(db.b.value("SELECT name FROM t WHERE id = 1;"), "'one'");
+        CHECK_EQ(db.b.row_count("SELECT id FROM t WHERE name = 'uno';"), 0u);
+
+        // b's snapshot is taken at BEGIN and kept past a's COMMIT
+        CHECK(db.b.run("BEGIN;"));
+        CHECK(db.a.run("COMMIT;"));
+        CHECK_EQ(db.b.value("SELECT COUNT(*) FROM t;"), "2");
+        CHECK_EQ(db.b.value("SELECT name FROM t WHERE id = 1;"), "'one'");
+        CHECK_EQ(db.b.value("SELECT id FROM t WHERE name = 'one';"), "1");
+        CHECK(db.b.run("COMMIT;"));
+
+        CHECK_EQ(db.b.value("SELECT COUNT(*) FROM t;"), "3");
+        CHECK_EQ(db.b.value("SELECT name FROM t WHERE id = 1;"), "'uno'");
+        CHECK_EQ(db.b.row_count("SELECT id FROM t WHERE name = 'one';"), 0u);
+    }
+
+    void concurrent_updates_of_a_row_conflict() {
+        TwoSessions db("conflicts");
+        CHECK(db.a.run("BEGIN;"));
+        CHECK(db.a.run("UPDATE t SET name = 'first' WHERE id = 1;"));
+        CHECK(!db.b.run("UPDATE t SET name = 'second' WHERE id = 1;"));
+        CHECK(db.a.run("COMMIT;"));
+        CHECK_EQ(db.b.value("SELECT name FROM t WHERE id = 1;"), "'first'");
+    }
+
+    // A conflict on one of the rows fails the whole statement, leaving the
+    // rows it did change as they were
+    void conflict_on_some_rows_fails_the_update() {
+        TwoSessions db("partial_conflict");
+        CHECK(db.a.run("BEGIN;"));
+        CHECK(db.a.run("UPDATE t SET name = 'a' WHERE id = 2;"));
+        CHECK(!db.b.run("UPDATE t SET name = 'b' WHERE id >= 1;"));
+        CHECK_EQ(db.b.value("SELECT name FROM t WHERE id = 1;"), "'one'");
+        CHECK(db.a.run("ROLLBACK;"));
+        CHECK_EQ(db.b.row_count("SELECT id FROM t WHERE name = 'b';"), 0u);
+
+        // Matching no rows is not a failure
+        CHECK(db.b.run("UPDATE t SET name = 'b' WHERE id = 5;"));
+        CHECK(db.b.run("UPDATE t SET name = 'b' WHERE id >= 1;"));
+        CHECK_EQ(db.a.row_count("SELECT id FROM t WHERE name = 'b';"), 2u);
+    }
+
+    void rollback_takes_every_change_back() {
+        TwoSessions db("rollback");
+        CHECK(db.a.run("BEGIN;"));
+        CHECK(db.a.run("INSERT INTO t (id, name) VALUES (3, 'three');"));
+        CHECK(db.a.run("UPDATE t SET name = 'uno' WHERE id = 1;"));
+        CHECK(db.a.run("UPDATE t SET name = 'eins' WHERE id = 1;"));
+        CHECK(db.a.run("DELETE FROM t WHERE id = 2;"));
+        CHECK(db.a.run("ROLLBACK;"));
+
+        for (SqlSession* session : {&db.a, &db.b}) {
+            CHECK_EQ(session->value("SELECT COUNT(*) FROM t;"), "2");
+            CHECK_EQ(session->value("SELECT name FROM t WHERE id = 1;"), "'one'");
+            CHECK_EQ(session->value("SELECT name FROM t WHERE id = 2;"), "'two'");
+            CHECK_EQ(session->value("SELECT id FROM t WHERE name = 'one';"), "1");
+            CHECK_EQ(session->row_count("SELECT id FROM t WHERE name = 'eins';"), 0u);
+            CHECK_EQ(session->row_count("SELECT id FROM t WHERE id = 3;"), 0u);
+        }
+        // The rolled back keys can be used again
+        CHECK(db.b.run("INSERT INTO t (id, name) VALUES (3, 'drei');"));
+        CHECK_EQ(db.a.value("SELECT name FROM t WHERE id = 3;"), "'drei'");
+    }
+
+    void failed_statement_changes_nothing() {
+        TwoSessions db("failed_statement");
+        // The second row repeats a key: the first must not stay inserted
+        CHECK(!db.a.run("INSERT INTO t (id, name) VALUES (3, 'three'), (1, 'again');"));
+        CHECK_EQ(db.b.value("SELECT COUNT(*) FROM t;"), "2");
+        CHECK_EQ(db.b.row_count("SELECT id FROM t WHERE name = 'three';"), 0u);
+        CHECK_EQ(db.b.row_count("SELECT id FROM t WHERE id = 3;"), 0u);
+
+        // Inside a transaction only the failing statement is undone
+        CHECK(db.a.run("BEGIN;"));
+        CHECK(db.a.run("INSERT INTO t (id, name) VALUES (3, 'three');"));
+        CHECK(!db.a.run("INSERT INTO t (id, name) VALUES (4, 'four'), (2, 'again');"));
+        CHECK(db.a.run("COMMIT;"));
+        CHECK_EQ(db.b.value("SELECT COUNT(*) FROM t;"), "3");
+        CHECK_EQ(db.b.value("SELECT name FROM t WHERE id = 3;"), "'three'");
+        CHECK_EQ(db.b.row_count("SELECT id FROM t WHERE id = 4;"), 0u);
+        CHECK_EQ(db.b.row_count("SELECT id FROM t WHERE name = 'four';"), 0u);
+    }
+}
+
+int main() {
+    snapshots_see_committed_rows_only();
+    concurrent_updates_of_a_row_conflict();
+    conflict_on_some_rows_fails_the_update();
+    rollback_takes_every_change_back();
+    failed_statement_changes_nothing();
+    return test_result();
+}